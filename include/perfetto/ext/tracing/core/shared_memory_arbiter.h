@@ -142,6 +142,24 @@ class PERFETTO_EXPORT_COMPONENT SharedMemoryArbiter {
   // DataSourceDescriptor.will_notify_on_stop=true).
   virtual void SetBatchCommitsDuration(uint32_t batch_commits_duration_ms) = 0;
 
+  // Overrides the batching of the commits of the chunks written by the
+  // TraceWriter with the given |writer_id|. Args:
+  // |batch_commits_duration_ms|: if non-zero, the chunks of this writer are
+  // sent to the service at most this long after being returned, instead of
+  // after the duration set by SetBatchCommitsDuration(). Commits of other
+  // writers batched in the meantime are sent together with them.
+  // |batch_commits_size_bytes|: if non-zero, the batched commits are sent as
+  // soon as they add up to this size while they include chunks of this
+  // writer, instead of when they fill up half of the shared memory buffer.
+  //
+  // Passing zero for both removes the override. The override is also removed
+  // when the TraceWriter is destroyed. The same caveats as
+  // SetBatchCommitsDuration() apply to data that hasn't been sent yet at the
+  // end of a tracing session.
+  virtual void SetBatchCommitsForWriter(WriterID writer_id,
+                                        uint32_t batch_commits_duration_ms,
+                                        size_t batch_commits_size_bytes) = 0;
+
   // Called to enable direct producer-side patching of chunks that have not yet
   // been committed to the service. The return value indicates whether direct
   // patching was successfully enabled. It will be true if
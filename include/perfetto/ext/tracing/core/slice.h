@@ -58,6 +58,10 @@ struct Slice {
     return own_data_.get();
   }
 
+  // Returns false if the slice points to memory owned by somebody else (e.g.
+  // the TraceBuffer), true if it was created via Allocate() / TakeOwnership().
+  bool has_own_data() const { return !!own_data_; }
+
   const void* start;
   size_t size;
 
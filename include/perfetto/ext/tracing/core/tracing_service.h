@@ -313,6 +313,11 @@ struct PERFETTO_EXPORT_COMPONENT TracingServiceInitOpts {
   using CompressorFn = void (*)(std::vector<TracePacket>*);
   CompressorFn compressor_fn = nullptr;
 
+  // Same as |compressor_fn|, but used for COMPRESSION_TYPE_ZSTD. The second
+  // argument is TraceConfig.compression_level (0 if unset).
+  using LevelCompressorFn = void (*)(std::vector<TracePacket>*, int);
+  LevelCompressorFn zstd_compressor_fn = nullptr;
+
   // Whether the relay endpoint is enabled on producer transport(s).
   bool enable_relay_endpoint = false;
 
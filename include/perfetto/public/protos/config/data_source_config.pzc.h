@@ -150,6 +150,16 @@ PERFETTO_PB_FIELD(perfetto_protos_DataSourceConfig,
                   perfetto_protos_ProtoVmConfig,
                   protovm_config,
                   12);
+PERFETTO_PB_FIELD(perfetto_protos_DataSourceConfig,
+                  VARINT,
+                  uint32_t,
+                  commit_batching_period_ms,
+                  13);
+PERFETTO_PB_FIELD(perfetto_protos_DataSourceConfig,
+                  VARINT,
+                  uint32_t,
+                  commit_batching_size_kb,
+                  14);
 PERFETTO_PB_FIELD(perfetto_protos_DataSourceConfig,
                   MSG,
                   perfetto_protos_FtraceConfig,
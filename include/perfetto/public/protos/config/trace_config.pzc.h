@@ -61,6 +61,8 @@ PERFETTO_PB_ENUM_IN_MSG(perfetto_protos_TraceConfig, CompressionType){
                                   COMPRESSION_TYPE_UNSPECIFIED) = 0,
     PERFETTO_PB_ENUM_IN_MSG_ENTRY(perfetto_protos_TraceConfig,
                                   COMPRESSION_TYPE_DEFLATE) = 1,
+    PERFETTO_PB_ENUM_IN_MSG_ENTRY(perfetto_protos_TraceConfig,
+                                  COMPRESSION_TYPE_ZSTD) = 2,
 };
 
 PERFETTO_PB_ENUM_IN_MSG(perfetto_protos_TraceConfig, StatsdLogging){
@@ -274,6 +276,11 @@ PERFETTO_PB_FIELD(perfetto_protos_TraceConfig,
                   enum perfetto_protos_TraceConfig_CompressionType,
                   compression_type,
                   24);
+PERFETTO_PB_FIELD(perfetto_protos_TraceConfig,
+                  VARINT,
+                  int32_t,
+                  compression_level,
+                  47);
 PERFETTO_PB_FIELD(perfetto_protos_TraceConfig,
                   MSG,
                   perfetto_protos_TraceConfig_IncidentReportConfig,
@@ -344,6 +351,11 @@ PERFETTO_PB_FIELD(perfetto_protos_TraceConfig,
                   perfetto_protos_TraceConfig_Note,
                   notes,
                   46);
+PERFETTO_PB_FIELD(perfetto_protos_TraceConfig,
+                  VARINT,
+                  uint32_t,
+                  file_write_queue_size_kb,
+                  48);
 
 PERFETTO_PB_MSG(perfetto_protos_TraceConfig_Note);
 PERFETTO_PB_FIELD(perfetto_protos_TraceConfig_Note,
@@ -219,6 +219,54 @@ struct PERFETTO_EXPORT_COMPONENT Config {
   // When provided, trace processor will remove all rows older than
   // (latest_ts - window_size_ns) from its internal tables.
   uint64_t window_size_ns = 0;
+
+  // The number of worker threads trace processor can use to parallelize the
+  // CPU-heavy parts of trace ingestion. Currently this is used to decompress
+  // the |compressed_packets| of proto traces concurrently: tokenization,
+  // sorting and parsing still happen on the thread calling Parse() so the
+  // resulting tables are identical to single-threaded ingestion.
+  //
+  // 0 (the default) disables multi-threaded ingestion.
+  uint32_t ingestion_thread_count = 0;
+
+  // The number of worker threads trace processor can use to execute a single
+  // query over a large table in parallel. Currently this is used for scans
+  // over tables which only filter rows (i.e. without sorting, DISTINCT or
+  // LIMIT): the rows are split into ranges which are filtered concurrently and
+  // the results are returned in the same order as with serial execution.
+  //
+  // 0 (the default) disables parallel query execution.
+  uint32_t query_thread_count = 0;
+
+  // When set to true, integer columns of the tables built during trace
+  // loading are compressed once the trace has been fully parsed: columns with
+  // few distinct values are dictionary encoded and columns whose values span
+  // a small range (e.g. sorted timestamps) are stored as offsets from their
+  // minimum. Filters are evaluated directly on the compressed values.
+  //
+  // This reduces memory usage at the cost of some extra work for queries
+  // which sort or aggregate compressed columns.
+  bool enable_column_compression = false;
+
+  // When set to true, queries passed to ExecuteQuery() which only select,
+  // filter and sort the columns of a single table (i.e. SELECT ... FROM table
+  // [WHERE ...] [ORDER BY ...] [LIMIT ...], with literals as the filter
+  // values) are executed directly on the table, bypassing SQLite: rows are
+  // returned in batches instead of one SQLite virtual table call per cell.
+  // All other queries are executed by SQLite as usual.
+  bool enable_dataframe_scans = false;
+
+  // If non-empty, the directory used to cache the tables created by the
+  // standard library modules across trace processor instances. Tables only
+  // depend on the contents of the trace and on the module sources so, once
+  // one instance has computed them, other instances loading the same trace
+  // with the same standard library reload them from this directory when the
+  // module is included. Hits and misses are reported by the
+  // module_cache_stats table. If |query_thread_count| is also set, the tables
+  // of included modules and of their dependencies are loaded in parallel.
+  // Entries are keyed by the version of trace processor: builds without
+  // version information should not share a directory with other builds.
+  std::string module_cache_dir;
 };
 
 // Represents a dynamically typed value returned by SQL.
@@ -91,10 +91,12 @@ class PERFETTO_EXPORT_COMPONENT Iterator {
   base::Status Status();
 
  private:
+  friend class ArrowQueryResultSerializer;
   friend class QueryResultSerializer;
 
-  // This is to allow QueryResultSerializer, which is very perf sensitive, to
-  // access direct the impl_ and avoid one extra function call for each cell.
+  // This is to allow QueryResultSerializer (and ArrowQueryResultSerializer),
+  // which are very perf sensitive, to access direct the impl_ and avoid one
+  // extra function call for each cell.
   template <typename T = IteratorImpl>
   std::unique_ptr<T> take_impl() {
     return std::move(iterator_);
@@ -185,6 +185,20 @@ class PERFETTO_EXPORT_COMPONENT TraceProcessor : public TraceProcessorStorage {
   // NOTE: No Iterators can active when called.
   virtual size_t RestoreInitialTables() = 0;
 
+  // Writes a snapshot of all the tables populated while parsing the trace to
+  // |path|. Must be called after NotifyEndOfFile(). Objects created by SQL
+  // queries are not included.
+  //
+  // Loading a snapshot with LoadSnapshot() is much faster than parsing the
+  // original trace as tables are copied in bulk rather than reconstructed.
+  virtual base::Status SaveSnapshot(const std::string& path) = 0;
+
+  // Loads a snapshot previously written by SaveSnapshot(). Must be called on a
+  // new instance in place of Parse() and NotifyEndOfFile(). Returns an error,
+  // leaving this instance untouched, if the snapshot was written by an
+  // incompatible version of trace processor.
+  virtual base::Status LoadSnapshot(const std::string& path) = 0;
+
   // =================================================================
   // |  Trace-based metrics (v1) related functionality starts here   |
   // =================================================================
@@ -25,6 +25,7 @@
 #include "perfetto/tracing/event_context.h"
 #include "perfetto/tracing/internal/track_event_internal.h"
 #include "perfetto/tracing/internal/track_event_legacy.h"
+#include "perfetto/tracing/internal/track_event_process_interning.h"
 #include "perfetto/tracing/internal/write_track_event_args.h"
 #include "perfetto/tracing/track.h"
 #include "perfetto/tracing/track_event_category_registry.h"
@@ -32,6 +33,7 @@
 #include "protos/perfetto/config/track_event/track_event_config.gen.h"
 #include "protos/perfetto/trace/track_event/track_event.pbzero.h"
 
+#include <memory>
 #include <type_traits>
 
 namespace perfetto {
@@ -251,6 +253,8 @@ class PERFETTO_EXPORT_COMPONENT TrackEventDataSource
     auto config_raw = args.config->track_event_config_raw();
     bool ok = config_.ParseFromArray(config_raw.data(), config_raw.size());
     PERFETTO_DCHECK(ok);
+    if (config_.enable_process_interning())
+      SetUpProcessInterning(args);
     TrackEventInternal::GetInstance().EnableTracing(config_, args);
   }
 
@@ -262,8 +266,15 @@ class PERFETTO_EXPORT_COMPONENT TrackEventDataSource
     uint32_t internal_instance_index = args.internal_instance_index;
     inner_stop_args.internal_instance_index = internal_instance_index;
     inner_stop_args.async_stop_closure = [internal_instance_index,
-                                          outer_stop_closure] {
+                                          outer_stop_closure,
+                                          process_interning =
+                                              process_interning_] {
       TrackEventInternal::GetInstance().DisableTracing(internal_instance_index);
+      // The data source doesn't handle flushes (see no_flush): like the
+      // thread sequences, the shared interning sequence relies on the service
+      // scraping the shared memory buffer until then.
+      if (process_interning)
+        process_interning->Flush();
       outer_stop_closure();
     };
 
@@ -277,6 +288,8 @@ class PERFETTO_EXPORT_COMPONENT TrackEventDataSource
 
   void WillClearIncrementalState(
       const DataSourceBase::ClearIncrementalStateArgs& args) override {
+    if (process_interning_)
+      process_interning_->OnIncrementalStateCleared();
     TrackEventInternal::WillClearIncrementalState(args);
   }
 
@@ -360,13 +373,24 @@ class PERFETTO_EXPORT_COMPONENT TrackEventDataSource
 
   const protos::gen::TrackEventConfig& GetConfig() const { return config_; }
 
+  // Returns nullptr unless TrackEventConfig.enable_process_interning is set.
+  std::shared_ptr<TrackEventProcessInterning> GetProcessInterning() const {
+    return process_interning_;
+  }
+
   static void ResetForTesting() {
     TrackEventInternal::GetInstance().ResetRegistriesForTesting();
   }
 
  private:
+  void SetUpProcessInterning(const DataSourceBase::SetupArgs& args);
+
   // Config for the current tracing session.
   protos::gen::TrackEventConfig config_;
+
+  // Shared with the TrackEventTlsState of the threads that trace into this
+  // instance.
+  std::shared_ptr<TrackEventProcessInterning> process_interning_;
 };
 
 template <const TrackEventCategoryRegistry* Registry>
@@ -113,6 +113,7 @@ class PERFETTO_EXPORT_COMPONENT TrackEventTlsStateUserData {
 
 namespace internal {
 class TrackEventCategoryRegistry;
+class TrackEventProcessInterning;
 
 class PERFETTO_EXPORT_COMPONENT BaseTrackEventInternedDataIndex {
  public:
@@ -134,6 +135,9 @@ struct TrackEventTlsState {
   uint64_t timestamp_unit_multiplier = 1;
   uint32_t default_clock;
   std::map<const void*, std::unique_ptr<TrackEventTlsStateUserData>> user_data;
+  // Set when TrackEventConfig.enable_process_interning is enabled. Keeps the
+  // dictionary alive for as long as this thread can write into it.
+  std::shared_ptr<TrackEventProcessInterning> process_interning;
 };
 
 struct TrackEventIncrementalState {
@@ -172,6 +176,11 @@ struct TrackEventIncrementalState {
   std::array<InternedDataIndex, kMaxInternedDataFields> interned_data_indices =
       {};
 
+  // Process-wide dictionary used instead of |interned_data_indices| for the
+  // values that are interned by address, if enabled. Owned by the
+  // TrackEventTlsState of the same data source instance.
+  TrackEventProcessInterning* process_interning = nullptr;
+
   // Track uuids for which we have written descriptors into the trace. If a
   // trace event uses a track which is not in this set, we'll write out a
   // descriptor for it.
@@ -406,6 +415,7 @@ TrackEventTlsState::TrackEventTlsState(const TraceContext& trace_context) {
     if (config.has_timestamp_unit_multiplier()) {
       timestamp_unit_multiplier = config.timestamp_unit_multiplier();
     }
+    process_interning = locked_ds->GetProcessInterning();
   }
   if (disable_incremental_timestamps) {
     if (timestamp_unit_multiplier == 1) {
@@ -35,6 +35,8 @@ struct PERFETTO_EXPORT_COMPONENT InternedEventCategory
           SmallInternedDataTraits> {
   ~InternedEventCategory() override;
 
+  static constexpr bool kSupportsProcessInterning = true;
+
   static void Add(protos::pbzero::InternedData* interned_data,
                   size_t iid,
                   const char* value,
@@ -49,6 +51,8 @@ struct PERFETTO_EXPORT_COMPONENT InternedEventName
           SmallInternedDataTraits> {
   ~InternedEventName() override;
 
+  static constexpr bool kSupportsProcessInterning = true;
+
   static void Add(protos::pbzero::InternedData* interned_data,
                   size_t iid,
                   const char* value);
@@ -63,6 +67,8 @@ struct PERFETTO_EXPORT_COMPONENT InternedDebugAnnotationName
           SmallInternedDataTraits> {
   ~InternedDebugAnnotationName() override;
 
+  static constexpr bool kSupportsProcessInterning = true;
+
   static void Add(protos::pbzero::InternedData* interned_data,
                   size_t iid,
                   const char* value);
@@ -77,6 +83,8 @@ struct PERFETTO_EXPORT_COMPONENT InternedDebugAnnotationValueTypeName
           SmallInternedDataTraits> {
   ~InternedDebugAnnotationValueTypeName() override;
 
+  static constexpr bool kSupportsProcessInterning = true;
+
   static void Add(protos::pbzero::InternedData* interned_data,
                   size_t iid,
                   const char* value);
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_PERFETTO_TRACING_INTERNAL_TRACK_EVENT_PROCESS_INTERNING_H_
+#define INCLUDE_PERFETTO_TRACING_INTERNAL_TRACK_EVENT_PROCESS_INTERNING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "perfetto/base/export.h"
+#include "perfetto/protozero/message_handle.h"
+#include "perfetto/tracing/trace_writer_base.h"
+#include "protos/perfetto/trace/interned_data/interned_data.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+namespace internal {
+
+// Process-wide interning dictionary of a track event data source instance,
+// used when TrackEventConfig.enable_process_interning is set.
+//
+// Values are keyed by address, so only interned data indices that key by
+// pointer (e.g. static strings of event names and categories) use it. Each
+// value is emitted once on a dedicated sequence, with the
+// SEQ_SHARED_INTERNED_DATA flag, and all the threads refer to it with the
+// same interning id, instead of every thread emitting it again on its own
+// sequence.
+//
+// Lookups (Find()) are lock-free and don't write to shared memory, so the
+// threads that trace hit the dictionary without contention. Insertions take a
+// lock, which also serializes the writes on the shared TraceWriter. The
+// dictionary is an open-addressing table that is never rehashed: when it is
+// half full, a table twice as big is chained after it, and lookups walk the
+// (few) tables in order.
+//
+// When the incremental state of the data source is cleared, values are
+// emitted again the next time they are used, with the same interning id, so
+// that they survive the wrapping of ring buffers.
+class PERFETTO_EXPORT_COMPONENT TrackEventProcessInterning {
+ public:
+  explicit TrackEventProcessInterning(
+      std::unique_ptr<TraceWriterBase> trace_writer);
+  ~TrackEventProcessInterning();
+
+  TrackEventProcessInterning(const TrackEventProcessInterning&) = delete;
+  TrackEventProcessInterning& operator=(const TrackEventProcessInterning&) =
+      delete;
+
+  // Returns the interning id of |value| for the InternedData field
+  // |field_number|, or 0 if the value needs to be (re-)emitted with Intern().
+  size_t Find(size_t field_number, const void* value) const {
+    uint64_t hash = Hash(field_number, value);
+    uint32_t generation = generation_.load(std::memory_order_relaxed);
+    for (const Table* table = first_table_.load(std::memory_order_acquire);
+         table; table = table->next.load(std::memory_order_acquire)) {
+      for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        const Slot& slot = table->slots[i];
+        const void* slot_value = slot.value.load(std::memory_order_acquire);
+        if (!slot_value)
+          break;
+        if (slot_value == value && slot.field_number == field_number) {
+          if (slot.generation.load(std::memory_order_acquire) != generation)
+            return 0;
+          return slot.iid;
+        }
+      }
+    }
+    return 0;
+  }
+
+  // Returns the interning id of |value|, emitting it on the shared sequence
+  // first if needed. |add| is called with the InternedData message to write
+  // the value into and its interning id.
+  template <typename AddFunction>
+  size_t Intern(size_t field_number, const void* value, AddFunction add) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot* slot = FindOrInsertLocked(field_number, value);
+    uint32_t generation = generation_.load(std::memory_order_relaxed);
+    if (slot->generation.load(std::memory_order_relaxed) != generation) {
+      {
+        auto packet = NewTracePacketLocked();
+        add(packet->set_interned_data(), slot->iid);
+      }
+      slot->generation.store(generation, std::memory_order_release);
+    }
+    return slot->iid;
+  }
+
+  // Identifies the shared sequence in the TracePacketDefaults of the
+  // sequences that refer to it.
+  uint64_t scope() const { return scope_; }
+
+  // Values are emitted again the next time they are used.
+  void OnIncrementalStateCleared();
+
+  void Flush();
+
+ private:
+  struct Slot {
+    // |field_number| and |iid| are written before |value| is published and
+    // never change afterwards.
+    std::atomic<const void*> value{nullptr};
+    size_t field_number = 0;
+    size_t iid = 0;
+    // The incremental state generation in which the value was last emitted.
+    std::atomic<uint32_t> generation{0};
+  };
+
+  struct Table {
+    explicit Table(size_t capacity);
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    // Guarded by |mutex_|.
+    size_t size = 0;
+    std::atomic<Table*> next{nullptr};
+  };
+
+  static uint64_t Hash(size_t field_number, const void* value) {
+    uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+    hash ^= static_cast<uint64_t>(field_number) << 56;
+    hash *= 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 32);
+  }
+
+  Slot* FindOrInsertLocked(size_t field_number, const void* value);
+  protozero::MessageHandle<protos::pbzero::TracePacket> NewTracePacketLocked();
+
+  const uint64_t scope_;
+  std::atomic<uint32_t> generation_{1};
+  std::atomic<Table*> first_table_{nullptr};
+
+  std::mutex mutex_;
+  // All the following fields are guarded by |mutex_|.
+  std::unique_ptr<TraceWriterBase> trace_writer_;
+  std::vector<std::unique_ptr<Table>> tables_;
+  // Next interning id for each InternedData field.
+  std::map<size_t, size_t> next_iids_;
+  // The generation of the last packet written on the shared sequence.
+  uint32_t packet_generation_ = 0;
+};
+
+}  // namespace internal
+}  // namespace perfetto
+
+#endif  // INCLUDE_PERFETTO_TRACING_INTERNAL_TRACK_EVENT_PROCESS_INTERNING_H_
@@ -21,6 +21,7 @@
 
 #include "perfetto/base/compiler.h"
 #include "perfetto/tracing/event_context.h"
+#include "perfetto/tracing/internal/track_event_process_interning.h"
 
 #include <map>
 #include <type_traits>
@@ -183,6 +184,33 @@ class TrackEventInternedDataIndex
   static size_t Get(internal::TrackEventIncrementalState* incremental_state,
                     const ValueType& value,
                     Args&&... add_args) {
+    // The indices of the SDK itself, which intern static strings by address,
+    // can be shared by all the threads of the process (see
+    // TrackEventConfig.enable_process_interning).
+    if constexpr (InternedDataType::kSupportsProcessInterning) {
+      static_assert(std::is_pointer<ValueType>::value &&
+                        std::is_same<Traits, SmallInternedDataTraits>::value,
+                    "Only indices keyed by address can be shared");
+      internal::TrackEventProcessInterning* process_interning =
+          incremental_state->process_interning;
+      if (process_interning) {
+#if PERFETTO_DCHECK_IS_ON()
+        // The shared interning ids would collide with those of another type
+        // interned per thread under the same field.
+        GetOrCreateIndexForField(incremental_state);
+#endif
+        size_t iid = process_interning->Find(FieldNumber, value);
+        if (PERFETTO_LIKELY(iid))
+          return iid;
+        return process_interning->Intern(
+            FieldNumber, value,
+            [&](protos::pbzero::InternedData* interned_data, size_t new_iid) {
+              InternedDataType::Add(interned_data, new_iid, value,
+                                    std::forward<Args>(add_args)...);
+            });
+      }
+    }
+
     // First check if the value exists in the dictionary.
     auto index_for_field = GetOrCreateIndexForField(incremental_state);
     size_t iid;
@@ -202,6 +230,10 @@ class TrackEventInternedDataIndex
   }
 
  protected:
+  // Set to true by the interned data types of the SDK whose values are shared
+  // by all the threads when TrackEventConfig.enable_process_interning is set.
+  static constexpr bool kSupportsProcessInterning = false;
+
   // Some use cases require a custom Get implemention, so they need access to
   // GetOrCreateIndexForField + the returned index.
   static InternedDataType* GetOrCreateIndexForField(
@@ -143,10 +143,11 @@ LazyKernelSymbolizer::LazyKernelSymbolizer() = default;
 LazyKernelSymbolizer::~LazyKernelSymbolizer() = default;
 
 KernelSymbolMap* LazyKernelSymbolizer::GetOrCreateKernelSymbolMap() {
-  PERFETTO_DCHECK_THREAD(thread_checker_);
   if (symbol_map_)
     return symbol_map_.get();
 
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+
   symbol_map_ = std::make_unique<KernelSymbolMap>();
 
   // Android platform builds: we have an fd from init.
@@ -44,6 +44,9 @@ class LazyKernelSymbolizer {
   ~LazyKernelSymbolizer();
 
   // Returns |instance_|, creating it if doesn't exist or was destroyed.
+  // Creation must happen on the owner thread. Once created, the map is only
+  // read, so other threads (e.g. ftrace reader threads) can call this too, as
+  // long as the owner thread doesn't Destroy() it meanwhile.
   KernelSymbolMap* GetOrCreateKernelSymbolMap();
 
   bool is_valid() const { return !!symbol_map_; }
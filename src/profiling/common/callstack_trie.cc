@@ -25,12 +25,25 @@
 namespace perfetto {
 namespace profiling {
 
+GlobalCallstackTrie::GlobalCallstackTrie(uint32_t shard, uint32_t num_shards)
+    : string_interner_(1 + shard, num_shards),
+      mapping_interner_(1 + shard, num_shards),
+      frame_interner_(1 + shard, num_shards),
+      callstack_id_stride_(num_shards) {
+  PERFETTO_CHECK(shard < num_shards);
+  // root_ has taken ID 1. The first child of this shard gets
+  // 1 + shard + num_shards.
+  next_callstack_id_ = 1 + shard;
+}
+
 GlobalCallstackTrie::Node* GlobalCallstackTrie::GetOrCreateChild(
     Node* self,
     const Interned<Frame>& loc) {
   Node* child = self->GetChild(loc);
-  if (!child)
-    child = self->AddChild(loc, ++next_callstack_id_, self);
+  if (!child) {
+    next_callstack_id_ += callstack_id_stride_;
+    child = self->AddChild(loc, next_callstack_id_, self);
+  }
   return child;
 }
 
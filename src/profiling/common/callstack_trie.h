@@ -145,6 +145,11 @@ class GlobalCallstackTrie {
   };
 
   GlobalCallstackTrie() = default;
+  // Creates the |shard|-th of |num_shards| tries whose callstack, frame,
+  // mapping and string IDs are disjoint, so that callstacks from different
+  // tries can be emitted in the same trace sequence. The root callsite has ID
+  // 1 in all of them.
+  GlobalCallstackTrie(uint32_t shard, uint32_t num_shards);
   ~GlobalCallstackTrie() = default;
   GlobalCallstackTrie(const GlobalCallstackTrie&) = delete;
   GlobalCallstackTrie& operator=(const GlobalCallstackTrie&) = delete;
@@ -183,6 +188,7 @@ class GlobalCallstackTrie {
   Interner<Frame> frame_interner_;
 
   uint64_t next_callstack_id_ = 0;
+  uint64_t callstack_id_stride_ = 1;
 
   // Note: profile_module in trace processor relies on the value of this root
   // callsite being exactly "1". See the perf_sample parsing code.
@@ -54,6 +54,13 @@ class Interner {
   };
 
  public:
+  Interner() = default;
+  // Hands out the IDs |first_id|, |first_id| + |id_stride|, ... instead of
+  // 1, 2, .... Several interners that use the same stride and different first
+  // IDs never hand out the same ID, so their output can share one ID space.
+  Interner(InternID first_id, InternID id_stride)
+      : next_id(first_id), id_stride_(id_stride) {}
+
   class Interned {
    public:
     friend class Interner<T>;
@@ -104,7 +111,7 @@ class Interner {
       // This does not invalidate pointers to entries we hold in Interned. See
       // https://timsong-cpp.github.io/cppwp/n3337/unord.req#8
       auto it_and_inserted = entries_.emplace(std::move(item));
-      next_id++;
+      next_id += id_stride_;
       it = it_and_inserted.first;
       PERFETTO_DCHECK(it_and_inserted.second);
     }
@@ -124,6 +131,7 @@ class Interner {
   }
 
   InternID next_id = 1;
+  InternID id_stride_ = 1;
   std::unordered_set<Entry, typename Entry::Hash> entries_;
   static_assert(sizeof(Interned) == sizeof(void*),
                 "interned things should be small");
@@ -128,6 +128,20 @@ TEST(InternerStringTest, IdsConsecutive) {
   ASSERT_EQ(interner.entry_count_for_testing(), 0u);
 }
 
+TEST(InternerStringTest, IdsStrided) {
+  Interner<std::string> interner(/*first_id=*/2, /*id_stride=*/3);
+  Interner<std::string> other_interner(/*first_id=*/3, /*id_stride=*/3);
+  {
+    Interned<std::string> interned_str = interner.Intern("foo");
+    Interned<std::string> other_interned_str = interner.Intern("bar");
+    Interned<std::string> other_foo = other_interner.Intern("foo");
+    EXPECT_EQ(interned_str.id(), 2u);
+    EXPECT_EQ(other_interned_str.id(), 5u);
+    EXPECT_EQ(other_foo.id(), 3u);
+  }
+  ASSERT_EQ(interner.entry_count_for_testing(), 0u);
+}
+
 }  // namespace
 }  // namespace profiling
 }  // namespace perfetto
@@ -52,6 +52,17 @@ namespace {
 const char kSingleByte[1] = {'x'};
 constexpr auto kResendBackoffUs = 100;
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ARCH_CPU_ARM64) || \
+    PERFETTO_BUILDFLAG(PERFETTO_ARCH_CPU_X86_64)
+constexpr bool kFramePointerUnwindingSupported = true;
+#else
+constexpr bool kFramePointerUnwindingSupported = false;
+#endif
+constexpr size_t kMaxFramePointerFrames = 256;
+// After this many samples with a broken frame pointer chain, the client always
+// sends stack copies.
+constexpr uint32_t kMaxFramePointerFailures = 16;
+
 inline bool IsMainThread() {
   return getpid() == base::GetThreadId();
 }
@@ -67,6 +78,41 @@ bool Contained(const StackRange& base, const char* ptr) {
 
 }  // namespace
 
+// Walks the chain of frame records starting at |frame|, storing the return
+// addresses into |pcs|. On arm64 and x86_64, a frame record is the frame
+// pointer of the caller followed by the return address.
+//
+// Returns the number of return addresses, or 0 if the chain leaves the stack
+// (or does not move towards |stackend|) before reaching the outermost frame,
+// whose frame pointer is null. This happens if a function on the stack was
+// built without frame pointers and uses the register for something else.
+size_t WalkFramePointers(const char* frame,
+                         const char* stackend,
+                         uint64_t* pcs,
+                         size_t max_frames)
+    __attribute__((no_sanitize("address", "hwaddress"))) {
+  constexpr uintptr_t kFrameRecordSize = 2 * sizeof(uintptr_t);
+  uintptr_t fp = reinterpret_cast<uintptr_t>(frame);
+  uintptr_t lowest = fp;
+  const uintptr_t end = reinterpret_cast<uintptr_t>(stackend);
+  size_t num_frames = 0;
+  while (num_frames < max_frames) {
+    if (fp == 0)
+      return num_frames;
+    if (fp < lowest || fp > end - kFrameRecordSize ||
+        fp % sizeof(uintptr_t) != 0) {
+      return 0;
+    }
+    const uintptr_t* record = reinterpret_cast<const uintptr_t*>(fp);
+    if (record[1] == 0)
+      return num_frames;
+    pcs[num_frames++] = record[1];
+    lowest = fp + kFrameRecordSize;
+    fp = record[0];
+  }
+  return num_frames;
+}
+
 uint64_t GetMaxTries(const ClientConfiguration& client_config) {
   if (!client_config.block_client)
     return 1u;
@@ -454,10 +500,32 @@ bool Client::RecordMalloc(uint32_t heap_id,
   }
 
   WireMessage msg{};
-  msg.record_type = RecordType::Malloc;
   msg.alloc_header = &metadata;
-  msg.payload = const_cast<char*>(stackptr);
-  msg.payload_size = static_cast<size_t>(stack_size);
+
+  // If the frame pointers can be trusted, only send the return addresses,
+  // rather than a copy of the stack for heapprofd to unwind.
+  uint64_t pcs[kMaxFramePointerFrames];
+  size_t num_pcs = 0;
+  if (kFramePointerUnwindingSupported &&
+      client_config_.frame_pointer_unwinding &&
+      frame_pointer_failures_.load(std::memory_order_relaxed) <
+          kMaxFramePointerFailures) {
+    num_pcs = WalkFramePointers(stackptr, stackend, pcs, base::ArraySize(pcs));
+    if (num_pcs == 0 &&
+        frame_pointer_failures_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+            kMaxFramePointerFailures) {
+      PERFETTO_LOG("Broken frame pointer chains. Sending stack copies.");
+    }
+  }
+  if (num_pcs > 0) {
+    msg.record_type = RecordType::MallocFramePointers;
+    msg.payload = reinterpret_cast<char*>(pcs);
+    msg.payload_size = num_pcs * sizeof(uint64_t);
+  } else {
+    msg.record_type = RecordType::Malloc;
+    msg.payload = const_cast<char*>(stackptr);
+    msg.payload_size = static_cast<size_t>(stack_size);
+  }
 
   if (SendWireMessageWithRetriesIfBlocking(msg) == -1)
     return false;
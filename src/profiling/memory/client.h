@@ -53,6 +53,14 @@ constexpr uint32_t kClientSockTimeoutMs = 1000;
 
 uint64_t GetMaxTries(const ClientConfiguration& client_config);
 
+// Stores the return addresses found by following the frame pointers from
+// |frame| into |pcs|. Returns 0 if the frame pointer chain is broken, in which
+// case the client sends a copy of the stack instead.
+size_t WalkFramePointers(const char* frame,
+                         const char* stackend,
+                         uint64_t* pcs,
+                         size_t max_frames);
+
 // Profiling client, used to sample and record the malloc/free family of calls,
 // and communicate the necessary state to a separate profiling daemon process.
 //
@@ -142,6 +150,9 @@ class Client {
   std::atomic<uint64_t>
       sequence_number_[base::ArraySize(ClientConfiguration{}.heaps)] = {};
   SharedRingBuffer shmem_;
+  // Number of samples for which WalkFramePointers failed. See
+  // kMaxFramePointerFailures.
+  std::atomic<uint32_t> frame_pointer_failures_{0};
 
   // Used to detect (during the slow path) the situation where the process has
   // forked during profiling, and is performing malloc operations in the child.
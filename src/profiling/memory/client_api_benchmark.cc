@@ -152,6 +152,30 @@ static void BM_ClientApiSample(benchmark::State& state) {
 
 BENCHMARK(BM_ClientApiSample);
 
+// Same as BM_ClientApiSample, but the client walks the frame pointers and
+// sends the return addresses instead of a copy of the stack.
+static void BM_ClientApiSampleFramePointers(benchmark::State& state) {
+  const uint32_t heap_id = GetHeapId();
+
+  ClientConfiguration client_config{};
+  client_config.default_interval = 32000;
+  client_config.all_heaps = true;
+  client_config.frame_pointer_unwinding = true;
+  g_client_config = client_config;
+  PERFETTO_CHECK(AHeapProfile_initSession(malloc, free));
+
+  PERFETTO_CHECK(g_shmem_fd);
+  auto ringbuf = SharedRingBuffer::Attach(base::ScopedFile(dup(g_shmem_fd)));
+
+  for (auto _ : state) {
+    AHeapProfile_reportSample(heap_id, 0x123, 20);
+  }
+  DisconnectGlobalServerSocket();
+  ringbuf->SetShuttingDown();
+}
+
+BENCHMARK(BM_ClientApiSampleFramePointers);
+
 static void BM_ClientApiDisabledHeapAllocation(benchmark::State& state) {
   const uint32_t heap_id = GetHeapId();
 
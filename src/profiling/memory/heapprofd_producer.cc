@@ -24,6 +24,8 @@
 #include <algorithm>
 #include <cinttypes>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 
@@ -142,6 +144,8 @@ bool HeapprofdConfigToClientConfiguration(
   cli_config->block_client_timeout_us =
       heapprofd_config.block_client_timeout_us();
   cli_config->all_heaps = heapprofd_config.all_heaps();
+  cli_config->frame_pointer_unwinding =
+      heapprofd_config.frame_pointer_unwinding();
   cli_config->adaptive_sampling_shmem_threshold =
       heapprofd_config.adaptive_sampling_shmem_threshold();
   cli_config->adaptive_sampling_max_sampling_interval_bytes =
@@ -202,8 +206,8 @@ bool HeapprofdConfigToClientConfiguration(
   return true;
 }
 
-// We create kUnwinderThreads unwinding threads. Bookkeeping is done on the main
-// thread.
+// We create kUnwinderThreads unwinding threads. Bookkeeping is sharded by pid
+// in the same way, and done on the unwinding thread that handles the process.
 HeapprofdProducer::HeapprofdProducer(HeapprofdMode mode,
                                      base::TaskRunner* task_runner,
                                      bool exit_when_done)
@@ -213,6 +217,12 @@ HeapprofdProducer::HeapprofdProducer(HeapprofdMode mode,
       socket_delegate_(this),
       weak_factory_(this),
       unwinding_workers_(MakeUnwindingWorkers(this, kUnwinderThreads)) {
+  // No records can arrive before the first handoff, which happens on this
+  // thread, so it is fine to create the shards after the workers.
+  for (size_t i = 0; i < kUnwinderThreads; ++i) {
+    bookkeeping_shards_.emplace_back(std::make_unique<BookkeepingShard>(
+        static_cast<uint32_t>(i), static_cast<uint32_t>(kUnwinderThreads)));
+  }
   CheckDataSourceCpuTask();
   CheckDataSourceMemoryTask();
 }
@@ -564,6 +574,10 @@ UnwindingWorker& HeapprofdProducer::UnwinderForPID(pid_t pid) {
   return unwinding_workers_[static_cast<uint64_t>(pid) % kUnwinderThreads];
 }
 
+HeapprofdProducer::BookkeepingShard& HeapprofdProducer::ShardForPID(pid_t pid) {
+  return *bookkeeping_shards_[static_cast<uint64_t>(pid) % kUnwinderThreads];
+}
+
 void HeapprofdProducer::StopDataSource(DataSourceInstanceID id) {
   auto it = data_sources_.find(id);
   if (it == data_sources_.end()) {
@@ -625,7 +639,9 @@ void HeapprofdProducer::ShutdownDataSource(DataSource* data_source) {
           }
           // Do not dump any stragglers, just trigger the Flush and tear down
           // the data source.
-          ds.process_states.clear();
+          while (!ds.process_states.empty())
+            weak_producer->EraseProcessState(&ds,
+                                             ds.process_states.begin()->first);
           ds.rejected_pids.clear();
           PERFETTO_CHECK(weak_producer->MaybeFinishDataSource(&ds));
         }
@@ -744,15 +760,25 @@ void HeapprofdProducer::DumpProcessState(DataSource* data_source,
          &data_source](const HeapTracker::CallstackAllocations& alloc) {
           dump_state.WriteAllocation(alloc, data_source->config.dump_at_max());
         });
-    dump_state.DumpCallstacks(&callsites_);
+    dump_state.DumpCallstacks(process_state->callsites);
   }
 }
 
+void HeapprofdProducer::EraseProcessState(DataSource* ds, pid_t pid) {
+  BookkeepingShard& shard = ShardForPID(pid);
+  // The HeapTrackers of the process hold references into the trie of the
+  // shard, so it has to be destroyed under the lock as well.
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.processes.erase({ds->id, pid});
+  ds->process_states.erase(pid);
+}
+
 void HeapprofdProducer::DumpProcessesInDataSource(DataSource* ds) {
   for (std::pair<const pid_t, ProcessState>& pid_and_process_state :
        ds->process_states) {
     pid_t pid = pid_and_process_state.first;
     ProcessState& process_state = pid_and_process_state.second;
+    std::lock_guard<std::mutex> lock(ShardForPID(pid).mutex);
     DumpProcessState(ds, pid, &process_state);
   }
 }
@@ -878,10 +904,17 @@ void HeapprofdProducer::SocketDelegate::OnDataAvailable(
       return;
     }
 
-    data_source.process_states.emplace(
+    BookkeepingShard& shard = producer_->ShardForPID(self->peer_pid_linux());
+    auto process_state_it = data_source.process_states.emplace(
         std::piecewise_construct, std::forward_as_tuple(self->peer_pid_linux()),
-        std::forward_as_tuple(&producer_->callsites_,
+        std::forward_as_tuple(&shard.callsites,
                               data_source.config.dump_at_max()));
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.processes[{data_source.id, self->peer_pid_linux()}] =
+          BookkeepingShard::Process{&process_state_it.first->second,
+                                    &data_source.config};
+    }
 
     PERFETTO_DLOG("%d: Received FDs.", self->peer_pid_linux());
     int raw_fd = pending_process.shmem.fd();
@@ -987,6 +1020,27 @@ void HeapprofdProducer::HandleClientConnection(
 void HeapprofdProducer::PostAllocRecord(
     UnwindingWorker* worker,
     std::unique_ptr<AllocRecord> alloc_rec) {
+  BookkeepingShard& shard = ShardForPID(alloc_rec->pid);
+  bool stream = false;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.processes.find(
+        {alloc_rec->data_source_instance_id, alloc_rec->pid});
+    if (it == shard.processes.end()) {
+      PERFETTO_LOG("Invalid PID in alloc record.");
+    } else if (it->second.config->stream_allocations()) {
+      stream = true;
+    } else {
+      ApplyAllocRecord(it->second, alloc_rec.get());
+    }
+  }
+  if (!stream) {
+    worker->ReturnAllocRecord(std::move(alloc_rec));
+    return;
+  }
+
+  // Streamed allocations are written to the TraceWriter of the data source,
+  // which is only used on the main thread.
   // Once we can use C++14, this should be std::moved into the lambda instead.
   auto* raw_alloc_rec = alloc_rec.release();
   auto weak_this = weak_factory_.GetWeakPtr();
@@ -994,7 +1048,7 @@ void HeapprofdProducer::PostAllocRecord(
     std::unique_ptr<AllocRecord> unique_alloc_ref =
         std::unique_ptr<AllocRecord>(raw_alloc_rec);
     if (weak_this) {
-      weak_this->HandleAllocRecord(unique_alloc_ref.get());
+      weak_this->HandleStreamingAllocRecord(unique_alloc_ref.get());
       worker->ReturnAllocRecord(std::move(unique_alloc_ref));
     }
   });
@@ -1002,6 +1056,30 @@ void HeapprofdProducer::PostAllocRecord(
 
 void HeapprofdProducer::PostFreeRecord(UnwindingWorker*,
                                        std::vector<FreeRecord> free_recs) {
+  if (free_recs.empty())
+    return;
+  // UnwindingWorker batches free records per client, so they all belong to
+  // the same process.
+  const DataSourceInstanceID ds_id = free_recs[0].data_source_instance_id;
+  const pid_t pid = free_recs[0].pid;
+  BookkeepingShard& shard = ShardForPID(pid);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.processes.find({ds_id, pid});
+    if (it == shard.processes.end()) {
+      PERFETTO_LOG("Invalid PID in free record.");
+      return;
+    }
+    if (!it->second.config->stream_allocations()) {
+      for (const FreeRecord& free_rec : free_recs) {
+        PERFETTO_DCHECK(free_rec.data_source_instance_id == ds_id &&
+                        free_rec.pid == pid);
+        ApplyFreeRecord(it->second, free_rec);
+      }
+      return;
+    }
+  }
+
   // Once we can use C++14, this should be std::moved into the lambda instead.
   std::vector<FreeRecord>* raw_free_recs =
       new std::vector<FreeRecord>(std::move(free_recs));
@@ -1009,7 +1087,7 @@ void HeapprofdProducer::PostFreeRecord(UnwindingWorker*,
   task_runner_->PostTask([weak_this, raw_free_recs] {
     if (weak_this) {
       for (FreeRecord& free_rec : *raw_free_recs)
-        weak_this->HandleFreeRecord(std::move(free_rec));
+        weak_this->HandleStreamingFreeRecord(std::move(free_rec));
     }
     delete raw_free_recs;
   });
@@ -1017,11 +1095,14 @@ void HeapprofdProducer::PostFreeRecord(UnwindingWorker*,
 
 void HeapprofdProducer::PostHeapNameRecord(UnwindingWorker*,
                                            HeapNameRecord rec) {
-  auto weak_this = weak_factory_.GetWeakPtr();
-  task_runner_->PostTask([weak_this, rec] {
-    if (weak_this)
-      weak_this->HandleHeapNameRecord(rec);
-  });
+  BookkeepingShard& shard = ShardForPID(rec.pid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.processes.find({rec.data_source_instance_id, rec.pid});
+  if (it == shard.processes.end()) {
+    PERFETTO_LOG("Invalid PID in heap name record.");
+    return;
+  }
+  ApplyHeapNameRecord(it->second, rec);
 }
 
 void HeapprofdProducer::PostSocketDisconnected(UnwindingWorker*,
@@ -1035,7 +1116,7 @@ void HeapprofdProducer::PostSocketDisconnected(UnwindingWorker*,
   });
 }
 
-void HeapprofdProducer::HandleAllocRecord(AllocRecord* alloc_rec) {
+void HeapprofdProducer::HandleStreamingAllocRecord(AllocRecord* alloc_rec) {
   const AllocMetadata& alloc_metadata = alloc_rec->alloc_metadata;
   auto it = data_sources_.find(alloc_rec->data_source_instance_id);
   if (it == data_sources_.end()) {
@@ -1044,26 +1125,48 @@ void HeapprofdProducer::HandleAllocRecord(AllocRecord* alloc_rec) {
   }
 
   DataSource& ds = it->second;
-  auto process_state_it = ds.process_states.find(alloc_rec->pid);
-  if (process_state_it == ds.process_states.end()) {
+  if (ds.process_states.find(alloc_rec->pid) == ds.process_states.end()) {
     PERFETTO_LOG("Invalid PID in alloc record.");
     return;
   }
 
-  if (ds.config.stream_allocations()) {
-    auto packet = ds.trace_writer->NewTracePacket();
-    auto* streaming_alloc = packet->set_streaming_allocation();
-    streaming_alloc->add_address(alloc_metadata.alloc_address);
-    streaming_alloc->add_size(alloc_metadata.alloc_size);
-    streaming_alloc->add_sample_size(alloc_metadata.sample_size);
-    streaming_alloc->add_clock_monotonic_coarse_timestamp(
-        alloc_metadata.clock_monotonic_coarse_timestamp);
-    streaming_alloc->add_heap_id(alloc_metadata.heap_id);
-    streaming_alloc->add_sequence_number(alloc_metadata.sequence_number);
+  auto packet = ds.trace_writer->NewTracePacket();
+  auto* streaming_alloc = packet->set_streaming_allocation();
+  streaming_alloc->add_address(alloc_metadata.alloc_address);
+  streaming_alloc->add_size(alloc_metadata.alloc_size);
+  streaming_alloc->add_sample_size(alloc_metadata.sample_size);
+  streaming_alloc->add_clock_monotonic_coarse_timestamp(
+      alloc_metadata.clock_monotonic_coarse_timestamp);
+  streaming_alloc->add_heap_id(alloc_metadata.heap_id);
+  streaming_alloc->add_sequence_number(alloc_metadata.sequence_number);
+}
+
+void HeapprofdProducer::HandleStreamingFreeRecord(FreeRecord free_rec) {
+  auto it = data_sources_.find(free_rec.data_source_instance_id);
+  if (it == data_sources_.end()) {
+    PERFETTO_LOG("Invalid data source in free record.");
+    return;
+  }
+
+  DataSource& ds = it->second;
+  if (ds.process_states.find(free_rec.pid) == ds.process_states.end()) {
+    PERFETTO_LOG("Invalid PID in free record.");
     return;
   }
 
-  const auto& prefixes = ds.config.skip_symbol_prefix();
+  auto packet = ds.trace_writer->NewTracePacket();
+  auto* streaming_free = packet->set_streaming_free();
+  streaming_free->add_address(free_rec.entry.addr);
+  streaming_free->add_heap_id(free_rec.entry.heap_id);
+  streaming_free->add_sequence_number(free_rec.entry.sequence_number);
+}
+
+// static
+void HeapprofdProducer::ApplyAllocRecord(
+    const BookkeepingShard::Process& process,
+    AllocRecord* alloc_rec) {
+  const AllocMetadata& alloc_metadata = alloc_rec->alloc_metadata;
+  const auto& prefixes = process.config->skip_symbol_prefix();
   if (!prefixes.empty()) {
     for (unwindstack::FrameData& frame_data : alloc_rec->frames) {
       if (frame_data.map_info == nullptr) {
@@ -1079,7 +1182,7 @@ void HeapprofdProducer::HandleAllocRecord(AllocRecord* alloc_rec) {
     }
   }
 
-  ProcessState& process_state = process_state_it->second;
+  ProcessState& process_state = *process.process_state;
   HeapTracker& heap_tracker =
       process_state.GetHeapTracker(alloc_rec->alloc_metadata.heap_id);
 
@@ -1103,51 +1206,21 @@ void HeapprofdProducer::HandleAllocRecord(AllocRecord* alloc_rec) {
       alloc_metadata.clock_monotonic_coarse_timestamp);
 }
 
-void HeapprofdProducer::HandleFreeRecord(FreeRecord free_rec) {
-  auto it = data_sources_.find(free_rec.data_source_instance_id);
-  if (it == data_sources_.end()) {
-    PERFETTO_LOG("Invalid data source in free record.");
-    return;
-  }
-
-  DataSource& ds = it->second;
-  auto process_state_it = ds.process_states.find(free_rec.pid);
-  if (process_state_it == ds.process_states.end()) {
-    PERFETTO_LOG("Invalid PID in free record.");
-    return;
-  }
-
-  if (ds.config.stream_allocations()) {
-    auto packet = ds.trace_writer->NewTracePacket();
-    auto* streaming_free = packet->set_streaming_free();
-    streaming_free->add_address(free_rec.entry.addr);
-    streaming_free->add_heap_id(free_rec.entry.heap_id);
-    streaming_free->add_sequence_number(free_rec.entry.sequence_number);
-    return;
-  }
-
-  ProcessState& process_state = process_state_it->second;
-
+// static
+void HeapprofdProducer::ApplyFreeRecord(
+    const BookkeepingShard::Process& process,
+    const FreeRecord& free_rec) {
   const FreeEntry& entry = free_rec.entry;
-  HeapTracker& heap_tracker = process_state.GetHeapTracker(entry.heap_id);
+  HeapTracker& heap_tracker =
+      process.process_state->GetHeapTracker(entry.heap_id);
   heap_tracker.RecordFree(entry.addr, entry.sequence_number, 0);
 }
 
-void HeapprofdProducer::HandleHeapNameRecord(HeapNameRecord rec) {
-  auto it = data_sources_.find(rec.data_source_instance_id);
-  if (it == data_sources_.end()) {
-    PERFETTO_LOG("Invalid data source in free record.");
-    return;
-  }
-
-  DataSource& ds = it->second;
-  auto process_state_it = ds.process_states.find(rec.pid);
-  if (process_state_it == ds.process_states.end()) {
-    PERFETTO_LOG("Invalid PID in free record.");
-    return;
-  }
-
-  ProcessState& process_state = process_state_it->second;
+// static
+void HeapprofdProducer::ApplyHeapNameRecord(
+    const BookkeepingShard::Process& process,
+    const HeapNameRecord& rec) {
+  ProcessState& process_state = *process.process_state;
   const HeapName& entry = rec.entry;
   if (entry.heap_name[0] != '\0') {
     std::string heap_name = entry.heap_name;
@@ -1225,15 +1298,19 @@ void HeapprofdProducer::HandleSocketDisconnected(
   PERFETTO_LOG("%d disconnected from heapprofd (ds shutting down: %d).", pid,
                ds.shutting_down);
 
-  ProcessState& process_state = process_state_it->second;
-  process_state.disconnected = !ds.shutting_down;
-  process_state.error_state = stats.error_state;
-  process_state.client_spinlock_blocked_us = stats.client_spinlock_blocked_us;
-  process_state.buffer_corrupted =
-      stats.num_writes_corrupt > 0 || stats.num_reads_corrupt > 0;
+  {
+    std::lock_guard<std::mutex> lock(ShardForPID(pid).mutex);
+    ProcessState& process_state = process_state_it->second;
+    process_state.disconnected = !ds.shutting_down;
+    process_state.error_state = stats.error_state;
+    process_state.client_spinlock_blocked_us =
+        stats.client_spinlock_blocked_us;
+    process_state.buffer_corrupted =
+        stats.num_writes_corrupt > 0 || stats.num_reads_corrupt > 0;
 
-  DumpProcessState(&ds, pid, &process_state);
-  ds.process_states.erase(pid);
+    DumpProcessState(&ds, pid, &process_state);
+  }
+  EraseProcessState(&ds, pid);
   MaybeFinishDataSource(&ds);
 }
 
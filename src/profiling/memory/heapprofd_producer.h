@@ -21,7 +21,10 @@
 #include <cinttypes>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "perfetto/base/task_runner.h"
@@ -138,9 +141,8 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
                               SharedRingBuffer::Stats) override;
   void PostDrainDone(UnwindingWorker*, DataSourceInstanceID) override;
 
-  void HandleAllocRecord(AllocRecord*);
-  void HandleFreeRecord(FreeRecord);
-  void HandleHeapNameRecord(HeapNameRecord);
+  void HandleStreamingAllocRecord(AllocRecord*);
+  void HandleStreamingFreeRecord(FreeRecord);
   void HandleSocketDisconnected(DataSourceInstanceID,
                                 pid_t,
                                 SharedRingBuffer::Stats);
@@ -243,6 +245,32 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
     GuardrailConfig guardrail_config;
   };
 
+  // Bookkeeping state of the processes handled by one UnwindingWorker.
+  //
+  // Alloc, free and heap name records are applied to the ProcessState by the
+  // worker thread that unwound them, under |mutex|, rather than being posted
+  // to the main thread. The main thread takes |mutex| to dump, update or
+  // destroy a ProcessState of the shard.
+  //
+  // Every shard has its own trie, with callstack and intern IDs disjoint from
+  // those of the other shards, so the dumps of processes from different
+  // shards can share the InterningOutputTracker of their data source.
+  struct BookkeepingShard {
+    // A process of this shard. Both pointers are owned by the DataSource;
+    // the entry is removed before the ProcessState is destroyed.
+    struct Process {
+      ProcessState* process_state;
+      const HeapprofdConfig* config;
+    };
+
+    BookkeepingShard(uint32_t shard, uint32_t num_shards)
+        : callsites(shard, num_shards) {}
+
+    std::mutex mutex;
+    GlobalCallstackTrie callsites;
+    std::map<std::pair<DataSourceInstanceID, pid_t>, Process> processes;
+  };
+
   struct PendingProcess {
     std::unique_ptr<base::UnixSocket> sock;
     DataSourceInstanceID data_source_instance_id;
@@ -262,7 +290,10 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
 
   void FinishDataSourceFlush(FlushRequestID flush_id);
   void DumpProcessesInDataSource(DataSource* ds);
+  // Must be called with the mutex of ShardForPID(pid) held.
   void DumpProcessState(DataSource* ds, pid_t pid, ProcessState* process);
+  // Takes the mutex of ShardForPID(pid).
+  void EraseProcessState(DataSource* ds, pid_t pid);
   static void SetStats(protos::pbzero::ProfilePacket::ProcessStats* stats,
                        const ProcessState& process_state);
 
@@ -271,6 +302,14 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
   void DrainDone(DataSourceInstanceID);
 
   UnwindingWorker& UnwinderForPID(pid_t);
+  BookkeepingShard& ShardForPID(pid_t);
+
+  // Called on the unwinding worker threads, with the shard mutex held.
+  static void ApplyAllocRecord(const BookkeepingShard::Process&, AllocRecord*);
+  static void ApplyFreeRecord(const BookkeepingShard::Process&,
+                              const FreeRecord&);
+  static void ApplyHeapNameRecord(const BookkeepingShard::Process&,
+                                  const HeapNameRecord&);
   bool IsPidProfiled(pid_t);
   DataSource* GetDataSourceForProcess(const Process& proc);
   void RecordOtherSourcesAsRejected(DataSource* active_ds, const Process& proc);
@@ -309,8 +348,9 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
   // TraceWriters.
   std::unique_ptr<TracingService::ProducerEndpoint> endpoint_;
 
-  // Must outlive data_sources_ - HeapTracker references the trie.
-  GlobalCallstackTrie callsites_;
+  // One per unwinding worker. Must outlive data_sources_ - HeapTracker
+  // references the tries.
+  std::vector<std::unique_ptr<BookkeepingShard>> bookkeeping_shards_;
 
   // Must outlive data_sources_ - DataSource can hold
   // SystemProperties::Handle-s.
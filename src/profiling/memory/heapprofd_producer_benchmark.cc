@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End-to-end benchmark of heapprofd. A number of client processes report
+// allocations as fast as they can to a HeapprofdProducer, which is connected to
+// an in-process tracing service. The clients block when their shared memory
+// buffer is full, so the reported rate is the number of allocations per second
+// that heapprofd sustains across all the clients. Allocations that could not
+// be delivered to heapprofd at all are reported as "drops".
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/time.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/pipe.h"
+#include "perfetto/ext/base/subprocess.h"
+#include "perfetto/ext/base/thread_task_runner.h"
+#include "perfetto/ext/tracing/ipc/consumer_ipc_client.h"
+#include "perfetto/ext/tracing/ipc/service_ipc_host.h"
+#include "protos/perfetto/common/data_source_descriptor.gen.h"
+#include "protos/perfetto/config/profiling/heapprofd_config.gen.h"
+#include "protos/perfetto/config/trace_config.gen.h"
+#include "src/base/test/test_task_runner.h"
+#include "src/base/test/tmp_dir_tree.h"
+#include "src/profiling/memory/client.h"
+#include "src/profiling/memory/heapprofd_producer.h"
+#include "src/profiling/memory/unhooked_allocator.h"
+#include "src/tracing/test/mock_consumer.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace profiling {
+namespace {
+
+constexpr char kProducerSock[] = "producer.sock";
+constexpr char kConsumerSock[] = "consumer.sock";
+constexpr char kHeapprofdSock[] = "heapprofd.sock";
+
+constexpr uint32_t kHeapId = 0;
+constexpr uint64_t kAllocsPerIteration = 1000;
+// Addresses are reused, so the number of live allocations (and the memory
+// used by heapprofd) does not grow with the number of iterations.
+constexpr uint64_t kLiveAllocations = 1024;
+constexpr uint64_t kBaseAddress = 0x10000000;
+
+class TracingServiceThread {
+ public:
+  TracingServiceThread(const std::string& producer_socket,
+                       const std::string& consumer_socket)
+      : runner_(base::ThreadTaskRunner::CreateAndStart("perfetto.svc")) {
+    runner_.PostTaskAndWaitForTesting([&]() {
+      svc_ = ServiceIPCHost::CreateInstance(&runner_);
+      PERFETTO_CHECK(
+          svc_->Start(producer_socket.c_str(), consumer_socket.c_str()));
+    });
+  }
+
+  ~TracingServiceThread() {
+    runner_.PostTaskAndWaitForTesting([this]() { svc_.reset(); });
+  }
+
+ private:
+  base::ThreadTaskRunner runner_;
+  std::unique_ptr<ServiceIPCHost> svc_;
+};
+
+class HeapprofdThread {
+ public:
+  HeapprofdThread(const std::string& producer_socket,
+                  const std::string& heapprofd_socket)
+      : runner_(base::ThreadTaskRunner::CreateAndStart("heapprofd.svc")),
+        producer_socket_(producer_socket) {
+    runner_.PostTaskAndWaitForTesting([&]() {
+      heapprofd_.reset(new HeapprofdProducer(HeapprofdMode::kCentral, &runner_,
+                                             /* exit_when_done= */ false));
+      heapprofd_->ConnectWithRetries(producer_socket_.c_str());
+      listen_sock_ = base::UnixSocket::Listen(
+          heapprofd_socket.c_str(), &heapprofd_->socket_delegate(), &runner_,
+          base::SockFamily::kUnix, base::SockType::kStream);
+      PERFETTO_CHECK(listen_sock_);
+    });
+  }
+
+  ~HeapprofdThread() {
+    runner_.PostTaskAndWaitForTesting([this]() {
+      listen_sock_.reset();
+      heapprofd_.reset();
+    });
+  }
+
+ private:
+  base::ThreadTaskRunner runner_;
+  std::string producer_socket_;
+  std::unique_ptr<HeapprofdProducer> heapprofd_;
+  std::unique_ptr<base::UnixSocket> listen_sock_;
+};
+
+TraceConfig MakeTraceConfig() {
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(64 * 1024);
+
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("android.heapprofd");
+  ds_config->set_target_buffer(0);
+
+  protos::gen::HeapprofdConfig heapprofd_config;
+  heapprofd_config.set_sampling_interval_bytes(1);
+  heapprofd_config.set_all(true);
+  heapprofd_config.set_all_heaps(true);
+  heapprofd_config.set_no_startup(true);
+  heapprofd_config.set_no_running(true);
+  heapprofd_config.set_shmem_size_bytes(1024 * 1024);
+  heapprofd_config.set_block_client(true);
+  heapprofd_config.set_block_client_timeout_us(1000 * 1000);
+  ds_config->set_heapprofd_config_raw(heapprofd_config.SerializeAsString());
+  return trace_config;
+}
+
+// A client process. Every time a byte is written to |go|, it reports
+// kAllocsPerIteration allocations and writes the number of them that were
+// dropped to |done|.
+struct ClientProcess {
+  base::Subprocess process;
+  base::ScopedFile go;
+  base::ScopedFile done;
+};
+
+void RunClient(const std::string& heapprofd_sock, int go, int done) {
+  std::shared_ptr<Client> client;
+  std::optional<base::UnixSocketRaw> sock =
+      Client::ConnectToHeapprofd(heapprofd_sock);
+  if (sock) {
+    client = Client::CreateAndHandshake(
+        std::move(*sock), UnhookedAllocator<Client>(malloc, free));
+  }
+  uint64_t drops = client ? 0 : kAllocsPerIteration;
+  // Signals that the handshake is done.
+  if (base::WriteAll(done, &drops, sizeof(drops)) < 0)
+    return;
+
+  char buf;
+  while (base::Read(go, &buf, sizeof(buf)) == 1) {
+    drops = 0;
+    for (uint64_t i = 0; i < kAllocsPerIteration; ++i) {
+      uint64_t address = kBaseAddress + (i % kLiveAllocations) * 16;
+      if (!client || !client->RecordMalloc(kHeapId, 16, 16, address))
+        drops++;
+    }
+    if (base::WriteAll(done, &drops, sizeof(drops)) < 0)
+      return;
+  }
+}
+
+std::unique_ptr<ClientProcess> StartClient(const std::string& heapprofd_sock) {
+  base::Pipe go = base::Pipe::Create();
+  base::Pipe done = base::Pipe::Create();
+  int go_rd = *go.rd;
+  int done_wr = *done.wr;
+
+  std::unique_ptr<ClientProcess> client(new ClientProcess());
+  client->process.args.preserve_fds.push_back(go_rd);
+  client->process.args.preserve_fds.push_back(done_wr);
+  client->process.args.posix_entrypoint_for_testing =
+      [heapprofd_sock, go_rd, done_wr] {
+        RunClient(heapprofd_sock, go_rd, done_wr);
+      };
+  client->process.Start();
+  client->go = std::move(go.wr);
+  client->done = std::move(done.rd);
+
+  uint64_t drops;
+  PERFETTO_CHECK(base::Read(*client->done, &drops, sizeof(drops)) ==
+                 sizeof(drops));
+  PERFETTO_CHECK(drops == 0);
+  return client;
+}
+
+static void BM_HeapprofdEndToEnd(benchmark::State& state) {
+  const size_t num_clients = static_cast<size_t>(state.range(0));
+
+  base::TmpDirTree tmpdir;
+  tmpdir.TrackFile(kProducerSock);
+  tmpdir.TrackFile(kConsumerSock);
+  tmpdir.TrackFile(kHeapprofdSock);
+  const std::string producer_sock = tmpdir.AbsolutePath(kProducerSock);
+  const std::string consumer_sock = tmpdir.AbsolutePath(kConsumerSock);
+  const std::string heapprofd_sock = tmpdir.AbsolutePath(kHeapprofdSock);
+
+  std::optional<TracingServiceThread> tracing_service;
+  tracing_service.emplace(producer_sock, consumer_sock);
+  std::optional<HeapprofdThread> heapprofd;
+  heapprofd.emplace(producer_sock, heapprofd_sock);
+
+  base::TestTaskRunner task_runner;
+  std::optional<::testing::NiceMock<MockConsumer>> consumer;
+  consumer.emplace(&task_runner);
+  consumer->Connect(
+      ConsumerIPCClient::Connect(consumer_sock.c_str(), &*consumer,
+                                 &task_runner));
+  for (;;) {
+    auto dss = consumer->QueryServiceState().data_sources();
+    if (std::any_of(dss.begin(), dss.end(),
+                    [](const TracingServiceState::DataSource& ds) {
+                      return ds.ds_descriptor().name() == "android.heapprofd";
+                    })) {
+      break;
+    }
+    base::SleepMicroseconds(10 * 1000);
+  }
+  consumer->ObserveEvents(ObservableEvents::TYPE_ALL_DATA_SOURCES_STARTED);
+  consumer->EnableTracing(MakeTraceConfig());
+  consumer->WaitForObservableEvents();
+
+  std::vector<std::unique_ptr<ClientProcess>> clients;
+  for (size_t i = 0; i < num_clients; ++i)
+    clients.emplace_back(StartClient(heapprofd_sock));
+
+  uint64_t drops = 0;
+  for (auto _ : state) {
+    for (auto& client : clients)
+      PERFETTO_CHECK(base::WriteAll(*client->go, "g", 1) == 1);
+    for (auto& client : clients) {
+      uint64_t client_drops;
+      PERFETTO_CHECK(base::Read(*client->done, &client_drops,
+                                sizeof(client_drops)) == sizeof(client_drops));
+      drops += client_drops;
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() *
+                                               num_clients *
+                                               kAllocsPerIteration));
+  state.counters["drops"] = static_cast<double>(drops);
+
+  // Closing |go| makes the clients exit.
+  for (auto& client : clients) {
+    client->go.reset();
+    client->process.Wait();
+  }
+  consumer->ForceDisconnect();
+  consumer.reset();
+  task_runner.RunUntilIdle();
+  heapprofd.reset();
+  tracing_service.reset();
+}
+
+}  // namespace
+
+BENCHMARK(BM_HeapprofdEndToEnd)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(5)
+    ->Arg(10)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace profiling
+}  // namespace perfetto
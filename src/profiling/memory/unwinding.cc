@@ -19,14 +19,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <condition_variable>
 #include <mutex>
+#include <string>
 
+#include <unwindstack/Elf.h>
 #include <unwindstack/MachineArm.h>
 #include <unwindstack/MachineArm64.h>
 #include <unwindstack/MachineRiscv64.h>
 #include <unwindstack/MachineX86.h>
 #include <unwindstack/MachineX86_64.h>
+#include <unwindstack/MapInfo.h>
 #include <unwindstack/Maps.h>
 #include <unwindstack/Memory.h>
 #include <unwindstack/Regs.h>
@@ -88,6 +92,15 @@ void ReadFromRawData(unwindstack::Regs* regs, void* raw_data) {
   memcpy(regs->RawData(), raw_data, GetRegsSize(regs));
 }
 
+bool IsSkippedMap(const unwindstack::MapInfo& map_info) {
+  std::string name = map_info.name();
+  size_t slash = name.rfind('/');
+  if (slash != std::string::npos)
+    name = name.substr(slash + 1);
+  return std::find(kSkipMaps.cbegin(), kSkipMaps.cend(), name) !=
+         kSkipMaps.cend();
+}
+
 }  // namespace
 
 std::unique_ptr<unwindstack::Regs> CreateRegsFromRawData(
@@ -195,6 +208,85 @@ bool DoUnwind(WireMessage* msg, UnwindingMetadata* metadata, AllocRecord* out) {
   return true;
 }
 
+bool DoFramePointerUnwind(WireMessage* msg,
+                          UnwindingMetadata* metadata,
+                          AllocRecord* out) {
+  AllocMetadata* alloc_metadata = msg->alloc_header;
+  const unwindstack::ArchEnum arch = alloc_metadata->arch;
+  const size_t num_pcs = msg->payload_size / sizeof(uint64_t);
+
+  unwindstack::ErrorCode error_code = unwindstack::ERROR_NONE;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (attempt > 0) {
+      if (metadata->last_maps_reparse_time + kMapsReparseInterval >
+          base::GetWallTimeMs()) {
+        PERFETTO_DLOG("Skipping reparse due to rate limit.");
+        break;
+      }
+      PERFETTO_DLOG("Reparsing maps");
+      metadata->ReparseMaps();
+      metadata->last_maps_reparse_time = base::GetWallTimeMs();
+      out->reparsed_map = true;
+    }
+    out->frames.clear();
+    error_code = unwindstack::ERROR_NONE;
+    // Like the unwinder, drop the frames of the client library itself.
+    bool skipping = true;
+    for (size_t i = 0; i < num_pcs && out->frames.size() < kMaxFrames; ++i) {
+      uint64_t pc;
+      memcpy(&pc, msg->payload + i * sizeof(pc), sizeof(pc));
+      std::shared_ptr<unwindstack::MapInfo> map_info =
+          metadata->fd_maps.Find(pc);
+      if (map_info == nullptr) {
+        error_code = unwindstack::ERROR_INVALID_MAP;
+        break;
+      }
+      if (skipping && IsSkippedMap(*map_info))
+        continue;
+      skipping = false;
+
+      unwindstack::FrameData frame;
+      frame.num = out->frames.size();
+      frame.pc = pc;
+      frame.rel_pc = pc;
+      frame.map_info = map_info;
+      unwindstack::Elf* elf = map_info->GetElf(metadata->fd_mem, arch);
+      if (elf != nullptr) {
+        // All the pcs are return addresses, so they point to the instruction
+        // after the call.
+        uint64_t relative_pc = elf->GetRelPc(pc, map_info.get());
+        uint64_t pc_adjustment = GetPcAdjustment(relative_pc, elf, arch);
+        frame.rel_pc = relative_pc - pc_adjustment;
+        frame.pc = pc - pc_adjustment;
+        if (!elf->GetFunctionName(frame.rel_pc, &frame.function_name,
+                                  &frame.function_offset)) {
+          frame.function_name = "";
+          frame.function_offset = 0;
+        }
+      }
+      out->frames.emplace_back(std::move(frame));
+    }
+    if (error_code != unwindstack::ERROR_INVALID_MAP)
+      break;
+  }
+  out->build_ids.resize(out->frames.size());
+  for (size_t i = 0; i < out->frames.size(); ++i) {
+    out->build_ids[i] = metadata->GetBuildId(out->frames[i]);
+  }
+
+  if (error_code != unwindstack::ERROR_NONE) {
+    PERFETTO_DLOG("Unwinding error %" PRIu8, error_code);
+    unwindstack::FrameData frame_data{};
+    frame_data.function_name =
+        "ERROR " + StringifyLibUnwindstackError(error_code);
+
+    out->frames.emplace_back(std::move(frame_data));
+    out->build_ids.emplace_back("");
+    out->error = true;
+  }
+  return true;
+}
+
 UnwindingWorker::~UnwindingWorker() {
   if (thread_task_runner_.get() == nullptr) {
     return;
@@ -404,14 +496,20 @@ void UnwindingWorker::HandleBuffer(UnwindingWorker* self,
     return;
   }
 
-  if (msg.record_type == RecordType::Malloc) {
+  if (msg.record_type == RecordType::Malloc ||
+      msg.record_type == RecordType::MallocFramePointers) {
     std::unique_ptr<AllocRecord> rec = alloc_record_arena->BorrowAllocRecord();
     rec->alloc_metadata = *msg.alloc_header;
     rec->pid = peer_pid;
     rec->data_source_instance_id = data_source_instance_id;
     auto start_time_us = base::GetWallTimeNs() / 1000;
-    if (!client_data->stream_allocations)
+    if (client_data->stream_allocations) {
+      // Nothing to unwind.
+    } else if (msg.record_type == RecordType::MallocFramePointers) {
+      DoFramePointerUnwind(&msg, unwinding_metadata, rec.get());
+    } else {
       DoUnwind(&msg, unwinding_metadata, rec.get());
+    }
     rec->unwinding_time_us = static_cast<uint64_t>(
         ((base::GetWallTimeNs() / 1000) - start_time_us).count());
     delegate->PostAllocRecord(self, std::move(rec));
@@ -37,6 +37,13 @@ std::unique_ptr<unwindstack::Regs> CreateRegsFromRawData(
 
 bool DoUnwind(WireMessage*, UnwindingMetadata* metadata, AllocRecord* out);
 
+// Like DoUnwind, for RecordType::MallocFramePointers messages. The client has
+// already walked the frame pointers, so this only symbolizes the return
+// addresses in the payload.
+bool DoFramePointerUnwind(WireMessage*,
+                          UnwindingMetadata* metadata,
+                          AllocRecord* out);
+
 // AllocRecords are expensive to construct and destruct. We have seen up to
 // 10 % of total CPU of heapprofd being used to destruct them. That is why
 // we reuse them to cut CPU usage significantly.
@@ -24,6 +24,7 @@
 
 #include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/utils.h"
 #include "src/profiling/common/unwind_support.h"
 #include "src/profiling/memory/client.h"
 #include "src/profiling/memory/wire_protocol.h"
@@ -183,6 +184,129 @@ TEST(UnwindingTest, DoUnwindReparse) {
                "namespace)::GetRecord(perfetto::profiling::WireMessage*)");
 }
 
+// A fake stack of frame records: each record is the frame pointer of the
+// caller followed by the return address into it.
+struct FakeStack {
+  void SetRecord(size_t index, const char* caller_frame, uintptr_t pc) {
+    words[index] = reinterpret_cast<uintptr_t>(caller_frame);
+    words[index + 1] = pc;
+  }
+  const char* frame(size_t index) const {
+    return reinterpret_cast<const char*>(words + index);
+  }
+  const char* end() const { return frame(base::ArraySize(words)); }
+
+  uintptr_t words[16] = {};
+};
+
+TEST(WalkFramePointersTest, Chain) {
+  FakeStack stack;
+  stack.SetRecord(0, stack.frame(4), 0x1000);
+  stack.SetRecord(4, stack.frame(10), 0x2000);
+  stack.SetRecord(10, nullptr, 0x3000);
+
+  uint64_t pcs[8];
+  ASSERT_EQ(WalkFramePointers(stack.frame(0), stack.end(), pcs, 8), 3u);
+  EXPECT_EQ(pcs[0], 0x1000u);
+  EXPECT_EQ(pcs[1], 0x2000u);
+  EXPECT_EQ(pcs[2], 0x3000u);
+
+  // Deep stacks are cut at |max_frames|.
+  EXPECT_EQ(WalkFramePointers(stack.frame(0), stack.end(), pcs, 2), 2u);
+}
+
+// WalkFramePointers returns 0 for broken chains, which makes the client send
+// a copy of the stack instead.
+TEST(WalkFramePointersTest, BrokenChain) {
+  uint64_t pcs[8];
+
+  // The frame pointer register was used for something else.
+  FakeStack garbage;
+  garbage.SetRecord(0, garbage.frame(4), 0x1000);
+  garbage.SetRecord(4, reinterpret_cast<const char*>(0x12345), 0x2000);
+  EXPECT_EQ(WalkFramePointers(garbage.frame(0), garbage.end(), pcs, 8), 0u);
+
+  // The chain goes back towards the innermost frame.
+  FakeStack loop;
+  loop.SetRecord(0, loop.frame(4), 0x1000);
+  loop.SetRecord(4, loop.frame(0), 0x2000);
+  EXPECT_EQ(WalkFramePointers(loop.frame(0), loop.end(), pcs, 8), 0u);
+
+  // The last record is cut by the end of the stack.
+  FakeStack truncated;
+  truncated.SetRecord(0, truncated.frame(14), 0x1000);
+  EXPECT_EQ(
+      WalkFramePointers(truncated.frame(0), truncated.frame(15), pcs, 8), 0u);
+}
+
+TEST(WalkFramePointersTest, FramePointerOutOfStack) {
+  uint64_t pcs[8];
+  FakeStack stack;
+  FakeStack other_stack;
+  other_stack.SetRecord(0, nullptr, 0x2000);
+  stack.SetRecord(0, other_stack.frame(0), 0x1000);
+  EXPECT_EQ(WalkFramePointers(stack.frame(0), stack.end(), pcs, 8), 0u);
+
+  stack.SetRecord(0, stack.end(), 0x1000);
+  EXPECT_EQ(WalkFramePointers(stack.frame(0), stack.end(), pcs, 8), 0u);
+}
+
+uint64_t __attribute__((noinline)) GetReturnAddress() {
+  return reinterpret_cast<uint64_t>(__builtin_return_address(0));
+}
+
+TEST(UnwindingTest, DoFramePointerUnwind) {
+  base::ScopedFile proc_maps(base::OpenFile("/proc/self/maps", O_RDONLY));
+  base::ScopedFile proc_mem(base::OpenFile("/proc/self/mem", O_RDONLY));
+  UnwindingMetadata metadata(std::move(proc_maps), std::move(proc_mem));
+
+  AllocMetadata alloc_metadata = {};
+  alloc_metadata.arch = unwindstack::Regs::CurrentArch();
+  uint64_t pcs[] = {GetReturnAddress()};
+  WireMessage msg = {};
+  msg.record_type = RecordType::MallocFramePointers;
+  msg.alloc_header = &alloc_metadata;
+  msg.payload = reinterpret_cast<char*>(pcs);
+  msg.payload_size = sizeof(pcs);
+
+  AllocRecord out;
+  ASSERT_TRUE(DoFramePointerUnwind(&msg, &metadata, &out));
+  ASSERT_EQ(out.frames.size(), 1u);
+  EXPECT_FALSE(out.error);
+  int st;
+  std::unique_ptr<char, base::FreeDeleter> demangled(abi::__cxa_demangle(
+      out.frames[0].function_name.c_str(), nullptr, nullptr, &st));
+  ASSERT_EQ(st, 0) << "mangled: " << out.frames[0].function_name;
+  ASSERT_STREQ(demangled.get(),
+               "perfetto::profiling::(anonymous "
+               "namespace)::UnwindingTest_DoFramePointerUnwind_Test::"
+               "TestBody()");
+}
+
+TEST(UnwindingTest, DoFramePointerUnwindInvalidPc) {
+  base::ScopedFile proc_maps(base::OpenFile("/proc/self/maps", O_RDONLY));
+  base::ScopedFile proc_mem(base::OpenFile("/proc/self/mem", O_RDONLY));
+  UnwindingMetadata metadata(std::move(proc_maps), std::move(proc_mem));
+
+  AllocMetadata alloc_metadata = {};
+  alloc_metadata.arch = unwindstack::Regs::CurrentArch();
+  // Nothing is mapped at the first page.
+  uint64_t pcs[] = {GetReturnAddress(), 0x10};
+  WireMessage msg = {};
+  msg.record_type = RecordType::MallocFramePointers;
+  msg.alloc_header = &alloc_metadata;
+  msg.payload = reinterpret_cast<char*>(pcs);
+  msg.payload_size = sizeof(pcs);
+
+  AllocRecord out;
+  ASSERT_TRUE(DoFramePointerUnwind(&msg, &metadata, &out));
+  EXPECT_TRUE(out.error);
+  EXPECT_TRUE(out.reparsed_map);
+  ASSERT_EQ(out.frames.size(), 2u);
+  EXPECT_EQ(out.frames[1].function_name, "ERROR INVALID_MAP");
+  EXPECT_EQ(out.build_ids.size(), out.frames.size());
+}
+
 TEST(AllocRecordArenaTest, Smoke) {
   AllocRecordArena a;
   auto borrowed = a.BorrowAllocRecord();
@@ -90,7 +90,8 @@ int64_t WithBuffer(SharedRingBuffer* shmem, size_t total_size, F fn) {
 
 int64_t SendWireMessage(SharedRingBuffer* shmem, const WireMessage& msg) {
   switch (msg.record_type) {
-    case RecordType::Malloc: {
+    case RecordType::Malloc:
+    case RecordType::MallocFramePointers: {
       size_t total_size = sizeof(msg.record_type) + sizeof(*msg.alloc_header) +
                           msg.payload_size;
       return WithBuffer(
@@ -139,7 +140,8 @@ bool ReceiveWireMessage(char* buf, size_t size, WireMessage* out) {
   out->payload_size = 0;
   out->record_type = *record_type;
 
-  if (*record_type == RecordType::Malloc) {
+  if (*record_type == RecordType::Malloc ||
+      *record_type == RecordType::MallocFramePointers) {
     if (!ViewAndAdvance<AllocMetadata>(&buf, &out->alloc_header, end)) {
       PERFETTO_DFATAL_OR_ELOG("Cannot read alloc header.");
       return false;
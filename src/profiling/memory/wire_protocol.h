@@ -53,6 +53,9 @@ constexpr size_t kMaxRegisterDataSize =
 // and heapprofd. The basic format of a record sent by the client is
 // record size (uint64_t) | record type (RecordType = uint64_t) | record
 // If record type is Malloc, the record format is AllocMetadata | raw stack.
+// If record type is MallocFramePointers, the record format is AllocMetadata |
+// return addresses (uint64_t each), as found by walking the frame pointers in
+// the client. The registers and stack pointer in AllocMetadata are not used.
 // If the record type is Free, the record is a FreeEntry.
 // If record type is HeapName, the record is a HeapName.
 // On connect, heapprofd sends one ClientConfiguration struct over the control
@@ -81,6 +84,7 @@ struct ClientConfiguration {
   PERFETTO_CROSS_ABI_ALIGNED(bool) disable_fork_teardown;
   PERFETTO_CROSS_ABI_ALIGNED(bool) disable_vfork_detection;
   PERFETTO_CROSS_ABI_ALIGNED(bool) all_heaps;
+  PERFETTO_CROSS_ABI_ALIGNED(bool) frame_pointer_unwinding;
   // Just double check that the array sizes are in correct order.
 };
 
@@ -88,6 +92,7 @@ enum class RecordType : uint64_t {
   Free = 0,
   Malloc = 1,
   HeapName = 2,
+  MallocFramePointers = 3,
 };
 
 // Make the whole struct 8-aligned. This is to make sizeof(AllocMetadata)
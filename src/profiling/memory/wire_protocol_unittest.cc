@@ -104,6 +104,40 @@ TEST(WireProtocolTest, AllocMessage) {
   shmem_server->EndRead(std::move(buf));
 }
 
+TEST(WireProtocolTest, AllocFramePointersMessage) {
+  uint64_t pcs[] = {0x1111111111111111, 0x2222222222222222, 0x3333333333333333};
+  WireMessage msg = {};
+  msg.record_type = RecordType::MallocFramePointers;
+  AllocMetadata metadata = {};
+  metadata.sequence_number = 0xA1A2A3A4A5A6A7A8;
+  metadata.alloc_size = 0xB1B2B3B4B5B6B7B8;
+  metadata.alloc_address = 0xC1C2C3C4C5C6C7C8;
+  metadata.arch = unwindstack::ARCH_X86_64;
+  msg.alloc_header = &metadata;
+  msg.payload = reinterpret_cast<char*>(pcs);
+  msg.payload_size = sizeof(pcs);
+
+  auto shmem_client = SharedRingBuffer::Create(kShmemSize);
+  ASSERT_TRUE(shmem_client);
+  ASSERT_TRUE(shmem_client->is_valid());
+  auto shmem_server = SharedRingBuffer::Attach(CopyFD(shmem_client->fd()));
+
+  ASSERT_GE(SendWireMessage(&shmem_client.value(), msg), 0);
+
+  auto buf = shmem_server->BeginRead();
+  ASSERT_TRUE(buf);
+  WireMessage recv_msg;
+  ASSERT_TRUE(ReceiveWireMessage(reinterpret_cast<char*>(buf.data), buf.size,
+                                 &recv_msg));
+
+  ASSERT_EQ(recv_msg.record_type, RecordType::MallocFramePointers);
+  ASSERT_EQ(*recv_msg.alloc_header, *msg.alloc_header);
+  ASSERT_EQ(recv_msg.payload_size, sizeof(pcs));
+  ASSERT_EQ(memcmp(recv_msg.payload, pcs, sizeof(pcs)), 0);
+
+  shmem_server->EndRead(std::move(buf));
+}
+
 TEST(WireProtocolTest, FreeMessage) {
   WireMessage msg = {};
   msg.record_type = RecordType::Free;
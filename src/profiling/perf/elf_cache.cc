@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/profiling/perf/elf_cache.h"
+
+#include <sys/mman.h>
+
+#include <unwindstack/Maps.h>
+
+#include "perfetto/base/logging.h"
+
+namespace perfetto {
+namespace profiling {
+
+namespace {
+
+// Whether the Elf of |map_info| can be shared with the mappings of the same
+// file in other processes.
+bool IsCacheable(unwindstack::MapInfo* map_info) {
+  if (!(map_info->flags() & PROT_EXEC) ||
+      (map_info->flags() & unwindstack::MAPS_FLAGS_DEVICE_MAP)) {
+    return false;
+  }
+  const std::string& name = map_info->name();
+  return !name.empty() && name[0] == '/';
+}
+
+}  // namespace
+
+ElfCache::ElfCache(size_t max_entries) : max_entries_(max_entries) {
+  PERFETTO_CHECK(max_entries_ > 0);
+}
+
+ElfCache::~ElfCache() = default;
+
+size_t ElfCache::AttachCachedElfs(unwindstack::Maps* maps) {
+  std::vector<unwindstack::MapInfo*> candidates;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (names_.empty())
+      return 0;
+    for (const auto& map_info : *maps) {
+      if (IsCacheable(map_info.get()) && !map_info->elf() &&
+          names_.count(map_info->name()) > 0) {
+        candidates.push_back(map_info.get());
+      }
+    }
+  }
+
+  // Reading the build id (from the file) doesn't need the lock.
+  std::vector<std::string> build_ids;
+  build_ids.reserve(candidates.size());
+  for (unwindstack::MapInfo* map_info : candidates) {
+    std::string build_id = map_info->GetBuildID();
+    build_ids.push_back(std::move(build_id));
+  }
+
+  size_t attached = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (build_ids[i].empty())
+      continue;
+    unwindstack::MapInfo* map_info = candidates[i];
+    auto it = entries_.find(Key(build_ids[i], map_info->offset()));
+    if (it == entries_.end())
+      continue;
+    Entry& entry = it->second;
+    entry.last_use = ++use_counter_;
+    map_info->set_elf(entry.elf);
+    map_info->set_elf_offset(entry.elf_offset);
+    map_info->set_elf_start_offset(entry.elf_start_offset);
+    attached++;
+  }
+  return attached;
+}
+
+size_t ElfCache::AddElfs(const std::vector<unwindstack::MapInfo*>& map_infos) {
+  // As in AttachCachedElfs, get the build ids before taking the lock. They are
+  // usually known already, as the unwinder reads them for the sample.
+  std::vector<std::pair<unwindstack::MapInfo*, std::string>> candidates;
+  candidates.reserve(map_infos.size());
+  for (unwindstack::MapInfo* map_info : map_infos) {
+    std::shared_ptr<unwindstack::Elf> elf = map_info->elf();
+    if (!elf || !elf->valid() || map_info->memory_backed_elf() ||
+        !IsCacheable(map_info)) {
+      continue;
+    }
+    std::string build_id = map_info->GetBuildID();
+    if (build_id.empty())
+      continue;
+    candidates.emplace_back(map_info, std::move(build_id));
+  }
+
+  size_t added = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& candidate : candidates) {
+    unwindstack::MapInfo* map_info = candidate.first;
+    std::shared_ptr<unwindstack::Elf> elf = map_info->elf();
+    Key key(std::move(candidate.second), map_info->offset());
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      it->second.last_use = ++use_counter_;
+      // Parsed by another process before it made it into the cache.
+      if (it->second.elf != elf)
+        added++;
+      continue;
+    }
+
+    EvictIfFullLocked();
+    Entry& entry = entries_[key];
+    entry.elf = std::move(elf);
+    entry.elf_offset = map_info->elf_offset();
+    entry.elf_start_offset = map_info->elf_start_offset();
+    const std::string& name = map_info->name();
+    entry.name = name;
+    entry.last_use = ++use_counter_;
+    names_[entry.name]++;
+    added++;
+  }
+  return added;
+}
+
+size_t ElfCache::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void ElfCache::EvictIfFullLocked() {
+  if (entries_.size() < max_entries_)
+    return;
+  auto lru = entries_.begin();
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->second.last_use < lru->second.last_use)
+      lru = it;
+  }
+  auto name_it = names_.find(lru->second.name);
+  PERFETTO_DCHECK(name_it != names_.end());
+  if (--name_it->second == 0)
+    names_.erase(name_it);
+  // Mappings that use the Elf keep it alive through their shared_ptr.
+  entries_.erase(lru);
+}
+
+}  // namespace profiling
+}  // namespace perfetto
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_PROFILING_PERF_ELF_CACHE_H_
+#define SRC_PROFILING_PERF_ELF_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unwindstack/Elf.h>
+#include <unwindstack/MapInfo.h>
+
+namespace perfetto {
+namespace profiling {
+
+// Bounded cache of parsed |unwindstack::Elf| objects (unwind tables and
+// symbols), keyed by build id and mapping offset. Unlike the libunwindstack
+// Elf cache, which is keyed by path and dropped whenever traced_perf has no
+// active data sources, this cache outlives the data sources, so that short
+// back-to-back profiling sessions don't have to parse the same libraries
+// again. Keying by build id guarantees that a library that was replaced on
+// disk between sessions is not unwound with stale tables.
+//
+// The unwinders call |AttachCachedElfs| after (re)parsing the maps of a
+// process, and |AddElfs| with the maps used by an unwound sample. Only
+// file-backed Elfs are cached, as those don't reference the memory of the
+// process they were loaded for.
+//
+// Shared by all the unwinder threads, all the methods are thread-safe.
+class ElfCache {
+ public:
+  // |max_entries| must be > 0. Least recently used entries are evicted.
+  explicit ElfCache(size_t max_entries);
+  ~ElfCache();
+
+  ElfCache(const ElfCache&) = delete;
+  ElfCache& operator=(const ElfCache&) = delete;
+
+  // Sets the Elf of the mappings in |maps| for which there is a cache entry.
+  // Only the mappings of files that are in the cache are looked at, for the
+  // others this doesn't need to read the build id from the file. Returns the
+  // number of mappings that got their Elf from the cache.
+  size_t AttachCachedElfs(unwindstack::Maps* maps);
+
+  // Adds the Elfs loaded by the unwinder for |map_infos| to the cache.
+  // Returns the number of Elfs that were not in the cache, i.e. that had to
+  // be parsed.
+  size_t AddElfs(const std::vector<unwindstack::MapInfo*>& map_infos);
+
+  size_t size();
+
+ private:
+  // build id, mapping offset.
+  using Key = std::pair<std::string, uint64_t>;
+  struct Entry {
+    std::shared_ptr<unwindstack::Elf> elf;
+    uint64_t elf_offset = 0;
+    uint64_t elf_start_offset = 0;
+    std::string name;
+    uint64_t last_use = 0;
+  };
+
+  void EvictIfFullLocked();
+
+  const size_t max_entries_;
+
+  std::mutex mutex_;
+  std::map<Key, Entry> entries_;
+  // Number of entries for each file name, to skip reading the build id of
+  // the mappings of files which are not in the cache.
+  std::map<std::string, uint32_t> names_;
+  uint64_t use_counter_ = 0;
+};
+
+}  // namespace profiling
+}  // namespace perfetto
+
+#endif  // SRC_PROFILING_PERF_ELF_CACHE_H_
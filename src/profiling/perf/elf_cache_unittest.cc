@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/profiling/perf/elf_cache.h"
+
+#include <sys/mman.h>
+
+#include <memory>
+#include <string>
+
+#include <unwindstack/Maps.h>
+#include <unwindstack/Regs.h>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace profiling {
+namespace {
+
+// Any Elf file works, the cache doesn't look at its contents. The build ids
+// are set explicitly to emulate different versions of the file.
+constexpr char kElfPath[] = "/proc/self/exe";
+constexpr uint64_t kFlags = PROT_READ | PROT_EXEC;
+
+// A mapping whose Elf was loaded by the unwinder.
+std::shared_ptr<unwindstack::MapInfo> LoadedMapping(const std::string& build_id,
+                                                    uint64_t offset = 0) {
+  auto map_info =
+      unwindstack::MapInfo::Create(0x1000, 0x2000, offset, kFlags, kElfPath);
+  map_info->SetBuildID(std::string(build_id));
+  // Parse the file from the start regardless of |offset|, the cache only
+  // uses the offset as part of the key.
+  auto elf_map_info =
+      unwindstack::MapInfo::Create(0x1000, 0x2000, 0, kFlags, kElfPath);
+  elf_map_info->GetElf(nullptr, unwindstack::Regs::CurrentArch());
+  map_info->set_elf(elf_map_info->elf());
+  return map_info;
+}
+
+// Reparsed maps of a process, with a single mapping that has no Elf yet.
+std::unique_ptr<unwindstack::Maps> ParsedMaps(const std::string& build_id,
+                                              uint64_t offset = 0) {
+  std::unique_ptr<unwindstack::Maps> maps(new unwindstack::Maps);
+  maps->Add(0x1000, 0x2000, offset, kFlags, kElfPath);
+  maps->Get(0)->SetBuildID(std::string(build_id));
+  return maps;
+}
+
+TEST(ElfCacheTest, AttachesAddedElfs) {
+  ElfCache cache(4);
+  auto loaded = LoadedMapping("id1");
+  ASSERT_TRUE(loaded->elf() && loaded->elf()->valid());
+
+  EXPECT_EQ(cache.AddElfs({loaded.get()}), 1u);
+  EXPECT_EQ(cache.AddElfs({loaded.get()}), 0u);
+  EXPECT_EQ(cache.size(), 1u);
+
+  auto maps = ParsedMaps("id1");
+  EXPECT_EQ(cache.AttachCachedElfs(maps.get()), 1u);
+  EXPECT_EQ(maps->Get(0)->elf(), loaded->elf());
+}
+
+TEST(ElfCacheTest, KeyedByBuildIdAndOffset) {
+  ElfCache cache(4);
+  auto at_zero = LoadedMapping("id1", 0);
+  auto at_offset = LoadedMapping("id1", 0x4000);
+  EXPECT_EQ(cache.AddElfs({at_zero.get(), at_offset.get()}), 2u);
+  EXPECT_EQ(cache.size(), 2u);
+
+  auto maps = ParsedMaps("id1", 0x4000);
+  EXPECT_EQ(cache.AttachCachedElfs(maps.get()), 1u);
+  EXPECT_EQ(maps->Get(0)->elf(), at_offset->elf());
+
+  auto other_offset = ParsedMaps("id1", 0x8000);
+  EXPECT_EQ(cache.AttachCachedElfs(other_offset.get()), 0u);
+  EXPECT_EQ(other_offset->Get(0)->elf(), nullptr);
+}
+
+TEST(ElfCacheTest, ReplacedFileMisses) {
+  ElfCache cache(4);
+  auto old_version = LoadedMapping("old");
+  EXPECT_EQ(cache.AddElfs({old_version.get()}), 1u);
+
+  // Same path and offset, but the file was replaced on disk.
+  auto maps = ParsedMaps("new");
+  EXPECT_EQ(cache.AttachCachedElfs(maps.get()), 0u);
+  EXPECT_EQ(maps->Get(0)->elf(), nullptr);
+
+  // Once unwound, the new version is cached next to the old one.
+  auto new_version = LoadedMapping("new");
+  EXPECT_EQ(cache.AddElfs({new_version.get()}), 1u);
+  EXPECT_EQ(cache.size(), 2u);
+}
+
+TEST(ElfCacheTest, EvictsLeastRecentlyUsed) {
+  ElfCache cache(2);
+  auto first = LoadedMapping("id1");
+  auto second = LoadedMapping("id2");
+  EXPECT_EQ(cache.AddElfs({first.get()}), 1u);
+  EXPECT_EQ(cache.AddElfs({second.get()}), 1u);
+
+  // Using |first| again makes |second| the least recently used.
+  auto maps = ParsedMaps("id1");
+  EXPECT_EQ(cache.AttachCachedElfs(maps.get()), 1u);
+
+  auto third = LoadedMapping("id3");
+  EXPECT_EQ(cache.AddElfs({third.get()}), 1u);
+  EXPECT_EQ(cache.size(), 2u);
+
+  auto first_maps = ParsedMaps("id1");
+  auto second_maps = ParsedMaps("id2");
+  auto third_maps = ParsedMaps("id3");
+  EXPECT_EQ(cache.AttachCachedElfs(first_maps.get()), 1u);
+  EXPECT_EQ(cache.AttachCachedElfs(second_maps.get()), 0u);
+  EXPECT_EQ(cache.AttachCachedElfs(third_maps.get()), 1u);
+}
+
+}  // namespace
+}  // namespace profiling
+}  // namespace perfetto
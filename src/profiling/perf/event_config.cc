@@ -473,7 +473,8 @@ std::optional<EventConfig> EventConfig::CreatePolling(
   // Double-check that the config isn't trying to set options that are known to
   // be incompatible with polling.
   if (pb_config.has_callstack_sampling() ||
-      pb_config.ring_buffer_read_period_ms() || pb_config.all_cpus()) {
+      pb_config.ring_buffer_read_period_ms() || pb_config.all_cpus() ||
+      pb_config.ring_buffer_wakeup_watermark_percent()) {
     PERFETTO_ELOG(
         "Config requesting options incompatible with polled counters");
     return std::nullopt;
@@ -487,7 +488,8 @@ std::optional<EventConfig> EventConfig::CreatePolling(
       /*kernel_frames=*/false,
       /*unwind_mode=*/protos::gen::PerfEventConfig::UNWIND_SKIP,
       /*target_filter=*/{}, /*ring_buffer_pages=*/0, poll_period_ms,
-      /*samples_per_tick_limit=*/1, /*remote_descriptor_timeout_ms=*/0,
+      /*samples_per_tick_limit=*/1, /*wakeup_watermark_bytes=*/0,
+      /*remote_descriptor_timeout_ms=*/0,
       /*unwind_state_clear_period_ms=*/0,
       /*max_enqueued_footprint_bytes=*/0, /*target_installed_by=*/{});
 }
@@ -579,6 +581,17 @@ std::optional<EventConfig> EventConfig::CreateSampling(
   if (samples_per_tick_limit == 0)
     return std::nullopt;
 
+  // Optional wakeups when a ring buffer fills up past the watermark.
+  uint32_t wakeup_watermark_percent =
+      pb_config.ring_buffer_wakeup_watermark_percent();
+  if (wakeup_watermark_percent > 100) {
+    PERFETTO_ELOG("ring_buffer_wakeup_watermark_percent must be <= 100");
+    return std::nullopt;
+  }
+  uint32_t wakeup_watermark_bytes = static_cast<uint32_t>(
+      uint64_t{*ring_buffer_pages} * base::GetSysPageSize() *
+      wakeup_watermark_percent / 100);
+
   // Optional footprint controls.
   uint64_t max_enqueued_footprint_bytes =
       pb_config.max_enqueued_footprint_kb() * 1024;
@@ -598,6 +611,10 @@ std::optional<EventConfig> EventConfig::CreateSampling(
   perf_event_attr pe = {};
   pe.size = sizeof(perf_event_attr);
   pe.disabled = 1;  // will be activated via ioctl
+  if (wakeup_watermark_bytes) {
+    pe.watermark = 1;
+    pe.wakeup_watermark = wakeup_watermark_bytes;
+  }
 
   // Sampling timebase.
   pe.type = timebase_event.attr_type;
@@ -668,8 +685,9 @@ std::optional<EventConfig> EventConfig::CreateSampling(
       raw_ds_config, pe, std::move(pe_followers), std::move(timebase_event),
       std::move(followers), RecordingMode::kSampling, kernel_frames,
       unwind_mode, std::move(target_filter), ring_buffer_pages.value(),
-      read_tick_period_ms, samples_per_tick_limit, remote_descriptor_timeout_ms,
-      unwind_state_clear_period_ms, max_enqueued_footprint_bytes,
+      read_tick_period_ms, samples_per_tick_limit, wakeup_watermark_bytes,
+      remote_descriptor_timeout_ms, unwind_state_clear_period_ms,
+      max_enqueued_footprint_bytes,
       pb_config.target_installed_by());
 }
 
@@ -701,6 +719,7 @@ EventConfig::EventConfig(const DataSourceConfig& raw_ds_config,
                          uint32_t ring_buffer_pages,
                          uint32_t read_tick_period_ms,
                          uint64_t samples_per_tick_limit,
+                         uint32_t wakeup_watermark_bytes,
                          uint32_t remote_descriptor_timeout_ms,
                          uint32_t unwind_state_clear_period_ms,
                          uint64_t max_enqueued_footprint_bytes,
@@ -716,6 +735,7 @@ EventConfig::EventConfig(const DataSourceConfig& raw_ds_config,
       ring_buffer_pages_(ring_buffer_pages),
       read_tick_period_ms_(read_tick_period_ms),
       samples_per_tick_limit_(samples_per_tick_limit),
+      wakeup_watermark_bytes_(wakeup_watermark_bytes),
       remote_descriptor_timeout_ms_(remote_descriptor_timeout_ms),
       unwind_state_clear_period_ms_(unwind_state_clear_period_ms),
       max_enqueued_footprint_bytes_(max_enqueued_footprint_bytes),
@@ -127,6 +127,7 @@ class EventConfig {
   uint32_t ring_buffer_pages() const { return ring_buffer_pages_; }
   uint32_t read_tick_period_ms() const { return read_tick_period_ms_; }
   uint64_t samples_per_tick_limit() const { return samples_per_tick_limit_; }
+  uint32_t wakeup_watermark_bytes() const { return wakeup_watermark_bytes_; }
   uint32_t remote_descriptor_timeout_ms() const { return remote_descriptor_timeout_ms_; }
   uint32_t unwind_state_clear_period_ms() const { return unwind_state_clear_period_ms_; }
   uint64_t max_enqueued_footprint_bytes() const { return max_enqueued_footprint_bytes_; }
@@ -160,6 +161,7 @@ class EventConfig {
               uint32_t ring_buffer_pages,
               uint32_t read_tick_period_ms,
               uint64_t samples_per_tick_limit,
+              uint32_t wakeup_watermark_bytes,
               uint32_t remote_descriptor_timeout_ms,
               uint32_t unwind_state_clear_period_ms,
               uint64_t max_enqueued_footprint_bytes,
@@ -218,6 +220,11 @@ class EventConfig {
   // *each* per-cpu buffer.
   const uint64_t samples_per_tick_limit_;
 
+  // If non-zero, the kernel signals the readability of the perf fd once the
+  // ring buffer holds this many bytes, and the producer reads the buffer as
+  // soon as it does, in addition to the read ticks.
+  const uint32_t wakeup_watermark_bytes_;
+
   // Timeout for proc-fd lookup.
   const uint32_t remote_descriptor_timeout_ms_;
 
@@ -22,6 +22,7 @@
 #include <optional>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/utils.h"
 #include "test/gtest_and_gmock.h"
 
 #include "protos/perfetto/common/perf_events.gen.h"
@@ -103,6 +104,37 @@ TEST(EventConfigTest, ReadTickPeriodDefaultedIfUnset) {
   }
 }
 
+TEST(EventConfigTest, WakeupWatermark) {
+  {  // if unset, no watermark
+    protos::gen::PerfEventConfig cfg;
+    std::optional<EventConfig> event_config = CreateEventConfig(cfg);
+
+    ASSERT_TRUE(event_config.has_value());
+    EXPECT_EQ(event_config->wakeup_watermark_bytes(), 0u);
+    EXPECT_EQ(event_config->perf_attr()->watermark, 0u);
+  }
+  {  // percentage of the ring buffer size
+    protos::gen::PerfEventConfig cfg;
+    cfg.set_ring_buffer_pages(128);
+    cfg.set_ring_buffer_wakeup_watermark_percent(25);
+    std::optional<EventConfig> event_config = CreateEventConfig(cfg);
+
+    ASSERT_TRUE(event_config.has_value());
+    uint32_t expected_bytes =
+        static_cast<uint32_t>(32 * base::GetSysPageSize());
+    EXPECT_EQ(event_config->wakeup_watermark_bytes(), expected_bytes);
+    EXPECT_EQ(event_config->perf_attr()->watermark, 1u);
+    EXPECT_EQ(event_config->perf_attr()->wakeup_watermark, expected_bytes);
+  }
+  {  // rejected if above 100%
+    protos::gen::PerfEventConfig cfg;
+    cfg.set_ring_buffer_wakeup_watermark_percent(101);
+    std::optional<EventConfig> event_config = CreateEventConfig(cfg);
+
+    ASSERT_FALSE(event_config.has_value());
+  }
+}
+
 TEST(EventConfigTest, RemotePeriodTimeoutDefaultedIfUnset) {
   {  // if unset, a default is used
     protos::gen::PerfEventConfig cfg;
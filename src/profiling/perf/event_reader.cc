@@ -195,6 +195,14 @@ char* PerfRingBuffer::ReadRecordNonconsuming() {
   }
 }
 
+bool PerfRingBuffer::HasPendingRecords() const {
+  PERFETTO_DCHECK(valid());
+  uint64_t write_offset =
+      reinterpret_cast<std::atomic<uint64_t>*>(&metadata_page_->data_head)
+          ->load(std::memory_order_relaxed);
+  return write_offset != metadata_page_->data_tail;
+}
+
 void PerfRingBuffer::Consume(size_t bytes) {
   PERFETTO_DCHECK(valid());
 
@@ -46,6 +46,10 @@ class PerfRingBuffer {
   char* ReadRecordNonconsuming();
   void Consume(size_t bytes);
 
+  // Cheap check for whether the kernel has written any records that haven't
+  // been consumed yet.
+  bool HasPendingRecords() const;
+
  private:
   PerfRingBuffer() = default;
 
@@ -92,7 +96,16 @@ class EventReader {
   // Pauses the event counting, without invalidating existing samples.
   void DisableEvents();
 
+  // Whether the ring buffer has records that haven't been read yet. Always
+  // false if polling counters.
+  bool HasPendingRecords() const {
+    return ring_buffer_.has_value() && ring_buffer_->HasPendingRecords();
+  }
+
   uint32_t cpu() const { return cpu_; }
+  // The timebase event's fd. If the events were configured with a wakeup
+  // watermark, it becomes readable once the ring buffer fills past it.
+  int perf_fd() const { return *perf_fd_; }
 
   ~EventReader() = default;
 
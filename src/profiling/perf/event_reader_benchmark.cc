@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the two ways traced_perf reads the per-cpu ring buffers:
+// * Tick: every read period, walk all the buffers.
+// * Watermark: wait for the kernel to signal the perf fds of the buffers
+//   filled past the wakeup watermark and read only those, with the read
+//   period as a timeout for the records below the watermark.
+// Reports the records read per second and the cpu time of the reading thread
+// as a percentage of the wall time. Needs perf_event_open permissions for
+// cpu-wide events (e.g. perf_event_paranoid <= 0).
+
+#include <benchmark/benchmark.h>
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <optional>
+#include <vector>
+
+#include "perfetto/base/time.h"
+#include "perfetto/ext/base/utils.h"
+#include "src/profiling/perf/event_config.h"
+#include "src/profiling/perf/event_reader.h"
+
+#include "protos/perfetto/common/perf_events.gen.h"
+#include "protos/perfetto/config/data_source_config.gen.h"
+#include "protos/perfetto/config/profiling/perf_event_config.gen.h"
+
+namespace perfetto {
+namespace profiling {
+namespace {
+
+constexpr uint64_t kSamplingFrequency = 4000;
+constexpr uint32_t kReadPeriodMs = 10;
+constexpr uint32_t kWatermarkPercent = 25;
+
+std::optional<EventConfig> CreateEventConfig(bool watermark) {
+  protos::gen::PerfEventConfig cfg;
+  cfg.mutable_timebase()->set_counter(protos::gen::PerfEvents::SW_CPU_CLOCK);
+  cfg.mutable_timebase()->set_frequency(kSamplingFrequency);
+  cfg.set_ring_buffer_read_period_ms(kReadPeriodMs);
+  if (watermark)
+    cfg.set_ring_buffer_wakeup_watermark_percent(kWatermarkPercent);
+
+  protos::gen::DataSourceConfig ds_cfg;
+  ds_cfg.set_perf_event_config_raw(cfg.SerializeAsString());
+  return EventConfig::Create(
+      cfg, ds_cfg, /*process_sharding=*/std::nullopt,
+      [](const std::string&, const std::string&) { return 0; });
+}
+
+std::vector<EventReader> CreateReaders(const EventConfig& event_config) {
+  std::vector<EventReader> readers;
+  long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+  for (uint32_t cpu = 0; cpu < static_cast<uint32_t>(num_cpus); cpu++) {
+    std::optional<EventReader> reader =
+        EventReader::ConfigureEvents(cpu, event_config);
+    if (!reader)
+      return {};
+    readers.emplace_back(std::move(*reader));
+  }
+  return readers;
+}
+
+int64_t ThreadCpuTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return base::FromPosixTimespec(ts).count();
+}
+
+uint64_t ReadAll(EventReader* reader, uint64_t* lost) {
+  uint64_t records = 0;
+  while (reader->ReadUntilSample([lost](uint64_t n) { *lost += n; }))
+    records++;
+  return records;
+}
+
+void BM_PerfEventReader(benchmark::State& state, bool watermark) {
+  std::optional<EventConfig> event_config = CreateEventConfig(watermark);
+  PERFETTO_CHECK(event_config);
+  std::vector<EventReader> readers = CreateReaders(*event_config);
+  if (readers.empty()) {
+    state.SkipWithError("perf_event_open failed");
+    return;
+  }
+  std::vector<struct pollfd> pollfds;
+  for (EventReader& reader : readers)
+    pollfds.push_back({reader.perf_fd(), POLLIN, 0});
+  for (EventReader& reader : readers)
+    reader.EnableEvents();
+
+  uint64_t records = 0;
+  uint64_t lost = 0;
+  int64_t wall_start_ns = base::GetWallTimeNs().count();
+  int64_t cpu_start_ns = ThreadCpuTimeNs();
+  for (auto _ : state) {
+    if (!watermark) {
+      // One read tick.
+      base::SleepMicroseconds(kReadPeriodMs * 1000);
+      for (EventReader& reader : readers)
+        records += ReadAll(&reader, &lost);
+      continue;
+    }
+    int ret = PERFETTO_EINTR(poll(pollfds.data(), pollfds.size(),
+                                  static_cast<int>(kReadPeriodMs)));
+    PERFETTO_CHECK(ret >= 0);
+    for (size_t i = 0; i < readers.size(); i++) {
+      // On timeout, read whatever is below the watermark.
+      bool ready = ret == 0 ? readers[i].HasPendingRecords()
+                            : (pollfds[i].revents & POLLIN) != 0;
+      if (ready)
+        records += ReadAll(&readers[i], &lost);
+    }
+  }
+  int64_t cpu_ns = ThreadCpuTimeNs() - cpu_start_ns;
+  int64_t wall_ns = base::GetWallTimeNs().count() - wall_start_ns;
+
+  for (EventReader& reader : readers)
+    reader.DisableEvents();
+
+  state.SetItemsProcessed(static_cast<int64_t>(records));
+  state.counters["lost"] = static_cast<double>(lost);
+  state.counters["cpus"] = static_cast<double>(readers.size());
+  state.counters["reader_cpu_pct"] =
+      100.0 * static_cast<double>(cpu_ns) / static_cast<double>(wall_ns);
+}
+
+void BM_PerfEventReaderTick(benchmark::State& state) {
+  BM_PerfEventReader(state, /*watermark=*/false);
+}
+
+void BM_PerfEventReaderWatermark(benchmark::State& state) {
+  BM_PerfEventReader(state, /*watermark=*/true);
+}
+
+}  // namespace
+
+BENCHMARK(BM_PerfEventReaderTick)->UseRealTime()->MinTime(2);
+BENCHMARK(BM_PerfEventReaderWatermark)->UseRealTime()->MinTime(2);
+
+}  // namespace profiling
+}  // namespace perfetto
@@ -411,14 +411,23 @@ bool PerfProducer::ShouldRejectDueToFilter(
 }
 
 PerfProducer::PerfProducer(ProcDescriptorGetter* proc_fd_getter,
-                           base::TaskRunner* task_runner)
+                           base::TaskRunner* task_runner,
+                           uint32_t unwinder_threads,
+                           ElfCache* elf_cache)
     : task_runner_(task_runner),
       proc_fd_getter_(proc_fd_getter),
-      unwinding_worker_(this),
+      unwinder_threads_(unwinder_threads),
+      elf_cache_(elf_cache),
+      unwinders_(this, unwinder_threads, elf_cache),
       weak_factory_(this) {
   proc_fd_getter->SetDelegate(this);
 }
 
+PerfProducer::~PerfProducer() {
+  for (auto& id_and_ds : data_sources_)
+    StopWatchingRingBuffers(&id_and_ds.second);
+}
+
 void PerfProducer::SetupDataSource(DataSourceInstanceID,
                                    const DataSourceConfig&) {}
 
@@ -510,6 +519,20 @@ void PerfProducer::StartDataSource(DataSourceInstanceID ds_id,
     per_cpu_reader.EnableEvents();
   }
 
+  // Optionally, read each ring buffer as soon as the kernel signals that it is
+  // past the watermark, rather than only on the read ticks.
+  if (ds.event_config.wakeup_watermark_bytes()) {
+    auto weak_this = weak_factory_.GetWeakPtr();
+    for (size_t i = 0; i < ds.per_cpu_readers.size(); i++) {
+      task_runner_->AddFileDescriptorWatch(
+          ds.per_cpu_readers[i].perf_fd(), [weak_this, ds_id, i] {
+            if (weak_this)
+              weak_this->OnRingBufferWakeup(ds_id, i);
+          });
+    }
+    ds.watching_ring_buffers = true;
+  }
+
   WritePerfEventDefaultsPacket(ds.event_config, ds.trace_writer.get());
 
   // Enqueue the periodic read task.
@@ -539,12 +562,13 @@ void PerfProducer::StartDataSource(DataSourceInstanceID ds_id,
                       protos::gen::PerfEventConfig::UNWIND_FRAME_POINTER)
                          ? Unwinder::UnwindMode::kFramePointer
                          : Unwinder::UnwindMode::kUnwindStack;
-  unwinding_worker_->PostStartDataSource(ds_id, ds.event_config.kernel_frames(),
-                                         unwind_mode);
-  if (ds.event_config.unwind_state_clear_period_ms()) {
-    unwinding_worker_->PostClearCachedStatePeriodic(
-        ds_id, ds.event_config.unwind_state_clear_period_ms());
-  }
+  bool kernel_frames = ds.event_config.kernel_frames();
+  uint32_t clear_period_ms = ds.event_config.unwind_state_clear_period_ms();
+  unwinders_.ForEach([&](Unwinder* unwinder) {
+    unwinder->PostStartDataSource(ds_id, kernel_frames, unwind_mode);
+    if (clear_period_ms)
+      unwinder->PostClearCachedStatePeriodic(ds_id, clear_period_ms);
+  });
 
   // Optionally kick off periodic memory footprint limit check.
   uint32_t max_daemon_memory_kb = event_config_pb.max_daemon_memory_kb();
@@ -723,22 +747,54 @@ bool PerfProducer::ReadRingBuffers(DataSourceInstanceID ds_id,
   uint64_t max_samples = ds.event_config.samples_per_tick_limit();
   bool more_records_available = false;
   for (EventReader& reader : ds.per_cpu_readers) {
+    // Most buffers are empty on machines with many cpus.
+    if (!reader.HasPendingRecords())
+      continue;
     if (ReadAndParsePerCpuBuffer(&reader, max_samples, ds_id, ds)) {
       more_records_available = true;
     }
   }
 
-  // Wake up the unwinder as we've (likely) pushed samples into its queue.
-  unwinding_worker_->PostProcessQueue();
+  // Wake up the unwinders as we've (likely) pushed samples into their queues.
+  unwinders_.ForEach([](Unwinder* unwinder) { unwinder->PostProcessQueue(); });
 
   if (PERFETTO_UNLIKELY(ds.status == DataSourceState::Status::kShuttingDown) &&
       !more_records_available) {
-    unwinding_worker_->PostInitiateDataSourceStop(ds_id);
+    ds.unwinders_pending_stop = unwinders_.size();
+    unwinders_.ForEach([ds_id](Unwinder* unwinder) {
+      unwinder->PostInitiateDataSourceStop(ds_id);
+    });
     return false;  // stop reposting the read callback
   }
   return true;  // continue reading
 }
 
+void PerfProducer::OnRingBufferWakeup(DataSourceInstanceID ds_id,
+                                      size_t index) {
+  auto it = data_sources_.find(ds_id);
+  if (it == data_sources_.end())
+    return;
+  DataSourceState& ds = it->second;
+  // While stopping, the read ticks drain the buffers and decide when the
+  // unwinders can be told to stop.
+  if (ds.status != DataSourceState::Status::kActive)
+    return;
+
+  PERFETTO_METATRACE_SCOPED(TAG_PRODUCER, PROFILER_READ_TICK);
+  ReadAndParsePerCpuBuffer(&ds.per_cpu_readers[index],
+                           ds.event_config.samples_per_tick_limit(), ds_id,
+                           ds);
+  unwinders_.ForEach([](Unwinder* unwinder) { unwinder->PostProcessQueue(); });
+}
+
+void PerfProducer::StopWatchingRingBuffers(DataSourceState* ds) {
+  if (!ds->watching_ring_buffers)
+    return;
+  for (EventReader& reader : ds->per_cpu_readers)
+    task_runner_->RemoveFileDescriptorWatch(reader.perf_fd());
+  ds->watching_ring_buffers = false;
+}
+
 bool PerfProducer::ReadAndParsePerCpuBuffer(EventReader* reader,
                                             uint64_t max_samples,
                                             DataSourceInstanceID ds_id,
@@ -842,7 +898,7 @@ bool PerfProducer::ReadAndParsePerCpuBuffer(EventReader* reader,
         // Either a kernel thread (no need to obtain proc-fds), or a userspace
         // process but we're not recording userspace callstacks.
         process_state = ProcessTrackingStatus::kAccepted;
-        unwinding_worker_->PostRecordNoUserspaceProcess(ds_id, pid);
+        unwinders_.ForPid(pid)->PostRecordNoUserspaceProcess(ds_id, pid);
         // note: fallthrough
       }
     }
@@ -865,7 +921,7 @@ bool PerfProducer::ReadAndParsePerCpuBuffer(EventReader* reader,
     uint64_t max_footprint_bytes = event_config.max_enqueued_footprint_bytes();
     uint64_t sample_stack_size = sample->stack.size();
     if (max_footprint_bytes) {
-      uint64_t footprint_bytes = unwinding_worker_->GetEnqueuedFootprint();
+      uint64_t footprint_bytes = unwinders_.GetEnqueuedFootprint();
       if (footprint_bytes + sample_stack_size >= max_footprint_bytes) {
         PERFETTO_DLOG("Skipping sample enqueueing due to footprint limit.");
         EmitSkippedSample(ds_id, std::move(sample.value()),
@@ -874,14 +930,16 @@ bool PerfProducer::ReadAndParsePerCpuBuffer(EventReader* reader,
       }
     }
 
-    // Push the sample into the unwinding queue if there is room.
-    auto& queue = unwinding_worker_->unwind_queue();
+    // Push the sample into the unwinding queue of the process' unwinder if
+    // there is room.
+    Unwinder* unwinder = unwinders_.ForPid(pid);
+    auto& queue = unwinder->unwind_queue();
     WriteView write_view = queue.BeginWrite();
     if (write_view.valid) {
       queue.at(write_view.write_pos) =
           UnwindEntry{ds_id, std::move(sample.value())};
       queue.CommitWrite();
-      unwinding_worker_->IncrementEnqueuedFootprint(sample_stack_size);
+      unwinder->IncrementEnqueuedFootprint(sample_stack_size);
     } else {
       PERFETTO_DLOG("Unwinder queue full, skipping sample");
       EmitSkippedSample(ds_id, std::move(sample.value()),
@@ -927,7 +985,7 @@ void PerfProducer::OnProcDescriptors(pid_t pid,
                     static_cast<int>(pid), static_cast<size_t>(it.first));
 
       proc_status_it->second = ProcessTrackingStatus::kAccepted;
-      unwinding_worker_->PostAdoptProcDescriptors(
+      unwinders_.ForPid(pid)->PostAdoptProcDescriptors(
           it.first, pid, std::move(maps_fd), std::move(mem_fd));
       return;  // done
     }
@@ -990,7 +1048,7 @@ void PerfProducer::EvaluateDescriptorLookupTimeout(DataSourceInstanceID ds_id,
     proc_status_it->second = ProcessTrackingStatus::kFdsTimedOut;
     // Also inform the unwinder of the state change (so that it can discard any
     // of the already-enqueued samples).
-    unwinding_worker_->PostRecordTimedOutProcDescriptors(ds_id, pid);
+    unwinders_.ForPid(pid)->PostRecordTimedOutProcDescriptors(ds_id, pid);
   }
 }
 
@@ -1093,6 +1151,32 @@ void PerfProducer::EmitRingBufferLoss(DataSourceInstanceID ds_id,
   perf_sample->set_kernel_records_lost(records_lost);
 }
 
+void PerfProducer::EmitUnwinderStats(DataSourceState& ds) {
+  if (!ds.event_config.sample_callstacks())
+    return;
+
+  for (uint32_t i = 0; i < unwinders_.size(); i++) {
+    Unwinder::Stats stats = unwinders_.at(i)->GetStats();
+
+    auto packet = StartTracePacket(ds.trace_writer.get());
+    packet->set_timestamp(static_cast<uint64_t>(base::GetBootTimeNs().count()));
+    packet->set_timestamp_clock_id(
+        protos::pbzero::BuiltinClock::BUILTIN_CLOCK_BOOTTIME);
+
+    auto* unwinder_stats = packet->set_perf_sample()->set_unwinder_stats();
+    unwinder_stats->set_unwinder_index(i);
+    unwinder_stats->set_samples_unwound(stats.samples_unwound);
+    unwinder_stats->set_max_queue_depth(stats.max_queue_depth);
+    unwinder_stats->set_unwind_time_total_us(stats.unwind_time_total_ns /
+                                             1000);
+    unwinder_stats->set_unwind_time_max_us(stats.unwind_time_max_ns / 1000);
+    if (elf_cache_) {
+      unwinder_stats->set_elf_cache_hits(stats.elf_cache_hits);
+      unwinder_stats->set_elf_cache_misses(stats.elf_cache_misses);
+    }
+  }
+}
+
 void PerfProducer::PostEmitUnwinderSkippedSample(DataSourceInstanceID ds_id,
                                                  ParsedSample sample) {
   PostEmitSkippedSample(ds_id, std::move(sample),
@@ -1184,7 +1268,14 @@ void PerfProducer::FinishDataSourceStop(DataSourceInstanceID ds_id) {
   DataSourceState& ds = ds_it->second;
   PERFETTO_CHECK(ds.status == DataSourceState::Status::kShuttingDown);
 
+  // Wait for all the unwinders to be done with the data source.
+  PERFETTO_CHECK(ds.unwinders_pending_stop > 0);
+  if (--ds.unwinders_pending_stop > 0)
+    return;
+
+  EmitUnwinderStats(ds);
   ds.trace_writer->Flush();
+  StopWatchingRingBuffers(&ds);
   data_sources_.erase(ds_it);
 
   endpoint_->NotifyDataSourceStopped(ds_id);
@@ -1214,7 +1305,10 @@ void PerfProducer::PurgeDataSource(DataSourceInstanceID ds_id) {
   PERFETTO_LOG("Stopping DataSource(%zu) prematurely",
                static_cast<size_t>(ds_id));
 
-  unwinding_worker_->PostPurgeDataSource(ds_id);
+  unwinders_.ForEach(
+      [ds_id](Unwinder* unwinder) { unwinder->PostPurgeDataSource(ds_id); });
+
+  EmitUnwinderStats(ds);
 
   // Write a packet indicating the abrupt stop.
   {
@@ -1229,6 +1323,7 @@ void PerfProducer::PurgeDataSource(DataSourceInstanceID ds_id) {
   }
 
   ds.trace_writer->Flush();
+  StopWatchingRingBuffers(&ds);
   data_sources_.erase(ds_it);
 
   // Clean up resources if there are no more active sources.
@@ -1372,10 +1467,13 @@ void PerfProducer::Restart() {
   base::TaskRunner* task_runner = task_runner_;
   const char* socket_name = producer_socket_name_;
   ProcDescriptorGetter* proc_fd_getter = proc_fd_getter_;
+  uint32_t unwinder_threads = unwinder_threads_;
+  ElfCache* elf_cache = elf_cache_;
 
   // Invoke destructor and then the constructor again.
   this->~PerfProducer();
-  new (this) PerfProducer(proc_fd_getter, task_runner);
+  new (this)
+      PerfProducer(proc_fd_getter, task_runner, unwinder_threads, elf_cache);
 
   ConnectWithRetries(socket_name);
 }
@@ -48,14 +48,17 @@ namespace profiling {
 // summary in the mean time: three stages: (1) kernel buffer reader that parses
 // the samples -> (2) callstack unwinder -> (3) interning and serialization of
 // samples. This class handles stages (1) and (3) on the main thread. Unwinding
-// is done by |Unwinder| on a dedicated thread.
+// is done by a pool of |Unwinder|s, each on a dedicated thread, with the
+// sampled processes sharded across them by pid.
 class PerfProducer : public Producer,
                      public ProcDescriptorDelegate,
                      public Unwinder::Delegate {
  public:
   PerfProducer(ProcDescriptorGetter* proc_fd_getter,
-               base::TaskRunner* task_runner);
-  ~PerfProducer() override = default;
+               base::TaskRunner* task_runner,
+               uint32_t unwinder_threads = 1,
+               ElfCache* elf_cache = nullptr);
+  ~PerfProducer() override;
 
   PerfProducer(const PerfProducer&) = delete;
   PerfProducer& operator=(const PerfProducer&) = delete;
@@ -164,6 +167,12 @@ class PerfProducer : public Producer,
     // Additional state for EventConfig.TargetFilter: command lines we have
     // decided to unwind, up to a total of additional_cmdline_count values.
     base::FlatSet<std::string> additional_cmdlines;
+    // While stopping: number of unwinders that haven't yet called back with
+    // |PostFinishDataSourceStop|.
+    uint32_t unwinders_pending_stop = 0;
+    // Whether the perf fds of |per_cpu_readers| are watched for watermark
+    // wakeups (see |EventConfig::wakeup_watermark_bytes|).
+    bool watching_ring_buffers = false;
   };
 
   // For |EmitSkippedSample|.
@@ -185,6 +194,11 @@ class PerfProducer : public Producer,
   void ReadCounters(DataSourceState& ds);
   // Reads a batch of samples from all kernel ring buffers for this data source.
   bool ReadRingBuffers(DataSourceInstanceID ds_id, DataSourceState& ds);
+  // Reads a batch of samples from the ring buffer of |per_cpu_readers[index]|,
+  // when the kernel signals that it's filled past the wakeup watermark.
+  void OnRingBufferWakeup(DataSourceInstanceID ds_id, size_t index);
+  // Must be called before destroying the readers of |ds|.
+  void StopWatchingRingBuffers(DataSourceState* ds);
 
   // Returns *false* if the reader has caught up with the writer position, true
   // otherwise. Return value is only useful if the underlying perf_event has
@@ -212,6 +226,8 @@ class PerfProducer : public Producer,
   void EmitRingBufferLoss(DataSourceInstanceID ds_id,
                           size_t cpu,
                           uint64_t records_lost);
+  // Emits the cumulative stats of each unwinder of the pool.
+  void EmitUnwinderStats(DataSourceState& ds);
 
   void PostEmitSkippedSample(DataSourceInstanceID ds_id,
                              ParsedSample sample,
@@ -230,7 +246,8 @@ class PerfProducer : public Producer,
   // source at the unwinding stage.
   void InitiateReaderStop(DataSourceState* ds);
   // Destroys the state belonging to this instance, and acks the stop to the
-  // tracing service.
+  // tracing service. Called once per unwinder, the stop completes when all of
+  // them are done with the data source.
   void FinishDataSourceStop(DataSourceInstanceID ds_id);
   // Immediately destroys the data source state, and instructs the unwinder to
   // do the same. This is used for abrupt stops.
@@ -259,6 +276,12 @@ class PerfProducer : public Producer,
   // Valid and stable for the lifetime of this class.
   ProcDescriptorGetter* const proc_fd_getter_;
 
+  // Number of threads in |unwinders_|.
+  const uint32_t unwinder_threads_;
+
+  // Shared by the unwinders, can be null. Outlives this class.
+  ElfCache* const elf_cache_;
+
   // Owns shared memory, must outlive trace writing.
   std::unique_ptr<TracingService::ProducerEndpoint> endpoint_;
 
@@ -279,8 +302,8 @@ class PerfProducer : public Producer,
   // State associated with perf-sampling data sources.
   std::map<DataSourceInstanceID, DataSourceState> data_sources_;
 
-  // Unwinding stage, running on a dedicated thread.
-  UnwinderHandle unwinding_worker_;
+  // Unwinding stage, running on dedicated threads.
+  UnwinderPool unwinders_;
 
   // Used for tracepoint name -> id lookups. Initialized lazily, and in general
   // best effort - can be null if tracefs isn't accessible.
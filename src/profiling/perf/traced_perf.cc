@@ -19,17 +19,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <memory>
+#include <optional>
+
 #include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/getopt.h"
 #include "perfetto/ext/base/lock_free_task_runner.h"
+#include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/version.h"
 #include "perfetto/tracing/default_socket.h"
+#include "src/profiling/perf/elf_cache.h"
 #include "src/profiling/perf/perf_producer.h"
 #include "src/profiling/perf/proc_descriptors.h"
 
 namespace perfetto {
 
 namespace {
+// Each unwinder has its own thread, queue and kernel symbol map.
+constexpr uint32_t kMaxUnwinderThreads = 64;
+
 #if PERFETTO_BUILDFLAG(PERFETTO_ANDROID_BUILD)
 static constexpr char kTracedPerfSocketEnvVar[] = "ANDROID_SOCKET_traced_perf";
 
@@ -51,13 +59,20 @@ int TracedPerfMain(int argc, char** argv) {
   enum LongOption {
     OPT_BACKGROUND = 1000,
     OPT_VERSION,
+    OPT_UNWINDER_THREADS,
+    OPT_ELF_CACHE_SIZE,
   };
 
   bool background = false;
+  uint32_t unwinder_threads = 1;
+  // Number of parsed libraries kept across data sources. 0: disabled.
+  uint32_t elf_cache_size = 0;
 
   static const option long_options[] = {
       {"background", no_argument, nullptr, OPT_BACKGROUND},
       {"version", no_argument, nullptr, OPT_VERSION},
+      {"unwinder-threads", required_argument, nullptr, OPT_UNWINDER_THREADS},
+      {"elf-cache-size", required_argument, nullptr, OPT_ELF_CACHE_SIZE},
       {nullptr, 0, nullptr, 0}};
 
   for (;;) {
@@ -71,8 +86,30 @@ int TracedPerfMain(int argc, char** argv) {
       case OPT_VERSION:
         printf("%s\n", base::GetVersionString());
         return 0;
+      case OPT_UNWINDER_THREADS: {
+        std::optional<uint32_t> threads = base::CStringToUInt32(optarg);
+        if (!threads || *threads == 0 || *threads > kMaxUnwinderThreads) {
+          fprintf(stderr, "--unwinder-threads must be in [1, %u]\n",
+                  kMaxUnwinderThreads);
+          return 1;
+        }
+        unwinder_threads = *threads;
+        break;
+      }
+      case OPT_ELF_CACHE_SIZE: {
+        std::optional<uint32_t> size = base::CStringToUInt32(optarg);
+        if (!size) {
+          fprintf(stderr, "--elf-cache-size must be a number of entries\n");
+          return 1;
+        }
+        elf_cache_size = *size;
+        break;
+      }
       default:
-        fprintf(stderr, "Usage: %s [--background] [--version]\n", argv[0]);
+        fprintf(stderr,
+                "Usage: %s [--background] [--version] "
+                "[--unwinder-threads N] [--elf-cache-size N]\n",
+                argv[0]);
         return 1;
     }
   }
@@ -91,7 +128,13 @@ int TracedPerfMain(int argc, char** argv) {
   DirectDescriptorGetter proc_fd_getter;
 #endif
 
-  profiling::PerfProducer producer(&proc_fd_getter, &task_runner);
+  // Outlives the producer, which is recreated when reconnecting to traced.
+  std::unique_ptr<profiling::ElfCache> elf_cache;
+  if (elf_cache_size > 0)
+    elf_cache.reset(new profiling::ElfCache(elf_cache_size));
+
+  profiling::PerfProducer producer(&proc_fd_getter, &task_runner,
+                                   unwinder_threads, elf_cache.get());
   const char* env_notif = getenv("TRACED_PERF_NOTIFY_FD");
   if (env_notif) {
     int notif_fd = atoi(env_notif);
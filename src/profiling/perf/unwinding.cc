@@ -17,11 +17,15 @@
 #include "src/profiling/perf/unwinding.h"
 
 #include <cinttypes>
+#include <condition_variable>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
 
 #include <unwindstack/Unwinder.h>
 
 #include "perfetto/ext/base/metatrace.h"
+#include "perfetto/base/time.h"
 #include "perfetto/ext/base/no_destructor.h"
 #include "perfetto/ext/base/thread_utils.h"
 #include "perfetto/ext/base/utils.h"
@@ -30,6 +34,57 @@
 namespace {
 constexpr size_t kUnwindingMaxFrames = 1000;
 constexpr uint32_t kDataSourceShutdownRetryDelayMs = 400;
+
+// The libunwindstack Elf cache is global, and toggling it (see
+// |ResetAndEnableUnwindstackCache|) frees the cache without any
+// synchronization with concurrent unwinds. With multiple unwinder threads,
+// unwinding holds this lock in shared mode and resetting the cache holds it
+// exclusively.
+//
+// Unlike std::shared_mutex (reader-preferring with glibc), a pending reset
+// blocks new unwinds from entering, so the reset can't be starved by the
+// other unwinders and stall the task queue of the thread requesting it.
+class WriterPreferringSharedMutex {
+ public:
+  void lock_shared() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !writer_active_ && waiting_writers_ == 0; });
+    readers_++;
+  }
+
+  void unlock_shared() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PERFETTO_DCHECK(readers_ > 0);
+    if (--readers_ == 0 && waiting_writers_ > 0)
+      cv_.notify_all();
+  }
+
+  void lock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_writers_++;
+    cv_.wait(lock, [this] { return !writer_active_ && readers_ == 0; });
+    waiting_writers_--;
+    writer_active_ = true;
+  }
+
+  void unlock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer_active_ = false;
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  uint32_t readers_ = 0;
+  uint32_t waiting_writers_ = 0;
+  bool writer_active_ = false;
+};
+
+WriterPreferringSharedMutex& UnwindstackCacheLock() {
+  static WriterPreferringSharedMutex* lock = new WriterPreferringSharedMutex{};
+  return *lock;
+}
 }  // namespace
 
 namespace perfetto {
@@ -38,10 +93,20 @@ namespace profiling {
 Unwinder::Delegate::~Delegate() = default;
 
 Unwinder::Unwinder(Delegate* delegate,
-                   base::MaybeLockFreeTaskRunner* task_runner)
-    : task_runner_(task_runner), delegate_(delegate) {
+                   base::MaybeLockFreeTaskRunner* task_runner,
+                   uint32_t index,
+                   ElfCache* elf_cache)
+    : task_runner_(task_runner),
+      delegate_(delegate),
+      index_(index),
+      elf_cache_(elf_cache) {
   ResetAndEnableUnwindstackCache();
-  base::MaybeSetThreadName("stack-unwinding");
+  // Keep the historical name for the first unwinder.
+  if (index == 0) {
+    base::MaybeSetThreadName("stack-unwinding");
+  } else {
+    base::MaybeSetThreadName("stack-unwind-" + std::to_string(index));
+  }
 }
 
 void Unwinder::PostStartDataSource(DataSourceInstanceID ds_id,
@@ -121,6 +186,7 @@ void Unwinder::AdoptProcDescriptors(DataSourceInstanceID ds_id,
   proc_state.status = ProcessState::Status::kFdsResolved;
   proc_state.unwind_state =
       UnwindingMetadata{std::move(maps_fd), std::move(mem_fd)};
+  AttachCachedElfs(&proc_state.unwind_state.value());
 }
 
 void Unwinder::PostRecordTimedOutProcDescriptors(DataSourceInstanceID ds_id,
@@ -216,6 +282,13 @@ base::FlatSet<DataSourceInstanceID> Unwinder::ConsumeAndUnwindReadySamples() {
       TAG_PRODUCER, PROFILER_UNWIND_QUEUE_SZ,
       static_cast<int32_t>(read_view.write_pos - read_view.read_pos));
 
+  uint64_t queue_depth = read_view.write_pos - read_view.read_pos;
+  if (queue_depth >
+      stats_tracker_.max_queue_depth.load(std::memory_order_relaxed)) {
+    stats_tracker_.max_queue_depth.store(queue_depth,
+                                         std::memory_order_relaxed);
+  }
+
   if (read_view.read_pos == read_view.write_pos)
     return pending_sample_sources;
 
@@ -306,9 +379,17 @@ base::FlatSet<DataSourceInstanceID> Unwinder::ConsumeAndUnwindReadySamples() {
           (proc_state.unwind_state.has_value()
                ? &proc_state.unwind_state.value()
                : nullptr);
-      CompletedSample unwound_sample =
-          UnwindSample(entry.sample, opt_user_state,
-                       proc_state.attempted_unwinding, ds.unwind_mode);
+      base::TimeNanos unwind_start = base::GetWallTimeNs();
+      CompletedSample unwound_sample;
+      {
+        std::shared_lock<WriterPreferringSharedMutex> cache_lock(
+            UnwindstackCacheLock());
+        unwound_sample =
+            UnwindSample(entry.sample, opt_user_state,
+                         proc_state.attempted_unwinding, ds.unwind_mode);
+      }
+      RecordUnwindTime(static_cast<uint64_t>(
+          (base::GetWallTimeNs() - unwind_start).count()));
       proc_state.attempted_unwinding = true;
 
       PERFETTO_METATRACE_COUNTER(TAG_PRODUCER, PROFILER_UNWIND_CURRENT_PID, 0);
@@ -444,6 +525,7 @@ CompletedSample Unwinder::UnwindSample(const ParsedSample& sample,
       PERFETTO_DLOG("Reparsing maps for pid [%d]",
                     static_cast<int>(sample.common.pid));
       unwind_state->ReparseMaps();
+      AttachCachedElfs(unwind_state);
     }
     // reunwind attempt
     unwind = attempt_unwind();
@@ -456,6 +538,10 @@ CompletedSample Unwinder::UnwindSample(const ParsedSample& sample,
     ret.frames.emplace_back(std::move(frame));
   }
 
+  // After the build ids are read, so that the cache doesn't read them while
+  // holding its lock. The kernel frames have no Elf and are skipped.
+  AddElfsToCache(ret.frames);
+
   // In case of an unwinding error, add a synthetic error frame (which will
   // appear as a caller of the partially-unwound fragment), for easier
   // visualization of errors.
@@ -473,6 +559,28 @@ CompletedSample Unwinder::UnwindSample(const ParsedSample& sample,
   return ret;
 }
 
+void Unwinder::AttachCachedElfs(UnwindingMetadata* unwind_state) {
+  if (!elf_cache_)
+    return;
+  size_t hits = elf_cache_->AttachCachedElfs(&unwind_state->fd_maps);
+  stats_tracker_.elf_cache_hits.fetch_add(hits, std::memory_order_relaxed);
+}
+
+void Unwinder::AddElfsToCache(
+    const std::vector<unwindstack::FrameData>& frames) {
+  if (!elf_cache_)
+    return;
+  // Consecutive frames are often in the same mapping.
+  std::vector<unwindstack::MapInfo*> map_infos;
+  for (const unwindstack::FrameData& frame : frames) {
+    unwindstack::MapInfo* map_info = frame.map_info.get();
+    if (map_info && (map_infos.empty() || map_infos.back() != map_info))
+      map_infos.push_back(map_info);
+  }
+  size_t misses = elf_cache_->AddElfs(map_infos);
+  stats_tracker_.elf_cache_misses.fetch_add(misses, std::memory_order_relaxed);
+}
+
 std::vector<unwindstack::FrameData> Unwinder::SymbolizeKernelCallchain(
     const ParsedSample& sample) {
   static base::NoDestructor<std::shared_ptr<unwindstack::MapInfo>>
@@ -604,7 +712,8 @@ void Unwinder::ClearCachedStatePeriodic(DataSourceInstanceID ds_id,
     if (pid_and_process.second.status == ProcessState::Status::kFdsResolved)
       pid_and_process.second.unwind_state->fd_maps.Reset();
   }
-  ResetAndEnableUnwindstackCache();
+  if (index_ == 0)
+    ResetAndEnableUnwindstackCache();
   base::MaybeReleaseAllocatorMemToOS();
 
   PostClearCachedStatePeriodic(ds_id, period_ms);  // repost
@@ -613,16 +722,29 @@ void Unwinder::ClearCachedStatePeriodic(DataSourceInstanceID ds_id,
 void Unwinder::ResetAndEnableUnwindstackCache() {
   PERFETTO_DLOG("Resetting unwindstack cache");
   // Libunwindstack uses an unsynchronized variable for setting/checking whether
-  // the cache is enabled. Therefore unwinding and cache toggling should stay on
-  // the same thread, but we might be moving unwinding across threads if we're
-  // recreating |Unwinder| instances (during a reconnect to traced). Therefore,
-  // use our own static lock to synchronize the cache toggling.
-  // TODO(rsavitski): consider fixing this in libunwindstack itself.
-  static std::mutex* lock = new std::mutex{};
-  std::lock_guard<std::mutex> guard{*lock};
+  // the cache is enabled, and frees the cache when disabling it. Unwinding
+  // happens on multiple threads (the unwinder pool, and we might be recreating
+  // |Unwinder| instances during a reconnect to traced). Therefore, use our own
+  // static lock to exclude concurrent unwinds while toggling the cache.
+  // Ideally libunwindstack would synchronize this itself.
+  std::unique_lock<WriterPreferringSharedMutex> guard(UnwindstackCacheLock());
   unwindstack::Elf::SetCachingEnabled(false);  // free any existing state
   unwindstack::Elf::SetCachingEnabled(true);   // reallocate a fresh cache
 }
 
+void Unwinder::RecordUnwindTime(uint64_t duration_ns) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  // Only written by this thread, so plain load + store is enough.
+  auto& st = stats_tracker_;
+  st.samples_unwound.store(
+      st.samples_unwound.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  st.unwind_time_total_ns.store(
+      st.unwind_time_total_ns.load(std::memory_order_relaxed) + duration_ns,
+      std::memory_order_relaxed);
+  if (duration_ns > st.unwind_time_max_ns.load(std::memory_order_relaxed))
+    st.unwind_time_max_ns.store(duration_ns, std::memory_order_relaxed);
+}
+
 }  // namespace profiling
 }  // namespace perfetto
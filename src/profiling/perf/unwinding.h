@@ -20,8 +20,10 @@
 #include <stdint.h>
 #include <condition_variable>
 #include <map>
+#include <memory>
 #include <optional>
 #include <thread>
+#include <vector>
 
 #include <linux/perf_event.h>
 #include <unwindstack/Error.h>
@@ -35,6 +37,7 @@
 #include "src/kallsyms/lazy_kernel_symbolizer.h"
 #include "src/profiling/common/unwind_support.h"
 #include "src/profiling/perf/common_types.h"
+#include "src/profiling/perf/elf_cache.h"
 #include "src/profiling/perf/unwind_queue.h"
 
 namespace perfetto {
@@ -48,6 +51,11 @@ constexpr static uint32_t kUnwindQueueCapacity = 1024;
 // symbolisation using /proc/kallsyms is necessary. Has a single unwinding ring
 // queue, shared across all data sources.
 //
+// The producer can run several unwinders (see |UnwinderPool|), each with its
+// own thread and queue. Processes are sharded across them by pid, so all the
+// samples and the unwinding state (parsed maps, proc-fds) of a given process
+// belong to a single unwinder. Every unwinder tracks all data sources.
+//
 // Userspace samples cannot be unwound without having /proc/<pid>/{maps,mem}
 // file descriptors for that process. This lookup can be asynchronous (e.g. on
 // Android), so the unwinder might have to wait before it can process (or
@@ -57,6 +65,9 @@ constexpr static uint32_t kUnwindQueueCapacity = 1024;
 // Besides the queue, all interactions between the unwinder and the rest of the
 // producer logic are through posted tasks.
 //
+// Optionally, the unwinders share an |ElfCache|, which keeps the parsed Elf
+// objects of the unwound libraries across data sources.
+//
 // As unwinding times are long-tailed (example measurements: median <1ms,
 // worst-case ~1000ms), the unwinder runs on a dedicated thread to avoid
 // starving the rest of the producer's work (including IPC and consumption of
@@ -111,6 +122,34 @@ class Unwinder {
     return unwind_queue_;
   }
 
+  // Cumulative stats of this unwinder. Can be called from any thread.
+  struct Stats {
+    uint64_t samples_unwound = 0;
+    uint64_t unwind_time_total_ns = 0;
+    uint64_t unwind_time_max_ns = 0;
+    uint64_t max_queue_depth = 0;
+    // Mappings that got their Elf from the |ElfCache|, and Elfs that were
+    // parsed and added to it.
+    uint64_t elf_cache_hits = 0;
+    uint64_t elf_cache_misses = 0;
+  };
+  Stats GetStats() const {
+    Stats stats;
+    stats.samples_unwound =
+        stats_tracker_.samples_unwound.load(std::memory_order_relaxed);
+    stats.unwind_time_total_ns =
+        stats_tracker_.unwind_time_total_ns.load(std::memory_order_relaxed);
+    stats.unwind_time_max_ns =
+        stats_tracker_.unwind_time_max_ns.load(std::memory_order_relaxed);
+    stats.max_queue_depth =
+        stats_tracker_.max_queue_depth.load(std::memory_order_relaxed);
+    stats.elf_cache_hits =
+        stats_tracker_.elf_cache_hits.load(std::memory_order_relaxed);
+    stats.elf_cache_misses =
+        stats_tracker_.elf_cache_misses.load(std::memory_order_relaxed);
+    return stats;
+  }
+
   uint64_t GetEnqueuedFootprint() {
     uint64_t freed =
         footprint_tracker_.stack_bytes_freed.load(std::memory_order_acquire);
@@ -165,8 +204,24 @@ class Unwinder {
     std::atomic<uint64_t> stack_bytes_freed;
   };
 
-  // Must be instantiated via the |UnwinderHandle|.
-  Unwinder(Delegate* delegate, base::MaybeLockFreeTaskRunner* task_runner);
+  // Backing storage for |Stats|. Written only by the unwinder thread, read by
+  // the main thread.
+  struct StatsTracker {
+    std::atomic<uint64_t> samples_unwound{0};
+    std::atomic<uint64_t> unwind_time_total_ns{0};
+    std::atomic<uint64_t> unwind_time_max_ns{0};
+    std::atomic<uint64_t> max_queue_depth{0};
+    std::atomic<uint64_t> elf_cache_hits{0};
+    std::atomic<uint64_t> elf_cache_misses{0};
+  };
+
+  // Must be instantiated via the |UnwinderHandle|. |index| is the position of
+  // this unwinder in the |UnwinderPool|, used to name its thread.
+  // |elf_cache| is optional.
+  Unwinder(Delegate* delegate,
+           base::MaybeLockFreeTaskRunner* task_runner,
+           uint32_t index,
+           ElfCache* elf_cache);
 
   // Marks the data source as valid and active at the unwinding stage.
   // Initializes kernel address symbolization if needed.
@@ -196,6 +251,13 @@ class Unwinder {
                                bool pid_unwound_before,
                                UnwindMode unwind_mode);
 
+  // Sets the Elfs of the freshly parsed maps of a process from the
+  // |elf_cache_|, if any.
+  void AttachCachedElfs(UnwindingMetadata* unwind_state);
+
+  // Adds the Elfs used to unwind |frames| to the |elf_cache_|, if any.
+  void AddElfsToCache(const std::vector<unwindstack::FrameData>& frames);
+
   // Returns a list of symbolized kernel frames in the sample (if any).
   std::vector<unwindstack::FrameData> SymbolizeKernelCallchain(
       const ParsedSample& sample);
@@ -242,6 +304,10 @@ class Unwinder {
   // Note that this operation is heavy in terms of cpu%, and should therefore
   // be called only for profiling configs that require it.
   //
+  // The |ElfCache| (if any) is bounded, and is not cleared by this. The
+  // process-wide libunwindstack cache is reset only by the first unwinder of
+  // the pool, as every unwinder runs this task with the same period.
+  //
   // TODO(rsavitski): dropping the full parsed maps is somewhat excessive, could
   // instead clear just the |MapInfo.elf| shared_ptr, but that's considered too
   // brittle as it's an implementation detail of libunwindstack.
@@ -249,12 +315,21 @@ class Unwinder {
   // worth having at the moment to speed up unwinds across map reparses).
   void ClearCachedStatePeriodic(DataSourceInstanceID ds_id, uint32_t period_ms);
 
+  // Note: the libunwindstack Elf cache is process-wide, so this also affects
+  // the other unwinders of the pool. See |UnwindstackCacheLock()| in the .cc.
   void ResetAndEnableUnwindstackCache();
 
+  void RecordUnwindTime(uint64_t duration_ns);
+
   base::MaybeLockFreeTaskRunner* const task_runner_;
   Delegate* const delegate_;
+  // Position of this unwinder in the |UnwinderPool|.
+  const uint32_t index_;
+  // Shared by all the unwinders of the pool, can be null.
+  ElfCache* const elf_cache_;
   UnwindQueue<UnwindEntry, kUnwindQueueCapacity> unwind_queue_;
   QueueFootprintTracker footprint_tracker_;
+  StatsTracker stats_tracker_;
   std::map<DataSourceInstanceID, DataSourceState> data_sources_;
   LazyKernelSymbolizer kernel_symbolizer_;
 
@@ -267,7 +342,9 @@ class Unwinder {
 // owned state, and consolidate.
 class UnwinderHandle {
  public:
-  explicit UnwinderHandle(Unwinder::Delegate* delegate) {
+  UnwinderHandle(Unwinder::Delegate* delegate,
+                 uint32_t index,
+                 ElfCache* elf_cache) {
     std::mutex init_lock;
     std::condition_variable init_cv;
 
@@ -285,7 +362,7 @@ class UnwinderHandle {
         };
 
     thread_ = std::thread(&UnwinderHandle::RunTaskThread, this,
-                          std::move(initializer), delegate);
+                          std::move(initializer), delegate, index, elf_cache);
 
     std::unique_lock<std::mutex> lock(init_lock);
     init_cv.wait(lock, [this] { return !!task_runner_ && !!unwinder_; });
@@ -302,13 +379,16 @@ class UnwinderHandle {
   }
 
   Unwinder* operator->() { return unwinder_; }
+  Unwinder* get() { return unwinder_; }
 
  private:
   void RunTaskThread(std::function<void(base::MaybeLockFreeTaskRunner*,
                                         Unwinder*)> initializer,
-                     Unwinder::Delegate* delegate) {
+                     Unwinder::Delegate* delegate,
+                     uint32_t index,
+                     ElfCache* elf_cache) {
     base::MaybeLockFreeTaskRunner task_runner;
-    Unwinder unwinder(delegate, &task_runner);
+    Unwinder unwinder(delegate, &task_runner, index, elf_cache);
     task_runner.PostTask(
         std::bind(std::move(initializer), &task_runner, &unwinder));
     task_runner.Run();
@@ -319,6 +399,47 @@ class UnwinderHandle {
   Unwinder* unwinder_ = nullptr;
 };
 
+// Fixed-size set of |Unwinder|s, each on its own thread. Samples are sharded
+// by pid, see |ForPid|. Operations that concern a data source as a whole
+// (start, stop, purge) need to be posted to all the unwinders. The optional
+// |elf_cache| is shared by all of them and must outlive the pool.
+class UnwinderPool {
+ public:
+  UnwinderPool(Unwinder::Delegate* delegate,
+               uint32_t num_unwinders,
+               ElfCache* elf_cache = nullptr) {
+    PERFETTO_CHECK(num_unwinders > 0);
+    for (uint32_t i = 0; i < num_unwinders; i++)
+      unwinders_.emplace_back(new UnwinderHandle(delegate, i, elf_cache));
+  }
+
+  uint32_t size() const { return static_cast<uint32_t>(unwinders_.size()); }
+
+  Unwinder* at(uint32_t index) { return unwinders_[index]->get(); }
+
+  // Returns the unwinder responsible for all the samples of |pid|.
+  Unwinder* ForPid(pid_t pid) {
+    return at(static_cast<uint32_t>(pid) % size());
+  }
+
+  // Sum of the enqueued footprints of all the unwinders.
+  uint64_t GetEnqueuedFootprint() {
+    uint64_t total = 0;
+    for (auto& unwinder : unwinders_)
+      total += unwinder->get()->GetEnqueuedFootprint();
+    return total;
+  }
+
+  template <typename F>
+  void ForEach(F fn) {
+    for (auto& unwinder : unwinders_)
+      fn(unwinder->get());
+  }
+
+ private:
+  std::vector<std::unique_ptr<UnwinderHandle>> unwinders_;
+};
+
 }  // namespace profiling
 }  // namespace perfetto
 
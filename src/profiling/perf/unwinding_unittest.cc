@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/profiling/perf/unwinding.h"
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace profiling {
+namespace {
+
+using ::testing::UnorderedElementsAre;
+
+constexpr DataSourceInstanceID kDsId = 1;
+
+// Records the callbacks of the unwinders, which arrive on their threads.
+class FakeDelegate : public Unwinder::Delegate {
+ public:
+  void PostEmitSample(DataSourceInstanceID, CompletedSample) override {}
+
+  void PostEmitUnwinderSkippedSample(DataSourceInstanceID,
+                                     ParsedSample sample) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    skipped_pids_.push_back(sample.common.pid);
+    cv_.notify_all();
+  }
+
+  void PostFinishDataSourceStop(DataSourceInstanceID) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_acks_++;
+    cv_.notify_all();
+  }
+
+  std::vector<pid_t> WaitForSkippedSamples(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return skipped_pids_.size() >= count; });
+    return skipped_pids_;
+  }
+
+  uint32_t WaitForStopAcks(uint32_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return stop_acks_ >= count; });
+    return stop_acks_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<pid_t> skipped_pids_;
+  uint32_t stop_acks_ = 0;
+};
+
+// Enqueues a userspace sample of |pid| into the queue of its unwinder, like
+// the producer does.
+void EnqueueSample(UnwinderPool* pool, pid_t pid) {
+  ParsedSample sample;
+  sample.common.pid = pid;
+  auto& queue = pool->ForPid(pid)->unwind_queue();
+  WriteView write_view = queue.BeginWrite();
+  ASSERT_TRUE(write_view.valid);
+  queue.at(write_view.write_pos) = UnwindEntry{kDsId, std::move(sample)};
+  queue.CommitWrite();
+}
+
+void StartDataSource(UnwinderPool* pool) {
+  pool->ForEach([](Unwinder* unwinder) {
+    unwinder->PostStartDataSource(kDsId, /*kernel_frames=*/false,
+                                  Unwinder::UnwindMode::kUnwindStack);
+  });
+}
+
+TEST(UnwinderPoolTest, ShardsProcessesByPid) {
+  FakeDelegate delegate;
+  UnwinderPool pool(&delegate, 3);
+
+  std::set<Unwinder*> unwinders;
+  for (pid_t pid = 100; pid < 106; pid++) {
+    EXPECT_EQ(pool.ForPid(pid), pool.ForPid(pid));
+    EXPECT_EQ(pool.ForPid(pid), pool.ForPid(pid + 3));
+    unwinders.insert(pool.ForPid(pid));
+  }
+  EXPECT_EQ(unwinders.size(), 3u);
+
+  // The samples and the process state updates of a pid are routed to the same
+  // unwinder, otherwise the samples would wait for the proc-fds forever.
+  StartDataSource(&pool);
+  for (pid_t pid : {100, 101, 102, 103}) {
+    pool.ForPid(pid)->PostRecordTimedOutProcDescriptors(kDsId, pid);
+    EnqueueSample(&pool, pid);
+  }
+  pool.ForEach([](Unwinder* unwinder) { unwinder->PostProcessQueue(); });
+
+  EXPECT_THAT(delegate.WaitForSkippedSamples(4),
+              UnorderedElementsAre(100, 101, 102, 103));
+}
+
+TEST(UnwinderPoolTest, EveryUnwinderAcksStop) {
+  FakeDelegate delegate;
+  UnwinderPool pool(&delegate, 3);
+
+  // A sample that its unwinder cannot process until the proc-fd lookup for
+  // the process completes.
+  const pid_t kPendingPid = 42;
+  StartDataSource(&pool);
+  EnqueueSample(&pool, kPendingPid);
+
+  pool.ForEach([](Unwinder* unwinder) {
+    unwinder->PostInitiateDataSourceStop(kDsId);
+  });
+
+  // The other unwinders ack right away, the producer must keep waiting for the
+  // last one.
+  EXPECT_EQ(delegate.WaitForStopAcks(2), 2u);
+
+  pool.ForPid(kPendingPid)
+      ->PostRecordTimedOutProcDescriptors(kDsId, kPendingPid);
+  EXPECT_EQ(delegate.WaitForStopAcks(3), 3u);
+  EXPECT_THAT(delegate.WaitForSkippedSamples(1),
+              UnorderedElementsAre(kPendingPid));
+}
+
+}  // namespace
+}  // namespace profiling
+}  // namespace perfetto
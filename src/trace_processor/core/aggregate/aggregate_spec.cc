@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "src/trace_processor/core/aggregate/aggregate_spec.h"
+
+#include <string>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/string_utils.h"
+
+namespace perfetto::trace_processor::core::aggregate {
+
+base::StatusOr<AggregateSpec> ParseAggregateSpec(const std::string& spec) {
+  std::string trimmed = base::TrimWhitespace(spec);
+  if (trimmed.empty()) {
+    return base::ErrStatus("aggregate spec: empty string");
+  }
+
+  // Find '(' to extract agg function name.
+  auto lparen = trimmed.find('(');
+  if (lparen == std::string::npos) {
+    return base::ErrStatus("aggregate spec: expected '(' in '%s'",
+                           trimmed.c_str());
+  }
+  std::string agg_str =
+      base::ToUpper(base::TrimWhitespace(trimmed.substr(0, lparen)));
+
+  GroupByAggOp agg_op;
+  if (agg_str == "COUNT") {
+    agg_op = GroupByAggOp::kCount;
+  } else if (agg_str == "SUM") {
+    agg_op = GroupByAggOp::kSum;
+  } else if (agg_str == "MIN") {
+    agg_op = GroupByAggOp::kMin;
+  } else if (agg_str == "MAX") {
+    agg_op = GroupByAggOp::kMax;
+  } else if (agg_str == "AVG") {
+    agg_op = GroupByAggOp::kAvg;
+  } else {
+    return base::ErrStatus("aggregate spec: unknown aggregate '%s'",
+                           agg_str.c_str());
+  }
+
+  // Find ')' to extract source column name.
+  auto rparen = trimmed.find(')', lparen + 1);
+  if (rparen == std::string::npos) {
+    return base::ErrStatus("aggregate spec: expected ')' in '%s'",
+                           trimmed.c_str());
+  }
+  std::string source_col =
+      base::TrimWhitespace(trimmed.substr(lparen + 1, rparen - lparen - 1));
+  if (agg_op == GroupByAggOp::kCount) {
+    if (!source_col.empty() && source_col != "*") {
+      return base::ErrStatus(
+          "aggregate spec: COUNT does not take a column in '%s'",
+          trimmed.c_str());
+    }
+    source_col.clear();
+  } else if (source_col.empty()) {
+    return base::ErrStatus("aggregate spec: empty source column in '%s'",
+                           trimmed.c_str());
+  }
+
+  // Find 'AS' (case-insensitive) after ')'.
+  std::string remainder = trimmed.substr(rparen + 1);
+  std::string remainder_upper = base::ToUpper(remainder);
+  auto as_pos = remainder_upper.find("AS");
+  if (as_pos == std::string::npos) {
+    return base::ErrStatus("aggregate spec: expected 'AS' in '%s'",
+                           trimmed.c_str());
+  }
+
+  // Verify that 'AS' is preceded and followed by whitespace or is at the
+  // boundary.
+  if (as_pos > 0 && remainder[as_pos - 1] != ' ' &&
+      remainder[as_pos - 1] != '\t') {
+    return base::ErrStatus(
+        "aggregate spec: expected whitespace before 'AS' in '%s'",
+        trimmed.c_str());
+  }
+  if (as_pos + 2 < remainder.size() && remainder[as_pos + 2] != ' ' &&
+      remainder[as_pos + 2] != '\t') {
+    return base::ErrStatus(
+        "aggregate spec: expected whitespace after 'AS' in '%s'",
+        trimmed.c_str());
+  }
+
+  std::string output_col = base::TrimWhitespace(remainder.substr(as_pos + 2));
+  if (output_col.empty()) {
+    return base::ErrStatus("aggregate spec: empty output column in '%s'",
+                           trimmed.c_str());
+  }
+
+  AggregateSpec result;
+  result.agg_op = agg_op;
+  result.source_col_name = std::move(source_col);
+  result.output_col_name = std::move(output_col);
+  return result;
+}
+
+}  // namespace perfetto::trace_processor::core::aggregate
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_AGGREGATE_AGGREGATE_SPEC_H_
+#define SRC_TRACE_PROCESSOR_CORE_AGGREGATE_AGGREGATE_SPEC_H_
+
+#include <cstdint>
+#include <string>
+
+#include "perfetto/ext/base/status_or.h"
+
+namespace perfetto::trace_processor::core::aggregate {
+
+// Aggregation operation computed for each group of a group by.
+enum class GroupByAggOp : uint8_t {
+  kCount,
+  kSum,
+  kMin,
+  kMax,
+  kAvg,
+};
+
+struct AggregateSpec {
+  GroupByAggOp agg_op;
+  // Empty for kCount, which counts the rows of the group.
+  std::string source_col_name;
+  std::string output_col_name;
+};
+
+// Parses an aggregate spec string of the form 'AGG(source_col) AS output_col'
+// where AGG is one of COUNT, SUM, MIN, MAX or AVG. COUNT takes no source
+// column (or '*').
+// Case-insensitive for the aggregate function name and AS keyword.
+// Whitespace-resilient.
+base::StatusOr<AggregateSpec> ParseAggregateSpec(const std::string& spec);
+
+}  // namespace perfetto::trace_processor::core::aggregate
+
+namespace perfetto::trace_processor {
+namespace aggregate = core::aggregate;
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_AGGREGATE_AGGREGATE_SPEC_H_
@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "src/trace_processor/core/aggregate/group_by_aggregator.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/aggregate/aggregate_spec.h"
+#include "src/trace_processor/core/common/null_types.h"
+#include "src/trace_processor/core/common/sort_types.h"
+#include "src/trace_processor/core/common/storage_types.h"
+#include "src/trace_processor/core/common/value_fetcher.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/types.h"
+#include "src/trace_processor/core/interpreter/bytecode_builder.h"
+#include "src/trace_processor/core/interpreter/bytecode_instructions.h"
+#include "src/trace_processor/core/interpreter/bytecode_interpreter.h"
+#include "src/trace_processor/core/interpreter/bytecode_interpreter_impl.h"  // IWYU pragma: keep
+#include "src/trace_processor/core/interpreter/bytecode_registers.h"
+#include "src/trace_processor/core/interpreter/interpreter_types.h"
+#include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/range.h"
+#include "src/trace_processor/core/util/slab.h"
+#include "src/trace_processor/core/util/span.h"
+
+namespace perfetto::trace_processor::core::aggregate {
+namespace {
+
+namespace i = interpreter;
+
+// The storage of a column in the form consumed by the interpreter.
+struct ColumnSource {
+  StorageType type = Id{};
+  // nullptr for Id columns.
+  const void* data = nullptr;
+  // nullptr for non-null columns.
+  const BitVector* null_bv = nullptr;
+  i::SparseNullCollapsedNullability nullability = NonNull{};
+  // For Id columns, the value of row 0.
+  uint32_t id_offset = 0;
+  // Owns the decoded values of encoded columns.
+  Slab<uint64_t> decoded;
+};
+
+template <typename T>
+void DecodeColumn(const dataframe::Storage& storage, ColumnSource& source) {
+  using C = typename T::cpp_type;
+  const auto& encoded = storage.unchecked_get_encoded<T>();
+  uint64_t size_bytes = uint64_t(encoded.size()) * sizeof(C);
+  source.decoded = Slab<uint64_t>::Alloc((size_bytes + 7) / 8);
+  auto* out = reinterpret_cast<C*>(source.decoded.data());
+  encoded.DecodeTo(out);
+  source.data = out;
+}
+
+ColumnSource GetColumnSource(const dataframe::Column& column) {
+  ColumnSource source;
+  source.type = column.storage.type();
+  if (column.storage.is_encoded()) {
+    // The interpreter only understands plain arrays: encoded columns are
+    // decoded once upfront.
+    switch (source.type.index()) {
+      case StorageType::GetTypeIndex<Uint32>():
+        DecodeColumn<Uint32>(column.storage, source);
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        DecodeColumn<Int32>(column.storage, source);
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        DecodeColumn<Int64>(column.storage, source);
+        break;
+      default:
+        PERFETTO_FATAL("Unsupported encoded storage type");
+    }
+  } else {
+    source.data = std::visit(
+        [](auto* ptr) { return static_cast<const void*>(ptr); },
+        column.storage.data());
+  }
+  if (source.type.Is<Id>()) {
+    source.id_offset = column.storage.unchecked_get<Id>().popped_rows;
+  }
+  source.null_bv = column.null_storage.MaybeGetNullBitVector();
+  switch (column.null_storage.nullability().index()) {
+    case Nullability::GetTypeIndex<NonNull>():
+      source.nullability = NonNull{};
+      break;
+    case Nullability::GetTypeIndex<DenseNull>():
+      source.nullability = DenseNull{};
+      break;
+    default:
+      source.nullability = SparseNull{};
+      break;
+  }
+  return source;
+}
+
+// Aggregates only read plain arrays: the values of Id columns are
+// materialized as Uint32.
+ColumnSource GetValueSource(const dataframe::Column& column, uint32_t rows) {
+  ColumnSource source = GetColumnSource(column);
+  if (!source.type.Is<Id>()) {
+    return source;
+  }
+  source.type = Uint32{};
+  source.decoded = Slab<uint64_t>::Alloc((uint64_t(rows) + 1) / 2);
+  auto* out = reinterpret_cast<uint32_t*>(source.decoded.data());
+  for (uint32_t i = 0; i < rows; ++i) {
+    out[i] = source.id_offset + i;
+  }
+  source.data = out;
+  return source;
+}
+
+// Whether the rows of |column| are sorted on its value, so that its rows can be
+// grouped by finding runs of equal keys.
+bool IsSortedKey(const dataframe::Column& column) {
+  if (column.storage.type().Is<Id>()) {
+    return true;
+  }
+  if (!column.null_storage.nullability().Is<NonNull>() ||
+      !column.storage.type().IsAnyOf<i::SortedGroupByType>()) {
+    return false;
+  }
+  return column.sort_state.Is<Sorted>() || column.sort_state.Is<SetIdSorted>();
+}
+
+dataframe::AdhocColumnType OutputType(GroupByAggOp op, StorageType type) {
+  if (op == GroupByAggOp::kAvg || type.Is<Double>()) {
+    return dataframe::AdhocColumnType::kDouble;
+  }
+  return dataframe::AdhocColumnType::kInt64;
+}
+
+i::AggregateOp ToInterpreterOp(GroupByAggOp op) {
+  switch (op) {
+    case GroupByAggOp::kSum:
+    case GroupByAggOp::kAvg:
+      return i::SumOp{};
+    case GroupByAggOp::kMin:
+      return i::MinOp{};
+    case GroupByAggOp::kMax:
+      return i::MaxOp{};
+    case GroupByAggOp::kCount:
+      break;
+  }
+  PERFETTO_FATAL("COUNT is not computed by an Aggregate bytecode");
+}
+
+// Pushes the key of the group starting at |row| to the builder.
+void PushKey(dataframe::AdhocDataframeBuilder& builder,
+             const ColumnSource& key,
+             const Slab<uint32_t>& popcount,
+             uint32_t row) {
+  uint32_t si = row;
+  if (key.null_bv) {
+    if (!key.null_bv->is_set(row)) {
+      builder.PushNull(0);
+      return;
+    }
+    if (key.nullability.Is<SparseNull>()) {
+      si = static_cast<uint32_t>(
+          popcount[row / 64] + key.null_bv->count_set_bits_until_in_word(row));
+    }
+  }
+  switch (key.type.index()) {
+    case StorageType::GetTypeIndex<Id>():
+      builder.PushNonNull(0, si + key.id_offset);
+      break;
+    case StorageType::GetTypeIndex<Uint32>():
+      builder.PushNonNull(0, static_cast<const uint32_t*>(key.data)[si]);
+      break;
+    case StorageType::GetTypeIndex<Int32>():
+      builder.PushNonNull(
+          0, static_cast<int64_t>(static_cast<const int32_t*>(key.data)[si]));
+      break;
+    case StorageType::GetTypeIndex<Int64>():
+      builder.PushNonNull(0, static_cast<const int64_t*>(key.data)[si]);
+      break;
+    case StorageType::GetTypeIndex<String>():
+      builder.PushNonNull(0, static_cast<const StringPool::Id*>(key.data)[si]);
+      break;
+    default:
+      PERFETTO_FATAL("Unsupported key type");
+  }
+}
+
+}  // namespace
+
+base::StatusOr<dataframe::Dataframe> GroupByAggregator::Aggregate(
+    const dataframe::Dataframe& df,
+    std::string_view key_col_name,
+    const std::vector<AggregateSpec>& specs,
+    StringPool* pool) {
+  auto resolve_column = [&](std::string_view name) -> std::optional<uint32_t> {
+    for (uint32_t col = 0; col < df.column_names_.size(); ++col) {
+      if (df.column_names_[col] == name) {
+        return col;
+      }
+    }
+    return std::nullopt;
+  };
+
+  // Resolve and validate the key column.
+  std::optional<uint32_t> key_col = resolve_column(key_col_name);
+  if (!key_col) {
+    return base::ErrStatus("group by: unknown key column '%.*s'",
+                           static_cast<int>(key_col_name.size()),
+                           key_col_name.data());
+  }
+  const dataframe::Column& key_column = *df.column_ptrs_[*key_col];
+  if (key_column.storage.type().Is<Double>()) {
+    return base::ErrStatus("group by: cannot group by double column '%s'",
+                           df.column_names_[*key_col].c_str());
+  }
+
+  // Resolve and validate the aggregated columns. |sources| holds the storage
+  // of the key at index 0 followed by the (distinct) aggregated columns.
+  std::vector<ColumnSource> sources;
+  sources.push_back(GetColumnSource(key_column));
+  std::vector<std::optional<uint32_t>> df_col_to_source(
+      df.column_names_.size());
+  std::vector<std::string> names{df.column_names_[*key_col]};
+  std::vector<dataframe::AdhocColumnType> types{
+      key_column.storage.type().Is<String>()
+          ? dataframe::AdhocColumnType::kString
+          : dataframe::AdhocColumnType::kInt64};
+  std::vector<uint32_t> spec_sources(specs.size());
+  for (uint32_t s = 0; s < specs.size(); ++s) {
+    const AggregateSpec& spec = specs[s];
+    names.push_back(spec.output_col_name);
+    if (spec.agg_op == GroupByAggOp::kCount) {
+      types.push_back(dataframe::AdhocColumnType::kInt64);
+      continue;
+    }
+    std::optional<uint32_t> col = resolve_column(spec.source_col_name);
+    if (!col) {
+      return base::ErrStatus("group by: unknown column '%s'",
+                             spec.source_col_name.c_str());
+    }
+    StorageType type = df.column_ptrs_[*col]->storage.type();
+    if (type.Is<Id>()) {
+      type = Uint32{};
+    }
+    if (!type.IsAnyOf<i::IntegerOrDoubleType>()) {
+      return base::ErrStatus(
+          "group by: cannot aggregate column '%s': only integer and double "
+          "columns are supported",
+          spec.source_col_name.c_str());
+    }
+    types.push_back(OutputType(spec.agg_op, type));
+    if (!df_col_to_source[*col]) {
+      df_col_to_source[*col] = static_cast<uint32_t>(sources.size());
+      sources.push_back(
+          GetValueSource(*df.column_ptrs_[*col], df.row_count_));
+    }
+    spec_sources[s] = *df_col_to_source[*col];
+  }
+
+  auto builder = dataframe::AdhocDataframeBuilder(
+      names, pool,
+      dataframe::AdhocDataframeBuilder::Options{
+          std::move(types),
+          dataframe::NullabilityType::kDenseNull,
+      });
+  uint32_t n = df.row_count_;
+  if (n == 0) {
+    return std::move(builder).Build();
+  }
+
+  // Emit the bytecode: group all the rows of the dataframe by the key and then
+  // fold every aggregated column into per-group accumulators.
+  i::BytecodeBuilder bc_builder;
+  auto range_reg = bc_builder.AllocateRegister<Range>();
+  {
+    using B = i::InitRange;
+    auto& op = bc_builder.AddOpcode<B>(i::Index<B>());
+    op.arg<B::size>() = n;
+    op.arg<B::dest_register>() = range_reg;
+  }
+  auto slab_reg = bc_builder.AllocateRegister<Slab<uint32_t>>();
+  auto span_reg = bc_builder.AllocateRegister<Span<uint32_t>>();
+  {
+    using B = i::AllocateIndices;
+    auto& op = bc_builder.AddOpcode<B>(i::Index<B>());
+    op.arg<B::size>() = n;
+    op.arg<B::dest_slab_register>() = slab_reg;
+    op.arg<B::dest_span_register>() = span_reg;
+  }
+  {
+    using B = i::Iota;
+    auto& op = bc_builder.AddOpcode<B>(i::Index<B>());
+    op.arg<B::source_register>() = range_reg;
+    op.arg<B::update_register>() = span_reg;
+  }
+  auto gb_reg =
+      bc_builder.AllocateRegister<std::unique_ptr<i::GroupByState>>();
+
+  std::vector<i::RwHandle<i::StoragePtr>> storage_regs;
+  std::vector<i::RwHandle<i::NullBitvector>> null_bv_regs;
+  for (const ColumnSource& source : sources) {
+    storage_regs.push_back(bc_builder.AllocateRegister<i::StoragePtr>());
+    null_bv_regs.push_back(source.null_bv
+                               ? bc_builder.AllocateRegister<i::NullBitvector>()
+                               : i::RwHandle<i::NullBitvector>{});
+    if (source.null_bv && source.nullability.Is<SparseNull>()) {
+      using B = i::PrefixPopcount;
+      auto& op = bc_builder.AddOpcode<B>(i::Index<B>());
+      op.arg<B::null_bv_register>() = null_bv_regs.back();
+    }
+  }
+
+  if (IsSortedKey(key_column)) {
+    using B = i::GroupBySortedBase;
+    auto& op = bc_builder.AddOpcode<B>(i::Index<i::GroupBySorted>(
+        *sources[0].type.TryDowncast<i::SortedGroupByType>()));
+    op.arg<B::storage_register>() = storage_regs[0];
+    op.arg<B::indices_register>() = span_reg;
+    op.arg<B::group_by_register>() = gb_reg;
+  } else {
+    using B = i::GroupByHashBase;
+    auto& op = bc_builder.AddOpcode<B>(i::Index<i::GroupByHash>(
+        *sources[0].type.TryDowncast<i::HashGroupByType>(),
+        sources[0].nullability));
+    op.arg<B::storage_register>() = storage_regs[0];
+    op.arg<B::null_bv_register>() = null_bv_regs[0];
+    op.arg<B::indices_register>() = span_reg;
+    op.arg<B::group_by_register>() = gb_reg;
+  }
+
+  std::vector<uint32_t> spec_aggregates(specs.size());
+  uint32_t aggregate_count = 0;
+  for (uint32_t s = 0; s < specs.size(); ++s) {
+    if (specs[s].agg_op == GroupByAggOp::kCount) {
+      continue;
+    }
+    uint32_t src = spec_sources[s];
+    spec_aggregates[s] = aggregate_count++;
+    using B = i::AggregateBase;
+    auto& op = bc_builder.AddOpcode<B>(i::Index<i::Aggregate>(
+        *sources[src].type.TryDowncast<i::IntegerOrDoubleType>(),
+        ToInterpreterOp(specs[s].agg_op)));
+    op.arg<B::storage_register>() = storage_regs[src];
+    op.arg<B::null_bv_register>() = null_bv_regs[src];
+    op.arg<B::indices_register>() = span_reg;
+    op.arg<B::group_by_register>() = gb_reg;
+    op.arg<B::aggregate_index>() = spec_aggregates[s];
+  }
+
+  // Initialize the registers and execute.
+  auto gb = std::make_unique<i::GroupByState>();
+  gb->aggregates.resize(aggregate_count);
+
+  i::Interpreter<ErrorValueFetcher> interp;
+  interp.Initialize(bc_builder.bytecode(), bc_builder.register_count(), pool);
+  interp.SetRegisterValue(
+      i::WriteHandle<std::unique_ptr<i::GroupByState>>(gb_reg.index),
+      std::move(gb));
+  for (uint32_t src = 0; src < sources.size(); ++src) {
+    interp.SetRegisterValue(
+        i::WriteHandle<i::StoragePtr>(storage_regs[src].index),
+        i::StoragePtr{sources[src].data, sources[src].type});
+    if (sources[src].null_bv) {
+      interp.SetRegisterValue(
+          i::WriteHandle<i::NullBitvector>(null_bv_regs[src].index),
+          i::NullBitvector{sources[src].null_bv, {}});
+    }
+  }
+  ErrorValueFetcher fetcher;
+  interp.Execute(fetcher);
+
+  const auto* gb_ptr = interp.GetRegisterValue(
+      i::ReadHandle<std::unique_ptr<i::GroupByState>>(gb_reg.index));
+  PERFETTO_CHECK(gb_ptr && *gb_ptr);
+  const i::GroupByState& result = **gb_ptr;
+  uint32_t group_count = result.group_count();
+
+  // Build the output: the key of every group followed by the aggregates.
+  const ColumnSource& key = sources[0];
+  Slab<uint32_t> key_popcount;
+  if (key.null_bv && key.nullability.Is<SparseNull>()) {
+    key_popcount = key.null_bv->PrefixPopcount();
+  }
+  for (uint32_t g = 0; g < group_count; ++g) {
+    PushKey(builder, key, key_popcount, result.group_rows[g]);
+  }
+  for (uint32_t s = 0; s < specs.size(); ++s) {
+    auto col = s + 1;
+    GroupByAggOp agg_op = specs[s].agg_op;
+    if (agg_op == GroupByAggOp::kCount) {
+      for (uint32_t g = 0; g < group_count; ++g) {
+        builder.PushNonNull(col, static_cast<int64_t>(result.group_sizes[g]));
+      }
+      continue;
+    }
+    const auto& agg = result.aggregates[spec_aggregates[s]];
+    bool is_double = sources[spec_sources[s]].type.Is<Double>();
+    for (uint32_t g = 0; g < group_count; ++g) {
+      if (agg.counts[g] == 0) {
+        builder.PushNull(col);
+        continue;
+      }
+      if (agg_op == GroupByAggOp::kAvg) {
+        double sum = is_double ? agg.double_values[g]
+                               : static_cast<double>(agg.int_values[g]);
+        builder.PushNonNull(col, sum / static_cast<double>(agg.counts[g]));
+      } else if (is_double) {
+        builder.PushNonNull(col, agg.double_values[g]);
+      } else {
+        builder.PushNonNull(col, agg.int_values[g]);
+      }
+    }
+  }
+  return std::move(builder).Build();
+}
+
+}  // namespace perfetto::trace_processor::core::aggregate
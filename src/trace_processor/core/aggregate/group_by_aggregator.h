@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_AGGREGATE_GROUP_BY_AGGREGATOR_H_
+#define SRC_TRACE_PROCESSOR_CORE_AGGREGATE_GROUP_BY_AGGREGATOR_H_
+
+#include <string_view>
+#include <vector>
+
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/aggregate/aggregate_spec.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+
+namespace perfetto::trace_processor::core::aggregate {
+
+// Groups the rows of a dataframe by the value of a key column and computes
+// aggregates of other columns for every group, producing a dataframe with one
+// row per group: the key column (with the same name) followed by one column
+// per AggregateSpec.
+//
+// This is the native equivalent of
+//   SELECT key, AGG(col) AS output, ... FROM df GROUP BY key
+// which avoids going through SQLite's sorter: the grouping and aggregation
+// are executed by the bytecode interpreter directly on the column storage.
+// Non-null key columns which are sorted are grouped by finding runs of equal
+// values; all other key columns are grouped with a hash table (or a
+// direct-mapped table for small integer keys).
+//
+// Groups appear in the order of the first row of each group. All null keys
+// form a single group. Like SQLite, SUM/MIN/MAX/AVG skip null values and are
+// null for groups with no non-null value.
+//
+// Usage:
+//   ASSIGN_OR_RETURN(auto spec, ParseAggregateSpec("SUM(dur) AS total"));
+//   ASSIGN_OR_RETURN(auto result, GroupByAggregator::Aggregate(
+//                                     df, "track_id", {spec}, pool));
+class GroupByAggregator {
+ public:
+  // Key columns can have any type but double. Aggregated columns must be
+  // numeric.
+  static base::StatusOr<dataframe::Dataframe> Aggregate(
+      const dataframe::Dataframe& df,
+      std::string_view key_col_name,
+      const std::vector<AggregateSpec>& specs,
+      StringPool* pool);
+};
+
+}  // namespace perfetto::trace_processor::core::aggregate
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_AGGREGATE_GROUP_BY_AGGREGATOR_H_
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/aggregate/group_by_aggregator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/base/test/status_matchers.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/aggregate/aggregate_spec.h"
+#include "src/trace_processor/core/dataframe/cursor.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core::aggregate {
+namespace {
+
+using dataframe::CreateTypedColumnSpec;
+using dataframe::CreateTypedDataframeSpec;
+using dataframe::Dataframe;
+using testing::ElementsAre;
+using testing::HasSubstr;
+using testing::IsEmpty;
+using testing::IsSupersetOf;
+using testing::SizeIs;
+
+// Appends the text of a cell to a row.
+struct CellToString : dataframe::CellCallback {
+  void OnCell(int64_t v) { out += std::to_string(v); }
+  void OnCell(uint32_t v) { out += std::to_string(v); }
+  void OnCell(int32_t v) { out += std::to_string(v); }
+  void OnCell(double v) { out += std::to_string(v); }
+  void OnCell(NullTermStringView v) { out += v.c_str(); }
+  void OnCell(std::nullptr_t) { out += "NULL"; }
+
+  std::string out;
+};
+
+// Groups |df| by |key| and returns the rows of the result as strings of '|'
+// separated values.
+std::vector<std::string> GroupByRows(const Dataframe& df,
+                                     const char* key,
+                                     const std::vector<std::string>& specs,
+                                     StringPool* pool) {
+  std::vector<AggregateSpec> parsed;
+  for (const std::string& spec : specs) {
+    auto spec_or = ParseAggregateSpec(spec);
+    EXPECT_OK(spec_or.status());
+    if (!spec_or.ok()) {
+      return {};
+    }
+    parsed.push_back(*spec_or);
+  }
+  auto result = GroupByAggregator::Aggregate(df, key, parsed, pool);
+  EXPECT_OK(result.status());
+  if (!result.ok()) {
+    return {};
+  }
+  std::vector<std::string> rows;
+  for (uint32_t row = 0; row < result->row_count(); ++row) {
+    CellToString cell;
+    // The key followed by one column per spec.
+    for (uint32_t col = 0; col <= specs.size(); ++col) {
+      if (col > 0) {
+        cell.out += "|";
+      }
+      result->GetCell(row, col, cell);
+    }
+    rows.push_back(std::move(cell.out));
+  }
+  return rows;
+}
+
+std::vector<std::string> AllAggregates() {
+  return {"COUNT() AS n", "SUM(v) AS sum", "MIN(v) AS min", "MAX(v) AS max",
+          "AVG(v) AS avg"};
+}
+
+TEST(GroupByAggregatorTest, AllAggregates) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.InsertUnchecked(kSpec, 1u, std::make_optional(int64_t(10)));
+  df.InsertUnchecked(kSpec, 2u, std::nullopt);
+  df.InsertUnchecked(kSpec, 1u, std::make_optional(int64_t(-30)));
+  df.InsertUnchecked(kSpec, 2u, std::nullopt);
+  df.InsertUnchecked(kSpec, 3u, std::make_optional(int64_t(5)));
+  df.Finalize();
+
+  // Groups are in the order of their first row. Nulls are skipped and the
+  // aggregates of a group without any value are null.
+  EXPECT_THAT(GroupByRows(df, "key", AllAggregates(), &pool),
+              ElementsAre("1|2|-20|-30|10|-10.000000",
+                          "2|2|NULL|NULL|NULL|NULL", "3|1|5|5|5|5.000000"));
+}
+
+TEST(GroupByAggregatorTest, DoubleValues) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(Int64(), NonNull(), Sorted()),
+      CreateTypedColumnSpec(Double(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.InsertUnchecked(kSpec, int64_t(1), 0.5);
+  df.InsertUnchecked(kSpec, int64_t(1), 2.0);
+  df.InsertUnchecked(kSpec, int64_t(4), 1.5);
+  df.Finalize();
+
+  EXPECT_THAT(GroupByRows(df, "key", AllAggregates(), &pool),
+              ElementsAre("1|2|2.500000|0.500000|2.000000|1.250000",
+                          "4|1|1.500000|1.500000|1.500000|1.500000"));
+}
+
+TEST(GroupByAggregatorTest, NullKeys) {
+  // All the null keys form a single group, for both sparse and dense null
+  // keys.
+  static constexpr auto kSparseSpec = CreateTypedDataframeSpec(
+      {"key", "v"},
+      CreateTypedColumnSpec(Int64(), SparseNullWithPopcountAlways(),
+                            Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe sparse = Dataframe::CreateFromTypedSpec(kSparseSpec, &pool);
+  sparse.InsertUnchecked(kSparseSpec, std::optional<int64_t>(), int64_t(1));
+  sparse.InsertUnchecked(kSparseSpec, std::make_optional(int64_t(7)),
+                         int64_t(2));
+  sparse.InsertUnchecked(kSparseSpec, std::optional<int64_t>(), int64_t(3));
+  sparse.InsertUnchecked(kSparseSpec, std::make_optional(int64_t(8)),
+                         int64_t(4));
+  sparse.InsertUnchecked(kSparseSpec, std::make_optional(int64_t(7)),
+                         int64_t(5));
+  sparse.Finalize();
+  EXPECT_THAT(
+      GroupByRows(sparse, "key", {"COUNT() AS n", "SUM(v) AS sum"}, &pool),
+      ElementsAre("NULL|2|4", "7|2|7", "8|1|4"));
+
+  static constexpr auto kDenseSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(String(), DenseNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  Dataframe dense = Dataframe::CreateFromTypedSpec(kDenseSpec, &pool);
+  dense.InsertUnchecked(kDenseSpec, std::make_optional(pool.InternString("a")),
+                        int64_t(1));
+  dense.InsertUnchecked(kDenseSpec, std::nullopt, int64_t(2));
+  dense.InsertUnchecked(kDenseSpec, std::make_optional(pool.InternString("b")),
+                        int64_t(3));
+  dense.InsertUnchecked(kDenseSpec, std::nullopt, int64_t(4));
+  dense.InsertUnchecked(kDenseSpec, std::make_optional(pool.InternString("a")),
+                        int64_t(5));
+  dense.Finalize();
+  EXPECT_THAT(
+      GroupByRows(dense, "key", {"COUNT() AS n", "MAX(v) AS max"}, &pool),
+      ElementsAre("a|2|5", "NULL|2|4", "b|1|3"));
+}
+
+TEST(GroupByAggregatorTest, EmptyInput) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.Finalize();
+  EXPECT_THAT(GroupByRows(df, "key", AllAggregates(), &pool), IsEmpty());
+
+  // The output still has the key and one column per spec.
+  std::vector<AggregateSpec> specs;
+  for (const std::string& spec : AllAggregates()) {
+    ASSERT_OK_AND_ASSIGN(AggregateSpec parsed, ParseAggregateSpec(spec));
+    specs.push_back(parsed);
+  }
+  auto result = GroupByAggregator::Aggregate(df, "key", specs, &pool);
+  ASSERT_OK(result.status());
+  EXPECT_THAT(result->column_names(),
+              IsSupersetOf({"key", "n", "sum", "min", "max", "avg"}));
+}
+
+constexpr auto kEncodedSpec = CreateTypedDataframeSpec(
+    {"ts", "cpu", "v"}, CreateTypedColumnSpec(Int64(), NonNull(), Sorted()),
+    CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+    CreateTypedColumnSpec(Int32(), DenseNull(), Unsorted()));
+
+// Returns a dataframe whose columns are all encoded if |compress| is true.
+Dataframe CreateEncodedDataframe(StringPool* pool, bool compress) {
+  Dataframe df = Dataframe::CreateFromTypedSpec(kEncodedSpec, pool);
+  for (uint32_t i = 0; i < 4096; ++i) {
+    std::optional<int32_t> v;
+    if (i % 5 != 0) {
+      v = static_cast<int32_t>(i % 40) - 20;
+    }
+    df.InsertUnchecked(kEncodedSpec, int64_t(1000000000000) + i / 4 * 10,
+                       (i % 8) * 3, v);
+  }
+  df.Finalize();
+  if (compress) {
+    df.CompressColumns();
+  }
+  return df;
+}
+
+TEST(GroupByAggregatorTest, EncodedColumns) {
+  StringPool pool;
+  Dataframe plain = CreateEncodedDataframe(&pool, false);
+  Dataframe encoded = CreateEncodedDataframe(&pool, true);
+  ASSERT_STREQ(encoded.GetColumnEncoding(0), "frame_of_reference");
+  ASSERT_STREQ(encoded.GetColumnEncoding(1), "dictionary");
+  ASSERT_STREQ(encoded.GetColumnEncoding(2), "frame_of_reference");
+
+  // Hashed encoded key, with every aggregate of encoded columns.
+  std::vector<std::string> specs = AllAggregates();
+  for (const char* spec : {"SUM(ts) AS ts_sum", "MIN(ts) AS ts_min",
+                           "MAX(ts) AS ts_max", "AVG(ts) AS ts_avg"}) {
+    specs.push_back(spec);
+  }
+  std::vector<std::string> expected = GroupByRows(plain, "cpu", specs, &pool);
+  ASSERT_THAT(expected, SizeIs(8));
+  EXPECT_EQ(GroupByRows(encoded, "cpu", specs, &pool), expected);
+
+  // Sorted encoded key, aggregating the dictionary encoded column.
+  specs = {"COUNT() AS n", "SUM(cpu) AS sum", "MIN(cpu) AS min",
+           "MAX(cpu) AS max", "AVG(cpu) AS avg"};
+  expected = GroupByRows(plain, "ts", specs, &pool);
+  ASSERT_THAT(expected, SizeIs(1024));
+  EXPECT_EQ(GroupByRows(encoded, "ts", specs, &pool), expected);
+}
+
+TEST(GroupByAggregatorTest, Errors) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key", "d", "s"}, CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Double(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(String(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.Finalize();
+
+  auto res = GroupByAggregator::Aggregate(df, "missing", {}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("unknown key column"));
+
+  res = GroupByAggregator::Aggregate(df, "d", {}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("cannot group by double"));
+
+  ASSERT_OK_AND_ASSIGN(AggregateSpec sum, ParseAggregateSpec("SUM(s) AS x"));
+  res = GroupByAggregator::Aggregate(df, "key", {sum}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("cannot aggregate column"));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core::aggregate
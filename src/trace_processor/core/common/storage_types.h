@@ -60,6 +60,10 @@ struct String {
 // TypeSet of all possible storage value types.
 using StorageType = core::TypeSet<Id, Uint32, Int32, Int64, Double, String>;
 
+// TypeSet of storage value types which can be stored in a compressed form
+// (see EncodedVector).
+using EncodableStorageType = core::TypeSet<Uint32, Int32, Int64>;
+
 // Maps a C++ type to its corresponding storage type tag.
 // E.g., TypeTagFor<int64_t>::type = Int64
 template <typename CppType>
@@ -17,9 +17,12 @@
 #ifndef SRC_TRACE_PROCESSOR_CORE_DATAFRAME_CURSOR_H_
 #define SRC_TRACE_PROCESSOR_CORE_DATAFRAME_CURSOR_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -34,6 +37,10 @@
 #include "src/trace_processor/core/interpreter/bytecode_interpreter.h"
 #include "src/trace_processor/core/interpreter/bytecode_registers.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor::core::dataframe {
 
 // Namespace alias for the interpreter types.
@@ -59,12 +66,26 @@ class Cursor {
   Cursor() = default;
 
   // Initializes the cursor from a query plan and dataframe columns.
+  //
+  // If `thread_pool` is non-null and the plan supports it, the plan is
+  // executed in morsels spread over the threads of `thread_pool` and the
+  // calling thread.
   void Initialize(const QueryPlanImpl& plan,
                   uint32_t column_count,
                   const Column* const* column_ptrs,
                   const Index* indexes,
-                  const StringPool* pool) {
-    interpreter_.Initialize(plan.bytecode, plan.params.register_count, pool);
+                  const StringPool* pool,
+                  base::ThreadPool* thread_pool = nullptr) {
+    morsel_.reset();
+    if (thread_pool && plan.params.morsel_size > 0) {
+      morsel_.emplace();
+      morsel_->bytecode = plan.SplitForMorsels();
+      morsel_->thread_pool = thread_pool;
+      interpreter_.Initialize(morsel_->bytecode.prologue,
+                              plan.params.register_count, pool);
+    } else {
+      interpreter_.Initialize(plan.bytecode, plan.params.register_count, pool);
+    }
     params_ = plan.params;
     col_to_output_offset_ = plan.col_to_output_offset;
     pool_ = pool;
@@ -83,6 +104,9 @@ class Cursor {
       interpreter_.SetRegisterValue(interpreter::HandleBase{init.dest_register},
                                     std::move(val));
     }
+    if (morsel_) {
+      InitializeMorselWorkers(plan, column_ptrs, indexes, pool);
+    }
   }
 
   // Executes the query and prepares the cursor for iteration.
@@ -145,14 +169,61 @@ class Cursor {
         cell_callback_impl.OnCell(
             pool_->Get(Storage::CastDataPtr<String>(p)[idx]));
         break;
+      case Storage::EncodedDataPointerIndex<Uint32>():
+        cell_callback_impl.OnCell(
+            (*Storage::CastEncodedDataPtr<Uint32>(p))[idx]);
+        break;
+      case Storage::EncodedDataPointerIndex<Int32>():
+        cell_callback_impl.OnCell(
+            (*Storage::CastEncodedDataPtr<Int32>(p))[idx]);
+        break;
+      case Storage::EncodedDataPointerIndex<Int64>():
+        cell_callback_impl.OnCell(
+            (*Storage::CastEncodedDataPtr<Int64>(p))[idx]);
+        break;
       default:
         PERFETTO_FATAL("Invalid storage spec");
     }
   }
 
  private:
-  // Bytecode interpreter that executes the query.
-  interpreter::Interpreter<FilterValueFetcherImpl> interpreter_;
+  using Interpreter = interpreter::Interpreter<FilterValueFetcherImpl>;
+
+  // State for executing a plan in morsels.
+  struct MorselState {
+    QueryPlanImpl::MorselBytecode bytecode;
+    base::ThreadPool* thread_pool = nullptr;
+
+    // One interpreter for the calling thread and each thread in the pool,
+    // executing `bytecode.body`.
+    std::vector<std::unique_ptr<Interpreter>> workers;
+
+    // The output indices of each morsel and all of them concatenated in
+    // morsel order.
+    std::vector<std::vector<uint32_t>> morsel_output;
+    std::vector<uint32_t> output;
+  };
+
+  void InitializeMorselWorkers(const QueryPlanImpl&,
+                               const Column* const* column_ptrs,
+                               const Index* indexes,
+                               const StringPool* pool);
+
+  // Executes the prologue on the calling thread and the body of the plan
+  // for every morsel on all the workers.
+  void ExecuteMorsels(FilterValueFetcherImpl&);
+
+  // Executes morsels on the `worker`-th interpreter until there are none
+  // left.
+  void RunMorsels(uint32_t worker,
+                  std::atomic<uint32_t>& next_morsel,
+                  FilterValueFetcherImpl&);
+
+  // Bytecode interpreter that executes the query (or only the prologue of
+  // the query for morsel execution).
+  Interpreter interpreter_;
+  // Only set if the query is executed in morsels.
+  std::optional<MorselState> morsel_;
   // Parameters for query execution.
   QueryPlanImpl::ExecutionParams params_;
   // Maps column indices to their output offsets in the result set.
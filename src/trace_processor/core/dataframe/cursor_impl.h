@@ -17,11 +17,22 @@
 #ifndef SRC_TRACE_PROCESSOR_CORE_DATAFRAME_CURSOR_IMPL_H_
 #define SRC_TRACE_PROCESSOR_CORE_DATAFRAME_CURSOR_IMPL_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
 
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "perfetto/ext/base/waitable_event.h"
 #include "src/trace_processor/core/dataframe/cursor.h"
 #include "src/trace_processor/core/interpreter/bytecode_interpreter_impl.h"  // IWYU pragma: keep
+#include "src/trace_processor/core/interpreter/bytecode_registers.h"
+#include "src/trace_processor/core/interpreter/interpreter_types.h"
+#include "src/trace_processor/core/util/range.h"
+#include "src/trace_processor/core/util/slab.h"
 #include "src/trace_processor/core/util/span.h"
 
 namespace perfetto::trace_processor::core::dataframe {
@@ -30,6 +41,10 @@ template <typename FilterValueFetcherImpl>
 void Cursor<FilterValueFetcherImpl>::Execute(
     FilterValueFetcherImpl& filter_value_fetcher) {
   using S = Span<uint32_t>;
+  if (morsel_) {
+    ExecuteMorsels(filter_value_fetcher);
+    return;
+  }
   interpreter_.Execute(filter_value_fetcher);
 
   const auto& span =
@@ -38,6 +53,129 @@ void Cursor<FilterValueFetcherImpl>::Execute(
   end_ = span.e;
 }
 
+template <typename FilterValueFetcherImpl>
+void Cursor<FilterValueFetcherImpl>::InitializeMorselWorkers(
+    const QueryPlanImpl& plan,
+    const Column* const* column_ptrs,
+    const Index* indexes,
+    const StringPool* pool) {
+  uint32_t worker_count = morsel_->thread_pool->thread_count() + 1;
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    auto& worker = morsel_->workers.emplace_back(new Interpreter());
+    worker->Initialize(morsel_->bytecode.body, plan.params.register_count,
+                       pool);
+    for (const auto& init : plan.register_inits) {
+      auto val =
+          QueryPlanImpl::GetRegisterInitValue(init, column_ptrs, indexes);
+      worker->SetRegisterValue(interpreter::HandleBase{init.dest_register},
+                               std::move(val));
+    }
+  }
+}
+
+template <typename FilterValueFetcherImpl>
+void Cursor<FilterValueFetcherImpl>::ExecuteMorsels(
+    FilterValueFetcherImpl& filter_value_fetcher) {
+  using CastResult = interpreter::CastFilterValueResult;
+  using NullBv = interpreter::NullBitvector;
+  MorselState& m = *morsel_;
+  const QueryPlanImpl::MorselBytecode& bytecode = m.bytecode;
+
+  // The value fetcher is not thread-safe: cast all the filter values up front
+  // and hand a copy of them to every worker.
+  interpreter_.Execute(filter_value_fetcher);
+  for (uint32_t reg : bytecode.filter_value_registers) {
+    const CastResult& value = *interpreter_.GetRegisterValue(
+        interpreter::ReadHandle<CastResult>(reg));
+    for (auto& worker : m.workers) {
+      worker->SetRegisterValue(interpreter::WriteHandle<CastResult>(reg),
+                               value);
+    }
+  }
+  for (uint32_t reg : bytecode.null_bv_registers) {
+    const NullBv& nbv =
+        *interpreter_.GetRegisterValue(interpreter::ReadHandle<NullBv>(reg));
+    for (auto& worker : m.workers) {
+      // The popcount only depends on the column so only needs to be copied
+      // on the first execution.
+      const NullBv& existing =
+          *worker->GetRegisterValue(interpreter::ReadHandle<NullBv>(reg));
+      if (existing.popcount.size() > 0) {
+        continue;
+      }
+      NullBv copy{nbv.bv, Slab<uint32_t>::Alloc(nbv.popcount.size())};
+      memcpy(copy.popcount.data(), nbv.popcount.data(),
+             nbv.popcount.size() * sizeof(uint32_t));
+      worker->SetRegisterValue(interpreter::WriteHandle<NullBv>(reg),
+                               std::move(copy));
+    }
+  }
+
+  uint32_t morsel_count =
+      (bytecode.row_count + params_.morsel_size - 1) / params_.morsel_size;
+  m.morsel_output.resize(morsel_count);
+
+  // Morsels are handed out dynamically so that threads which happen to get
+  // cheap morsels (e.g. because few rows match a filter) pick up more of
+  // them. The calling thread also works on morsels rather than just waiting.
+  std::atomic<uint32_t> next_morsel{0};
+  uint32_t task_count = std::min(
+      static_cast<uint32_t>(m.workers.size()) - 1, morsel_count - 1);
+  base::WaitableEvent tasks_done;
+  for (uint32_t i = 1; i <= task_count; ++i) {
+    m.thread_pool->PostTask(
+        [this, i, &next_morsel, &filter_value_fetcher, &tasks_done] {
+          RunMorsels(i, next_morsel, filter_value_fetcher);
+          tasks_done.Notify();
+        });
+  }
+  RunMorsels(0, next_morsel, filter_value_fetcher);
+  tasks_done.Wait(task_count);
+
+  size_t total = 0;
+  for (const auto& out : m.morsel_output) {
+    total += out.size();
+  }
+  m.output.resize(total);
+  uint32_t* it = m.output.data();
+  for (const auto& out : m.morsel_output) {
+    if (!out.empty()) {
+      memcpy(it, out.data(), out.size() * sizeof(uint32_t));
+      it += out.size();
+    }
+  }
+  pos_ = m.output.data();
+  end_ = m.output.data() + total;
+}
+
+template <typename FilterValueFetcherImpl>
+void Cursor<FilterValueFetcherImpl>::RunMorsels(
+    uint32_t worker,
+    std::atomic<uint32_t>& next_morsel,
+    FilterValueFetcherImpl& filter_value_fetcher) {
+  using S = Span<uint32_t>;
+  MorselState& m = *morsel_;
+  Interpreter& interpreter = *m.workers[worker];
+  uint32_t morsel_count = static_cast<uint32_t>(m.morsel_output.size());
+  for (;;) {
+    uint32_t i = next_morsel.fetch_add(1, std::memory_order_relaxed);
+    if (i >= morsel_count) {
+      return;
+    }
+    uint32_t begin = i * params_.morsel_size;
+    uint32_t size = std::min(params_.morsel_size, m.bytecode.row_count - begin);
+    interpreter.SetRegisterValue(m.bytecode.range_register,
+                                 Range{begin, begin + size});
+
+    // The body never fetches filter values (they are all cast in the
+    // prologue) so sharing the fetcher between threads is safe.
+    interpreter.Execute(filter_value_fetcher);
+    const auto& span =
+        *interpreter.template GetRegisterValue<S>(params_.output_register);
+    m.morsel_output[i].assign(span.b, span.e);
+  }
+}
+
 }  // namespace perfetto::trace_processor::core::dataframe
 
 #endif  // SRC_TRACE_PROCESSOR_CORE_DATAFRAME_CURSOR_IMPL_H_
@@ -36,6 +36,8 @@
 #include "src/trace_processor/core/dataframe/types.h"
 #include "src/trace_processor/core/interpreter/bytecode_to_string.h"
 #include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/encoded_vector.h"
+#include "src/trace_processor/core/util/flex_vector.h"
 
 namespace perfetto::trace_processor::core::dataframe {
 namespace {
@@ -60,6 +62,61 @@ void GatherBitsInPlace(core::BitVector& bv,
   bv.resize(count);
 }
 
+// Replaces the storage with an EncodedVector if that saves enough memory.
+// Returns true if the storage was replaced.
+template <typename T>
+bool MaybeEncodeStorage(Storage& storage) {
+  const auto& vec = storage.unchecked_get<T>();
+  auto encoded = EncodedVector<typename T::cpp_type>::MaybeEncode(
+      vec.data(), static_cast<uint32_t>(vec.size()));
+  if (!encoded) {
+    return false;
+  }
+  storage = Storage(std::move(*encoded));
+  return true;
+}
+
+template <typename T>
+FlexVector<typename T::cpp_type> DecodeStorage(const Storage& storage) {
+  const auto& encoded = storage.unchecked_get_encoded<T>();
+  auto vec = FlexVector<typename T::cpp_type>::CreateWithSize(encoded.size());
+  encoded.DecodeTo(vec.data());
+  return vec;
+}
+
+// Replaces encoded storage with the equivalent unencoded storage.
+void DecodeStorageInPlace(Storage& storage) {
+  switch (storage.type().index()) {
+    case StorageType::GetTypeIndex<Uint32>():
+      storage = Storage(DecodeStorage<Uint32>(storage));
+      break;
+    case StorageType::GetTypeIndex<Int32>():
+      storage = Storage(DecodeStorage<Int32>(storage));
+      break;
+    case StorageType::GetTypeIndex<Int64>():
+      storage = Storage(DecodeStorage<Int64>(storage));
+      break;
+    default:
+      PERFETTO_FATAL("Invalid encoded storage type");
+  }
+}
+
+template <typename T>
+const char* EncodingName(const Storage& storage) {
+  using Encoding = typename EncodedVector<typename T::cpp_type>::Encoding;
+  switch (storage.unchecked_get_encoded<T>().encoding()) {
+    case Encoding::kDictionary:
+      return "dictionary";
+    case Encoding::kFrameOfReference:
+      return "frame_of_reference";
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+uint64_t BitVectorMemoryUsage(const BitVector& bv) {
+  return (bv.size() + 63u) / 64u * sizeof(uint64_t);
+}
+
 }  // namespace
 
 Dataframe::Dataframe(StringPool* string_pool,
@@ -334,6 +391,121 @@ void Dataframe::Finalize() {
   ++non_column_mutations_;
 }
 
+void Dataframe::CompressColumns() {
+  PERFETTO_CHECK(finalized_);
+  bool changed = false;
+  for (const auto& c : columns_) {
+    // SetIdSorted columns have dedicated bytecodes which rely on having direct
+    // access to the values: compressing them would make those slower.
+    if (c->storage.is_encoded() || c->sort_state.Is<SetIdSorted>()) {
+      continue;
+    }
+    bool encoded;
+    switch (c->storage.type().index()) {
+      case StorageType::GetTypeIndex<Uint32>():
+        encoded = MaybeEncodeStorage<Uint32>(c->storage);
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        encoded = MaybeEncodeStorage<Int32>(c->storage);
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        encoded = MaybeEncodeStorage<Int64>(c->storage);
+        break;
+      default:
+        encoded = false;
+        break;
+    }
+    if (encoded) {
+      // The column may be shared with copies of this dataframe: make sure
+      // they also know that any cached pointers to the storage are stale.
+      ++c->mutations;
+      changed = true;
+    }
+  }
+  if (changed) {
+    ++non_column_mutations_;
+  }
+}
+
+const char* Dataframe::GetColumnEncoding(uint32_t column_idx) const {
+  const Storage& storage = columns_[column_idx]->storage;
+  if (!storage.is_encoded()) {
+    return "none";
+  }
+  switch (storage.type().index()) {
+    case StorageType::GetTypeIndex<Uint32>():
+      return EncodingName<Uint32>(storage);
+    case StorageType::GetTypeIndex<Int32>():
+      return EncodingName<Int32>(storage);
+    case StorageType::GetTypeIndex<Int64>():
+      return EncodingName<Int64>(storage);
+    default:
+      PERFETTO_FATAL("Invalid encoded storage type");
+  }
+}
+
+uint64_t Dataframe::GetColumnMemoryUsage(uint32_t column_idx) const {
+  const Column& c = *columns_[column_idx];
+  uint64_t res = 0;
+  if (c.storage.is_encoded()) {
+    switch (c.storage.type().index()) {
+      case StorageType::GetTypeIndex<Uint32>():
+        res += c.storage.unchecked_get_encoded<Uint32>().size_bytes();
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        res += c.storage.unchecked_get_encoded<Int32>().size_bytes();
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        res += c.storage.unchecked_get_encoded<Int64>().size_bytes();
+        break;
+      default:
+        PERFETTO_FATAL("Invalid encoded storage type");
+    }
+  } else {
+    switch (c.storage.type().index()) {
+      case StorageType::GetTypeIndex<Id>():
+        break;
+      case StorageType::GetTypeIndex<Uint32>():
+        res += c.storage.unchecked_get<Uint32>().capacity() * sizeof(uint32_t);
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        res += c.storage.unchecked_get<Int32>().capacity() * sizeof(int32_t);
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        res += c.storage.unchecked_get<Int64>().capacity() * sizeof(int64_t);
+        break;
+      case StorageType::GetTypeIndex<Double>():
+        res += c.storage.unchecked_get<Double>().capacity() * sizeof(double);
+        break;
+      case StorageType::GetTypeIndex<String>():
+        res += c.storage.unchecked_get<String>().capacity() *
+               sizeof(StringPool::Id);
+        break;
+      default:
+        PERFETTO_FATAL("Invalid storage type");
+    }
+  }
+  switch (c.null_storage.nullability().index()) {
+    case Nullability::GetTypeIndex<NonNull>():
+      break;
+    case Nullability::GetTypeIndex<SparseNull>():
+    case Nullability::GetTypeIndex<SparseNullWithPopcountAlways>():
+    case Nullability::GetTypeIndex<SparseNullWithPopcountUntilFinalization>(): {
+      const auto& null = c.null_storage.unchecked_get<SparseNull>();
+      res += BitVectorMemoryUsage(null.bit_vector);
+      res += null.prefix_popcount_for_cell_get.capacity() * sizeof(uint32_t);
+      break;
+    }
+    case Nullability::GetTypeIndex<DenseNull>():
+      res += BitVectorMemoryUsage(
+          c.null_storage.unchecked_get<DenseNull>().bit_vector);
+      break;
+    default:
+      PERFETTO_FATAL("Invalid nullability type");
+  }
+  return res;
+}
+
 dataframe::Dataframe Dataframe::CopyFinalized() const {
   PERFETTO_CHECK(finalized_);
   return *this;
@@ -468,6 +640,9 @@ Dataframe Dataframe::SelectRows(const uint32_t* indices, uint32_t count) && {
     PERFETTO_DCHECK(indices[i - 1] < indices[i]);
   }
   for (auto& col : columns_) {
+    if (col->storage.is_encoded()) {
+      DecodeStorageInPlace(col->storage);
+    }
     auto type = col->storage.type();
     if (type.Is<Id>()) {
       col->storage.unchecked_get<Id>().size = count;
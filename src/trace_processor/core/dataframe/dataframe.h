@@ -38,6 +38,14 @@
 #include "src/trace_processor/core/dataframe/types.h"
 #include "src/trace_processor/core/util/bit_vector.h"
 
+namespace perfetto::trace_processor::core::aggregate {
+class GroupByAggregator;
+}  // namespace perfetto::trace_processor::core::aggregate
+
+namespace perfetto::trace_processor::core::join {
+class HashJoiner;
+}  // namespace perfetto::trace_processor::core::join
+
 namespace perfetto::trace_processor::core::tree {
 class TreeTransformer;
 }  // namespace perfetto::trace_processor::core::tree
@@ -203,14 +211,18 @@ class Dataframe {
   // calling `PlanQuery`.
   //
   // Parameters:
-  //   plan: The query plan to execute.
-  //   c:    A reference to a std::optional that will be set to the prepared
-  //         cursor.
+  //   plan:        The query plan to execute.
+  //   c:           A reference to a std::optional that will be set to the
+  //                prepared cursor.
+  //   thread_pool: If non-null, large scans are executed in parallel on the
+  //                threads of this pool (see Cursor::Initialize).
   template <typename FilterValueFetcherImpl>
   void PrepareCursor(const QueryPlan& plan,
-                     Cursor<FilterValueFetcherImpl>& c) const {
+                     Cursor<FilterValueFetcherImpl>& c,
+                     base::ThreadPool* thread_pool = nullptr) const {
     c.Initialize(plan.plan_, static_cast<uint32_t>(column_ptrs_.size()),
-                 column_ptrs_.data(), indexes_.data(), string_pool_);
+                 column_ptrs_.data(), indexes_.data(), string_pool_,
+                 thread_pool);
   }
 
   // Given a typed spec, a column index and a row index, returns the value
@@ -281,6 +293,24 @@ class Dataframe {
   // If the dataframe is already finalized, this function does nothing.
   void Finalize();
 
+  // Replaces the storage of the integer columns of a finalized dataframe with
+  // a compressed representation (see EncodedVector) wherever doing so saves a
+  // significant amount of memory. Filters on compressed columns are evaluated
+  // directly on the compressed values; other operations decompress on the
+  // fly.
+  //
+  // Note: this can only be called on a finalized dataframe; it's undefined
+  // behavior to call this on a non-finalized dataframe.
+  void CompressColumns();
+
+  // Returns a human readable name for the representation of the storage of
+  // the column at `column_idx` (e.g. "dictionary" for compressed columns).
+  const char* GetColumnEncoding(uint32_t column_idx) const;
+
+  // Returns the number of bytes of memory used to store the values and nulls
+  // of the column at `column_idx`.
+  uint64_t GetColumnMemoryUsage(uint32_t column_idx) const;
+
   // Makes a copy of the dataframe which has been finalized. Unfinalized
   // dataframes *cannot* be copied, so this function will assert if not
   // finalized.
@@ -408,6 +438,18 @@ class Dataframe {
         callback.OnCell(string_pool_->Get(id));
         break;
       }
+      case Storage::EncodedDataPointerIndex<Uint32>():
+        callback.OnCell(
+            (*Storage::CastEncodedDataPtr<Uint32>(data_ptr))[storage_idx]);
+        break;
+      case Storage::EncodedDataPointerIndex<Int32>():
+        callback.OnCell(
+            (*Storage::CastEncodedDataPtr<Int32>(data_ptr))[storage_idx]);
+        break;
+      case Storage::EncodedDataPointerIndex<Int64>():
+        callback.OnCell(
+            (*Storage::CastEncodedDataPtr<Int64>(data_ptr))[storage_idx]);
+        break;
       default:
         PERFETTO_FATAL("Invalid storage type");
     }
@@ -446,10 +488,14 @@ class Dataframe {
 
  private:
   friend class AdhocDataframeBuilder;
+  friend class DataframeSnapshotReader;
+  friend class DataframeSnapshotWriter;
   friend class TypedCursor;
   friend class QueryPlanBuilder;
   friend struct QueryPlanImpl;
   friend class tree::TreeTransformer;
+  friend class aggregate::GroupByAggregator;
+  friend class join::HashJoiner;
 
   // TODO(lalitm): remove this once we have a proper static builder for
   // dataframe.
@@ -593,19 +639,19 @@ class Dataframe {
         std::is_same_v<N, SparseNullWithPopcountAlways>;
     static constexpr bool is_sparse_null_supporting_get_until_finalization =
         std::is_same_v<N, SparseNullWithPopcountUntilFinalization>;
-    const auto& storage = col.storage.unchecked_get<T>();
+    const auto& storage = col.storage;
     const auto& nulls = col.null_storage.unchecked_get<N>();
     // See kStringNullLegacy above.
     if constexpr (std::is_same_v<N, NonNull>) {
-      auto result = GetCellUncheckedFromStorage(storage, row);
+      auto result = GetCellUncheckedFromStorage<T>(storage, row);
       if constexpr (std::is_same_v<T, String>) {
         PERFETTO_DCHECK(!result.is_null());
       }
       return result;
     } else if constexpr (std::is_same_v<N, DenseNull>) {
-      using Ret = decltype(GetCellUncheckedFromStorage(storage, {}));
+      using Ret = decltype(GetCellUncheckedFromStorage<T>(storage, {}));
       if (nulls.bit_vector.is_set(row)) {
-        auto result = GetCellUncheckedFromStorage(storage, row);
+        auto result = GetCellUncheckedFromStorage<T>(storage, row);
         if constexpr (std::is_same_v<T, String>) {
           PERFETTO_DCHECK(!result.is_null());
         }
@@ -615,12 +661,12 @@ class Dataframe {
     } else if constexpr (is_sparse_null_supporting_get_always ||
                          is_sparse_null_supporting_get_until_finalization) {
       PERFETTO_DCHECK(is_sparse_null_supporting_get_always || !finalized_);
-      using Ret = decltype(GetCellUncheckedFromStorage(storage, {}));
+      using Ret = decltype(GetCellUncheckedFromStorage<T>(storage, {}));
       if (nulls.bit_vector.is_set(row)) {
         auto index = static_cast<uint32_t>(
             nulls.prefix_popcount_for_cell_get[row / 64] +
             nulls.bit_vector.count_set_bits_until_in_word(row));
-        auto result = GetCellUncheckedFromStorage(storage, index);
+        auto result = GetCellUncheckedFromStorage<T>(storage, index);
         if constexpr (std::is_same_v<T, String>) {
           PERFETTO_DCHECK(!result.is_null());
         }
@@ -714,13 +760,19 @@ class Dataframe {
     }
   }
 
-  template <typename C>
-  PERFETTO_ALWAYS_INLINE auto GetCellUncheckedFromStorage(const C& column,
-                                                          uint32_t row) const {
-    if constexpr (std::is_same_v<C, Storage::Id>) {
-      return row + column.popped_rows;
+  template <typename T>
+  PERFETTO_ALWAYS_INLINE auto GetCellUncheckedFromStorage(
+      const Storage& storage,
+      uint32_t row) const {
+    if constexpr (std::is_same_v<T, Id>) {
+      return row + storage.unchecked_get<Id>().popped_rows;
+    } else if constexpr (EncodableStorageType::Contains<T>()) {
+      if (PERFETTO_UNLIKELY(storage.is_encoded())) {
+        return storage.unchecked_get_encoded<T>()[row];
+      }
+      return storage.unchecked_get<T>()[row];
     } else {
-      return column[row];
+      return storage.unchecked_get<T>()[row];
     }
   }
 
@@ -0,0 +1,606 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/dataframe/dataframe_snapshot.h"
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/utils.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/types.h"
+#include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/encoded_vector.h"
+#include "src/trace_processor/core/util/flex_vector.h"
+
+namespace perfetto::trace_processor::core::dataframe {
+namespace {
+
+constexpr char kMagic[8] = {'P', 'E', 'R', 'F', 'S', 'N', 'A', 'P'};
+
+// magic + version + dataframe count + string count.
+constexpr size_t kHeaderSize = sizeof(kMagic) + 4 + 4 + 8;
+
+void AppendBytes(std::vector<uint8_t>* out, const void* data, size_t size) {
+  const auto* ptr = static_cast<const uint8_t*>(data);
+  out->insert(out->end(), ptr, ptr + size);
+}
+
+template <typename T>
+void AppendPod(std::vector<uint8_t>* out, T value) {
+  AppendBytes(out, &value, sizeof(T));
+}
+
+void AlignTo8(std::vector<uint8_t>* out) {
+  out->resize(base::AlignUp<8>(out->size()), 0);
+}
+
+void AppendName(std::vector<uint8_t>* out, std::string_view name) {
+  AppendPod<uint32_t>(out, static_cast<uint32_t>(name.size()));
+  AppendBytes(out, name.data(), name.size());
+  AlignTo8(out);
+}
+
+template <typename T>
+void AppendFlexVector(std::vector<uint8_t>* out, const FlexVector<T>& vec) {
+  AppendPod<uint64_t>(out, vec.size());
+  AppendBytes(out, vec.data(), vec.size() * sizeof(T));
+  AlignTo8(out);
+}
+
+// Encoded vectors are written in the same format as FlexVectors: snapshots
+// always contain decoded values.
+template <typename T>
+void AppendEncodedVector(std::vector<uint8_t>* out,
+                         const EncodedVector<T>& vec) {
+  AppendPod<uint64_t>(out, vec.size());
+  size_t offset = out->size();
+  out->resize(offset + vec.size() * sizeof(T));
+  vec.DecodeTo(reinterpret_cast<T*>(out->data() + offset));
+  AlignTo8(out);
+}
+
+void AppendBitVector(std::vector<uint8_t>* out, const BitVector& bv) {
+  AppendPod<uint64_t>(out, bv.size());
+  AppendBytes(out, bv.words(), ((bv.size() + 63u) / 64u) * sizeof(uint64_t));
+}
+
+// Bounds-checked reader over a snapshot. Offsets are relative to the start of
+// the snapshot so that alignment matches the one used by the writer.
+class SnapshotCursor {
+ public:
+  SnapshotCursor(const uint8_t* data, size_t end, size_t offset)
+      : data_(data), end_(end), offset_(offset) {}
+
+  // Returns a pointer to the next `count` elements of `elem_size` bytes and
+  // advances past them or nullptr if the snapshot is too short.
+  const uint8_t* TakeArray(uint64_t count, size_t elem_size) {
+    if (count > (end_ - offset_) / elem_size) {
+      return nullptr;
+    }
+    const uint8_t* res = data_ + offset_;
+    offset_ += static_cast<size_t>(count) * elem_size;
+    return res;
+  }
+
+  template <typename T>
+  bool Read(T* out) {
+    const uint8_t* ptr = TakeArray(1, sizeof(T));
+    if (!ptr) {
+      return false;
+    }
+    memcpy(out, ptr, sizeof(T));
+    return true;
+  }
+
+  bool ReadName(std::string_view* out) {
+    uint32_t size;
+    if (!Read(&size)) {
+      return false;
+    }
+    const uint8_t* ptr = TakeArray(size, 1);
+    if (!ptr) {
+      return false;
+    }
+    *out = std::string_view(reinterpret_cast<const char*>(ptr), size);
+    return AlignTo8();
+  }
+
+  bool AlignTo8() {
+    size_t aligned = base::AlignUp<8>(offset_);
+    if (aligned > end_) {
+      return false;
+    }
+    offset_ = aligned;
+    return true;
+  }
+
+  size_t offset() const { return offset_; }
+
+ private:
+  const uint8_t* data_;
+  size_t end_;
+  size_t offset_;
+};
+
+base::Status TruncatedError() {
+  return base::ErrStatus("Snapshot: file is truncated or corrupted");
+}
+
+// Returns the TypeSet `T` holding the type at `index` or std::nullopt if
+// `index` is out of range.
+template <typename T, size_t... Is>
+std::optional<T> TypeSetFromIndex(uint32_t index, std::index_sequence<Is...>) {
+  std::optional<T> res;
+  ((index == Is
+        ? (res.emplace(typename T::template GetTypeAtIndex<Is>{}), true)
+        : false) ||
+   ...);
+  return res;
+}
+
+template <typename T>
+std::optional<T> TypeSetFromIndex(uint32_t index) {
+  return TypeSetFromIndex<T>(index, std::make_index_sequence<T::kSize>());
+}
+
+template <typename T>
+base::StatusOr<FlexVector<T>> ReadFlexVector(SnapshotCursor& c) {
+  uint64_t count;
+  if (!c.Read(&count)) {
+    return TruncatedError();
+  }
+  const uint8_t* ptr = c.TakeArray(count, sizeof(T));
+  if (!ptr || !c.AlignTo8()) {
+    return TruncatedError();
+  }
+  auto vec = FlexVector<T>::CreateWithSize(count);
+  if (count > 0) {
+    memcpy(vec.data(), ptr, static_cast<size_t>(count) * sizeof(T));
+  }
+  return std::move(vec);
+}
+
+base::StatusOr<BitVector> ReadBitVector(SnapshotCursor& c) {
+  uint64_t size;
+  if (!c.Read(&size)) {
+    return TruncatedError();
+  }
+  uint64_t words = size / 64u + (size % 64u != 0);
+  const uint8_t* ptr = c.TakeArray(words, sizeof(uint64_t));
+  if (!ptr) {
+    return TruncatedError();
+  }
+  return BitVector::CreateFromWords(reinterpret_cast<const uint64_t*>(ptr),
+                                    size);
+}
+
+NullStorage CreateNullStorage(Nullability nullability, BitVector bv) {
+  switch (nullability.index()) {
+    case Nullability::GetTypeIndex<NonNull>():
+      return NullStorage(NullStorage::NonNull{});
+    case Nullability::GetTypeIndex<SparseNull>():
+      return NullStorage(NullStorage::SparseNull{std::move(bv), {}},
+                         SparseNull{});
+    case Nullability::GetTypeIndex<SparseNullWithPopcountAlways>(): {
+      auto popcount = bv.PrefixPopcountFlexVector();
+      return NullStorage(
+          NullStorage::SparseNull{std::move(bv), std::move(popcount)},
+          SparseNullWithPopcountAlways{});
+    }
+    case Nullability::GetTypeIndex<SparseNullWithPopcountUntilFinalization>():
+      // Snapshots only contain finalized dataframes which have already
+      // dropped the popcount.
+      return NullStorage(NullStorage::SparseNull{std::move(bv), {}},
+                         SparseNullWithPopcountUntilFinalization{});
+    case Nullability::GetTypeIndex<DenseNull>():
+      return NullStorage(NullStorage::DenseNull{std::move(bv)});
+    default:
+      PERFETTO_FATAL("Invalid nullability type");
+  }
+}
+
+}  // namespace
+
+// =================================================================
+// |                DataframeSnapshotWriter                        |
+// =================================================================
+
+DataframeSnapshotWriter::DataframeSnapshotWriter() = default;
+DataframeSnapshotWriter::~DataframeSnapshotWriter() = default;
+
+void DataframeSnapshotWriter::AddDataframe(std::string_view name,
+                                           const Dataframe& df) {
+  PERFETTO_CHECK(df.finalized());
+  PERFETTO_CHECK(!pool_ || pool_ == df.string_pool_);
+  pool_ = df.string_pool_;
+  ++dataframe_count_;
+
+  AppendName(&dataframes_, name);
+
+  // Placeholder for the payload size, patched below once it is known. This
+  // allows the reader to skip over dataframes without parsing them.
+  size_t size_offset = dataframes_.size();
+  AppendPod<uint64_t>(&dataframes_, 0);
+  size_t start = dataframes_.size();
+
+  AppendPod<uint32_t>(&dataframes_, df.row_count_);
+  AppendPod<uint32_t>(&dataframes_, static_cast<uint32_t>(df.columns_.size()));
+  for (size_t i = 0; i < df.columns_.size(); ++i) {
+    AppendColumn(df.column_names_[i], *df.columns_[i]);
+  }
+
+  auto size = static_cast<uint64_t>(dataframes_.size() - start);
+  memcpy(dataframes_.data() + size_offset, &size, sizeof(size));
+}
+
+void DataframeSnapshotWriter::AppendColumn(std::string_view name,
+                                           const Column& column) {
+  std::vector<uint8_t>* out = &dataframes_;
+  AppendName(out, name);
+
+  bool has_small_value_eq =
+      column.specialized_storage.Is<SpecializedStorage::SmallValueEq>();
+  AppendPod<uint32_t>(out, column.storage.type().index());
+  AppendPod<uint32_t>(out, column.null_storage.nullability().index());
+  AppendPod<uint32_t>(out, column.sort_state.index());
+  AppendPod<uint32_t>(out, column.duplicate_state.index());
+  AppendPod<uint32_t>(out, has_small_value_eq);
+  AppendPod<uint32_t>(out, 0);  // Reserved.
+
+  const Storage& storage = column.storage;
+  switch (storage.type().index()) {
+    case StorageType::GetTypeIndex<Id>(): {
+      const auto& id = storage.unchecked_get<Id>();
+      AppendPod<uint64_t>(out, id.size);
+      AppendPod<uint64_t>(out, id.popped_rows);
+      break;
+    }
+    case StorageType::GetTypeIndex<Uint32>():
+      if (storage.is_encoded()) {
+        AppendEncodedVector(out, storage.unchecked_get_encoded<Uint32>());
+      } else {
+        AppendFlexVector(out, storage.unchecked_get<Uint32>());
+      }
+      break;
+    case StorageType::GetTypeIndex<Int32>():
+      if (storage.is_encoded()) {
+        AppendEncodedVector(out, storage.unchecked_get_encoded<Int32>());
+      } else {
+        AppendFlexVector(out, storage.unchecked_get<Int32>());
+      }
+      break;
+    case StorageType::GetTypeIndex<Int64>():
+      if (storage.is_encoded()) {
+        AppendEncodedVector(out, storage.unchecked_get_encoded<Int64>());
+      } else {
+        AppendFlexVector(out, storage.unchecked_get<Int64>());
+      }
+      break;
+    case StorageType::GetTypeIndex<Double>():
+      AppendFlexVector(out, storage.unchecked_get<Double>());
+      break;
+    case StorageType::GetTypeIndex<String>(): {
+      const auto& vec = storage.unchecked_get<String>();
+      AppendPod<uint64_t>(out, vec.size());
+      for (StringPool::Id id : vec) {
+        AppendPod<uint32_t>(out, InternString(id));
+      }
+      AlignTo8(out);
+      break;
+    }
+    default:
+      PERFETTO_FATAL("Invalid storage type");
+  }
+
+  if (const BitVector* bv = column.null_storage.MaybeGetNullBitVector(); bv) {
+    AppendBitVector(out, *bv);
+  }
+  if (has_small_value_eq) {
+    const auto& eq = column.specialized_storage
+                         .unchecked_get<SpecializedStorage::SmallValueEq>();
+    AppendBitVector(out, eq.bit_vector);
+  }
+}
+
+uint32_t DataframeSnapshotWriter::InternString(StringPool::Id id) {
+  if (id.is_null()) {
+    return 0;
+  }
+  auto [index, inserted] = string_index_.Insert(
+      id.raw_id(), static_cast<uint32_t>(strings_.size() + 1));
+  if (inserted) {
+    strings_.push_back(pool_->Get(id));
+  }
+  return *index;
+}
+
+std::vector<uint8_t> DataframeSnapshotWriter::Finish() && {
+  std::vector<uint8_t> out;
+  AppendBytes(&out, kMagic, sizeof(kMagic));
+  AppendPod<uint32_t>(&out, DataframeSnapshotReader::kVersion);
+  AppendPod<uint32_t>(&out, dataframe_count_);
+  AppendPod<uint64_t>(&out, strings_.size());
+  PERFETTO_DCHECK(out.size() == kHeaderSize);
+
+  // The string table is stored as all the lengths followed by all the
+  // characters to avoid padding every string to 8 bytes.
+  for (const auto& s : strings_) {
+    AppendPod<uint32_t>(&out, static_cast<uint32_t>(s.size()));
+  }
+  AlignTo8(&out);
+  for (const auto& s : strings_) {
+    AppendBytes(&out, s.data(), s.size());
+  }
+  AlignTo8(&out);
+
+  out.insert(out.end(), dataframes_.begin(), dataframes_.end());
+  return out;
+}
+
+// =================================================================
+// |                DataframeSnapshotReader                        |
+// =================================================================
+
+DataframeSnapshotReader::DataframeSnapshotReader(const uint8_t* data,
+                                                 size_t size)
+    : data_(data), size_(size) {}
+DataframeSnapshotReader::DataframeSnapshotReader(
+    DataframeSnapshotReader&&) noexcept = default;
+DataframeSnapshotReader& DataframeSnapshotReader::operator=(
+    DataframeSnapshotReader&&) noexcept = default;
+DataframeSnapshotReader::~DataframeSnapshotReader() = default;
+
+// static
+bool DataframeSnapshotReader::IsSnapshot(const uint8_t* data, size_t size) {
+  return size >= sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+// static
+base::StatusOr<DataframeSnapshotReader> DataframeSnapshotReader::Create(
+    const uint8_t* data,
+    size_t size) {
+  if (!IsSnapshot(data, size)) {
+    return base::ErrStatus("Snapshot: invalid magic");
+  }
+  SnapshotCursor c(data, size, sizeof(kMagic));
+  uint32_t version;
+  uint32_t dataframe_count;
+  uint64_t string_count;
+  if (!c.Read(&version)) {
+    return TruncatedError();
+  }
+  if (version != kVersion) {
+    return base::ErrStatus(
+        "Snapshot: unsupported version %u (this build supports version %u)",
+        version, kVersion);
+  }
+  if (!c.Read(&dataframe_count) || !c.Read(&string_count)) {
+    return TruncatedError();
+  }
+
+  DataframeSnapshotReader reader(data, size);
+
+  const uint8_t* lengths = c.TakeArray(string_count, sizeof(uint32_t));
+  if (!lengths || !c.AlignTo8()) {
+    return TruncatedError();
+  }
+  reader.strings_.reserve(static_cast<size_t>(string_count));
+  for (uint64_t i = 0; i < string_count; ++i) {
+    uint32_t len;
+    memcpy(&len, lengths + i * sizeof(uint32_t), sizeof(uint32_t));
+    const uint8_t* ptr = c.TakeArray(len, 1);
+    if (!ptr) {
+      return TruncatedError();
+    }
+    reader.strings_.emplace_back(reinterpret_cast<const char*>(ptr), len);
+  }
+  if (!c.AlignTo8()) {
+    return TruncatedError();
+  }
+
+  reader.entries_.reserve(dataframe_count);
+  for (uint32_t i = 0; i < dataframe_count; ++i) {
+    std::string_view name;
+    uint64_t payload_size;
+    if (!c.ReadName(&name) || !c.Read(&payload_size)) {
+      return TruncatedError();
+    }
+    size_t offset = c.offset();
+    if (!c.TakeArray(payload_size, 1)) {
+      return TruncatedError();
+    }
+    reader.entries_.push_back(
+        Entry{std::string(name), offset, static_cast<size_t>(payload_size)});
+  }
+  return std::move(reader);
+}
+
+std::vector<std::string> DataframeSnapshotReader::GetDataframeNames() const {
+  std::vector<std::string> names;
+  names.reserve(entries_.size());
+  for (const auto& e : entries_) {
+    names.push_back(e.name);
+  }
+  return names;
+}
+
+base::StatusOr<Dataframe> DataframeSnapshotReader::Load(std::string_view name,
+                                                        StringPool* pool) {
+  const Entry* entry = nullptr;
+  for (const auto& e : entries_) {
+    if (e.name == name) {
+      entry = &e;
+      break;
+    }
+  }
+  if (!entry) {
+    return base::ErrStatus("Snapshot: no dataframe named '%.*s'",
+                           static_cast<int>(name.size()), name.data());
+  }
+
+  // Interning is done lazily (and only once per pool) so that callers which
+  // only need a subset of the dataframes do not pay for all the strings.
+  if (interned_pool_ != pool) {
+    interned_pool_ = pool;
+    interned_ids_.clear();
+    interned_ids_.reserve(strings_.size() + 1);
+    interned_ids_.push_back(StringPool::Id::Null());
+    for (std::string_view s : strings_) {
+      interned_ids_.push_back(
+          pool->InternString(base::StringView(s.data(), s.size())));
+    }
+  }
+
+  SnapshotCursor c(data_, entry->offset + entry->size, entry->offset);
+  uint32_t row_count;
+  uint32_t column_count;
+  if (!c.Read(&row_count) || !c.Read(&column_count)) {
+    return TruncatedError();
+  }
+
+  std::vector<std::string> column_names;
+  std::vector<std::shared_ptr<Column>> columns;
+  for (uint32_t i = 0; i < column_count; ++i) {
+    std::string_view column_name;
+    uint32_t indices[6];
+    if (!c.ReadName(&column_name) || !c.Read(&indices)) {
+      return TruncatedError();
+    }
+    auto type = TypeSetFromIndex<StorageType>(indices[0]);
+    auto nullability = TypeSetFromIndex<Nullability>(indices[1]);
+    auto sort_state = TypeSetFromIndex<SortState>(indices[2]);
+    auto duplicate_state = TypeSetFromIndex<DuplicateState>(indices[3]);
+    if (!type || !nullability || !sort_state || !duplicate_state) {
+      return base::ErrStatus("Snapshot: column '%s' has an invalid spec",
+                             std::string(column_name).c_str());
+    }
+    bool has_small_value_eq = indices[4] != 0;
+
+    std::optional<Storage> storage;
+    uint64_t storage_size;
+    switch (type->index()) {
+      case StorageType::GetTypeIndex<Id>(): {
+        uint64_t size;
+        uint64_t popped_rows;
+        if (!c.Read(&size) || !c.Read(&popped_rows)) {
+          return TruncatedError();
+        }
+        storage.emplace(Storage::Id{static_cast<uint32_t>(size),
+                                    static_cast<uint32_t>(popped_rows)});
+        storage_size = size;
+        break;
+      }
+      case StorageType::GetTypeIndex<Uint32>(): {
+        ASSIGN_OR_RETURN(auto vec, ReadFlexVector<uint32_t>(c));
+        storage_size = vec.size();
+        storage.emplace(std::move(vec));
+        break;
+      }
+      case StorageType::GetTypeIndex<Int32>(): {
+        ASSIGN_OR_RETURN(auto vec, ReadFlexVector<int32_t>(c));
+        storage_size = vec.size();
+        storage.emplace(std::move(vec));
+        break;
+      }
+      case StorageType::GetTypeIndex<Int64>(): {
+        ASSIGN_OR_RETURN(auto vec, ReadFlexVector<int64_t>(c));
+        storage_size = vec.size();
+        storage.emplace(std::move(vec));
+        break;
+      }
+      case StorageType::GetTypeIndex<Double>(): {
+        ASSIGN_OR_RETURN(auto vec, ReadFlexVector<double>(c));
+        storage_size = vec.size();
+        storage.emplace(std::move(vec));
+        break;
+      }
+      case StorageType::GetTypeIndex<String>(): {
+        ASSIGN_OR_RETURN(auto indexes, ReadFlexVector<uint32_t>(c));
+        auto vec = Storage::String::CreateWithSize(indexes.size());
+        for (uint64_t j = 0; j < indexes.size(); ++j) {
+          if (indexes[j] >= interned_ids_.size()) {
+            return TruncatedError();
+          }
+          vec[j] = interned_ids_[indexes[j]];
+        }
+        storage_size = vec.size();
+        storage.emplace(std::move(vec));
+        break;
+      }
+      default:
+        PERFETTO_FATAL("Invalid storage type");
+    }
+
+    BitVector null_bv;
+    uint64_t expected_storage_size = row_count;
+    if (!nullability->Is<NonNull>()) {
+      ASSIGN_OR_RETURN(null_bv, ReadBitVector(c));
+      if (null_bv.size() != row_count) {
+        return TruncatedError();
+      }
+      if (!nullability->Is<DenseNull>()) {
+        expected_storage_size = null_bv.CountSetBits(null_bv.size());
+      }
+    }
+    if (storage_size != expected_storage_size) {
+      return base::ErrStatus(
+          "Snapshot: column '%s' has %" PRIu64 " values, expected %" PRIu64,
+          std::string(column_name).c_str(), storage_size,
+          expected_storage_size);
+    }
+
+    SpecializedStorage specialized;
+    if (has_small_value_eq) {
+      ASSIGN_OR_RETURN(BitVector bv, ReadBitVector(c));
+      auto popcount = bv.PrefixPopcount();
+      specialized = SpecializedStorage(
+          SpecializedStorage::SmallValueEq{std::move(bv), std::move(popcount)});
+    }
+
+    column_names.emplace_back(column_name);
+    columns.emplace_back(std::make_shared<Column>(Column{
+        std::move(*storage),
+        CreateNullStorage(*nullability, std::move(null_bv)),
+        *sort_state,
+        *duplicate_state,
+        std::move(specialized),
+    }));
+  }
+  // The columns are already in their finalized form: mark the dataframe as
+  // finalized directly rather than calling Finalize() which would reallocate
+  // every column.
+  Dataframe df(false, std::move(column_names), std::move(columns), row_count,
+               pool);
+  df.finalized_ = true;
+  return std::move(df);
+}
+
+}  // namespace perfetto::trace_processor::core::dataframe
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_DATAFRAME_DATAFRAME_SNAPSHOT_H_
+#define SRC_TRACE_PROCESSOR_CORE_DATAFRAME_DATAFRAME_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+
+namespace perfetto::trace_processor::core::dataframe {
+
+// Snapshots are a versioned, columnar, binary serialization of a set of
+// finalized dataframes. They are designed to be mmap()ed and loaded back with
+// a handful of memcpys per column rather than any per-row parsing.
+//
+// Layout (all integers are host-endian; every section starts at an 8-byte
+// aligned offset):
+//   header:     magic, format version, dataframe count, string count.
+//   strings:    every string referenced by a string column, deduplicated.
+//   dataframes: name, payload size, row count and, for each column, its name,
+//               spec, raw storage and null bitvector words.
+//
+// String columns are stored as indices into the string table (0 == null) so
+// that a snapshot does not depend on the StringPool ids of the writer.
+
+// Builds a snapshot from a set of dataframes.
+class DataframeSnapshotWriter {
+ public:
+  DataframeSnapshotWriter();
+  ~DataframeSnapshotWriter();
+
+  DataframeSnapshotWriter(const DataframeSnapshotWriter&) = delete;
+  DataframeSnapshotWriter& operator=(const DataframeSnapshotWriter&) = delete;
+
+  // Adds `df` to the snapshot under `name`. `df` must be finalized. All
+  // dataframes must share the same string pool, which must outlive this
+  // writer.
+  void AddDataframe(std::string_view name, const Dataframe& df);
+
+  // Returns the serialized snapshot.
+  std::vector<uint8_t> Finish() &&;
+
+ private:
+  void AppendColumn(std::string_view name, const Column& column);
+  uint32_t InternString(StringPool::Id id);
+
+  uint32_t dataframe_count_ = 0;
+  std::vector<uint8_t> dataframes_;
+
+  // Maps the raw StringPool::Id of a string in `pool_` to its index in
+  // `strings_` + 1 (0 is reserved for null).
+  const StringPool* pool_ = nullptr;
+  base::FlatHashMap<uint32_t, uint32_t> string_index_;
+  std::vector<NullTermStringView> strings_;
+};
+
+// Reads back dataframes from a snapshot created by DataframeSnapshotWriter.
+class DataframeSnapshotReader {
+ public:
+  // The version of the snapshot format. Must be bumped on any change to the
+  // layout or to the meaning of the serialized type indices.
+  static constexpr uint32_t kVersion = 1;
+
+  // Returns true if `data` looks like a snapshot.
+  static bool IsSnapshot(const uint8_t* data, size_t size);
+
+  // Parses the header, string table and dataframe directory of the snapshot
+  // in `data`. `data` must outlive the returned reader.
+  static base::StatusOr<DataframeSnapshotReader> Create(const uint8_t* data,
+                                                        size_t size);
+
+  DataframeSnapshotReader(DataframeSnapshotReader&&) noexcept;
+  DataframeSnapshotReader& operator=(DataframeSnapshotReader&&) noexcept;
+  ~DataframeSnapshotReader();
+
+  // Returns the names of all dataframes in the snapshot, in the order they
+  // were added.
+  std::vector<std::string> GetDataframeNames() const;
+
+  // Loads the dataframe called `name`, interning strings into `pool`. The
+  // returned dataframe is finalized.
+  base::StatusOr<Dataframe> Load(std::string_view name, StringPool* pool);
+
+ private:
+  struct Entry {
+    std::string name;
+    size_t offset;
+    size_t size;
+  };
+
+  DataframeSnapshotReader(const uint8_t* data, size_t size);
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<std::string_view> strings_;
+  std::vector<Entry> entries_;
+
+  // `strings_` interned into `interned_pool_`; index 0 is the null id.
+  StringPool* interned_pool_ = nullptr;
+  std::vector<StringPool::Id> interned_ids_;
+};
+
+}  // namespace perfetto::trace_processor::core::dataframe
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_DATAFRAME_DATAFRAME_SNAPSHOT_H_
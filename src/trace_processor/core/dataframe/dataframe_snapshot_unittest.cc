@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/dataframe/dataframe_snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "src/base/test/status_matchers.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/dataframe_test_utils.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core::dataframe {
+namespace {
+
+using base::gtest_matchers::IsError;
+using testing::ElementsAre;
+
+constexpr auto kSpec = CreateTypedDataframeSpec(
+    {"id", "uint32", "int32", "int64", "double", "string"},
+    CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+    CreateTypedColumnSpec(Uint32(), NonNull(), Sorted()),
+    CreateTypedColumnSpec(Int32(), DenseNull(), Unsorted()),
+    CreateTypedColumnSpec(Int64(), SparseNull(), Unsorted()),
+    CreateTypedColumnSpec(Double(), SparseNullWithPopcountAlways(),
+                          Unsorted()),
+    CreateTypedColumnSpec(String(), SparseNullWithPopcountUntilFinalization(),
+                          Unsorted()));
+
+Dataframe CreateTestDataframe(StringPool* pool) {
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, pool);
+  df.InsertUnchecked(kSpec, std::monostate(), 1u, std::make_optional(-1),
+                     std::make_optional(int64_t(100)), std::make_optional(1.5),
+                     std::make_optional(pool->InternString("foo")));
+  df.InsertUnchecked(kSpec, std::monostate(), 2u, std::nullopt, std::nullopt,
+                     std::nullopt, std::nullopt);
+  df.InsertUnchecked(kSpec, std::monostate(), 3u, std::make_optional(7),
+                     std::make_optional(int64_t(-5)), std::make_optional(2.5),
+                     std::make_optional(pool->InternString("bar")));
+  df.Finalize();
+  return df;
+}
+
+std::vector<uint8_t> CreateSnapshot(const Dataframe& df) {
+  DataframeSnapshotWriter writer;
+  writer.AddDataframe("test", df);
+  return std::move(writer).Finish();
+}
+
+TEST(DataframeSnapshotTest, RoundTrip) {
+  StringPool pool;
+  Dataframe df = CreateTestDataframe(&pool);
+  std::vector<uint8_t> snapshot = CreateSnapshot(df);
+  ASSERT_TRUE(
+      DataframeSnapshotReader::IsSnapshot(snapshot.data(), snapshot.size()));
+
+  ASSERT_OK_AND_ASSIGN(
+      auto reader,
+      DataframeSnapshotReader::Create(snapshot.data(), snapshot.size()));
+  EXPECT_THAT(reader.GetDataframeNames(), ElementsAre("test"));
+
+  // Load into a different pool with unrelated strings to make sure that
+  // strings are re-interned rather than copied as raw ids.
+  StringPool other_pool;
+  other_pool.InternString("unrelated");
+  ASSERT_OK_AND_ASSIGN(Dataframe loaded, reader.Load("test", &other_pool));
+
+  EXPECT_TRUE(loaded.finalized());
+  EXPECT_EQ(loaded.row_count(), 3u);
+  EXPECT_EQ(loaded.column_names(), df.column_names());
+  VerifyData(loaded, 0b111111,
+             Rows(Row(0u, 1u, int32_t(-1), int64_t(100), 1.5, "foo"),
+                  Row(1u, 2u, nullptr, nullptr, nullptr, nullptr),
+                  Row(2u, 3u, int32_t(7), int64_t(-5), 2.5, "bar")));
+
+  // Random access on popcount columns must work without re-finalizing.
+  EXPECT_EQ(loaded.GetCellUnchecked<4>(kSpec, 2), 2.5);
+  EXPECT_EQ(loaded.GetCellUnchecked<4>(kSpec, 1), std::nullopt);
+}
+
+TEST(DataframeSnapshotTest, MultipleDataframesShareStrings) {
+  StringPool pool;
+  Dataframe first = CreateTestDataframe(&pool);
+  Dataframe second = CreateTestDataframe(&pool);
+
+  DataframeSnapshotWriter writer;
+  writer.AddDataframe("first", first);
+  writer.AddDataframe("second", second);
+  std::vector<uint8_t> snapshot = std::move(writer).Finish();
+
+  ASSERT_OK_AND_ASSIGN(
+      auto reader,
+      DataframeSnapshotReader::Create(snapshot.data(), snapshot.size()));
+  EXPECT_THAT(reader.GetDataframeNames(), ElementsAre("first", "second"));
+
+  StringPool other_pool;
+  ASSERT_OK_AND_ASSIGN(Dataframe loaded, reader.Load("second", &other_pool));
+  VerifyData(loaded, 0b100001,
+             Rows(Row(0u, "foo"), Row(1u, nullptr), Row(2u, "bar")));
+  EXPECT_THAT(reader.Load("third", &other_pool), IsError());
+}
+
+TEST(DataframeSnapshotTest, EmptyDataframe) {
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.Finalize();
+  std::vector<uint8_t> snapshot = CreateSnapshot(df);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto reader,
+      DataframeSnapshotReader::Create(snapshot.data(), snapshot.size()));
+  ASSERT_OK_AND_ASSIGN(Dataframe loaded, reader.Load("test", &pool));
+  EXPECT_EQ(loaded.row_count(), 0u);
+  EXPECT_EQ(loaded.column_names(), df.column_names());
+}
+
+TEST(DataframeSnapshotTest, RejectsOtherVersion) {
+  StringPool pool;
+  std::vector<uint8_t> snapshot = CreateSnapshot(CreateTestDataframe(&pool));
+
+  // The version immediately follows the 8 byte magic.
+  uint32_t version = DataframeSnapshotReader::kVersion + 1;
+  memcpy(snapshot.data() + 8, &version, sizeof(version));
+  auto reader_or =
+      DataframeSnapshotReader::Create(snapshot.data(), snapshot.size());
+  ASSERT_THAT(reader_or, IsError());
+  EXPECT_THAT(reader_or.status().message(), testing::HasSubstr("version"));
+}
+
+TEST(DataframeSnapshotTest, RejectsTruncatedSnapshot) {
+  StringPool pool;
+  std::vector<uint8_t> snapshot = CreateSnapshot(CreateTestDataframe(&pool));
+
+  for (size_t size = 0; size < snapshot.size(); size += 8) {
+    EXPECT_THAT(DataframeSnapshotReader::Create(snapshot.data(), size),
+                IsError())
+        << "size: " << size;
+  }
+}
+
+TEST(DataframeSnapshotTest, RejectsNonSnapshot) {
+  std::vector<uint8_t> data = {0x0a, 0x00, 0x01, 0x02};
+  EXPECT_FALSE(DataframeSnapshotReader::IsSnapshot(data.data(), data.size()));
+  EXPECT_THAT(DataframeSnapshotReader::Create(data.data(), data.size()),
+              IsError());
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core::dataframe
@@ -31,6 +31,7 @@
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/regex.h"
 #include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "src/base/test/status_matchers.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
@@ -2003,4 +2004,330 @@ TEST(DataframeTest, SelectRows) {
   EXPECT_EQ(result.row_count(), 2u);
 }
 
+// Large enough for scans to be executed in morsels.
+constexpr uint32_t kMorselTestRowCount = 1024 * 1024;
+
+constexpr auto kMorselSpec = CreateTypedDataframeSpec(
+    {"id", "uint32", "int64", "double", "string"},
+    CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+    CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+    CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()),
+    CreateTypedColumnSpec(Double(), SparseNull(), Unsorted()),
+    CreateTypedColumnSpec(String(), NonNull(), Unsorted()));
+
+Dataframe CreateMorselTestDataframe(StringPool* pool) {
+  Dataframe df = Dataframe::CreateFromTypedSpec(kMorselSpec, pool);
+  StringPool::Id strings[] = {pool->InternString("a"), pool->InternString("b"),
+                              pool->InternString("c")};
+  for (uint32_t i = 0; i < kMorselTestRowCount; ++i) {
+    std::optional<int64_t> i64;
+    if (i % 3 != 0) {
+      i64 = static_cast<int64_t>(i % 1000) - 500;
+    }
+    std::optional<double> d;
+    if (i % 5 != 0) {
+      d = static_cast<double>((i * 7) % 100);
+    }
+    df.InsertUnchecked(kMorselSpec, std::monostate(), (i * 13) % 97, i64, d,
+                       strings[(i / 7) % 3]);
+  }
+  df.Finalize();
+  return df;
+}
+
+using MorselRows = std::vector<std::vector<ValueVerifier::ValueVariant>>;
+
+// Executes `plan` and returns all the cells of all the rows it returns.
+MorselRows ExecuteForMorselTest(const Dataframe& df,
+                                const Dataframe::QueryPlan& plan,
+                                const std::vector<TestRowFetcher::Value>& vals,
+                                base::ThreadPool* thread_pool) {
+  auto cursor = std::make_unique<Cursor<TestRowFetcher>>();
+  df.PrepareCursor(plan, *cursor, thread_pool);
+  TestRowFetcher fetcher;
+  fetcher.SetRow(vals);
+  cursor->Execute(fetcher);
+  MorselRows rows;
+  for (; !cursor->Eof(); cursor->Next()) {
+    ValueVerifier verifier;
+    verifier.Fetch(&*cursor, 5);
+    rows.emplace_back(std::move(verifier.values));
+  }
+  return rows;
+}
+
+// Plans a query with `filters`, whose values are `values` in order, and
+// checks that executing it serially and in morsels gives the same rows.
+void CheckMorselExecution(const Dataframe& df,
+                          std::vector<FilterSpec> filters,
+                          const std::vector<TestRowFetcher::Value>& values,
+                          base::ThreadPool* thread_pool) {
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanQuery(filters, {}, {}, {}, 0b11111));
+  ASSERT_GT(plan.GetImplForTesting().params.morsel_size, 0u)
+      << base::Join(plan.BytecodeToString(), "\n");
+
+  // Filter specs are reordered during planning: map the values to the
+  // positions assigned by the planner.
+  std::vector<TestRowFetcher::Value> vals(values.size(), std::nullopt);
+  for (const auto& f : filters) {
+    if (f.value_index) {
+      vals[*f.value_index] = values[f.source_index];
+    }
+  }
+  MorselRows serial = ExecuteForMorselTest(df, plan, vals, nullptr);
+  MorselRows parallel = ExecuteForMorselTest(df, plan, vals, thread_pool);
+  ASSERT_EQ(serial.size(), parallel.size());
+  ASSERT_EQ(serial, parallel);
+}
+
+TEST(DataframeTest, MorselExecutionMatchesSerial) {
+  StringPool pool;
+  Dataframe df = CreateMorselTestDataframe(&pool);
+  base::ThreadPool thread_pool(3);
+
+  CheckMorselExecution(df, {}, {}, &thread_pool);
+  CheckMorselExecution(df, {{1, 0, Lt{}, {}}}, {int64_t(50)}, &thread_pool);
+  CheckMorselExecution(df, {{2, 0, IsNotNull{}, {}}, {2, 1, Gt{}, {}}},
+                       {std::nullopt, int64_t(490)}, &thread_pool);
+  CheckMorselExecution(df, {{3, 0, Ge{}, {}}, {4, 1, Eq{}, {}}},
+                       {50.0, "b"}, &thread_pool);
+  CheckMorselExecution(df, {{3, 0, IsNull{}, {}}}, {std::nullopt},
+                       &thread_pool);
+  CheckMorselExecution(df, {{1, 0, Gt{}, {}}}, {int64_t(1000)}, &thread_pool);
+  CheckMorselExecution(df, {{4, 0, Glob{}, {}}, {1, 1, Ne{}, {}}},
+                       {"[ac]", int64_t(5)}, &thread_pool);
+}
+
+TEST(DataframeTest, MorselExecutionReexecute) {
+  StringPool pool;
+  Dataframe df = CreateMorselTestDataframe(&pool);
+  base::ThreadPool thread_pool(3);
+
+  std::vector<FilterSpec> filters = {{3, 0, Lt{}, {}}};
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanQuery(filters, {}, {}, {}, 0b11111));
+  auto cursor = std::make_unique<Cursor<TestRowFetcher>>();
+  df.PrepareCursor(plan, *cursor, &thread_pool);
+  for (double v : {10.0, 90.0, 0.0}) {
+    std::vector<TestRowFetcher::Value> vals = {v};
+    TestRowFetcher fetcher;
+    fetcher.SetRow(vals);
+    cursor->Execute(fetcher);
+    MorselRows rows;
+    for (; !cursor->Eof(); cursor->Next()) {
+      ValueVerifier verifier;
+      verifier.Fetch(&*cursor, 5);
+      rows.emplace_back(std::move(verifier.values));
+    }
+    ASSERT_EQ(rows, ExecuteForMorselTest(df, plan, vals, nullptr));
+  }
+}
+
+TEST(DataframeTest, MorselExecutionNotUsedForOrderDependentPlans) {
+  StringPool pool;
+  Dataframe df = CreateMorselTestDataframe(&pool);
+
+  std::vector<FilterSpec> filters;
+  {
+    ASSERT_OK_AND_ASSIGN(
+        Dataframe::QueryPlan plan,
+        df.PlanQuery(filters, {}, {{1, SortDirection::kAscending}}, {},
+                     0b11111));
+    EXPECT_EQ(plan.GetImplForTesting().params.morsel_size, 0u);
+  }
+  {
+    LimitSpec limit;
+    limit.limit = 10;
+    ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                         df.PlanQuery(filters, {}, {}, limit, 0b11111));
+    EXPECT_EQ(plan.GetImplForTesting().params.morsel_size, 0u);
+  }
+  {
+    ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                         df.PlanQuery(filters, {{1}}, {}, {}, 0b11111));
+    EXPECT_EQ(plan.GetImplForTesting().params.morsel_size, 0u);
+  }
+  {
+    // Filters on the id column are done with a binary search rather than a
+    // scan.
+    filters = {{0, 0, Lt{}, {}}};
+    ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                         df.PlanQuery(filters, {}, {}, {}, 0b11111));
+    EXPECT_EQ(plan.GetImplForTesting().params.morsel_size, 0u);
+  }
+}
+
+TEST(DataframeTest, MorselExecutionNotUsedForSmallTables) {
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kMorselSpec, &pool);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    df.InsertUnchecked(kMorselSpec, std::monostate(), i, std::nullopt,
+                       std::nullopt, pool.InternString("a"));
+  }
+  df.Finalize();
+  std::vector<FilterSpec> filters = {{1, 0, Lt{}, {}}};
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanQuery(filters, {}, {}, {}, 0b11111));
+  EXPECT_EQ(plan.GetImplForTesting().params.morsel_size, 0u);
+}
+
+constexpr auto kCompressionSpec = CreateTypedDataframeSpec(
+    {"id", "ts", "cpu", "prio", "utid"},
+    CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+    CreateTypedColumnSpec(Int64(), NonNull(), Sorted()),
+    CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+    CreateTypedColumnSpec(Int32(), DenseNull(), Unsorted()),
+    CreateTypedColumnSpec(Int64(), SparseNullWithPopcountAlways(),
+                          Unsorted()));
+
+Dataframe CreateCompressionTestDataframe(StringPool* pool) {
+  Dataframe df = Dataframe::CreateFromTypedSpec(kCompressionSpec, pool);
+  for (uint32_t i = 0; i < 4096; ++i) {
+    std::optional<int32_t> prio;
+    if (i % 5 != 0) {
+      prio = static_cast<int32_t>(i % 40) - 20;
+    }
+    std::optional<int64_t> utid;
+    if (i % 3 != 0) {
+      utid = static_cast<int64_t>((i * 7) % 50) * 1000;
+    }
+    df.InsertUnchecked(kCompressionSpec, std::monostate(),
+                       int64_t(1000000000000) + i * 10, (i % 8) * 3, prio,
+                       utid);
+  }
+  df.Finalize();
+  return df;
+}
+
+// Plans and executes a query on both `df` and `compressed` and checks that
+// they return the same rows.
+void CheckCompressedQuery(const Dataframe& df,
+                          const Dataframe& compressed,
+                          std::vector<FilterSpec> filters,
+                          const std::vector<TestRowFetcher::Value>& values,
+                          std::vector<DistinctSpec> distinct = {},
+                          std::vector<SortSpec> sorts = {}) {
+  std::vector<FilterSpec> compressed_filters = filters;
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanQuery(filters, distinct, sorts, {}, 0b11111));
+  ASSERT_OK_AND_ASSIGN(
+      Dataframe::QueryPlan compressed_plan,
+      compressed.PlanQuery(compressed_filters, distinct, sorts, {}, 0b11111));
+  std::vector<TestRowFetcher::Value> vals(values.size(), std::nullopt);
+  for (const auto& f : filters) {
+    if (f.value_index) {
+      vals[*f.value_index] = values[f.source_index];
+    }
+  }
+  std::vector<TestRowFetcher::Value> compressed_vals(values.size(),
+                                                     std::nullopt);
+  for (const auto& f : compressed_filters) {
+    if (f.value_index) {
+      compressed_vals[*f.value_index] = values[f.source_index];
+    }
+  }
+  MorselRows expected = ExecuteForMorselTest(df, plan, vals, nullptr);
+  MorselRows actual =
+      ExecuteForMorselTest(compressed, compressed_plan, compressed_vals,
+                           nullptr);
+  ASSERT_EQ(expected.size(), actual.size())
+      << base::Join(compressed_plan.BytecodeToString(), "\n");
+  ASSERT_EQ(expected, actual);
+}
+
+TEST(DataframeTest, CompressColumns) {
+  StringPool pool;
+  Dataframe df = CreateCompressionTestDataframe(&pool);
+  Dataframe compressed = CreateCompressionTestDataframe(&pool);
+  std::vector<uint64_t> sizes;
+  for (uint32_t i = 0; i < 5; ++i) {
+    ASSERT_STREQ(compressed.GetColumnEncoding(i), "none");
+    sizes.push_back(compressed.GetColumnMemoryUsage(i));
+  }
+  compressed.CompressColumns();
+
+  ASSERT_STREQ(compressed.GetColumnEncoding(0), "none");
+  ASSERT_STREQ(compressed.GetColumnEncoding(1), "frame_of_reference");
+  ASSERT_STREQ(compressed.GetColumnEncoding(2), "dictionary");
+  ASSERT_STREQ(compressed.GetColumnEncoding(3), "frame_of_reference");
+  ASSERT_STREQ(compressed.GetColumnEncoding(4), "dictionary");
+  for (uint32_t i = 1; i < 5; ++i) {
+    ASSERT_LT(compressed.GetColumnMemoryUsage(i), sizes[i]);
+  }
+  for (uint32_t row = 0; row < df.row_count(); ++row) {
+    ASSERT_EQ(compressed.GetCellUnchecked<1>(kCompressionSpec, row),
+              df.GetCellUnchecked<1>(kCompressionSpec, row));
+    ASSERT_EQ(compressed.GetCellUnchecked<2>(kCompressionSpec, row),
+              df.GetCellUnchecked<2>(kCompressionSpec, row));
+    ASSERT_EQ(compressed.GetCellUnchecked<3>(kCompressionSpec, row),
+              df.GetCellUnchecked<3>(kCompressionSpec, row));
+    ASSERT_EQ(compressed.GetCellUnchecked<4>(kCompressionSpec, row),
+              df.GetCellUnchecked<4>(kCompressionSpec, row));
+  }
+}
+
+TEST(DataframeTest, CompressColumnsQueriesMatchUncompressed) {
+  StringPool pool;
+  Dataframe df = CreateCompressionTestDataframe(&pool);
+  Dataframe compressed = CreateCompressionTestDataframe(&pool);
+  compressed.CompressColumns();
+
+  CheckCompressedQuery(df, compressed, {}, {});
+  for (int64_t v : {-1, 0, 5, 6, 9, 21, 22}) {
+    CheckCompressedQuery(df, compressed, {{2, 0, Eq{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{2, 0, Ne{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{2, 0, Lt{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{2, 0, Le{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{2, 0, Gt{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{2, 0, Ge{}, {}}}, {v});
+  }
+  for (int64_t v : {-21, -20, -3, 0, 19, 20}) {
+    CheckCompressedQuery(df, compressed, {{3, 0, Eq{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{3, 0, Ne{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{3, 0, Ge{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{4, 0, Lt{}, {}}}, {v * 1000});
+  }
+  for (int64_t v : {int64_t(0), int64_t(1000000000000),
+                    int64_t(1000000000055), int64_t(1000000020000),
+                    int64_t(1000000040950), int64_t(1000000050000)}) {
+    CheckCompressedQuery(df, compressed, {{1, 0, Eq{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{1, 0, Lt{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{1, 0, Le{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{1, 0, Gt{}, {}}}, {v});
+    CheckCompressedQuery(df, compressed, {{1, 0, Ge{}, {}}}, {v});
+  }
+  CheckCompressedQuery(df, compressed, {{3, 0, IsNull{}, {}}},
+                       {std::nullopt});
+  CheckCompressedQuery(df, compressed,
+                       {{1, 0, Ge{}, {}}, {2, 1, Eq{}, {}}, {3, 2, Lt{}, {}}},
+                       {int64_t(1000000010000), int64_t(9), int64_t(0)});
+  CheckCompressedQuery(df, compressed, {{2, 0, Gt{}, {}}}, {3.5});
+  CheckCompressedQuery(
+      df, compressed, {}, {}, {},
+      {{2, SortDirection::kDescending}, {4, SortDirection::kAscending}});
+  CheckCompressedQuery(df, compressed, {}, {}, {{2}, {3}});
+}
+
+TEST(DataframeTest, CompressColumnsFiltersOnCodes) {
+  StringPool pool;
+  Dataframe df = CreateCompressionTestDataframe(&pool);
+  df.CompressColumns();
+
+  std::vector<FilterSpec> filters = {{1, 0, Ge{}, {}}, {2, 1, Eq{}, {}}};
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanQuery(filters, {}, {}, {}, 0b11111));
+  std::string bytecode = base::Join(plan.BytecodeToString(), "\n");
+  EXPECT_NE(bytecode.find("EncodedSortedFilter"), std::string::npos);
+  EXPECT_NE(bytecode.find("EncodedFilter"), std::string::npos);
+  EXPECT_EQ(bytecode.find("DecodeStorage"), std::string::npos);
+
+  // Sorting on an encoded column needs the decoded values.
+  ASSERT_OK_AND_ASSIGN(
+      plan, df.PlanQuery(filters, {}, {{2, SortDirection::kAscending}}, {},
+                         0b11111));
+  bytecode = base::Join(plan.BytecodeToString(), "\n");
+  EXPECT_NE(bytecode.find("DecodeStorage"), std::string::npos);
+}
+
 }  // namespace perfetto::trace_processor::core::dataframe
@@ -66,9 +66,21 @@ enum RegType : uint32_t {
   kSmallValueEqBvReg = 2,
   kSmallValueEqPopcountReg = 3,
   kIndexReg = 4,
-  kRegTypeCount = 5,
+  kEncodedStorageReg = 5,
+  kRegTypeCount = 6,
 };
 
+// The number of rows in each morsel of a plan executed in parallel. Small
+// enough for morsels to be spread evenly over threads even when filters are
+// much more selective in some parts of the table than others and large
+// enough for the per-morsel interpretation overhead to be negligible.
+constexpr uint32_t kMorselSize = 64 * 1024;
+
+// Plans with a lower estimated cost are always executed serially: for these,
+// the cost of handing work to other threads dominates any speedup. This
+// roughly corresponds to filtering a table with a million rows.
+constexpr double kMinMorselExecutionCost = 10'000'000;
+
 // TypeSet of all possible sparse nullability states.
 using SparseNullTypes = TypeSet<SparseNull,
                                 SparseNullWithPopcountAlways,
@@ -226,6 +238,60 @@ std::optional<BestIndex> GetBestIndexForFilterSpecs(
   return BestIndex{best_index_idx, std::move(best_index_specs)};
 }
 
+template <typename Start, typename End>
+bool IsOpcodeBetween(uint32_t option) {
+  return option >= i::Index<Start>() && option <= i::Index<End>();
+}
+
+// Returns true if `bc` only ever looks at the rows in its input indices (or
+// does not look at rows at all). Executing a plan made up only of such
+// bytecodes over disjoint ranges of rows and concatenating the results gives
+// exactly the same result as executing it over all the rows at once.
+bool IsMorselSafe(const i::Bytecode& bc) {
+  uint32_t o = bc.option;
+  return o == i::Index<i::InitRange>() || o == i::Index<i::AllocateIndices>() ||
+         o == i::Index<i::Iota>() ||
+         IsOpcodeBetween<i::CastFilterValue<Id>, i::CastFilterValue<String>>(
+             o) ||
+         IsOpcodeBetween<i::LinearFilterEq<Uint32>, i::LinearFilterEq<String>>(
+             o) ||
+         IsOpcodeBetween<i::NonStringFilter<Id, Eq>,
+                         i::NonStringFilter<Double, Ge>>(o) ||
+         IsOpcodeBetween<i::EncodedFilter<Uint32, Eq>,
+                         i::EncodedFilter<Int64, Ge>>(o) ||
+         IsOpcodeBetween<i::StringFilter<Eq>, i::StringFilter<Regex>>(o) ||
+         IsOpcodeBetween<i::NullFilter<IsNotNull>, i::NullFilter<IsNull>>(o) ||
+         o == i::Index<i::StrideCopy>() ||
+         o == i::Index<i::StrideTranslateAndCopySparseNullIndices>() ||
+         o == i::Index<i::StrideCopyDenseNullIndices>() ||
+         o == i::Index<i::PrefixPopcount>() ||
+         o == i::Index<i::TranslateSparseNullIndices>();
+}
+
+// Returns the morsel size to use for `plan` or 0 if the plan should be
+// executed serially.
+uint32_t ComputeMorselSize(const QueryPlanImpl& plan, uint32_t row_count) {
+  if (row_count <= kMorselSize ||
+      plan.params.estimated_cost < kMinMorselExecutionCost) {
+    return 0;
+  }
+  // The plan must start with the scan over all the rows...
+  if (plan.bytecode.empty() ||
+      plan.bytecode[0].option != i::Index<i::InitRange>()) {
+    return 0;
+  }
+  // ... and only contain bytecodes which don't care about which other rows
+  // are being processed. This rules out anything which uses an index or the
+  // sort order of a column and any sort, distinct or limit.
+  for (uint32_t j = 1; j < plan.bytecode.size(); ++j) {
+    const auto& bc = plan.bytecode[j];
+    if (bc.option == i::Index<i::InitRange>() || !IsMorselSafe(bc)) {
+      return 0;
+    }
+  }
+  return kMorselSize;
+}
+
 }  // namespace
 
 QueryPlanBuilder::QueryPlanBuilder(
@@ -277,32 +343,77 @@ base::StatusOr<QueryPlanImpl> QueryPlanBuilder::Build(
     builder.Sort(sort_specs);
     builder.Output(limit_spec, cols_used);
   }
-  return std::move(builder).Build();
+  QueryPlanImpl plan = std::move(builder).Build();
+  plan.params.morsel_size = ComputeMorselSize(plan, row_count);
+  return plan;
+}
+
+QueryPlanImpl::MorselBytecode QueryPlanImpl::SplitForMorsels() const {
+  PERFETTO_CHECK(params.morsel_size > 0);
+  MorselBytecode res;
+  for (const auto& bc : bytecode) {
+    if (bc.option == i::Index<i::InitRange>()) {
+      using B = i::InitRange;
+      const auto& ir = static_cast<const B&>(bc);
+      res.range_register = ir.arg<B::dest_register>();
+      res.row_count = ir.arg<B::size>();
+      continue;
+    }
+    if (IsOpcodeBetween<i::CastFilterValue<Id>, i::CastFilterValue<String>>(
+            bc.option)) {
+      using B = i::CastFilterValueBase;
+      const auto& cast = static_cast<const B&>(bc);
+      res.filter_value_registers.emplace_back(
+          cast.arg<B::write_register>().index);
+      res.prologue.emplace_back(bc);
+      continue;
+    }
+    if (bc.option == i::Index<i::PrefixPopcount>()) {
+      using B = i::PrefixPopcount;
+      const auto& popcount = static_cast<const B&>(bc);
+      res.null_bv_registers.emplace_back(
+          popcount.arg<B::null_bv_register>().index);
+      res.prologue.emplace_back(bc);
+      continue;
+    }
+    res.body.emplace_back(bc);
+    if (bc.option == i::Index<i::AllocateIndices>()) {
+      // Allocations are sized for the maximum number of rows the whole plan
+      // can return: a morsel never needs more than its own rows (empty
+      // allocations, used for filters which never match, stay empty).
+      using B = i::AllocateIndices;
+      auto& ai = static_cast<B&>(res.body.back());
+      if (ai.arg<B::size>() > 0) {
+        ai.arg<B::size>() = params.morsel_size * params.output_per_row;
+      }
+    }
+  }
+  return res;
 }
 
 i::RegValue QueryPlanImpl::GetRegisterInitValue(const RegisterInit& init,
                                                 const Column* const* columns,
                                                 const Index* indexes) {
+  // For encoded columns, the decoded values are only available after the
+  // DecodeStorage bytecode has run: start with a nullptr which it fills in.
+  auto maybe_encoded_storage_ptr = [&](auto type) {
+    const Storage& storage = columns[init.source_index]->storage;
+    if (storage.is_encoded()) {
+      return i::StoragePtr{nullptr, type};
+    }
+    return i::StoragePtr{storage.unchecked_data<decltype(type)>(), type};
+  };
   switch (init.kind.index()) {
     case RegisterInit::Type::GetTypeIndex<Id>():
       // Id columns don't have actual storage - the row index IS the value.
       // Return a nullptr StoragePtr which the interpreter knows to handle.
       return i::StoragePtr{nullptr, Id{}};
     case RegisterInit::Type::GetTypeIndex<Uint32>():
-      return i::StoragePtr{
-          columns[init.source_index]->storage.unchecked_data<Uint32>(),
-          Uint32{},
-      };
+      return maybe_encoded_storage_ptr(Uint32{});
     case RegisterInit::Type::GetTypeIndex<Int32>():
-      return i::StoragePtr{
-          columns[init.source_index]->storage.unchecked_data<Int32>(),
-          Int32{},
-      };
+      return maybe_encoded_storage_ptr(Int32{});
     case RegisterInit::Type::GetTypeIndex<Int64>():
-      return i::StoragePtr{
-          columns[init.source_index]->storage.unchecked_data<Int64>(),
-          Int64{},
-      };
+      return maybe_encoded_storage_ptr(Int64{});
     case RegisterInit::Type::GetTypeIndex<Double>():
       return i::StoragePtr{
           columns[init.source_index]->storage.unchecked_data<Double>(),
@@ -339,6 +450,22 @@ i::RegValue QueryPlanImpl::GetRegisterInitValue(const RegisterInit& init,
           sve.prefix_popcount.data(),
           sve.prefix_popcount.data() + sve.prefix_popcount.size());
     }
+    case RegisterInit::Type::GetTypeIndex<RegisterInit::EncodedStorage>(): {
+      const Storage& storage = columns[init.source_index]->storage;
+      switch (storage.type().index()) {
+        case StorageType::GetTypeIndex<Uint32>():
+          return i::EncodedStoragePtr{
+              &storage.unchecked_get_encoded<Uint32>(), Uint32{}};
+        case StorageType::GetTypeIndex<Int32>():
+          return i::EncodedStoragePtr{&storage.unchecked_get_encoded<Int32>(),
+                                      Int32{}};
+        case StorageType::GetTypeIndex<Int64>():
+          return i::EncodedStoragePtr{&storage.unchecked_get_encoded<Int64>(),
+                                      Int64{}};
+        default:
+          PERFETTO_FATAL("Invalid encoded storage type");
+      }
+    }
     default:
       PERFETTO_FATAL("Unhandled RegisterInit kind: %u",
                      static_cast<uint32_t>(init.kind.index()));
@@ -409,12 +536,12 @@ base::Status QueryPlanBuilder::Filter(std::vector<FilterSpec>& specs) {
       auto source = TranslateNonNullIndices(c.col, update, false);
       {
         using B = i::FilterInBase;
+        auto storage_reg = StorageRegisterFor(c.col, col.storage.type());
         B& bc = AddOpcode<B>(
             i::Index<i::FilterIn>(col.storage.type(),
                                   i::SparseNullCollapsedNullability{NonNull{}}),
             RowCountModifier{NonEqualityFilterRowCount{}});
-        bc.arg<B::storage_register>() =
-            StorageRegisterFor(c.col, col.storage.type());
+        bc.arg<B::storage_register>() = storage_reg;
         bc.arg<B::null_bv_register>() = {};
         bc.arg<B::value_list_register>() = value;
         bc.arg<B::index_register>() = {};
@@ -569,9 +696,9 @@ void QueryPlanBuilder::Sort(const std::vector<SortSpec>& sort_specs) {
       // Collect IDs using the prepared (non-null, translated) indices.
       {
         using B = i::CollectIdIntoRankMap;
+        auto storage_reg = StorageRegisterFor(spec.col, col.storage.type());
         auto& op = AddOpcode<B>(UnchangedRowCount{});
-        op.arg<B::storage_register>() =
-            StorageRegisterFor(spec.col, col.storage.type());
+        op.arg<B::storage_register>() = storage_reg;
         op.arg<B::source_register>() = translated;
         op.arg<B::rank_map_register>() = string_rank_map;
       }
@@ -619,11 +746,12 @@ void QueryPlanBuilder::MinMax(const SortSpec& sort_spec) {
                          : i::MinMaxOp(i::MaxOp{});
 
   auto indices = EnsureIndicesAreInSlab();
+  auto storage_reg = StorageRegisterFor(col_idx, storage_type);
   using B = i::FindMinMaxIndexBase;
   auto& op = AddOpcode<B>(i::Index<i::FindMinMaxIndex>(storage_type, mmop),
                           OneRowCount{});
   op.arg<B::update_register>() = indices;
-  op.arg<B::storage_register>() = StorageRegisterFor(col_idx, storage_type);
+  op.arg<B::storage_register>() = storage_reg;
 }
 
 void QueryPlanBuilder::Output(const LimitSpec& limit, uint64_t cols_used) {
@@ -746,7 +874,9 @@ void QueryPlanBuilder::NonStringConstraint(
     const i::NonStringOp& op,
     const i::ReadHandle<i::CastFilterValueResult>& result) {
   const auto& col = GetColumn(c.col);
-  if (std::holds_alternative<i::RwHandle<Range>>(indices_reg_) && op.Is<Eq>() &&
+  bool is_encoded = col.storage.is_encoded();
+  if (!is_encoded &&
+      std::holds_alternative<i::RwHandle<Range>>(indices_reg_) && op.Is<Eq>() &&
       col.null_storage.nullability().Is<NonNull>()) {
     // Non null equality on an id column should have been handled earlier.
     PERFETTO_CHECK(!type.Is<Id>());
@@ -758,13 +888,23 @@ void QueryPlanBuilder::NonStringConstraint(
   auto update = EnsureIndicesAreInSlab();
   PruneNullIndices(c.col, update);
   auto source = TranslateNonNullIndices(c.col, update, false);
-  {
+  RowCountModifier modifier =
+      op.Is<Eq>()
+          ? RowCountModifier{EqualityFilterRowCount{col.duplicate_state}}
+          : RowCountModifier{NonEqualityFilterRowCount{}};
+  if (is_encoded) {
+    using B = i::EncodedFilterBase;
+    auto encodable_type = type.TryDowncast<EncodableStorageType>();
+    PERFETTO_CHECK(encodable_type);
+    B& bc = AddOpcode<B>(i::Index<i::EncodedFilter>(*encodable_type, op),
+                         modifier);
+    bc.arg<B::storage_register>() = EncodedStorageRegisterFor(c.col);
+    bc.arg<B::val_register>() = result;
+    bc.arg<B::source_register>() = source;
+    bc.arg<B::update_register>() = update;
+  } else {
     using B = i::NonStringFilterBase;
-    B& bc = AddOpcode<B>(
-        i::Index<i::NonStringFilter>(type, op),
-        op.Is<Eq>()
-            ? RowCountModifier{EqualityFilterRowCount{col.duplicate_state}}
-            : RowCountModifier{NonEqualityFilterRowCount{}});
+    B& bc = AddOpcode<B>(i::Index<i::NonStringFilter>(type, op), modifier);
     bc.arg<B::storage_register>() =
         StorageRegisterFor(c.col, type.Upcast<StorageType>());
     bc.arg<B::val_register>() = result;
@@ -896,14 +1036,15 @@ void QueryPlanBuilder::IndexConstraints(
       {
         using B = i::FilterInBase;
         auto null_bv_reg = EnsurePrefixPopcountFor(fs.col);
+        auto storage_reg =
+            StorageRegisterFor(fs.col, non_id->Upcast<StorageType>());
         auto& bc = AddOpcode<B>(
             i::Index<i::FilterIn>(non_id->Upcast<StorageType>(),
                                   NullabilityToSparseNullCollapsedNullability(
                                       column.null_storage.nullability())),
             RowCountModifier{EqualityFilterRowCount{column.duplicate_state}},
             i::LogPerRowCost{10});
-        bc.arg<B::storage_register>() =
-            StorageRegisterFor(fs.col, non_id->Upcast<StorageType>());
+        bc.arg<B::storage_register>() = storage_reg;
         bc.arg<B::null_bv_register>() = null_bv_reg;
         bc.arg<B::value_list_register>() = value_list_reg;
         bc.arg<B::index_register>() = source_reg;
@@ -920,13 +1061,14 @@ void QueryPlanBuilder::IndexConstraints(
       {
         using B = i::IndexedFilterEqBase;
         auto null_bv_reg = EnsurePrefixPopcountFor(fs.col);
+        auto storage_reg =
+            StorageRegisterFor(fs.col, non_id->Upcast<StorageType>());
         auto& bc = AddOpcode<B>(
             i::Index<i::IndexedFilterEq>(
                 *non_id, NullabilityToSparseNullCollapsedNullability(
                              column.null_storage.nullability())),
             RowCountModifier{EqualityFilterRowCount{column.duplicate_state}});
-        bc.arg<B::storage_register>() =
-            StorageRegisterFor(fs.col, non_id->Upcast<StorageType>());
+        bc.arg<B::storage_register>() = storage_reg;
         bc.arg<B::null_bv_register>() = null_bv_reg;
         bc.arg<B::filter_value_reg>() = value_reg;
         bc.arg<B::source_register>() = source_reg;
@@ -1004,7 +1146,17 @@ bool QueryPlanBuilder::TrySortedConstraint(FilterSpec& fs,
   } else {
     modifier = NonEqualityFilterRowCount{};
   }
-  {
+  if (col.storage.is_encoded()) {
+    using B = i::EncodedSortedFilterBase;
+    auto encodable_type = ct.TryDowncast<EncodableStorageType>();
+    PERFETTO_CHECK(encodable_type);
+    auto& bc = AddOpcode<B>(
+        i::Index<i::EncodedSortedFilter>(*encodable_type, erlbub), modifier);
+    bc.arg<B::storage_register>() = EncodedStorageRegisterFor(fs.col);
+    bc.arg<B::val_register>() = value_reg;
+    bc.arg<B::update_register>() = reg;
+    bc.arg<B::write_result_to>() = bound;
+  } else {
     using B = i::SortedFilterBase;
     auto& bc = AddOpcode<B>(i::Index<i::SortedFilter>(ct, erlbub), modifier,
                             i::SortedFilterBase::EstimateCost(ct));
@@ -1230,6 +1382,29 @@ i::RwHandle<i::StoragePtr> QueryPlanBuilder::StorageRegisterFor(
     plan_.register_inits.emplace_back(
         RegisterInit{reg.index, type.Upcast<RegisterInit::Type>(),
                      static_cast<uint16_t>(col)});
+    if (GetColumn(col).storage.is_encoded()) {
+      using B = i::DecodeStorageBase;
+      auto encodable_type = type.TryDowncast<EncodableStorageType>();
+      PERFETTO_CHECK(encodable_type);
+      auto& bc = AddOpcode<B>(i::Index<i::DecodeStorage>(*encodable_type),
+                              UnchangedRowCount{});
+      bc.arg<B::encoded_register>() = EncodedStorageRegisterFor(col);
+      bc.arg<B::buffer_register>() =
+          builder_.AllocateRegister<Slab<uint64_t>>();
+      bc.arg<B::storage_register>() = reg;
+    }
+  }
+  return reg;
+}
+
+i::ReadHandle<i::EncodedStoragePtr> QueryPlanBuilder::EncodedStorageRegisterFor(
+    uint32_t col) {
+  auto [reg, inserted] = cache_.GetOrAllocate<i::EncodedStoragePtr>(
+      kEncodedStorageReg, columns_[col].get());
+  if (inserted) {
+    plan_.register_inits.emplace_back(
+        RegisterInit{reg.index, RegisterInit::EncodedStorage{},
+                     static_cast<uint16_t>(col)});
   }
   return reg;
 }
@@ -1380,14 +1555,14 @@ i::RwHandle<Slab<uint8_t>> QueryPlanBuilder::CopyToRowLayout(
     const Column& col = GetColumn(param.column);
     const auto& nullability = col.null_storage.nullability();
     auto null_bv_reg = EnsurePrefixPopcountFor(param.column);
+    auto storage_reg = StorageRegisterFor(param.column, col.storage.type());
     {
       using B = i::CopyToRowLayoutBase;
       auto index = i::Index<i::CopyToRowLayout>(
           col.storage.type(),
           NullabilityToSparseNullCollapsedNullability(nullability));
       auto& op = AddOpcode<B>(index, UnchangedRowCount{});
-      op.arg<B::storage_register>() =
-          StorageRegisterFor(param.column, col.storage.type());
+      op.arg<B::storage_register>() = storage_reg;
       op.arg<B::null_bv_register>() = null_bv_reg;
       op.arg<B::source_indices_register>() = indices;
       op.arg<B::dest_buffer_register>() = new_buffer_reg;
@@ -60,6 +60,7 @@ struct RegisterInit {
   struct IndexVector {};
   struct SmallValueEqBitvector {};
   struct SmallValueEqPopcount {};
+  struct EncodedStorage {};
 
   using Type = TypeSet<Id,
                        Uint32,
@@ -70,7 +71,8 @@ struct RegisterInit {
                        NullBitvector,
                        IndexVector,
                        SmallValueEqBitvector,
-                       SmallValueEqPopcount>;
+                       SmallValueEqPopcount,
+                       EncodedStorage>;
   uint32_t dest_register = 0;
   Type kind{Id{}};
   uint16_t source_index = 0;  // col_index or index_id depending on kind
@@ -103,10 +105,38 @@ struct QueryPlanImpl {
 
     // Number of output indices per row.
     uint32_t output_per_row = 0;
+
+    // If non-zero, the plan is a filter-only scan over all the rows which can
+    // be split into ranges of this many rows ("morsels") and executed on
+    // several threads. See SplitForMorsels.
+    uint32_t morsel_size = 0;
   };
   static_assert(std::is_trivially_copyable_v<ExecutionParams>);
   static_assert(std::is_trivially_destructible_v<ExecutionParams>);
-  static_assert(sizeof(ExecutionParams) == 32);
+  static_assert(sizeof(ExecutionParams) == 40);
+
+  // The bytecode of a plan with a non-zero |morsel_size| split up for morsel
+  // execution.
+  struct MorselBytecode {
+    // Bytecode which does not depend on the rows being processed (i.e.
+    // casting filter values and computing prefix popcounts). Executed once,
+    // on the calling thread, before any morsel.
+    interpreter::BytecodeVector prologue;
+
+    // The rest of the plan. Executed once per morsel, with the
+    // |range_register| set to the rows of the morsel beforehand.
+    interpreter::BytecodeVector body;
+
+    // The register holding the rows to process.
+    interpreter::WriteHandle<Range> range_register;
+
+    // The total number of rows to process.
+    uint32_t row_count = 0;
+
+    // Registers written by |prologue| which |body| reads.
+    base::SmallVector<uint32_t, 8> filter_value_registers;
+    base::SmallVector<uint32_t, 8> null_bv_registers;
+  };
 
   // Serializes the query plan to a Base64-encoded string.
   // This allows plans to be stored or transmitted between processes.
@@ -219,6 +249,10 @@ struct QueryPlanImpl {
       const Column* const* columns,
       const Index* indexes);
 
+  // Splits the bytecode of this plan for morsel execution. Must only be
+  // called if |params.morsel_size| is non-zero.
+  MorselBytecode SplitForMorsels() const;
+
   ExecutionParams params;
   interpreter::BytecodeVector bytecode;
   base::SmallVector<uint32_t, 24> col_to_output_offset;
@@ -394,10 +428,19 @@ class QueryPlanBuilder {
 
   // Allocates a register for column data pointer and adds RegisterInit entry.
   // Returns a HandleBase that can be assigned to typed data_register fields.
+  //
+  // For encoded columns, also emits a DecodeStorage bytecode to fill the
+  // register with the decoded values: this means that this function must be
+  // called *before* adding the bytecode which reads the register.
   interpreter::RwHandle<interpreter::StoragePtr> StorageRegisterFor(
       uint32_t col,
       StorageType storage_type);
 
+  // Returns the register pointing to the EncodedVector of the given encoded
+  // column.
+  interpreter::ReadHandle<interpreter::EncodedStoragePtr>
+  EncodedStorageRegisterFor(uint32_t col);
+
   // Returns the index register for the given position.
   interpreter::RwHandle<Span<uint32_t>> IndexRegisterFor(uint32_t pos);
 
@@ -11,12 +11,14 @@
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/variant.h"
+#include "perfetto/public/compiler.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/core/common/duplicate_types.h"
 #include "src/trace_processor/core/common/null_types.h"
 #include "src/trace_processor/core/common/sort_types.h"
 #include "src/trace_processor/core/common/storage_types.h"
 #include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/encoded_vector.h"
 #include "src/trace_processor/core/util/flex_vector.h"
 #include "src/trace_processor/core/util/slab.h"
 
@@ -69,12 +71,21 @@ class Storage {
   using Double = FlexVector<double>;
   using String = FlexVector<StringPool::Id>;
 
+  // Compressed storage representations for finalized integer columns. The
+  // StorageType of an encoded column is the same as the unencoded one.
+  using EncodedUint32 = EncodedVector<uint32_t>;
+  using EncodedInt32 = EncodedVector<int32_t>;
+  using EncodedInt64 = EncodedVector<int64_t>;
+
   using DataPointer = std::variant<const IdDataTag*,
                                    const uint32_t*,
                                    const int32_t*,
                                    const int64_t*,
                                    const double*,
-                                   const StringPool::Id*>;
+                                   const StringPool::Id*,
+                                   const EncodedUint32*,
+                                   const EncodedInt32*,
+                                   const EncodedInt64*>;
 
   Storage(Storage::Id data) : type_(core::Id{}), data_(data) {}
   Storage(Storage::Uint32 data)
@@ -85,18 +96,40 @@ class Storage {
       : type_(core::Double{}), data_(std::move(data)) {}
   Storage(Storage::String data)
       : type_(core::String{}), data_(std::move(data)) {}
+  Storage(Storage::EncodedUint32 data)
+      : type_(core::Uint32{}), data_(std::move(data)) {}
+  Storage(Storage::EncodedInt32 data)
+      : type_(core::Int32{}), data_(std::move(data)) {}
+  Storage(Storage::EncodedInt64 data)
+      : type_(core::Int64{}), data_(std::move(data)) {}
 
   // Type-safe access to storage with unchecked variant access.
   template <typename T>
   auto& unchecked_get() {
-    using U = StorageType::VariantTypeAtIndex<T, Variant>;
+    using U = std::variant_alternative_t<StorageType::GetTypeIndex<T>(),
+                                         Variant>;
     PERFETTO_DCHECK(std::holds_alternative<U>(data_));
     return base::unchecked_get<U>(data_);
   }
 
   template <typename T>
   const auto& unchecked_get() const {
-    using U = StorageType::VariantTypeAtIndex<T, Variant>;
+    using U = std::variant_alternative_t<StorageType::GetTypeIndex<T>(),
+                                         Variant>;
+    PERFETTO_DCHECK(std::holds_alternative<U>(data_));
+    return base::unchecked_get<U>(data_);
+  }
+
+  // Returns true if the storage is encoded (i.e. holds an EncodedVector
+  // instead of a FlexVector). In this case, the unchecked_get() and
+  // unchecked_data() functions must not be called: use unchecked_get_encoded()
+  // instead.
+  bool is_encoded() const { return data_.index() >= StorageType::kSize; }
+
+  // Type-safe access to encoded storage with unchecked variant access.
+  template <typename T>
+  const auto& unchecked_get_encoded() const {
+    using U = EncodedVector<typename T::cpp_type>;
     PERFETTO_DCHECK(std::holds_alternative<U>(data_));
     return base::unchecked_get<U>(data_);
   }
@@ -115,7 +148,13 @@ class Storage {
   // Returns a variant containing pointer to the underlying data.
   // Returns nullptr (as IdDataTag*) if the storage type is Id (which has no
   // buffer).
+  //
+  // For encoded storage, returns a pointer to the EncodedVector instead: see
+  // EncodedDataPointerIndex().
   DataPointer data() const {
+    if (PERFETTO_UNLIKELY(is_encoded())) {
+      return encoded_data();
+    }
     switch (type_.index()) {
       case StorageType::GetTypeIndex<core::Id>():
         return static_cast<const IdDataTag*>(nullptr);
@@ -136,15 +175,50 @@ class Storage {
 
   template <typename T>
   static auto* CastDataPtr(const DataPointer& ptr) {
-    using U = StorageType::VariantTypeAtIndex<T, DataPointer>;
+    using U = std::variant_alternative_t<StorageType::GetTypeIndex<T>(),
+                                         DataPointer>;
+    return base::unchecked_get<U>(ptr);
+  }
+
+  // Returns the index of the alternative of DataPointer which is used for
+  // encoded storage of type T.
+  template <typename T>
+  static constexpr size_t EncodedDataPointerIndex() {
+    return StorageType::kSize + EncodableStorageType::GetTypeIndex<T>();
+  }
+
+  template <typename T>
+  static auto* CastEncodedDataPtr(const DataPointer& ptr) {
+    using U = const EncodedVector<typename T::cpp_type>*;
     return base::unchecked_get<U>(ptr);
   }
 
   StorageType type() const { return type_; }
 
  private:
+  DataPointer encoded_data() const {
+    switch (type_.index()) {
+      case StorageType::GetTypeIndex<core::Uint32>():
+        return &base::unchecked_get<Storage::EncodedUint32>(data_);
+      case StorageType::GetTypeIndex<core::Int32>():
+        return &base::unchecked_get<Storage::EncodedInt32>(data_);
+      case StorageType::GetTypeIndex<core::Int64>():
+        return &base::unchecked_get<Storage::EncodedInt64>(data_);
+      default:
+        PERFETTO_FATAL("Should not reach here");
+    }
+  }
+
   // Variant containing all possible storage representations.
-  using Variant = std::variant<Id, Uint32, Int32, Int64, Double, String>;
+  using Variant = std::variant<Id,
+                               Uint32,
+                               Int32,
+                               Int64,
+                               Double,
+                               String,
+                               EncodedUint32,
+                               EncodedInt32,
+                               EncodedInt64>;
   StorageType type_;
   Variant data_;
 };
@@ -203,6 +203,79 @@ struct NonStringFilter : NonStringFilterBase {
   static_assert(TS2::Contains<Op>());
 };
 
+// Filter operations on encoded (i.e. compressed) integer columns. The filter
+// value is translated into a range of codes and the comparison is done
+// directly on the codes without decoding any value.
+struct EncodedFilterBase
+    : TemplatedBytecode2<EncodableStorageType, NonStringOp> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LinearPerRowCost{6};
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_4(ReadHandle<EncodedStoragePtr>,
+                                     storage_register,
+                                     ReadHandle<CastFilterValueResult>,
+                                     val_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     source_register,
+                                     RwHandle<Span<uint32_t>>,
+                                     update_register);
+};
+template <typename T, typename Op>
+struct EncodedFilter : EncodedFilterBase {
+  static_assert(TS1::Contains<T>());
+  static_assert(TS2::Contains<Op>());
+};
+
+// Equivalent of SortedFilter for encoded integer columns: as encoding
+// preserves the order of values, the binary search is done directly on the
+// codes.
+struct EncodedSortedFilterBase
+    : TemplatedBytecode2<EncodableStorageType, EqualRangeLowerBoundUpperBound> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LogPerRowCost{12};
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_4(ReadHandle<EncodedStoragePtr>,
+                                     storage_register,
+                                     ReadHandle<CastFilterValueResult>,
+                                     val_register,
+                                     RwHandle<Range>,
+                                     update_register,
+                                     BoundModifier,
+                                     write_result_to);
+};
+template <typename T, typename RangeOp>
+struct EncodedSortedFilter : EncodedSortedFilterBase {
+  static_assert(TS1::Contains<T>());
+  static_assert(TS2::Contains<RangeOp>());
+};
+
+// Decodes an encoded column into a buffer and points `storage_register` at
+// it. Used to run bytecodes which need direct access to the values (e.g.
+// sorting) on encoded columns.
+//
+// Note: if `storage_register` already points to decoded data, we'll assume
+// that this bytecode has already been executed and skip the decoding. This
+// allows for caching the result of this bytecode across executions of the
+// interpreter.
+struct DecodeStorageBase : TemplatedBytecode1<EncodableStorageType> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LinearPerRowCost{2};
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_3(ReadHandle<EncodedStoragePtr>,
+                                     encoded_register,
+                                     WriteHandle<Slab<uint64_t>>,
+                                     buffer_register,
+                                     RwHandle<StoragePtr>,
+                                     storage_register);
+};
+template <typename T>
+struct DecodeStorage : DecodeStorageBase {
+  static_assert(TS1::Contains<T>());
+};
+
 // Filter operations on string columns.
 struct StringFilterBase : TemplatedBytecode1<StringOp> {
   // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
@@ -653,6 +726,84 @@ struct PropagateTreeDown : Bytecode {
                                      spec_count);
 };
 
+// Assigns every entry of |indices_register| to a group keyed by the value of
+// the column in |storage_register| using a hash table (or a direct-mapped
+// table for small Uint32 keys). All null keys belong to the same group.
+//
+// Writes the group of each entry and the first row and size of each group to
+// the GroupByState.
+struct GroupByHashBase
+    : TemplatedBytecode2<HashGroupByType, SparseNullCollapsedNullability> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LinearPerRowCost{15};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_4(ReadHandle<StoragePtr>,
+                                     storage_register,
+                                     ReadHandle<NullBitvector>,
+                                     null_bv_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     RwHandle<std::unique_ptr<GroupByState>>,
+                                     group_by_register);
+};
+template <typename T, typename N>
+struct GroupByHash : GroupByHashBase {
+  static_assert(TS1::Contains<T>());
+  static_assert(TS2::Contains<N>());
+};
+
+// Same as GroupByHash for a non-null column whose values are sorted in the
+// order of |indices_register|: equal keys are adjacent, so a new group starts
+// whenever the key differs from the previous one.
+struct GroupBySortedBase : TemplatedBytecode1<SortedGroupByType> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LinearPerRowCost{3};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_3(ReadHandle<StoragePtr>,
+                                     storage_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     RwHandle<std::unique_ptr<GroupByState>>,
+                                     group_by_register);
+};
+template <typename T>
+struct GroupBySorted : GroupBySortedBase {
+  static_assert(TS1::Contains<T>());
+};
+
+// Folds the values of the column in |storage_register| into the accumulators
+// of aggregate |aggregate_index| of the GroupByState. Must run after a
+// GroupBy* bytecode over the same |indices_register|. Null values are skipped.
+//
+// |null_bv_register| is only set for nullable columns. Its popcount must be
+// populated (see PrefixPopcount) iff the column is SparseNull.
+struct AggregateBase : TemplatedBytecode2<IntegerOrDoubleType, AggregateOp> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LinearPerRowCost{5};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_5(ReadHandle<StoragePtr>,
+                                     storage_register,
+                                     ReadHandle<NullBitvector>,
+                                     null_bv_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     RwHandle<std::unique_ptr<GroupByState>>,
+                                     group_by_register,
+                                     uint32_t,
+                                     aggregate_index);
+};
+template <typename T, typename Op>
+struct Aggregate : AggregateBase {
+  static_assert(TS1::Contains<T>());
+  static_assert(TS2::Contains<Op>());
+};
+
 // Bytecode ops that require FilterValueFetcher access.
 #define PERFETTO_DATAFRAME_BYTECODE_FVF_LIST(X) \
   X(CastFilterValue<Id>)                        \
@@ -728,6 +879,36 @@ struct PropagateTreeDown : Bytecode {
   X(NonStringFilter<Double, Le>)                       \
   X(NonStringFilter<Double, Gt>)                       \
   X(NonStringFilter<Double, Ge>)                       \
+  X(EncodedFilter<Uint32, Eq>)                         \
+  X(EncodedFilter<Uint32, Ne>)                         \
+  X(EncodedFilter<Uint32, Lt>)                         \
+  X(EncodedFilter<Uint32, Le>)                         \
+  X(EncodedFilter<Uint32, Gt>)                         \
+  X(EncodedFilter<Uint32, Ge>)                         \
+  X(EncodedFilter<Int32, Eq>)                          \
+  X(EncodedFilter<Int32, Ne>)                          \
+  X(EncodedFilter<Int32, Lt>)                          \
+  X(EncodedFilter<Int32, Le>)                          \
+  X(EncodedFilter<Int32, Gt>)                          \
+  X(EncodedFilter<Int32, Ge>)                          \
+  X(EncodedFilter<Int64, Eq>)                          \
+  X(EncodedFilter<Int64, Ne>)                          \
+  X(EncodedFilter<Int64, Lt>)                          \
+  X(EncodedFilter<Int64, Le>)                          \
+  X(EncodedFilter<Int64, Gt>)                          \
+  X(EncodedFilter<Int64, Ge>)                          \
+  X(EncodedSortedFilter<Uint32, EqualRange>)           \
+  X(EncodedSortedFilter<Uint32, LowerBound>)           \
+  X(EncodedSortedFilter<Uint32, UpperBound>)           \
+  X(EncodedSortedFilter<Int32, EqualRange>)            \
+  X(EncodedSortedFilter<Int32, LowerBound>)            \
+  X(EncodedSortedFilter<Int32, UpperBound>)            \
+  X(EncodedSortedFilter<Int64, EqualRange>)            \
+  X(EncodedSortedFilter<Int64, LowerBound>)            \
+  X(EncodedSortedFilter<Int64, UpperBound>)            \
+  X(DecodeStorage<Uint32>)                             \
+  X(DecodeStorage<Int32>)                              \
+  X(DecodeStorage<Int64>)                              \
   X(StringFilter<Eq>)                                  \
   X(StringFilter<Ne>)                                  \
   X(StringFilter<Lt>)                                  \
@@ -816,7 +997,35 @@ struct PropagateTreeDown : Bytecode {
   X(SortRowLayout)                                     \
   X(Reverse)                                           \
   X(FilterTreeState)                                   \
-  X(PropagateTreeDown)
+  X(PropagateTreeDown)                                 \
+  X(GroupByHash<Uint32, NonNull>)                      \
+  X(GroupByHash<Uint32, SparseNull>)                   \
+  X(GroupByHash<Uint32, DenseNull>)                    \
+  X(GroupByHash<Int32, NonNull>)                       \
+  X(GroupByHash<Int32, SparseNull>)                    \
+  X(GroupByHash<Int32, DenseNull>)                     \
+  X(GroupByHash<Int64, NonNull>)                       \
+  X(GroupByHash<Int64, SparseNull>)                    \
+  X(GroupByHash<Int64, DenseNull>)                     \
+  X(GroupByHash<String, NonNull>)                      \
+  X(GroupByHash<String, SparseNull>)                   \
+  X(GroupByHash<String, DenseNull>)                    \
+  X(GroupBySorted<Id>)                                 \
+  X(GroupBySorted<Uint32>)                             \
+  X(GroupBySorted<Int32>)                              \
+  X(GroupBySorted<Int64>)                              \
+  X(Aggregate<Uint32, SumOp>)                          \
+  X(Aggregate<Uint32, MinOp>)                          \
+  X(Aggregate<Uint32, MaxOp>)                          \
+  X(Aggregate<Int32, SumOp>)                           \
+  X(Aggregate<Int32, MinOp>)                           \
+  X(Aggregate<Int32, MaxOp>)                           \
+  X(Aggregate<Int64, SumOp>)                           \
+  X(Aggregate<Int64, MinOp>)                           \
+  X(Aggregate<Int64, MaxOp>)                           \
+  X(Aggregate<Double, SumOp>)                          \
+  X(Aggregate<Double, MinOp>)                          \
+  X(Aggregate<Double, MaxOp>)
 
 // Combined list of all bytecode instruction types.
 #define PERFETTO_DATAFRAME_BYTECODE_LIST(X) \
@@ -381,6 +381,186 @@ void BM_FilterIn_IndexedLinearScan(benchmark::State& state) {
 }
 BENCHMARK(BM_FilterIn_IndexedLinearScan)->Apply(FilterInConstantSweepingArgs);
 
+// Selectivities (in percent) used by the filter kernel benchmarks below.
+void FilterSelectivityArgs(benchmark::internal::Benchmark* b) {
+  for (int pct : {1, 10, 50, 90}) {
+    b->Arg(pct);
+  }
+}
+
+constexpr uint32_t kFilterTableSize = 1024 * 1024;
+
+// Returns the column data for the filter kernel benchmarks. With `eq` set, a
+// row matches `Eq 0` with probability `pct`%; otherwise a row matches
+// `Lt pct` with probability `pct`%. Matching rows are randomly distributed,
+// which is the worst case for the branchy scalar loops.
+template <typename C>
+FlexVector<C> CreateSelectivityData(uint32_t pct, bool eq) {
+  std::minstd_rand0 rnd(0);
+  FlexVector<C> data;
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    auto x = static_cast<uint32_t>(rnd() % 100);
+    if (eq) {
+      data.push_back(static_cast<C>(x < pct ? 0 : x + 1));
+    } else {
+      data.push_back(static_cast<C>(x));
+    }
+  }
+  return data;
+}
+
+// Measures LinearFilterEq<T> over the whole table. Reports rows/s as items/s.
+template <typename T, typename C>
+void RunLinearFilterEqBenchmark(benchmark::State& state,
+                                const std::string& type) {
+  auto pct = static_cast<uint32_t>(state.range(0));
+  dataframe::Column col{
+      dataframe::Storage{CreateSelectivityData<C>(pct, /*eq=*/true)},
+      dataframe::NullStorage::NonNull{}, Unsorted{}, HasDuplicates{}};
+
+  // Register layout:
+  // R0: CastFilterValueResult (filter value)
+  // R1: Range (source range)
+  // R2: Span<uint32_t> (output indices)
+  // R3: Slab<uint32_t> (backing storage for output)
+  // R4: StoragePtr (column data pointer)
+  std::string size = std::to_string(kFilterTableSize);
+  std::string bytecode_str =
+      "CastFilterValue<" + type +
+      ">: [fval_handle=FilterValue(0), write_register=Register(0), "
+      "op=NonNullOp(0)]\n"
+      "InitRange: [size=" +
+      size +
+      ", dest_register=Register(1)]\n"
+      "AllocateIndices: [size=" +
+      size +
+      ", dest_slab_register=Register(3), dest_span_register=Register(2)]\n"
+      "LinearFilterEq<" +
+      type +
+      ">: [storage_register=Register(4), filter_value_reg=Register(0), "
+      "source_register=Register(1), update_register=Register(2)]";
+
+  StringPool spool;
+  Interpreter<Fetcher> interpreter;
+  interpreter.Initialize(ParseBytecodeToVec(bytecode_str), 5, &spool);
+  StoragePtr storage_ptr{col.storage.unchecked_data<T>(), T{}};
+  interpreter.SetRegisterValue(WriteHandle<StoragePtr>(4), storage_ptr);
+
+  Fetcher fetcher;
+  fetcher.value.push_back(int64_t(0));
+  for (auto _ : state) {
+    interpreter.Execute(fetcher);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations() * kFilterTableSize));
+}
+
+// Measures NonStringFilter<T, Op> over the whole table, where `op` is the
+// name of Op and `op_index` its index in NonNullOp. The Iota which resets the
+// indices before every execution is included in the measurement. Reports
+// rows/s as items/s.
+template <typename T, typename C>
+void RunNonStringFilterBenchmark(benchmark::State& state,
+                                 const std::string& type,
+                                 const std::string& op,
+                                 uint32_t op_index) {
+  auto pct = static_cast<uint32_t>(state.range(0));
+  bool eq = op == "Eq";
+  dataframe::Column col{dataframe::Storage{CreateSelectivityData<C>(pct, eq)},
+                        dataframe::NullStorage::NonNull{}, Unsorted{},
+                        HasDuplicates{}};
+
+  // Register layout:
+  // R0: CastFilterValueResult (filter value)
+  // R1: Range (source range)
+  // R2: Span<uint32_t> (indices, filtered in-place)
+  // R3: Slab<uint32_t> (backing storage for indices)
+  // R4: StoragePtr (column data pointer)
+  std::string size = std::to_string(kFilterTableSize);
+  std::string bytecode_str =
+      "CastFilterValue<" + type +
+      ">: [fval_handle=FilterValue(0), write_register=Register(0), "
+      "op=NonNullOp(" +
+      std::to_string(op_index) +
+      ")]\n"
+      "InitRange: [size=" +
+      size +
+      ", dest_register=Register(1)]\n"
+      "AllocateIndices: [size=" +
+      size +
+      ", dest_slab_register=Register(3), dest_span_register=Register(2)]\n"
+      "Iota: [source_register=Register(1), update_register=Register(2)]\n"
+      "NonStringFilter<" +
+      type + ", " + op +
+      ">: [storage_register=Register(4), val_register=Register(0), "
+      "source_register=Register(2), update_register=Register(2)]";
+
+  StringPool spool;
+  Interpreter<Fetcher> interpreter;
+  interpreter.Initialize(ParseBytecodeToVec(bytecode_str), 5, &spool);
+  StoragePtr storage_ptr{col.storage.unchecked_data<T>(), T{}};
+  interpreter.SetRegisterValue(WriteHandle<StoragePtr>(4), storage_ptr);
+
+  Fetcher fetcher;
+  fetcher.value.push_back(eq ? int64_t(0) : int64_t(pct));
+  for (auto _ : state) {
+    interpreter.Execute(fetcher);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations() * kFilterTableSize));
+}
+
+void BM_BytecodeInterpreter_LinearFilterEqKernelUint32(
+    benchmark::State& state) {
+  RunLinearFilterEqBenchmark<Uint32, uint32_t>(state, "Uint32");
+}
+BENCHMARK(BM_BytecodeInterpreter_LinearFilterEqKernelUint32)
+    ->Apply(FilterSelectivityArgs);
+
+void BM_BytecodeInterpreter_LinearFilterEqKernelInt64(
+    benchmark::State& state) {
+  RunLinearFilterEqBenchmark<Int64, int64_t>(state, "Int64");
+}
+BENCHMARK(BM_BytecodeInterpreter_LinearFilterEqKernelInt64)
+    ->Apply(FilterSelectivityArgs);
+
+void BM_BytecodeInterpreter_LinearFilterEqKernelDouble(
+    benchmark::State& state) {
+  RunLinearFilterEqBenchmark<Double, double>(state, "Double");
+}
+BENCHMARK(BM_BytecodeInterpreter_LinearFilterEqKernelDouble)
+    ->Apply(FilterSelectivityArgs);
+
+void BM_BytecodeInterpreter_NonStringFilterKernelUint32Eq(
+    benchmark::State& state) {
+  RunNonStringFilterBenchmark<Uint32, uint32_t>(state, "Uint32", "Eq", 0);
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterKernelUint32Eq)
+    ->Apply(FilterSelectivityArgs);
+
+void BM_BytecodeInterpreter_NonStringFilterKernelInt32Lt(
+    benchmark::State& state) {
+  RunNonStringFilterBenchmark<Int32, int32_t>(state, "Int32", "Lt", 2);
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterKernelInt32Lt)
+    ->Apply(FilterSelectivityArgs);
+
+void BM_BytecodeInterpreter_NonStringFilterKernelInt64Lt(
+    benchmark::State& state) {
+  RunNonStringFilterBenchmark<Int64, int64_t>(state, "Int64", "Lt", 2);
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterKernelInt64Lt)
+    ->Apply(FilterSelectivityArgs);
+
+void BM_BytecodeInterpreter_NonStringFilterKernelDoubleLt(
+    benchmark::State& state) {
+  RunNonStringFilterBenchmark<Double, double>(state, "Double", "Lt", 2);
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterKernelDoubleLt)
+    ->Apply(FilterSelectivityArgs);
+
 }  // namespace
 
 static void BM_BytecodeInterpreter_SortUint32(benchmark::State& state) {
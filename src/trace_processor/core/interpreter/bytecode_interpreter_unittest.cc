@@ -2681,5 +2681,162 @@ TEST_F(BytecodeInterpreterTest, SortedFilterUint32Eq_ManyDuplicates) {
   EXPECT_EQ(result.e, 22u);
 }
 
+TEST_F(BytecodeInterpreterTest, GroupByHash_Uint32_NonNull) {
+  AddColumn(CreateNonNullColumn<uint32_t, uint32_t>(
+      {5u, 3u, 5u, 7u, 3u}, Unsorted{}, HasDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: group by state, 2: storage
+  std::string bytecode =
+      "GroupByHash<Uint32, NonNull>: [storage_register=Register(2), "
+      "null_bv_register=Register(4294967295), indices_register=Register(0), "
+      "group_by_register=Register(1)]";
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4};
+  SetRegistersAndExecute(bytecode, GetSpan(indices),
+                         std::make_unique<GroupByState>(),
+                         GetStoragePtr<Uint32>(0));
+
+  const auto& gb = *GetRegister<std::unique_ptr<GroupByState>>(1);
+  EXPECT_THAT(gb.group_ids, ElementsAre(0u, 1u, 0u, 2u, 1u));
+  EXPECT_THAT(gb.group_rows, ElementsAre(0u, 1u, 3u));
+  EXPECT_THAT(gb.group_sizes, ElementsAre(2u, 2u, 1u));
+}
+
+TEST_F(BytecodeInterpreterTest, GroupByHash_Int64_SparseNull) {
+  AddColumn(CreateSparseNullableColumn<int64_t>(
+      {std::make_optional(int64_t{10}), std::nullopt,
+       std::make_optional(int64_t{20}), std::make_optional(int64_t{10}),
+       std::nullopt},
+      Unsorted{}, HasDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: group by state, 2: storage, 3: null bitvector
+  std::string bytecode = R"(
+    PrefixPopcount: [null_bv_register=Register(3)]
+    GroupByHash<Int64, SparseNull>: [storage_register=Register(2), null_bv_register=Register(3), indices_register=Register(0), group_by_register=Register(1)]
+  )";
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4};
+  SetRegistersAndExecute(bytecode, GetSpan(indices),
+                         std::make_unique<GroupByState>(),
+                         GetStoragePtr<Int64>(0),
+                         NullBitvector{GetNullBv(0), {}});
+
+  // All the nulls end up in the same group.
+  const auto& gb = *GetRegister<std::unique_ptr<GroupByState>>(1);
+  EXPECT_THAT(gb.group_ids, ElementsAre(0u, 1u, 2u, 0u, 1u));
+  EXPECT_THAT(gb.group_rows, ElementsAre(0u, 1u, 2u));
+  EXPECT_THAT(gb.group_sizes, ElementsAre(2u, 2u, 1u));
+}
+
+TEST_F(BytecodeInterpreterTest, GroupByHash_String_NonNull) {
+  AddColumn(CreateNonNullStringColumn<const char*>(
+      {"b", "a", "b", "c", "a", "a"}, Unsorted{}, HasDuplicates{}, &spool_));
+
+  // Register layout:
+  // 0: indices span, 1: group by state, 2: storage
+  std::string bytecode =
+      "GroupByHash<String, NonNull>: [storage_register=Register(2), "
+      "null_bv_register=Register(4294967295), indices_register=Register(0), "
+      "group_by_register=Register(1)]";
+
+  // Only group a subset of the rows.
+  std::vector<uint32_t> indices = {1, 3, 4, 5};
+  SetRegistersAndExecute(bytecode, GetSpan(indices),
+                         std::make_unique<GroupByState>(),
+                         GetStoragePtr<String>(0));
+
+  const auto& gb = *GetRegister<std::unique_ptr<GroupByState>>(1);
+  EXPECT_THAT(gb.group_ids, ElementsAre(0u, 1u, 0u, 0u));
+  EXPECT_THAT(gb.group_rows, ElementsAre(1u, 3u));
+  EXPECT_THAT(gb.group_sizes, ElementsAre(3u, 1u));
+}
+
+TEST_F(BytecodeInterpreterTest, GroupBySorted_Uint32) {
+  AddColumn(CreateNonNullColumn<uint32_t, uint32_t>(
+      {1u, 1u, 1u, 4u, 9u, 9u}, Sorted{}, HasDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: group by state, 2: storage
+  std::string bytecode =
+      "GroupBySorted<Uint32>: [storage_register=Register(2), "
+      "indices_register=Register(0), group_by_register=Register(1)]";
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4, 5};
+  SetRegistersAndExecute(bytecode, GetSpan(indices),
+                         std::make_unique<GroupByState>(),
+                         GetStoragePtr<Uint32>(0));
+
+  const auto& gb = *GetRegister<std::unique_ptr<GroupByState>>(1);
+  EXPECT_THAT(gb.group_ids, ElementsAre(0u, 0u, 0u, 1u, 2u, 2u));
+  EXPECT_THAT(gb.group_rows, ElementsAre(0u, 3u, 4u));
+  EXPECT_THAT(gb.group_sizes, ElementsAre(3u, 1u, 2u));
+}
+
+TEST_F(BytecodeInterpreterTest, Aggregate_Int64_NonNull) {
+  AddColumn(CreateNonNullColumn<int64_t, int64_t>(
+      {4, -2, 7, 1, 3}, Unsorted{}, HasDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: group by state, 2: storage
+  std::string bytecode = R"(
+    Aggregate<Int64, SumOp>: [storage_register=Register(2), null_bv_register=Register(4294967295), indices_register=Register(0), group_by_register=Register(1), aggregate_index=0]
+    Aggregate<Int64, MinOp>: [storage_register=Register(2), null_bv_register=Register(4294967295), indices_register=Register(0), group_by_register=Register(1), aggregate_index=1]
+    Aggregate<Int64, MaxOp>: [storage_register=Register(2), null_bv_register=Register(4294967295), indices_register=Register(0), group_by_register=Register(1), aggregate_index=2]
+  )";
+
+  // Rows {0, 2, 4} are in group 0 and rows {1, 3} in group 1.
+  auto gb = std::make_unique<GroupByState>();
+  gb->group_ids = Slab<uint32_t>::Alloc(5);
+  uint32_t group_ids[] = {0, 1, 0, 1, 0};
+  std::copy(std::begin(group_ids), std::end(group_ids), gb->group_ids.data());
+  gb->group_rows = {0, 1};
+  gb->group_sizes = {3, 2};
+  gb->aggregates.resize(3);
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4};
+  SetRegistersAndExecute(bytecode, GetSpan(indices), std::move(gb),
+                         GetStoragePtr<Int64>(0));
+
+  const auto& result = *GetRegister<std::unique_ptr<GroupByState>>(1);
+  EXPECT_THAT(result.aggregates[0].int_values, ElementsAre(14, -1));
+  EXPECT_THAT(result.aggregates[1].int_values, ElementsAre(3, -2));
+  EXPECT_THAT(result.aggregates[2].int_values, ElementsAre(7, 1));
+  EXPECT_THAT(result.aggregates[0].counts, ElementsAre(3u, 2u));
+}
+
+TEST_F(BytecodeInterpreterTest, Aggregate_Double_DenseNull) {
+  AddColumn(CreateDenseNullableColumn<double>(
+      {std::make_optional(1.5), std::nullopt, std::make_optional(2.5),
+       std::nullopt},
+      Unsorted{}, HasDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: group by state, 2: storage, 3: null bitvector
+  std::string bytecode =
+      "Aggregate<Double, SumOp>: [storage_register=Register(2), "
+      "null_bv_register=Register(3), indices_register=Register(0), "
+      "group_by_register=Register(1), aggregate_index=0]";
+
+  // Rows {0, 2} are in group 0 and rows {1, 3} (both null) in group 1.
+  auto gb = std::make_unique<GroupByState>();
+  gb->group_ids = Slab<uint32_t>::Alloc(4);
+  uint32_t group_ids[] = {0, 1, 0, 1};
+  std::copy(std::begin(group_ids), std::end(group_ids), gb->group_ids.data());
+  gb->group_rows = {0, 1};
+  gb->group_sizes = {2, 2};
+  gb->aggregates.resize(1);
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3};
+  SetRegistersAndExecute(bytecode, GetSpan(indices), std::move(gb),
+                         GetStoragePtr<Double>(0),
+                         NullBitvector{GetNullBv(0), {}});
+
+  const auto& result = *GetRegister<std::unique_ptr<GroupByState>>(1);
+  EXPECT_THAT(result.aggregates[0].double_values, ElementsAre(4.0, 0.0));
+  EXPECT_THAT(result.aggregates[0].counts, ElementsAre(2u, 0u));
+}
+
 }  // namespace
 }  // namespace perfetto::trace_processor::core::interpreter
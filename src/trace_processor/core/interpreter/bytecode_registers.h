@@ -103,6 +103,13 @@ struct StoragePtr {
   StorageType type;
 };
 
+// Pointer to the EncodedVector<T::cpp_type> storing the data of an encoded
+// column along with its type T.
+struct EncodedStoragePtr {
+  const void* ptr;
+  StorageType type;
+};
+
 // Wraps a null bitvector and its prefix popcount cache as a single unit.
 // Used for both SparseNull and DenseNull columns:
 //  - SparseNull: both |bv| and |popcount| are populated (popcount is lazily
@@ -129,7 +136,10 @@ using RegValue = std::variant<Empty,
                               Span<const uint32_t>,
                               BitVector,
                               std::unique_ptr<TreeState>,
-                              NullBitvector>;
+                              std::unique_ptr<GroupByState>,
+                              NullBitvector,
+                              EncodedStoragePtr,
+                              Slab<uint64_t>>;
 
 }  // namespace perfetto::trace_processor::core::interpreter
 
@@ -115,6 +115,20 @@ struct MaxOp {};
 // TypeSet combining Min and Max operations.
 using MinMaxOp = TypeSet<MinOp, MaxOp>;
 
+// Type tag for summing values.
+struct SumOp {};
+
+// TypeSet of the operations which fold the values of a group into a single
+// value.
+using AggregateOp = TypeSet<SumOp, MinOp, MaxOp>;
+
+// TypeSet of the key types which can be grouped with a hash table.
+using HashGroupByType = TypeSet<Uint32, Int32, Int64, String>;
+
+// TypeSet of the key types which can be grouped by finding runs of equal
+// values in sorted columns.
+using SortedGroupByType = TypeSet<Id, Uint32, Int32, Int64>;
+
 // TypeSet containing all the non-id storage types.
 using NonIdStorageType = TypeSet<Uint32, Int32, Int64, Double, String>;
 
@@ -280,6 +294,37 @@ struct TreeState {
   std::vector<PropagateDownSpec> propagate_down_specs;
 };
 
+// Opaque state for group-by aggregations. The GroupBy* bytecodes assign every
+// entry of a span of indices to a group and the Aggregate bytecodes then fold
+// the values of a column into one accumulator per group.
+//
+// |aggregates| is sized by the GroupByAggregator before execution: each
+// Aggregate bytecode fills the entry it is given.
+struct GroupByState {
+  // group_ids[i] = group of the i-th entry of the grouped indices.
+  Slab<uint32_t> group_ids;
+
+  // group_rows[g] = first row of group g (the key is read back from it).
+  std::vector<uint32_t> group_rows;
+
+  // group_sizes[g] = number of rows in group g.
+  std::vector<uint32_t> group_sizes;
+
+  // Per-group accumulators of an aggregate. Integer columns are folded into
+  // |int_values| and double columns into |double_values|.
+  struct Aggregate {
+    std::vector<int64_t> int_values;
+    std::vector<double> double_values;
+    // Number of non-null values folded into each group.
+    std::vector<uint32_t> counts;
+  };
+  std::vector<Aggregate> aggregates;
+
+  uint32_t group_count() const {
+    return static_cast<uint32_t>(group_rows.size());
+  }
+};
+
 }  // namespace perfetto::trace_processor::core::interpreter
 
 #endif  // SRC_TRACE_PROCESSOR_CORE_INTERPRETER_INTERPRETER_TYPES_H_
@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_INTERPRETER_SIMD_FILTER_H_
+#define SRC_TRACE_PROCESSOR_CORE_INTERPRETER_SIMD_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/compiler.h"
+#include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/common/op_types.h"
+
+// Which vectorized implementation of the filter kernels is compiled in.
+//
+// AVX2 is only used when the whole binary is built with
+// enable_perfetto_x64_cpu_opt: in that case CheckCpuOptimizations() in
+// src/base/utils.cc has already verified at startup that the CPU supports
+// AVX2 and BMI2 so no further dispatch is needed. NEON is part of the arm64
+// baseline.
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+#define PERFETTO_TP_SIMD_FILTER_AVX2() 1
+#define PERFETTO_TP_SIMD_FILTER_NEON() 0
+#include <immintrin.h>
+#elif PERFETTO_BUILDFLAG(PERFETTO_ARCH_CPU_ARM64) && \
+    !PERFETTO_BUILDFLAG(PERFETTO_COMPILER_MSVC)
+#define PERFETTO_TP_SIMD_FILTER_AVX2() 0
+#define PERFETTO_TP_SIMD_FILTER_NEON() 1
+#include <arm_neon.h>
+#else
+#define PERFETTO_TP_SIMD_FILTER_AVX2() 0
+#define PERFETTO_TP_SIMD_FILTER_NEON() 0
+#endif
+
+// Vectorized implementations of the hot filtering loops of the bytecode
+// interpreter for integer and double columns.
+//
+// Every kernel works in blocks of kLanes elements: the comparison of a block
+// produces a bitmask of matching elements which is then used to left-pack
+// ("compact") the corresponding row indices into the output with a single
+// shuffle + unaligned store. Leftover elements (and all elements on platforms
+// without a vectorized implementation) are handled by the same scalar loop as
+// before.
+//
+// The vectorized stores always write a full block even if only some of the
+// lanes match. Callers must therefore guarantee that the output buffer has
+// space for as many elements as there are inputs; this is already the case
+// for all interpreter registers as filters only ever shrink index vectors.
+namespace perfetto::trace_processor::core::interpreter::simd {
+
+namespace internal {
+
+template <typename Op, typename T>
+PERFETTO_ALWAYS_INLINE bool ScalarCompare(T a, T b) {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return a == b;
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return a != b;
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return a < b;
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return a <= b;
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return a > b;
+  } else if constexpr (std::is_same_v<Op, Ge>) {
+    return a >= b;
+  } else {
+    static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
+  }
+}
+
+#if PERFETTO_TP_SIMD_FILTER_AVX2()
+
+static constexpr uint32_t kLanes = 8;
+
+using IndexVec = __m256i;
+
+inline PERFETTO_ALWAYS_INLINE IndexVec LoadIndices(const uint32_t* ptr) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+}
+
+inline PERFETTO_ALWAYS_INLINE IndexVec IotaIndices(uint32_t start) {
+  return _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(start)),
+                          _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// Writes the lanes of `v` selected by `mask` contiguously to `out` and returns
+// the pointer past the last selected lane.
+//
+// The permutation is computed without a lookup table: PDEP spreads each mask
+// bit to a whole byte and PEXT then selects the lane numbers of the set bytes
+// from the identity permutation.
+inline PERFETTO_ALWAYS_INLINE uint32_t* CompactStore(IndexVec v,
+                                                     uint32_t mask,
+                                                     uint32_t* out) {
+  uint64_t expanded = _pdep_u64(mask, 0x0101010101010101ull) * 0xff;
+  uint64_t lanes = _pext_u64(0x0706050403020100ull, expanded);
+  __m256i perm = _mm256_cvtepu8_epi32(
+      _mm_cvtsi64_si128(static_cast<long long>(lanes)));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                      _mm256_permutevar8x32_epi32(v, perm));
+  return out + PERFETTO_POPCOUNT(mask);
+}
+
+// kLanes values of type T. 32-bit values only use `lo`; 64-bit values use
+// `lo` for the first four and `hi` for the last four.
+struct Batch {
+  __m256i lo;
+  __m256i hi;
+};
+
+template <typename T>
+PERFETTO_ALWAYS_INLINE Batch Splat(T value) {
+  if constexpr (sizeof(T) == 4) {
+    int v;
+    memcpy(&v, &value, sizeof(v));
+    return {_mm256_set1_epi32(v), _mm256_setzero_si256()};
+  } else {
+    long long v;
+    memcpy(&v, &value, sizeof(v));
+    return {_mm256_set1_epi64x(v), _mm256_set1_epi64x(v)};
+  }
+}
+
+template <typename T>
+PERFETTO_ALWAYS_INLINE Batch Load(const T* ptr) {
+  const auto* p = reinterpret_cast<const __m256i*>(ptr);
+  if constexpr (sizeof(T) == 4) {
+    return {_mm256_loadu_si256(p), _mm256_setzero_si256()};
+  } else {
+    return {_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1)};
+  }
+}
+
+// Row indices are always < 2^31 so treating them as signed for the gather is
+// safe.
+template <typename T>
+PERFETTO_ALWAYS_INLINE Batch Gather(const T* data, IndexVec idx) {
+  if constexpr (sizeof(T) == 4) {
+    return {_mm256_i32gather_epi32(reinterpret_cast<const int*>(data), idx, 4),
+            _mm256_setzero_si256()};
+  } else {
+    const auto* base = reinterpret_cast<const long long*>(data);
+    return {
+        _mm256_i32gather_epi64(base, _mm256_castsi256_si128(idx), 8),
+        _mm256_i32gather_epi64(base, _mm256_extracti128_si256(idx, 1), 8),
+    };
+  }
+}
+
+template <typename T>
+PERFETTO_ALWAYS_INLINE __m256i CmpEq(__m256i a, __m256i b) {
+  if constexpr (sizeof(T) == 4) {
+    return _mm256_cmpeq_epi32(a, b);
+  } else {
+    return _mm256_cmpeq_epi64(a, b);
+  }
+}
+
+template <typename T>
+PERFETTO_ALWAYS_INLINE __m256i CmpGt(__m256i a, __m256i b) {
+  if constexpr (std::is_same_v<T, uint32_t>) {
+    // AVX2 only has signed comparisons: flipping the sign bit of both sides
+    // maps unsigned order onto signed order.
+    const __m256i bias = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    return _mm256_cmpgt_epi32(_mm256_xor_si256(a, bias),
+                              _mm256_xor_si256(b, bias));
+  } else if constexpr (sizeof(T) == 4) {
+    return _mm256_cmpgt_epi32(a, b);
+  } else {
+    return _mm256_cmpgt_epi64(a, b);
+  }
+}
+
+template <typename T>
+PERFETTO_ALWAYS_INLINE uint32_t MoveMask(__m256i lo, __m256i hi) {
+  if constexpr (sizeof(T) == 4) {
+    return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(lo)));
+  } else {
+    auto l = _mm256_movemask_pd(_mm256_castsi256_pd(lo));
+    auto h = _mm256_movemask_pd(_mm256_castsi256_pd(hi));
+    return static_cast<uint32_t>(l | (h << 4));
+  }
+}
+
+template <typename Op>
+constexpr int DoublePredicate() {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return _CMP_EQ_OQ;
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    // Unordered so that NaN != x is true, matching operator!=.
+    return _CMP_NEQ_UQ;
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return _CMP_LT_OQ;
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return _CMP_LE_OQ;
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return _CMP_GT_OQ;
+  } else if constexpr (std::is_same_v<Op, Ge>) {
+    return _CMP_GE_OQ;
+  } else {
+    static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
+  }
+}
+
+// Returns a kLanes-bit mask with bit i set iff `b[i] Op v[i]`.
+template <typename Op, typename T>
+PERFETTO_ALWAYS_INLINE uint32_t Match(const Batch& b, const Batch& v) {
+  constexpr uint32_t kAll = (1u << kLanes) - 1;
+  if constexpr (std::is_same_v<T, double>) {
+    constexpr int kPred = DoublePredicate<Op>();
+    __m256i lo = _mm256_castpd_si256(_mm256_cmp_pd(
+        _mm256_castsi256_pd(b.lo), _mm256_castsi256_pd(v.lo), kPred));
+    __m256i hi = _mm256_castpd_si256(_mm256_cmp_pd(
+        _mm256_castsi256_pd(b.hi), _mm256_castsi256_pd(v.hi), kPred));
+    return MoveMask<T>(lo, hi);
+  } else if constexpr (std::is_same_v<Op, Eq> || std::is_same_v<Op, Ne>) {
+    uint32_t eq = MoveMask<T>(CmpEq<T>(b.lo, v.lo), CmpEq<T>(b.hi, v.hi));
+    return std::is_same_v<Op, Eq> ? eq : ~eq & kAll;
+  } else if constexpr (std::is_same_v<Op, Gt> || std::is_same_v<Op, Le>) {
+    uint32_t gt = MoveMask<T>(CmpGt<T>(b.lo, v.lo), CmpGt<T>(b.hi, v.hi));
+    return std::is_same_v<Op, Gt> ? gt : ~gt & kAll;
+  } else {
+    static_assert(std::is_same_v<Op, Lt> || std::is_same_v<Op, Ge>);
+    uint32_t lt = MoveMask<T>(CmpGt<T>(v.lo, b.lo), CmpGt<T>(v.hi, b.hi));
+    return std::is_same_v<Op, Lt> ? lt : ~lt & kAll;
+  }
+}
+
+template <typename Op, typename T>
+PERFETTO_ALWAYS_INLINE uint32_t MatchContiguous(const T* ptr, T value) {
+  return Match<Op, T>(Load(ptr), Splat(value));
+}
+
+template <typename Op, typename T>
+PERFETTO_ALWAYS_INLINE uint32_t MatchGather(const T* data,
+                                            IndexVec idx,
+                                            T value) {
+  return Match<Op, T>(Gather(data, idx), Splat(value));
+}
+
+#elif PERFETTO_TP_SIMD_FILTER_NEON()
+
+static constexpr uint32_t kLanes = 4;
+
+using IndexVec = uint32x4_t;
+
+inline PERFETTO_ALWAYS_INLINE IndexVec LoadIndices(const uint32_t* ptr) {
+  return vld1q_u32(ptr);
+}
+
+inline PERFETTO_ALWAYS_INLINE IndexVec IotaIndices(uint32_t start) {
+  static constexpr uint32_t kIota[] = {0, 1, 2, 3};
+  return vaddq_u32(vdupq_n_u32(start), vld1q_u32(kIota));
+}
+
+// For each 4-bit mask, the byte shuffle which moves the selected 32-bit lanes
+// to the front of the vector.
+struct CompactTable {
+  constexpr CompactTable() : bytes() {
+    for (uint32_t mask = 0; mask < 16; ++mask) {
+      uint32_t out = 0;
+      for (uint32_t lane = 0; lane < 4; ++lane) {
+        if (mask & (1u << lane)) {
+          for (uint32_t b = 0; b < 4; ++b) {
+            bytes[mask][out * 4 + b] = static_cast<uint8_t>(lane * 4 + b);
+          }
+          ++out;
+        }
+      }
+    }
+  }
+  uint8_t bytes[16][16];
+};
+inline constexpr CompactTable kCompactTable{};
+
+inline PERFETTO_ALWAYS_INLINE uint32_t* CompactStore(IndexVec v,
+                                                     uint32_t mask,
+                                                     uint32_t* out) {
+  uint8x16_t shuffle = vld1q_u8(kCompactTable.bytes[mask]);
+  vst1q_u32(out, vreinterpretq_u32_u8(
+                     vqtbl1q_u8(vreinterpretq_u8_u32(v), shuffle)));
+  return out + PERFETTO_POPCOUNT(mask);
+}
+
+inline PERFETTO_ALWAYS_INLINE uint32_t MoveMask(uint32x4_t m) {
+  static constexpr uint32_t kBits[] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(m, vld1q_u32(kBits)));
+}
+
+inline PERFETTO_ALWAYS_INLINE uint32_t MoveMask(uint64x2_t lo,
+                                                uint64x2_t hi) {
+  static constexpr uint64_t kLoBits[] = {1, 2};
+  static constexpr uint64_t kHiBits[] = {4, 8};
+  return static_cast<uint32_t>(vaddvq_u64(vandq_u64(lo, vld1q_u64(kLoBits))) |
+                               vaddvq_u64(vandq_u64(hi, vld1q_u64(kHiBits))));
+}
+
+inline PERFETTO_ALWAYS_INLINE uint64x2_t Not(uint64x2_t m) {
+  return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(m)));
+}
+
+// Unlike AVX2, NEON has native ordered comparisons for all the types we care
+// about so every (type, op) pair maps to a single instruction (plus a NOT for
+// Ne, which is also correct for NaN as NaN != x is always true).
+template <typename Op>
+PERFETTO_ALWAYS_INLINE uint32x4_t Compare(uint32x4_t a, uint32x4_t b) {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return vceqq_u32(a, b);
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return vmvnq_u32(vceqq_u32(a, b));
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return vcltq_u32(a, b);
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return vcleq_u32(a, b);
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return vcgtq_u32(a, b);
+  } else {
+    static_assert(std::is_same_v<Op, Ge>, "Unsupported op");
+    return vcgeq_u32(a, b);
+  }
+}
+
+template <typename Op>
+PERFETTO_ALWAYS_INLINE uint32x4_t Compare(int32x4_t a, int32x4_t b) {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return vceqq_s32(a, b);
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return vmvnq_u32(vceqq_s32(a, b));
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return vcltq_s32(a, b);
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return vcleq_s32(a, b);
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return vcgtq_s32(a, b);
+  } else {
+    static_assert(std::is_same_v<Op, Ge>, "Unsupported op");
+    return vcgeq_s32(a, b);
+  }
+}
+
+template <typename Op>
+PERFETTO_ALWAYS_INLINE uint64x2_t Compare(int64x2_t a, int64x2_t b) {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return vceqq_s64(a, b);
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return Not(vceqq_s64(a, b));
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return vcltq_s64(a, b);
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return vcleq_s64(a, b);
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return vcgtq_s64(a, b);
+  } else {
+    static_assert(std::is_same_v<Op, Ge>, "Unsupported op");
+    return vcgeq_s64(a, b);
+  }
+}
+
+template <typename Op>
+PERFETTO_ALWAYS_INLINE uint64x2_t Compare(float64x2_t a, float64x2_t b) {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return vceqq_f64(a, b);
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return Not(vceqq_f64(a, b));
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return vcltq_f64(a, b);
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return vcleq_f64(a, b);
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return vcgtq_f64(a, b);
+  } else {
+    static_assert(std::is_same_v<Op, Ge>, "Unsupported op");
+    return vcgeq_f64(a, b);
+  }
+}
+
+// Returns a kLanes-bit mask with bit i set iff `ptr[i] Op value`.
+template <typename Op, typename T>
+PERFETTO_ALWAYS_INLINE uint32_t MatchContiguous(const T* ptr, T value) {
+  if constexpr (std::is_same_v<T, uint32_t>) {
+    return MoveMask(Compare<Op>(vld1q_u32(ptr), vdupq_n_u32(value)));
+  } else if constexpr (std::is_same_v<T, int32_t>) {
+    return MoveMask(Compare<Op>(vld1q_s32(ptr), vdupq_n_s32(value)));
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    int64x2_t v = vdupq_n_s64(value);
+    return MoveMask(Compare<Op>(vld1q_s64(ptr), v),
+                    Compare<Op>(vld1q_s64(ptr + 2), v));
+  } else {
+    static_assert(std::is_same_v<T, double>, "Unsupported type");
+    float64x2_t v = vdupq_n_f64(value);
+    return MoveMask(Compare<Op>(vld1q_f64(ptr), v),
+                    Compare<Op>(vld1q_f64(ptr + 2), v));
+  }
+}
+
+#endif  // PERFETTO_TP_SIMD_FILTER_NEON()
+
+}  // namespace internal
+
+// Returns true if the kernels below are vectorized on this platform.
+constexpr bool IsVectorized() {
+  return PERFETTO_TP_SIMD_FILTER_AVX2() || PERFETTO_TP_SIMD_FILTER_NEON();
+}
+
+// Vectorized equivalent of ops::Filter: keeps `output[i]` iff
+// `data[begin[i]] Op value`, compacting `output` in-place. `begin` and
+// `output` may alias.
+//
+// Returns a pointer one past the last index written to `output`.
+template <typename Op, typename T>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* FilterGather(
+    const T* data,
+    const uint32_t* begin,
+    const uint32_t* end,
+    uint32_t* output,
+    T value) {
+  const uint32_t* it = begin;
+  const uint32_t* o_read = output;
+  uint32_t* o_write = output;
+  // NEON has no gather instruction and assembling a vector from scalar loads
+  // is no faster than the scalar loop so only AVX2 is vectorized here.
+#if PERFETTO_TP_SIMD_FILTER_AVX2()
+  using internal::kLanes;
+  for (; static_cast<size_t>(end - it) >= kLanes;
+       it += kLanes, o_read += kLanes) {
+    uint32_t mask =
+        internal::MatchGather<Op>(data, internal::LoadIndices(it), value);
+    // Note: `o_read` must be loaded before storing to `o_write` as the
+    // latter can overwrite (at most) the current block.
+    o_write =
+        internal::CompactStore(internal::LoadIndices(o_read), mask, o_write);
+  }
+#endif
+  for (; it != end; ++it, ++o_read) {
+    if (internal::ScalarCompare<Op>(data[*it], value)) {
+      *o_write++ = *o_read;
+    }
+  }
+  return o_write;
+}
+
+// Vectorized equivalent of ops::IdentityFilter: keeps `output[i]` iff
+// `begin[i] Op value`, compacting `output` in-place.
+//
+// Returns a pointer one past the last index written to `output`.
+template <typename Op>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* FilterIdentity(
+    const uint32_t* begin,
+    const uint32_t* end,
+    uint32_t* output,
+    uint32_t value) {
+  const uint32_t* it = begin;
+  const uint32_t* o_read = output;
+  uint32_t* o_write = output;
+#if PERFETTO_TP_SIMD_FILTER_AVX2() || PERFETTO_TP_SIMD_FILTER_NEON()
+  using internal::kLanes;
+  for (; static_cast<size_t>(end - it) >= kLanes;
+       it += kLanes, o_read += kLanes) {
+    uint32_t mask = internal::MatchContiguous<Op>(it, value);
+    o_write =
+        internal::CompactStore(internal::LoadIndices(o_read), mask, o_write);
+  }
+#endif
+  for (; it != end; ++it, ++o_read) {
+    if (internal::ScalarCompare<Op>(*it, value)) {
+      *o_write++ = *o_read;
+    }
+  }
+  return o_write;
+}
+
+// Writes to `output` every index `i` in [begin, end) for which
+// `data[i] Op value`, in increasing order. `output` must have space for
+// `end - begin` elements.
+//
+// Returns a pointer one past the last index written to `output`.
+template <typename Op, typename T>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* FilterLinear(const T* data,
+                                                           uint32_t begin,
+                                                           uint32_t end,
+                                                           uint32_t* output,
+                                                           T value) {
+  uint32_t i = begin;
+  uint32_t* o_write = output;
+#if PERFETTO_TP_SIMD_FILTER_AVX2() || PERFETTO_TP_SIMD_FILTER_NEON()
+  using internal::kLanes;
+  for (; end - i >= kLanes; i += kLanes) {
+    uint32_t mask = internal::MatchContiguous<Op>(data + i, value);
+    o_write = internal::CompactStore(internal::IotaIndices(i), mask, o_write);
+  }
+#endif
+  for (; i < end; ++i) {
+    if (internal::ScalarCompare<Op>(data[i], value)) {
+      *o_write++ = i;
+    }
+  }
+  return o_write;
+}
+
+}  // namespace perfetto::trace_processor::core::interpreter::simd
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_INTERPRETER_SIMD_FILTER_H_
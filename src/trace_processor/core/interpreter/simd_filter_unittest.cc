@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/interpreter/simd_filter.h"
+
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "src/trace_processor/core/common/op_types.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core::interpreter::simd {
+namespace {
+
+using testing::ElementsAre;
+
+// Sizes chosen to cover empty inputs, inputs smaller than a block and inputs
+// with and without a scalar tail for both 4 and 8 lanes.
+constexpr uint32_t kSizes[] = {0, 1, 3, 4, 7, 8, 9, 16, 31, 100, 1000};
+
+// Returns a random value for T which is likely to collide with other values
+// returned by this function. Includes values which are sensitive to signed vs
+// unsigned comparisons and NaN for doubles.
+template <typename T>
+T RandomValue(std::minstd_rand0& rnd) {
+  uint32_t x = static_cast<uint32_t>(rnd() % 10);
+  if constexpr (std::is_same_v<T, double>) {
+    return x == 9 ? std::numeric_limits<double>::quiet_NaN()
+                  : static_cast<double>(x) - 4;
+  } else if constexpr (std::is_same_v<T, uint32_t>) {
+    return x >= 7 ? std::numeric_limits<uint32_t>::max() - x : x;
+  } else {
+    return static_cast<T>(x) - 4;
+  }
+}
+
+template <typename T>
+std::vector<T> RandomData(std::minstd_rand0& rnd, uint32_t size) {
+  std::vector<T> data(size);
+  for (T& d : data) {
+    d = RandomValue<T>(rnd);
+  }
+  return data;
+}
+
+template <typename Op, typename T>
+void CheckFilterLinear(std::minstd_rand0& rnd) {
+  for (uint32_t size : kSizes) {
+    std::vector<T> data = RandomData<T>(rnd, size);
+    T value = RandomValue<T>(rnd);
+    uint32_t begin = size == 0 ? 0 : static_cast<uint32_t>(rnd() % 3) % size;
+
+    std::vector<uint32_t> expected;
+    for (uint32_t i = begin; i < size; ++i) {
+      if (internal::ScalarCompare<Op>(data[i], value)) {
+        expected.push_back(i);
+      }
+    }
+    std::vector<uint32_t> out(size);
+    uint32_t* end =
+        FilterLinear<Op>(data.data(), begin, size, out.data(), value);
+    ASSERT_EQ(std::vector<uint32_t>(out.data(), end), expected)
+        << "size: " << size;
+  }
+}
+
+template <typename Op, typename T>
+void CheckFilterGather(std::minstd_rand0& rnd) {
+  for (uint32_t size : kSizes) {
+    std::vector<T> data = RandomData<T>(rnd, size);
+    T value = RandomValue<T>(rnd);
+    std::vector<uint32_t> indices(size);
+    for (uint32_t& idx : indices) {
+      idx = static_cast<uint32_t>(rnd() % size);
+    }
+
+    // In-place, as used for NonNull columns.
+    std::vector<uint32_t> expected;
+    for (uint32_t idx : indices) {
+      if (internal::ScalarCompare<Op>(data[idx], value)) {
+        expected.push_back(idx);
+      }
+    }
+    std::vector<uint32_t> update = indices;
+    uint32_t* end = FilterGather<Op>(data.data(), update.data(),
+                                     update.data() + size, update.data(),
+                                     value);
+    ASSERT_EQ(std::vector<uint32_t>(update.data(), end), expected)
+        << "size: " << size;
+
+    // Separate source indices, as used for SparseNull columns.
+    std::vector<uint32_t> original(size);
+    std::iota(original.begin(), original.end(), 1000u);
+    expected.clear();
+    for (uint32_t i = 0; i < size; ++i) {
+      if (internal::ScalarCompare<Op>(data[indices[i]], value)) {
+        expected.push_back(original[i]);
+      }
+    }
+    end = FilterGather<Op>(data.data(), indices.data(), indices.data() + size,
+                           original.data(), value);
+    ASSERT_EQ(std::vector<uint32_t>(original.data(), end), expected)
+        << "size: " << size;
+  }
+}
+
+template <typename Op>
+void CheckFilterIdentity(std::minstd_rand0& rnd) {
+  for (uint32_t size : kSizes) {
+    std::vector<uint32_t> ids = RandomData<uint32_t>(rnd, size);
+    uint32_t value = RandomValue<uint32_t>(rnd);
+    std::vector<uint32_t> update(size);
+    std::iota(update.begin(), update.end(), 1000u);
+
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < size; ++i) {
+      if (internal::ScalarCompare<Op>(ids[i], value)) {
+        expected.push_back(update[i]);
+      }
+    }
+    uint32_t* end = FilterIdentity<Op>(ids.data(), ids.data() + size,
+                                       update.data(), value);
+    ASSERT_EQ(std::vector<uint32_t>(update.data(), end), expected)
+        << "size: " << size;
+  }
+}
+
+template <typename T>
+void CheckAllOps() {
+  std::minstd_rand0 rnd(42);
+  for (uint32_t i = 0; i < 10; ++i) {
+    CheckFilterLinear<Eq, T>(rnd);
+    CheckFilterLinear<Ne, T>(rnd);
+    CheckFilterLinear<Lt, T>(rnd);
+    CheckFilterLinear<Le, T>(rnd);
+    CheckFilterLinear<Gt, T>(rnd);
+    CheckFilterLinear<Ge, T>(rnd);
+    CheckFilterGather<Eq, T>(rnd);
+    CheckFilterGather<Ne, T>(rnd);
+    CheckFilterGather<Lt, T>(rnd);
+    CheckFilterGather<Le, T>(rnd);
+    CheckFilterGather<Gt, T>(rnd);
+    CheckFilterGather<Ge, T>(rnd);
+  }
+}
+
+TEST(SimdFilterTest, Uint32) {
+  CheckAllOps<uint32_t>();
+}
+
+TEST(SimdFilterTest, Int32) {
+  CheckAllOps<int32_t>();
+}
+
+TEST(SimdFilterTest, Int64) {
+  CheckAllOps<int64_t>();
+}
+
+TEST(SimdFilterTest, Double) {
+  CheckAllOps<double>();
+}
+
+TEST(SimdFilterTest, Identity) {
+  std::minstd_rand0 rnd(42);
+  for (uint32_t i = 0; i < 10; ++i) {
+    CheckFilterIdentity<Eq>(rnd);
+    CheckFilterIdentity<Ne>(rnd);
+    CheckFilterIdentity<Lt>(rnd);
+    CheckFilterIdentity<Le>(rnd);
+    CheckFilterIdentity<Gt>(rnd);
+    CheckFilterIdentity<Ge>(rnd);
+  }
+}
+
+TEST(SimdFilterTest, LinearWritesIndicesInOrder) {
+  std::vector<int64_t> data = {5, 1, 5, 5, 2, 5, 3, 4, 5, 5, 5};
+  std::vector<uint32_t> out(data.size());
+  uint32_t* end = FilterLinear<Eq>(data.data(), 1u,
+                                   static_cast<uint32_t>(data.size()),
+                                   out.data(), int64_t(5));
+  EXPECT_THAT(std::vector<uint32_t>(out.data(), end),
+              ElementsAre(2u, 3u, 5u, 8u, 9u, 10u));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core::interpreter::simd
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "src/trace_processor/core/join/hash_joiner.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "perfetto/base/compiler.h"
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/null_types.h"
+#include "src/trace_processor/core/common/storage_types.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/types.h"
+#include "src/trace_processor/core/join/join_spec.h"
+#include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/slab.h"
+
+namespace perfetto::trace_processor::core::join {
+namespace {
+
+constexpr uint32_t kNoRow = std::numeric_limits<uint32_t>::max();
+
+// Random access to the values of a column, whatever its encoding and
+// nullability.
+struct ColumnReader {
+  StorageType type = Id{};
+  // nullptr for Id columns.
+  const void* data = nullptr;
+  // nullptr for non-null columns.
+  const BitVector* null_bv = nullptr;
+  // For sparse null columns, which only store the non-null values: the number
+  // of non-null rows before each word of |null_bv|.
+  Slab<uint32_t> prefix_popcount;
+  // For Id columns, the value of row 0.
+  uint32_t id_offset = 0;
+  // Owns the decoded values of encoded columns.
+  Slab<uint64_t> decoded;
+
+  // Returns the index of the value of |row| in |data|, or kNoRow if the value
+  // is null.
+  PERFETTO_ALWAYS_INLINE uint32_t StorageIndex(uint32_t row) const {
+    if (!null_bv) {
+      return row;
+    }
+    if (!null_bv->is_set(row)) {
+      return kNoRow;
+    }
+    if (prefix_popcount.size() == 0) {
+      return row;
+    }
+    return prefix_popcount[row / 64] +
+           static_cast<uint32_t>(null_bv->count_set_bits_until_in_word(row));
+  }
+};
+
+template <typename T>
+void DecodeColumn(const dataframe::Storage& storage, ColumnReader& reader) {
+  using C = typename T::cpp_type;
+  const auto& encoded = storage.unchecked_get_encoded<T>();
+  uint64_t size_bytes = uint64_t(encoded.size()) * sizeof(C);
+  reader.decoded = Slab<uint64_t>::Alloc((size_bytes + 7) / 8);
+  auto* out = reinterpret_cast<C*>(reader.decoded.data());
+  encoded.DecodeTo(out);
+  reader.data = out;
+}
+
+ColumnReader GetColumnReader(const dataframe::Column& column) {
+  ColumnReader reader;
+  reader.type = column.storage.type();
+  if (column.storage.is_encoded()) {
+    switch (reader.type.index()) {
+      case StorageType::GetTypeIndex<Uint32>():
+        DecodeColumn<Uint32>(column.storage, reader);
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        DecodeColumn<Int32>(column.storage, reader);
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        DecodeColumn<Int64>(column.storage, reader);
+        break;
+      default:
+        PERFETTO_FATAL("Unsupported encoded storage type");
+    }
+  } else {
+    reader.data = std::visit(
+        [](auto* ptr) { return static_cast<const void*>(ptr); },
+        column.storage.data());
+  }
+  if (reader.type.Is<Id>()) {
+    reader.id_offset = column.storage.unchecked_get<Id>().popped_rows;
+  }
+  reader.null_bv = column.null_storage.MaybeGetNullBitVector();
+  if (reader.null_bv && !column.null_storage.nullability().Is<DenseNull>()) {
+    reader.prefix_popcount = reader.null_bv->PrefixPopcount();
+  }
+  return reader;
+}
+
+template <typename C, typename Fn>
+void ForEachValue(const ColumnReader& reader, uint32_t rows, Fn fn) {
+  const auto* data = static_cast<const C*>(reader.data);
+  for (uint32_t row = 0; row < rows; ++row) {
+    uint32_t idx = reader.StorageIndex(row);
+    if (idx != kNoRow) {
+      fn(row, data[idx]);
+    }
+  }
+}
+
+// Calls |fn| with the row and the key of every non-null row of a key column.
+// All the integer types are widened to int64; strings are keyed by their
+// interned id.
+template <typename Fn>
+void ForEachKey(const ColumnReader& reader, uint32_t rows, Fn fn) {
+  switch (reader.type.index()) {
+    case StorageType::GetTypeIndex<Id>():
+      for (uint32_t row = 0; row < rows; ++row) {
+        fn(row, static_cast<int64_t>(reader.id_offset + row));
+      }
+      break;
+    case StorageType::GetTypeIndex<Uint32>():
+      ForEachValue<uint32_t>(reader, rows, [&](uint32_t row, uint32_t v) {
+        fn(row, static_cast<int64_t>(v));
+      });
+      break;
+    case StorageType::GetTypeIndex<Int32>():
+      ForEachValue<int32_t>(reader, rows, [&](uint32_t row, int32_t v) {
+        fn(row, static_cast<int64_t>(v));
+      });
+      break;
+    case StorageType::GetTypeIndex<Int64>():
+      ForEachValue<int64_t>(reader, rows, fn);
+      break;
+    case StorageType::GetTypeIndex<String>():
+      ForEachValue<StringPool::Id>(
+          reader, rows, [&](uint32_t row, StringPool::Id v) {
+            // See kStringNullLegacy in dataframe.h.
+            if (!v.is_null()) {
+              fn(row, static_cast<int64_t>(v.raw_id()));
+            }
+          });
+      break;
+    default:
+      PERFETTO_FATAL("Unsupported key type");
+  }
+}
+
+dataframe::AdhocColumnType OutputType(StorageType type) {
+  if (type.Is<Double>()) {
+    return dataframe::AdhocColumnType::kDouble;
+  }
+  if (type.Is<String>()) {
+    return dataframe::AdhocColumnType::kString;
+  }
+  return dataframe::AdhocColumnType::kInt64;
+}
+
+// Pushes the value of |row| of |reader| to the column |col| of |builder|.
+void PushValue(dataframe::AdhocDataframeBuilder& builder,
+               uint32_t col,
+               const ColumnReader& reader,
+               uint32_t row) {
+  uint32_t idx = reader.StorageIndex(row);
+  if (idx == kNoRow) {
+    builder.PushNull(col);
+    return;
+  }
+  switch (reader.type.index()) {
+    case StorageType::GetTypeIndex<Id>():
+      builder.PushNonNull(col, idx + reader.id_offset);
+      break;
+    case StorageType::GetTypeIndex<Uint32>():
+      builder.PushNonNull(col, static_cast<const uint32_t*>(reader.data)[idx]);
+      break;
+    case StorageType::GetTypeIndex<Int32>():
+      builder.PushNonNull(
+          col,
+          static_cast<int64_t>(static_cast<const int32_t*>(reader.data)[idx]));
+      break;
+    case StorageType::GetTypeIndex<Int64>():
+      builder.PushNonNull(col, static_cast<const int64_t*>(reader.data)[idx]);
+      break;
+    case StorageType::GetTypeIndex<Double>():
+      builder.PushNonNull(col, static_cast<const double*>(reader.data)[idx]);
+      break;
+    case StorageType::GetTypeIndex<String>():
+      builder.PushNonNull(col,
+                          static_cast<const StringPool::Id*>(reader.data)[idx]);
+      break;
+    default:
+      PERFETTO_FATAL("Unsupported storage type");
+  }
+}
+
+std::optional<uint32_t> ResolveColumn(const dataframe::Dataframe& df,
+                                      std::string_view name) {
+  const std::vector<std::string>& names = df.column_names();
+  for (uint32_t col = 0; col < names.size(); ++col) {
+    if (names[col] == name) {
+      return col;
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+base::StatusOr<dataframe::Dataframe> HashJoiner::InnerJoin(
+    const dataframe::Dataframe& left,
+    std::string_view left_key_col_name,
+    const dataframe::Dataframe& right,
+    std::string_view right_key_col_name,
+    const std::vector<JoinColumnSpec>& columns,
+    StringPool* pool) {
+  // Resolve and validate the key columns.
+  std::optional<uint32_t> left_key_col =
+      ResolveColumn(left, left_key_col_name);
+  if (!left_key_col) {
+    return base::ErrStatus("join: unknown left key column '%.*s'",
+                           static_cast<int>(left_key_col_name.size()),
+                           left_key_col_name.data());
+  }
+  std::optional<uint32_t> right_key_col =
+      ResolveColumn(right, right_key_col_name);
+  if (!right_key_col) {
+    return base::ErrStatus("join: unknown right key column '%.*s'",
+                           static_cast<int>(right_key_col_name.size()),
+                           right_key_col_name.data());
+  }
+  StorageType left_key_type = left.column_ptrs_[*left_key_col]->storage.type();
+  StorageType right_key_type =
+      right.column_ptrs_[*right_key_col]->storage.type();
+  if (left_key_type.Is<Double>() || right_key_type.Is<Double>()) {
+    return base::ErrStatus("join: cannot join on double columns");
+  }
+  if (left_key_type.Is<String>() != right_key_type.Is<String>()) {
+    return base::ErrStatus(
+        "join: cannot join string column with non-string column");
+  }
+
+  // Resolve the output columns.
+  std::vector<ColumnReader> readers;
+  std::vector<std::string> names;
+  std::vector<dataframe::AdhocColumnType> types;
+  for (const JoinColumnSpec& spec : columns) {
+    const dataframe::Dataframe& df =
+        spec.side == JoinSide::kLeft ? left : right;
+    std::optional<uint32_t> col = ResolveColumn(df, spec.source_col_name);
+    if (!col) {
+      return base::ErrStatus(
+          "join: unknown %s column '%s'",
+          spec.side == JoinSide::kLeft ? "left" : "right",
+          spec.source_col_name.c_str());
+    }
+    for (const std::string& name : names) {
+      if (name == spec.output_col_name) {
+        return base::ErrStatus("join: duplicate output column '%s'",
+                               name.c_str());
+      }
+    }
+    readers.push_back(GetColumnReader(*df.column_ptrs_[*col]));
+    names.push_back(spec.output_col_name);
+    types.push_back(OutputType(readers.back().type));
+  }
+
+  // Build: index the rows of the right side by key. The rows with the same key
+  // are chained through |next|, in increasing order.
+  ColumnReader left_key = GetColumnReader(*left.column_ptrs_[*left_key_col]);
+  ColumnReader right_key =
+      GetColumnReader(*right.column_ptrs_[*right_key_col]);
+  std::vector<uint32_t> left_rows;
+  std::vector<uint32_t> right_rows;
+  if (right_key.type.Is<Id>()) {
+    // The key of every row is its index (plus an offset): no need for a
+    // hash table.
+    int64_t offset = right_key.id_offset;
+    int64_t size = right.row_count_;
+    ForEachKey(left_key, left.row_count_, [&](uint32_t row, int64_t key) {
+      if (key >= offset && key - offset < size) {
+        left_rows.push_back(row);
+        right_rows.push_back(static_cast<uint32_t>(key - offset));
+      }
+    });
+  } else {
+    std::vector<uint32_t> build_rows;
+    std::vector<int64_t> build_keys;
+    ForEachKey(right_key, right.row_count_, [&](uint32_t row, int64_t key) {
+      build_rows.push_back(row);
+      build_keys.push_back(key);
+    });
+    // The capacity must be a power of two: size it so that all the keys fit
+    // below the load limit without growing.
+    size_t capacity = 1;
+    while (capacity < build_rows.size() * 2) {
+      capacity *= 2;
+    }
+    base::FlatHashMapV2<int64_t, uint32_t> heads(capacity);
+    std::vector<uint32_t> next(right.row_count_, kNoRow);
+    for (size_t i = build_rows.size(); i-- > 0;) {
+      auto [head, inserted] = heads.Insert(build_keys[i], build_rows[i]);
+      if (!inserted) {
+        next[build_rows[i]] = *head;
+        *head = build_rows[i];
+      }
+    }
+
+    // Probe: look up the key of every row of the left side.
+    ForEachKey(left_key, left.row_count_, [&](uint32_t row, int64_t key) {
+      uint32_t* head = heads.Find(key);
+      if (!head) {
+        return;
+      }
+      for (uint32_t r = *head; r != kNoRow; r = next[r]) {
+        left_rows.push_back(row);
+        right_rows.push_back(r);
+      }
+    });
+  }
+
+  // Gather the output columns.
+  auto builder = dataframe::AdhocDataframeBuilder(
+      names, pool,
+      dataframe::AdhocDataframeBuilder::Options{
+          std::move(types),
+          dataframe::NullabilityType::kDenseNull,
+      });
+  for (uint32_t c = 0; c < columns.size(); ++c) {
+    const std::vector<uint32_t>& rows =
+        columns[c].side == JoinSide::kLeft ? left_rows : right_rows;
+    for (uint32_t row : rows) {
+      PushValue(builder, c, readers[c], row);
+    }
+  }
+  return std::move(builder).Build();
+}
+
+}  // namespace perfetto::trace_processor::core::join
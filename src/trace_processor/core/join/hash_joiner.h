@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_JOIN_HASH_JOINER_H_
+#define SRC_TRACE_PROCESSOR_CORE_JOIN_HASH_JOINER_H_
+
+#include <string_view>
+#include <vector>
+
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/join/join_spec.h"
+
+namespace perfetto::trace_processor::core::join {
+
+// Computes the inner equi-join of two dataframes, producing a dataframe with
+// one column per JoinColumnSpec.
+//
+// This is the native equivalent of
+//   SELECT l.col AS output, r.col AS output, ...
+//   FROM left l JOIN right r ON l.left_key = r.right_key
+// which SQLite executes as a nested loop, filtering |right| once per row of
+// |left|: unless |right_key| is indexed, that is a full scan of |right| per
+// row. Instead, the right side is read once to build a hash table on its key
+// (or, for id keys, used directly as a row index) which the rows of the left
+// side then probe.
+//
+// Rows appear in the order of the left rows, then of the matching right rows.
+// Like SQL, null keys match nothing. Integer keys of different widths can be
+// joined together; string keys can only be joined with string keys.
+//
+// Usage:
+//   ASSIGN_OR_RETURN(auto spec, ParseJoinColumnSpec("right.name AS thread"));
+//   ASSIGN_OR_RETURN(auto result, HashJoiner::InnerJoin(
+//                                     slices, "utid", threads, "id",
+//                                     {spec}, pool));
+class HashJoiner {
+ public:
+  // Key columns can have any type but double.
+  static base::StatusOr<dataframe::Dataframe> InnerJoin(
+      const dataframe::Dataframe& left,
+      std::string_view left_key_col_name,
+      const dataframe::Dataframe& right,
+      std::string_view right_key_col_name,
+      const std::vector<JoinColumnSpec>& columns,
+      StringPool* pool);
+};
+
+}  // namespace perfetto::trace_processor::core::join
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_JOIN_HASH_JOINER_H_
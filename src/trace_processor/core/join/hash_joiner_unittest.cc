@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/join/hash_joiner.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "src/base/test/status_matchers.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/cursor.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/core/join/join_spec.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core::join {
+namespace {
+
+using dataframe::CreateTypedColumnSpec;
+using dataframe::CreateTypedDataframeSpec;
+using dataframe::Dataframe;
+using testing::ElementsAre;
+using testing::HasSubstr;
+using testing::IsEmpty;
+using testing::SizeIs;
+
+// Appends the text of a cell to a row.
+struct CellToString : dataframe::CellCallback {
+  void OnCell(int64_t v) { out += std::to_string(v); }
+  void OnCell(uint32_t v) { out += std::to_string(v); }
+  void OnCell(int32_t v) { out += std::to_string(v); }
+  void OnCell(double v) { out += std::to_string(v); }
+  void OnCell(NullTermStringView v) { out += v.c_str(); }
+  void OnCell(std::nullptr_t) { out += "NULL"; }
+
+  std::string out;
+};
+
+// Returns the rows of |df| as strings of '|' separated values.
+std::vector<std::string> Rows(const Dataframe& df) {
+  std::vector<std::string> rows;
+  for (uint32_t row = 0; row < df.row_count(); ++row) {
+    CellToString cell;
+    for (uint32_t col = 0; col < df.column_names().size(); ++col) {
+      if (df.column_names()[col] == "_auto_id") {
+        continue;
+      }
+      if (col > 0) {
+        cell.out += "|";
+      }
+      df.GetCell(row, col, cell);
+    }
+    rows.push_back(std::move(cell.out));
+  }
+  return rows;
+}
+
+// Joins |left| and |right| and returns the rows of the result.
+std::vector<std::string> JoinRows(const Dataframe& left,
+                                  const char* left_key,
+                                  const Dataframe& right,
+                                  const char* right_key,
+                                  const std::vector<JoinColumnSpec>& columns,
+                                  StringPool* pool) {
+  auto result =
+      HashJoiner::InnerJoin(left, left_key, right, right_key, columns, pool);
+  EXPECT_OK(result.status());
+  return result.ok() ? Rows(*result) : std::vector<std::string>();
+}
+
+JoinColumnSpec Left(const char* col) {
+  return {JoinSide::kLeft, col, std::string("l_") + col};
+}
+
+JoinColumnSpec Right(const char* col) {
+  return {JoinSide::kRight, col, std::string("r_") + col};
+}
+
+TEST(HashJoinerTest, IntKeys) {
+  static constexpr auto kLeftSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  static constexpr auto kRightSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(Int32(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe left = Dataframe::CreateFromTypedSpec(kLeftSpec, &pool);
+  left.InsertUnchecked(kLeftSpec, int64_t(3), int64_t(10));
+  left.InsertUnchecked(kLeftSpec, int64_t(1), int64_t(11));
+  left.InsertUnchecked(kLeftSpec, int64_t(2), int64_t(12));
+  left.InsertUnchecked(kLeftSpec, int64_t(3), int64_t(13));
+  left.Finalize();
+  Dataframe right = Dataframe::CreateFromTypedSpec(kRightSpec, &pool);
+  right.InsertUnchecked(kRightSpec, int32_t(3), int64_t(20));
+  right.InsertUnchecked(kRightSpec, int32_t(1), int64_t(21));
+  right.InsertUnchecked(kRightSpec, int32_t(3), int64_t(22));
+  right.InsertUnchecked(kRightSpec, int32_t(5), int64_t(23));
+  right.Finalize();
+
+  // Rows are in the order of the left rows, then of the right rows.
+  EXPECT_THAT(JoinRows(left, "key", right, "key",
+                       {Left("key"), Left("v"), Right("v")}, &pool),
+              ElementsAre("3|10|20", "3|10|22", "1|11|21", "3|13|20",
+                          "3|13|22"));
+}
+
+TEST(HashJoinerTest, NullableKeys) {
+  // The left key is sparse null and the right key dense null: null keys match
+  // nothing, including other null keys.
+  static constexpr auto kLeftSpec = CreateTypedDataframeSpec(
+      {"key", "v"},
+      CreateTypedColumnSpec(Uint32(), SparseNullWithPopcountAlways(),
+                            Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  static constexpr auto kRightSpec = CreateTypedDataframeSpec(
+      {"key", "v"}, CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), SparseNullWithPopcountAlways(),
+                            Unsorted()));
+  StringPool pool;
+  Dataframe left = Dataframe::CreateFromTypedSpec(kLeftSpec, &pool);
+  left.InsertUnchecked(kLeftSpec, std::make_optional(1u), int64_t(0));
+  left.InsertUnchecked(kLeftSpec, std::nullopt, int64_t(1));
+  left.InsertUnchecked(kLeftSpec, std::make_optional(2u), int64_t(2));
+  left.InsertUnchecked(kLeftSpec, std::nullopt, int64_t(3));
+  left.InsertUnchecked(kLeftSpec, std::make_optional(1u), int64_t(4));
+  left.Finalize();
+  Dataframe right = Dataframe::CreateFromTypedSpec(kRightSpec, &pool);
+  right.InsertUnchecked(kRightSpec, std::nullopt,
+                        std::make_optional(int64_t(10)));
+  right.InsertUnchecked(kRightSpec, std::make_optional(int64_t(2)),
+                        std::nullopt);
+  right.InsertUnchecked(kRightSpec, std::nullopt, std::nullopt);
+  right.InsertUnchecked(kRightSpec, std::make_optional(int64_t(1)),
+                        std::make_optional(int64_t(13)));
+  right.Finalize();
+
+  EXPECT_THAT(JoinRows(left, "key", right, "key",
+                       {Left("v"), Right("key"), Right("v")}, &pool),
+              ElementsAre("0|1|13", "2|2|NULL", "4|1|13"));
+
+  // Same with the sides swapped, so that the sparse null key is hashed.
+  EXPECT_THAT(
+      JoinRows(right, "key", left, "key", {Left("v"), Right("v")}, &pool),
+      ElementsAre("NULL|2", "13|0", "13|4"));
+}
+
+TEST(HashJoinerTest, IdRightKeyWithPoppedRows) {
+  static constexpr auto kLeftSpec = CreateTypedDataframeSpec(
+      {"key"}, CreateTypedColumnSpec(Uint32(), DenseNull(), Unsorted()));
+  static constexpr auto kRightSpec = CreateTypedDataframeSpec(
+      {"id", "v"}, CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe left = Dataframe::CreateFromTypedSpec(kLeftSpec, &pool);
+  for (std::optional<uint32_t> key :
+       {std::make_optional(4u), std::make_optional(1u),
+        std::optional<uint32_t>(), std::make_optional(2u),
+        std::make_optional(5u), std::make_optional(3u)}) {
+    left.InsertUnchecked(kLeftSpec, key);
+  }
+  left.Finalize();
+
+  // After removing the first two rows, the ids of the right side start at 2.
+  Dataframe right = Dataframe::CreateFromTypedSpec(kRightSpec, &pool);
+  for (int64_t i = 0; i < 5; ++i) {
+    right.InsertUnchecked(kRightSpec, std::monostate(), i * 10);
+  }
+  right.ShrinkFromFront(2);
+  right.Finalize();
+
+  EXPECT_THAT(JoinRows(left, "key", right, "id",
+                       {Left("key"), Right("id"), Right("v")}, &pool),
+              ElementsAre("4|4|40", "2|2|20", "3|3|30"));
+}
+
+constexpr auto kEncodedSpec = CreateTypedDataframeSpec(
+    {"key", "v"}, CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+    CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+
+// Returns a dataframe whose key column is dictionary encoded if |compress| is
+// true.
+Dataframe CreateEncodedKeyDataframe(StringPool* pool, bool compress) {
+  Dataframe df = Dataframe::CreateFromTypedSpec(kEncodedSpec, pool);
+  for (uint32_t i = 0; i < 4096; ++i) {
+    df.InsertUnchecked(kEncodedSpec, (i % 8) * 3, int64_t(i));
+  }
+  df.Finalize();
+  if (compress) {
+    df.CompressColumns();
+  }
+  return df;
+}
+
+TEST(HashJoinerTest, EncodedKeys) {
+  static constexpr auto kSmallSpec = CreateTypedDataframeSpec(
+      {"key"}, CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe plain = CreateEncodedKeyDataframe(&pool, false);
+  Dataframe encoded = CreateEncodedKeyDataframe(&pool, true);
+  ASSERT_STREQ(encoded.GetColumnEncoding(0), "dictionary");
+  Dataframe small = Dataframe::CreateFromTypedSpec(kSmallSpec, &pool);
+  for (int64_t key : {21, 1, 0, 3}) {
+    small.InsertUnchecked(kSmallSpec, key);
+  }
+  small.Finalize();
+
+  // Encoded key on the probe side.
+  std::vector<std::string> expected = JoinRows(
+      plain, "key", small, "key", {Left("key"), Left("v")}, &pool);
+  EXPECT_THAT(expected, SizeIs(3 * 512));
+  EXPECT_EQ(JoinRows(encoded, "key", small, "key", {Left("key"), Left("v")},
+                     &pool),
+            expected);
+
+  // Encoded key on the build side.
+  expected = JoinRows(small, "key", plain, "key", {Left("key"), Right("v")},
+                      &pool);
+  EXPECT_THAT(expected, SizeIs(3 * 512));
+  EXPECT_EQ(JoinRows(small, "key", encoded, "key", {Left("key"), Right("v")},
+                     &pool),
+            expected);
+}
+
+TEST(HashJoinerTest, StringKeys) {
+  static constexpr auto kLeftSpec = CreateTypedDataframeSpec(
+      {"name", "v"}, CreateTypedColumnSpec(String(), DenseNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  static constexpr auto kRightSpec = CreateTypedDataframeSpec(
+      {"name", "v"}, CreateTypedColumnSpec(String(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe left = Dataframe::CreateFromTypedSpec(kLeftSpec, &pool);
+  left.InsertUnchecked(kLeftSpec, std::make_optional(pool.InternString("b")),
+                       int64_t(0));
+  left.InsertUnchecked(kLeftSpec, std::nullopt, int64_t(1));
+  left.InsertUnchecked(kLeftSpec, std::make_optional(pool.InternString("a")),
+                       int64_t(2));
+  left.InsertUnchecked(kLeftSpec, std::make_optional(pool.InternString("c")),
+                       int64_t(3));
+  left.Finalize();
+  Dataframe right = Dataframe::CreateFromTypedSpec(kRightSpec, &pool);
+  right.InsertUnchecked(kRightSpec, pool.InternString("a"), int64_t(10));
+  right.InsertUnchecked(kRightSpec, pool.InternString("b"), int64_t(11));
+  right.InsertUnchecked(kRightSpec, pool.InternString("a"), int64_t(12));
+  right.Finalize();
+
+  EXPECT_THAT(JoinRows(left, "name", right, "name",
+                       {Left("name"), Left("v"), Right("v")}, &pool),
+              ElementsAre("b|0|11", "a|2|10", "a|2|12"));
+
+  // Strings can't be joined with integers.
+  auto mixed = HashJoiner::InnerJoin(left, "name", right, "v", {Left("v")},
+                                     &pool);
+  ASSERT_FALSE(mixed.ok());
+  EXPECT_THAT(mixed.status().message(),
+              HasSubstr("cannot join string column with non-string column"));
+}
+
+TEST(HashJoinerTest, NoMatches) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key"}, CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe left = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  left.InsertUnchecked(kSpec, int64_t(1));
+  left.Finalize();
+  Dataframe right = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  right.Finalize();
+
+  EXPECT_THAT(JoinRows(left, "key", right, "key", {Left("key")}, &pool),
+              IsEmpty());
+}
+
+TEST(HashJoinerTest, Errors) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key", "d"}, CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Double(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.Finalize();
+
+  auto res = HashJoiner::InnerJoin(df, "missing", df, "key", {}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("unknown left key column"));
+
+  res = HashJoiner::InnerJoin(df, "d", df, "key", {}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("cannot join on double"));
+
+  res = HashJoiner::InnerJoin(df, "key", df, "key", {Right("missing")}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("unknown right column"));
+
+  res = HashJoiner::InnerJoin(
+      df, "key", df, "key",
+      {Left("key"), {JoinSide::kRight, "key", "l_key"}}, &pool);
+  ASSERT_FALSE(res.ok());
+  EXPECT_THAT(res.status().message(), HasSubstr("duplicate output column"));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core::join
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "src/trace_processor/core/join/join_spec.h"
+
+#include <string>
+#include <utility>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/string_utils.h"
+
+namespace perfetto::trace_processor::core::join {
+
+base::StatusOr<JoinColumnSpec> ParseJoinColumnSpec(const std::string& spec) {
+  std::string trimmed = base::TrimWhitespace(spec);
+  if (trimmed.empty()) {
+    return base::ErrStatus("join spec: empty string");
+  }
+
+  // Find '.' to extract the side.
+  auto dot = trimmed.find('.');
+  if (dot == std::string::npos) {
+    return base::ErrStatus("join spec: expected '.' in '%s'", trimmed.c_str());
+  }
+  std::string side_str =
+      base::ToUpper(base::TrimWhitespace(trimmed.substr(0, dot)));
+
+  JoinSide side;
+  if (side_str == "LEFT") {
+    side = JoinSide::kLeft;
+  } else if (side_str == "RIGHT") {
+    side = JoinSide::kRight;
+  } else {
+    return base::ErrStatus("join spec: unknown side '%s'", side_str.c_str());
+  }
+
+  // The source column ends at the first whitespace, if any, which must be
+  // followed by 'AS' (case-insensitive).
+  std::string remainder = base::TrimWhitespace(trimmed.substr(dot + 1));
+  auto ws = remainder.find_first_of(" \t");
+  std::string source_col = remainder.substr(0, ws);
+  if (source_col.empty()) {
+    return base::ErrStatus("join spec: empty source column in '%s'",
+                           trimmed.c_str());
+  }
+  std::string output_col = source_col;
+  if (ws != std::string::npos) {
+    std::string alias = base::TrimWhitespace(remainder.substr(ws));
+    if (alias.size() < 3 || base::ToUpper(alias.substr(0, 2)) != "AS" ||
+        (alias[2] != ' ' && alias[2] != '\t')) {
+      return base::ErrStatus("join spec: expected 'AS' in '%s'",
+                             trimmed.c_str());
+    }
+    output_col = base::TrimWhitespace(alias.substr(2));
+  }
+
+  JoinColumnSpec result;
+  result.side = side;
+  result.source_col_name = std::move(source_col);
+  result.output_col_name = std::move(output_col);
+  return result;
+}
+
+}  // namespace perfetto::trace_processor::core::join
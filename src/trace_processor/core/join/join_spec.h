@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_JOIN_JOIN_SPEC_H_
+#define SRC_TRACE_PROCESSOR_CORE_JOIN_JOIN_SPEC_H_
+
+#include <cstdint>
+#include <string>
+
+#include "perfetto/ext/base/status_or.h"
+
+namespace perfetto::trace_processor::core::join {
+
+// Which input of a join a column is read from.
+enum class JoinSide : uint8_t {
+  kLeft,
+  kRight,
+};
+
+struct JoinColumnSpec {
+  JoinSide side;
+  std::string source_col_name;
+  std::string output_col_name;
+};
+
+// Parses a join column spec string of the form 'side.source_col' or
+// 'side.source_col AS output_col' where side is one of LEFT or RIGHT. The
+// output column has the name of the source column if there is no 'AS'.
+// Case-insensitive for the side and AS keyword.
+// Whitespace-resilient.
+base::StatusOr<JoinColumnSpec> ParseJoinColumnSpec(const std::string& spec);
+
+}  // namespace perfetto::trace_processor::core::join
+
+namespace perfetto::trace_processor {
+namespace join = core::join;
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_JOIN_JOIN_SPEC_H_
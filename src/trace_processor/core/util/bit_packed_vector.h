@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_UTIL_BIT_PACKED_VECTOR_H_
+#define SRC_TRACE_PROCESSOR_CORE_UTIL_BIT_PACKED_VECTOR_H_
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/bits.h"
+#include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/util/slab.h"
+
+namespace perfetto::trace_processor::core {
+
+// A fixed size vector of unsigned integers where every element is stored
+// using exactly `bit_width()` bits, packed back to back into 64-bit words.
+//
+// Elements are read with a couple of shifts and a mask and without any
+// branches: this makes random access cheap enough to use directly in filter
+// loops.
+class BitPackedVector {
+ public:
+  // The maximum number of bits which can be used to store a single element.
+  static constexpr uint32_t kMaxBitWidth = 32;
+
+  BitPackedVector() = default;
+
+  // Allocates a vector of `size` zeroed elements, each `bit_width` bits wide.
+  static BitPackedVector CreateWithSize(uint32_t bit_width, uint32_t size) {
+    PERFETTO_CHECK(bit_width <= kMaxBitWidth);
+    // Always allocate one word more than needed: this allows Get() to read
+    // two consecutive words without bounds checks.
+    uint64_t words = (static_cast<uint64_t>(size) * bit_width + 63) / 64 + 1;
+    BitPackedVector res(Slab<uint64_t>::Alloc(words), bit_width, size);
+    memset(res.words_.data(), 0, words * sizeof(uint64_t));
+    return res;
+  }
+
+  // Returns the minimum number of bits needed to store `value`.
+  static uint32_t BitWidthFor(uint64_t value) {
+    return 64 - base::CountLeadZeros64(value);
+  }
+
+  // Returns the element at index `i`.
+  PERFETTO_ALWAYS_INLINE uint32_t Get(uint32_t i) const {
+    PERFETTO_DCHECK(i < size_);
+    uint64_t bit = static_cast<uint64_t>(i) * bit_width_;
+    const uint64_t* w = words_.data() + bit / 64;
+    auto shift = static_cast<uint32_t>(bit % 64);
+    // The shifts of the second word are split in two so that they never shift
+    // by 64 when `shift` is zero.
+    uint64_t v = (w[0] >> shift) | ((w[1] << (63 - shift)) << 1);
+    return static_cast<uint32_t>(v & mask_);
+  }
+
+  // Sets the element at index `i` to `value`. `value` must fit in
+  // `bit_width()` bits.
+  void Set(uint32_t i, uint32_t value) {
+    PERFETTO_DCHECK(i < size_);
+    PERFETTO_DCHECK((value & ~mask_) == 0);
+    uint64_t bit = static_cast<uint64_t>(i) * bit_width_;
+    uint64_t* w = words_.data() + bit / 64;
+    auto shift = static_cast<uint32_t>(bit % 64);
+    w[0] = (w[0] & ~(mask_ << shift)) | (uint64_t(value) << shift);
+    w[1] = (w[1] & ~((mask_ >> (63 - shift)) >> 1)) |
+           ((uint64_t(value) >> (63 - shift)) >> 1);
+  }
+
+  // Returns the number of elements in the vector.
+  PERFETTO_ALWAYS_INLINE uint32_t size() const { return size_; }
+
+  // Returns the number of bits used to store each element.
+  uint32_t bit_width() const { return bit_width_; }
+
+  // Returns the number of bytes of memory used by the elements.
+  uint64_t size_bytes() const { return words_.size() * sizeof(uint64_t); }
+
+ private:
+  BitPackedVector(Slab<uint64_t> words, uint32_t bit_width, uint32_t size)
+      : words_(std::move(words)),
+        mask_((uint64_t(1) << bit_width) - 1),
+        size_(size),
+        bit_width_(bit_width) {}
+
+  Slab<uint64_t> words_;
+  uint64_t mask_ = 0;
+  uint32_t size_ = 0;
+  uint32_t bit_width_ = 0;
+};
+
+}  // namespace perfetto::trace_processor::core
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_UTIL_BIT_PACKED_VECTOR_H_
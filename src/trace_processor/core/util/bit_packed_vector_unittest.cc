@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/util/bit_packed_vector.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core {
+namespace {
+
+TEST(BitPackedVectorTest, BitWidthFor) {
+  EXPECT_EQ(BitPackedVector::BitWidthFor(0), 0u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(1), 1u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(2), 2u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(255), 8u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(256), 9u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(UINT32_MAX), 32u);
+}
+
+TEST(BitPackedVectorTest, ZeroWidth) {
+  auto v = BitPackedVector::CreateWithSize(0, 100);
+  ASSERT_EQ(v.size(), 100u);
+  for (uint32_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(v.Get(i), 0u);
+  }
+}
+
+TEST(BitPackedVectorTest, InitiallyZeroed) {
+  auto v = BitPackedVector::CreateWithSize(13, 100);
+  for (uint32_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(v.Get(i), 0u);
+  }
+}
+
+// Checks every width, including those where elements straddle two words.
+TEST(BitPackedVectorTest, SetAndGetAllWidths) {
+  for (uint32_t width = 1; width <= BitPackedVector::kMaxBitWidth; ++width) {
+    uint64_t mask = (uint64_t(1) << width) - 1;
+    auto v = BitPackedVector::CreateWithSize(width, 257);
+    std::vector<uint32_t> expected(v.size());
+    for (uint32_t i = 0; i < v.size(); ++i) {
+      expected[i] = static_cast<uint32_t>((i * 2654435761u) & mask);
+      v.Set(i, expected[i]);
+    }
+    for (uint32_t i = 0; i < v.size(); ++i) {
+      ASSERT_EQ(v.Get(i), expected[i]) << "width " << width << " index " << i;
+    }
+  }
+}
+
+TEST(BitPackedVectorTest, OverwriteDoesNotAffectNeighbours) {
+  auto v = BitPackedVector::CreateWithSize(7, 64);
+  for (uint32_t i = 0; i < v.size(); ++i) {
+    v.Set(i, 0x7f);
+  }
+  v.Set(9, 0);
+  for (uint32_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(v.Get(i), i == 9 ? 0u : 0x7fu);
+  }
+}
+
+TEST(BitPackedVectorTest, SizeBytes) {
+  auto v = BitPackedVector::CreateWithSize(4, 1000);
+  // 4000 bits round up to 63 words, plus one padding word.
+  EXPECT_EQ(v.size_bytes(), 64u * sizeof(uint64_t));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core
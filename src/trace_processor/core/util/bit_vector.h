@@ -243,6 +243,22 @@ struct BitVector {
     return BitVector(std::move(words), size_);
   }
 
+  // Creates a BitVector with `size` bits by copying the words pointed to by
+  // `words`. `words` must point to at least (size + 63) / 64 words and bits
+  // past `size` in the last word must be unset.
+  static BitVector CreateFromWords(const uint64_t* words, uint64_t size) {
+    if (size == 0) {
+      return {};
+    }
+    auto data = FlexVector<uint64_t>::CreateWithSize((size + 63u) / 64u);
+    memcpy(data.data(), words, data.size() * sizeof(uint64_t));
+    return BitVector(std::move(data), size);
+  }
+
+  // Returns a pointer to the underlying words. There are (size() + 63) / 64
+  // valid words.
+  const uint64_t* words() const { return words_.data(); }
+
   // Gathers only the bits at positions where |keep| is set into a dense
   // result of size popcount(keep). Equivalent to:
   //   result[j] = this[i]  for each i where keep[i] is set (j = 0,1,2,...)
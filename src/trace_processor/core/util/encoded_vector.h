@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_UTIL_ENCODED_VECTOR_H_
+#define SRC_TRACE_PROCESSOR_CORE_UTIL_ENCODED_VECTOR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/util/bit_packed_vector.h"
+#include "src/trace_processor/core/util/slab.h"
+
+namespace perfetto::trace_processor::core {
+
+// An immutable, compressed vector of integers. Every element is replaced by a
+// small integer "code" which is stored in a BitPackedVector. Two encodings
+// are supported:
+//  - dictionary: the code is the index of the value in a sorted dictionary
+//    of all the distinct values. Used for columns with a handful of distinct
+//    values (e.g. cpu, state, priority).
+//  - frame of reference: the code is the difference between the value and
+//    the minimum value. Used for columns where the values span a small range
+//    (e.g. sorted timestamps).
+//
+// In both cases, codes are ordered exactly like the values they represent.
+// This means that any comparison against a value can be translated to a
+// comparison against a code (see LowerBoundCode() and UpperBoundCode()) and
+// evaluated without decoding any element.
+template <typename T>
+class EncodedVector {
+ public:
+  static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+
+  enum class Encoding : uint8_t {
+    kDictionary,
+    kFrameOfReference,
+  };
+
+  // The maximum number of distinct values in a dictionary.
+  static constexpr uint32_t kMaxDictionarySize = 1u << 16;
+
+  EncodedVector() = default;
+
+  // Encodes `data` with whichever encoding uses the least memory. Returns
+  // std::nullopt if neither encoding saves at least a quarter of the memory
+  // used to store `data` directly.
+  static std::optional<EncodedVector<T>> MaybeEncode(const T* data,
+                                                     uint32_t size) {
+    if (size == 0) {
+      return std::nullopt;
+    }
+    auto [min_it, max_it] = std::minmax_element(data, data + size);
+    T min = *min_it;
+    uint64_t range = Diff(*max_it, min);
+
+    uint64_t raw_bits = uint64_t(size) * sizeof(T) * 8;
+    uint64_t best_bits = raw_bits - raw_bits / 4;
+    std::optional<Encoding> best;
+    if (range < std::numeric_limits<uint32_t>::max()) {
+      uint64_t bits = uint64_t(size) * BitPackedVector::BitWidthFor(range);
+      if (bits < best_bits) {
+        best = Encoding::kFrameOfReference;
+        best_bits = bits;
+      }
+    }
+    // Frame of reference is optimal when all the values in the range are
+    // present so only try a dictionary if there are gaps.
+    std::optional<Slab<T>> dictionary;
+    if (range > 1) {
+      dictionary = MaybeBuildDictionary(data, size);
+    }
+    if (dictionary) {
+      auto width = BitPackedVector::BitWidthFor(dictionary->size() - 1);
+      uint64_t bits =
+          uint64_t(size) * width + dictionary->size() * sizeof(T) * 8;
+      if (bits < best_bits) {
+        best = Encoding::kDictionary;
+      }
+    }
+    if (!best) {
+      return std::nullopt;
+    }
+    if (*best == Encoding::kDictionary) {
+      return EncodeDictionary(data, size, std::move(*dictionary));
+    }
+    return EncodeFrameOfReference(data, size, min, range);
+  }
+
+  // Returns the element at index `i`.
+  PERFETTO_ALWAYS_INLINE T operator[](uint32_t i) const {
+    return Decode(codes_.Get(i));
+  }
+
+  // Returns the value represented by `code`.
+  PERFETTO_ALWAYS_INLINE T Decode(uint32_t code) const {
+    return encoding_ == Encoding::kDictionary
+               ? dictionary_[code]
+               : static_cast<T>(static_cast<uint64_t>(reference_) + code);
+  }
+
+  // Writes all the elements of the vector to `out`.
+  void DecodeTo(T* out) const {
+    for (uint32_t i = 0; i < codes_.size(); ++i) {
+      out[i] = (*this)[i];
+    }
+  }
+
+  // Returns the smallest code whose value is >= `value` or code_count() if
+  // there is no such code.
+  uint32_t LowerBoundCode(T value) const {
+    if (encoding_ == Encoding::kDictionary) {
+      return static_cast<uint32_t>(
+          std::lower_bound(dictionary_.begin(), dictionary_.end(), value) -
+          dictionary_.begin());
+    }
+    if (value <= reference_) {
+      return 0;
+    }
+    return static_cast<uint32_t>(
+        std::min<uint64_t>(Diff(value, reference_), code_count_));
+  }
+
+  // Returns the smallest code whose value is > `value` or code_count() if
+  // there is no such code.
+  uint32_t UpperBoundCode(T value) const {
+    if (encoding_ == Encoding::kDictionary) {
+      return static_cast<uint32_t>(
+          std::upper_bound(dictionary_.begin(), dictionary_.end(), value) -
+          dictionary_.begin());
+    }
+    if (value < reference_) {
+      return 0;
+    }
+    uint64_t diff = Diff(value, reference_);
+    return diff >= code_count_ ? code_count_ : static_cast<uint32_t>(diff + 1);
+  }
+
+  // Returns the codes of all the elements.
+  PERFETTO_ALWAYS_INLINE const BitPackedVector& codes() const {
+    return codes_;
+  }
+
+  // Returns the number of possible codes: all codes are < code_count().
+  uint32_t code_count() const { return code_count_; }
+
+  // Returns the number of elements in the vector.
+  uint32_t size() const { return codes_.size(); }
+
+  Encoding encoding() const { return encoding_; }
+
+  // Returns the number of bytes of memory used by the vector.
+  uint64_t size_bytes() const {
+    return codes_.size_bytes() + dictionary_.size() * sizeof(T);
+  }
+
+ private:
+  EncodedVector(Encoding encoding,
+                BitPackedVector codes,
+                Slab<T> dictionary,
+                T reference,
+                uint32_t code_count)
+      : encoding_(encoding),
+        codes_(std::move(codes)),
+        dictionary_(std::move(dictionary)),
+        reference_(reference),
+        code_count_(code_count) {}
+
+  // Returns `a - b` for `a >= b` without overflowing.
+  static uint64_t Diff(T a, T b) {
+    return static_cast<uint64_t>(a) - static_cast<uint64_t>(b);
+  }
+
+  // Returns the sorted distinct values in `data` or std::nullopt if there are
+  // more than kMaxDictionarySize of them.
+  static std::optional<Slab<T>> MaybeBuildDictionary(const T* data,
+                                                     uint32_t size) {
+    base::FlatHashMap<T, uint32_t> distinct;
+    for (uint32_t i = 0; i < size; ++i) {
+      distinct.Insert(data[i], 0);
+      if (distinct.size() > kMaxDictionarySize) {
+        return std::nullopt;
+      }
+    }
+    auto dictionary = Slab<T>::Alloc(distinct.size());
+    uint32_t i = 0;
+    for (auto it = distinct.GetIterator(); it; ++it) {
+      dictionary[i++] = it.key();
+    }
+    std::sort(dictionary.begin(), dictionary.end());
+    return dictionary;
+  }
+
+  static EncodedVector<T> EncodeDictionary(const T* data,
+                                           uint32_t size,
+                                           Slab<T> dictionary) {
+    auto count = static_cast<uint32_t>(dictionary.size());
+    base::FlatHashMap<T, uint32_t> code_for_value;
+    for (uint32_t i = 0; i < count; ++i) {
+      code_for_value.Insert(dictionary[i], i);
+    }
+    auto codes = BitPackedVector::CreateWithSize(
+        BitPackedVector::BitWidthFor(count - 1), size);
+    for (uint32_t i = 0; i < size; ++i) {
+      codes.Set(i, *code_for_value.Find(data[i]));
+    }
+    return EncodedVector<T>(Encoding::kDictionary, std::move(codes),
+                            std::move(dictionary), T(), count);
+  }
+
+  static EncodedVector<T> EncodeFrameOfReference(const T* data,
+                                                 uint32_t size,
+                                                 T min,
+                                                 uint64_t range) {
+    auto codes = BitPackedVector::CreateWithSize(
+        BitPackedVector::BitWidthFor(range), size);
+    for (uint32_t i = 0; i < size; ++i) {
+      codes.Set(i, static_cast<uint32_t>(Diff(data[i], min)));
+    }
+    return EncodedVector<T>(Encoding::kFrameOfReference, std::move(codes),
+                            Slab<T>(), min,
+                            static_cast<uint32_t>(range + 1));
+  }
+
+  Encoding encoding_ = Encoding::kFrameOfReference;
+  BitPackedVector codes_;
+  // Only used for kDictionary.
+  Slab<T> dictionary_;
+  // Only used for kFrameOfReference.
+  T reference_ = 0;
+  uint32_t code_count_ = 0;
+};
+
+}  // namespace perfetto::trace_processor::core
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_UTIL_ENCODED_VECTOR_H_
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/util/encoded_vector.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core {
+namespace {
+
+template <typename T>
+std::vector<T> Decode(const EncodedVector<T>& v) {
+  std::vector<T> res(v.size());
+  v.DecodeTo(res.data());
+  return res;
+}
+
+TEST(EncodedVectorTest, EmptyIsNotEncoded) {
+  EXPECT_FALSE(EncodedVector<uint32_t>::MaybeEncode(nullptr, 0).has_value());
+}
+
+TEST(EncodedVectorTest, FrameOfReference) {
+  std::vector<int64_t> data;
+  for (int64_t i = 0; i < 1000; ++i) {
+    data.push_back(1'000'000'000'000 + i * 3);
+  }
+  auto v = EncodedVector<int64_t>::MaybeEncode(
+      data.data(), static_cast<uint32_t>(data.size()));
+  ASSERT_TRUE(v.has_value());
+  EXPECT_EQ(v->encoding(), EncodedVector<int64_t>::Encoding::kFrameOfReference);
+  EXPECT_EQ(v->codes().bit_width(), 12u);
+  EXPECT_EQ(Decode(*v), data);
+  EXPECT_LT(v->size_bytes(), data.size() * sizeof(int64_t) / 4);
+}
+
+TEST(EncodedVectorTest, Dictionary) {
+  std::vector<int32_t> data;
+  for (int32_t i = 0; i < 1000; ++i) {
+    data.push_back(i % 3 == 0 ? -1'000'000 : (i % 3 == 1 ? 7 : 1'000'000));
+  }
+  auto v = EncodedVector<int32_t>::MaybeEncode(
+      data.data(), static_cast<uint32_t>(data.size()));
+  ASSERT_TRUE(v.has_value());
+  EXPECT_EQ(v->encoding(), EncodedVector<int32_t>::Encoding::kDictionary);
+  EXPECT_EQ(v->codes().bit_width(), 2u);
+  EXPECT_EQ(v->code_count(), 3u);
+  EXPECT_EQ(Decode(*v), data);
+
+  // Codes should be ordered like the values.
+  EXPECT_EQ(v->codes().Get(0), 0u);
+  EXPECT_EQ(v->codes().Get(1), 1u);
+  EXPECT_EQ(v->codes().Get(2), 2u);
+}
+
+TEST(EncodedVectorTest, Constant) {
+  std::vector<uint32_t> data(100, 42);
+  auto v = EncodedVector<uint32_t>::MaybeEncode(
+      data.data(), static_cast<uint32_t>(data.size()));
+  ASSERT_TRUE(v.has_value());
+  EXPECT_EQ(v->codes().bit_width(), 0u);
+  EXPECT_EQ(Decode(*v), data);
+}
+
+TEST(EncodedVectorTest, IncompressibleIsNotEncoded) {
+  std::vector<uint32_t> data;
+  for (uint32_t i = 0; i < EncodedVector<uint32_t>::kMaxDictionarySize + 10;
+       ++i) {
+    data.push_back(i * 2654435761u);
+  }
+  EXPECT_FALSE(EncodedVector<uint32_t>::MaybeEncode(
+                   data.data(), static_cast<uint32_t>(data.size()))
+                   .has_value());
+}
+
+TEST(EncodedVectorTest, ExtremeValues) {
+  std::vector<int64_t> data;
+  for (uint32_t i = 0; i < 100; ++i) {
+    data.push_back(i % 2 ? std::numeric_limits<int64_t>::max()
+                         : std::numeric_limits<int64_t>::min());
+  }
+  auto v = EncodedVector<int64_t>::MaybeEncode(
+      data.data(), static_cast<uint32_t>(data.size()));
+  ASSERT_TRUE(v.has_value());
+  EXPECT_EQ(v->encoding(), EncodedVector<int64_t>::Encoding::kDictionary);
+  EXPECT_EQ(Decode(*v), data);
+}
+
+TEST(EncodedVectorTest, BoundCodesFrameOfReference) {
+  std::vector<int32_t> data;
+  for (int32_t i = 0; i < 100; ++i) {
+    data.push_back(-10 + i % 20);
+  }
+  auto v = EncodedVector<int32_t>::MaybeEncode(
+      data.data(), static_cast<uint32_t>(data.size()));
+  ASSERT_TRUE(v.has_value());
+  ASSERT_EQ(v->encoding(),
+            EncodedVector<int32_t>::Encoding::kFrameOfReference);
+  ASSERT_EQ(v->code_count(), 20u);
+
+  EXPECT_EQ(v->LowerBoundCode(std::numeric_limits<int32_t>::min()), 0u);
+  EXPECT_EQ(v->LowerBoundCode(-10), 0u);
+  EXPECT_EQ(v->LowerBoundCode(-9), 1u);
+  EXPECT_EQ(v->LowerBoundCode(9), 19u);
+  EXPECT_EQ(v->LowerBoundCode(10), 20u);
+  EXPECT_EQ(v->LowerBoundCode(std::numeric_limits<int32_t>::max()), 20u);
+
+  EXPECT_EQ(v->UpperBoundCode(std::numeric_limits<int32_t>::min()), 0u);
+  EXPECT_EQ(v->UpperBoundCode(-11), 0u);
+  EXPECT_EQ(v->UpperBoundCode(-10), 1u);
+  EXPECT_EQ(v->UpperBoundCode(8), 19u);
+  EXPECT_EQ(v->UpperBoundCode(9), 20u);
+  EXPECT_EQ(v->UpperBoundCode(std::numeric_limits<int32_t>::max()), 20u);
+}
+
+TEST(EncodedVectorTest, BoundCodesDictionary) {
+  std::vector<uint32_t> data;
+  for (uint32_t i = 0; i < 100; ++i) {
+    data.push_back((i % 4) * 100);
+  }
+  auto v = EncodedVector<uint32_t>::MaybeEncode(
+      data.data(), static_cast<uint32_t>(data.size()));
+  ASSERT_TRUE(v.has_value());
+  ASSERT_EQ(v->encoding(), EncodedVector<uint32_t>::Encoding::kDictionary);
+
+  EXPECT_EQ(v->LowerBoundCode(0), 0u);
+  EXPECT_EQ(v->LowerBoundCode(50), 1u);
+  EXPECT_EQ(v->LowerBoundCode(100), 1u);
+  EXPECT_EQ(v->LowerBoundCode(301), 4u);
+
+  EXPECT_EQ(v->UpperBoundCode(0), 1u);
+  EXPECT_EQ(v->UpperBoundCode(50), 1u);
+  EXPECT_EQ(v->UpperBoundCode(100), 2u);
+  EXPECT_EQ(v->UpperBoundCode(300), 4u);
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core
@@ -33,8 +33,11 @@ namespace trace_processor {
 // trace packet defaults.
 class PacketSequenceStateBuilder {
  public:
-  explicit PacketSequenceStateBuilder(TraceProcessorContext* context) {
-    generation_ = PacketSequenceStateGeneration::CreateFirst(context);
+  explicit PacketSequenceStateBuilder(
+      TraceProcessorContext* context,
+      SharedInternedDataMap* shared_interned_data = nullptr) {
+    generation_ = PacketSequenceStateGeneration::CreateFirst(
+        context, shared_interned_data);
   }
 
   // Intern a message into the current generation.
@@ -42,6 +45,12 @@ class PacketSequenceStateBuilder {
     generation_->InternMessage(field_id, std::move(message));
   }
 
+  // Intern a message into the interned data shared by all the sequences with
+  // the same scope as this one (see TracePacket.SEQ_SHARED_INTERNED_DATA).
+  void InternSharedMessage(uint32_t field_id, TraceBlobView message) {
+    generation_->InternSharedMessage(field_id, std::move(message));
+  }
+
   // Set the trace packet defaults for the current generation. If the current
   // generation already has defaults set, starts a new generation without
   // invalidating other incremental state (such as interned data).
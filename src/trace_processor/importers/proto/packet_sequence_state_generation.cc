@@ -28,20 +28,25 @@ PacketSequenceStateGeneration::CustomState::~CustomState() = default;
 
 // static
 RefPtr<PacketSequenceStateGeneration>
-PacketSequenceStateGeneration::CreateFirst(TraceProcessorContext* context) {
+PacketSequenceStateGeneration::CreateFirst(
+    TraceProcessorContext* context,
+    SharedInternedDataMap* shared_interned_data) {
   return RefPtr<PacketSequenceStateGeneration>(
-      new PacketSequenceStateGeneration(
-          context, TrackEventSequenceState::CreateFirst(), false));
+      new PacketSequenceStateGeneration(context, shared_interned_data,
+                                        TrackEventSequenceState::CreateFirst(),
+                                        false));
 }
 
 PacketSequenceStateGeneration::PacketSequenceStateGeneration(
     TraceProcessorContext* context,
+    SharedInternedDataMap* shared_interned_data,
     InternedFieldMap interned_data,
     TrackEventSequenceState track_event_sequence_state,
     CustomStateArray custom_state,
     TraceBlobView trace_packet_defaults,
     bool is_incremental_state_valid)
     : context_(context),
+      shared_interned_data_(shared_interned_data),
       interned_data_(std::move(interned_data)),
       track_event_sequence_state_(std::move(track_event_sequence_state)),
       custom_state_(std::move(custom_state)),
@@ -71,8 +76,8 @@ RefPtr<PacketSequenceStateGeneration>
 PacketSequenceStateGeneration::OnIncrementalStateCleared() {
   return RefPtr<PacketSequenceStateGeneration>(
       new PacketSequenceStateGeneration(
-          context_, track_event_sequence_state_.OnIncrementalStateCleared(),
-          true));
+          context_, shared_interned_data_,
+          track_event_sequence_state_.OnIncrementalStateCleared(), true));
 }
 
 RefPtr<PacketSequenceStateGeneration>
@@ -80,7 +85,7 @@ PacketSequenceStateGeneration::OnNewTracePacketDefaults(
     TraceBlobView trace_packet_defaults) {
   return RefPtr<PacketSequenceStateGeneration>(
       new PacketSequenceStateGeneration(
-          context_, interned_data_,
+          context_, shared_interned_data_, interned_data_,
           track_event_sequence_state_.OnIncrementalStateCleared(),
           custom_state_, std::move(trace_packet_defaults),
           is_incremental_state_valid_));
@@ -98,12 +103,52 @@ InternedMessageView* PacketSequenceStateGeneration::GetInternedMessageView(
     }
   }
 
+  if (InternedFieldMap* shared = GetSharedInternedData(); shared) {
+    auto shared_field_it = shared->find(field_id);
+    if (shared_field_it != shared->end()) {
+      auto it = shared_field_it->second.find(iid);
+      if (it != shared_field_it->second.end()) {
+        return &it->second;
+      }
+    }
+  }
+
   context_->storage->IncrementStats(stats::interned_data_tokenizer_errors);
   return nullptr;
 }
 
 void PacketSequenceStateGeneration::InternMessage(uint32_t field_id,
                                                   TraceBlobView message) {
+  InternMessageInto(&interned_data_, field_id, std::move(message));
+}
+
+void PacketSequenceStateGeneration::InternSharedMessage(
+    uint32_t field_id,
+    TraceBlobView message) {
+  InternedFieldMap* shared = GetSharedInternedData();
+  if (PERFETTO_UNLIKELY(!shared)) {
+    PERFETTO_DLOG("Shared interned data on a sequence without a scope");
+    context_->storage->IncrementStats(stats::interned_data_tokenizer_errors);
+    return;
+  }
+  InternMessageInto(shared, field_id, std::move(message));
+}
+
+InternedFieldMap* PacketSequenceStateGeneration::GetSharedInternedData() {
+  if (!shared_interned_data_) {
+    return nullptr;
+  }
+  auto* defaults = GetTracePacketDefaults();
+  if (!defaults || !defaults->has_shared_interned_data_scope()) {
+    return nullptr;
+  }
+  return &(*shared_interned_data_)[defaults->shared_interned_data_scope()];
+}
+
+void PacketSequenceStateGeneration::InternMessageInto(
+    InternedFieldMap* interned_data,
+    uint32_t field_id,
+    TraceBlobView message) {
   constexpr auto kIidFieldNumber = 1;
 
   uint64_t iid = 0;
@@ -119,7 +164,7 @@ void PacketSequenceStateGeneration::InternMessage(uint32_t field_id,
   }
   iid = field.as_uint64();
 
-  auto res = interned_data_[field_id].emplace(
+  auto res = (*interned_data)[field_id].emplace(
       iid, InternedMessageView(std::move(message)));
 
   // If a message with this ID is already interned in the same generation,
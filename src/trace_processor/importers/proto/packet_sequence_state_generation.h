@@ -42,6 +42,11 @@ using InternedMessageMap =
     std::unordered_map<uint64_t /*iid*/, InternedMessageView>;
 using InternedFieldMap =
     std::unordered_map<uint32_t /*field_id*/, InternedMessageMap>;
+// Interned data emitted with TracePacket.SEQ_SHARED_INTERNED_DATA, which is
+// visible to all the sequences that declare the same
+// TracePacketDefaults.shared_interned_data_scope.
+using SharedInternedDataMap =
+    std::unordered_map<uint64_t /*scope*/, InternedFieldMap>;
 
 class TraceProcessorContext;
 
@@ -131,8 +136,12 @@ class PacketSequenceStateGeneration : public RefCounted {
     using Tracker = void;
   };
 
+  // |shared_interned_data| is owned by the caller and outlives all the
+  // generations of the sequence. If null, interning ids are only looked up
+  // in the interned data of the sequence itself.
   static RefPtr<PacketSequenceStateGeneration> CreateFirst(
-      TraceProcessorContext* context);
+      TraceProcessorContext* context,
+      SharedInternedDataMap* shared_interned_data = nullptr);
 
   RefPtr<PacketSequenceStateGeneration> OnPacketLoss();
 
@@ -148,7 +157,9 @@ class PacketSequenceStateGeneration : public RefCounted {
   int64_t tid() const { return track_event_sequence_state_.tid(); }
 
   // Returns |nullptr| if the message with the given |iid| was not found (also
-  // records a stat in this case).
+  // records a stat in this case). Interning ids that the sequence doesn't
+  // define are looked up in the interned data shared with the other sequences
+  // of its scope, if any.
   template <uint32_t FieldId, typename MessageType>
   typename MessageType::Decoder* LookupInternedMessage(uint64_t iid) {
     auto* interned_message_view = GetInternedMessageView(FieldId, iid);
@@ -277,14 +288,17 @@ class PacketSequenceStateGeneration : public RefCounted {
   }
 
   PacketSequenceStateGeneration(TraceProcessorContext* context,
+                                SharedInternedDataMap* shared_interned_data,
                                 TrackEventSequenceState track_state,
                                 bool is_incremental_state_valid)
       : context_(context),
+        shared_interned_data_(shared_interned_data),
         track_event_sequence_state_(std::move(track_state)),
         is_incremental_state_valid_(is_incremental_state_valid) {}
 
   PacketSequenceStateGeneration(
       TraceProcessorContext* context,
+      SharedInternedDataMap* shared_interned_data,
       InternedFieldMap interned_data,
       TrackEventSequenceState track_event_sequence_state,
       CustomStateArray custom_state,
@@ -297,7 +311,20 @@ class PacketSequenceStateGeneration : public RefCounted {
   // data out of trace packets.
   void InternMessage(uint32_t field_id, TraceBlobView message);
 
+  // Same as above for interned data emitted with SEQ_SHARED_INTERNED_DATA,
+  // which is added to the scope of the sequence instead.
+  void InternSharedMessage(uint32_t field_id, TraceBlobView message);
+
+  // Returns the shared interned data of the scope of this sequence, or
+  // |nullptr| if the sequence doesn't have one.
+  InternedFieldMap* GetSharedInternedData();
+
+  void InternMessageInto(InternedFieldMap* interned_data,
+                         uint32_t field_id,
+                         TraceBlobView message);
+
   TraceProcessorContext* const context_;
+  SharedInternedDataMap* const shared_interned_data_;
   InternedFieldMap interned_data_;
   TrackEventSequenceState track_event_sequence_state_;
   CustomStateArray custom_state_;
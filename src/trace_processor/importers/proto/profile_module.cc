@@ -252,6 +252,35 @@ void ProfileModule::ParsePerfSample(
     return;
   }
 
+  // Not a sample, but the stats of one of the profiler's unwinder threads.
+  // The stats are cumulative, so a later packet overrides an earlier one.
+  if (sample.has_unwinder_stats()) {
+    PerfSample::UnwinderStats::Decoder unwinder_stats(sample.unwinder_stats());
+    auto* storage = context_->storage.get();
+    int index = static_cast<int>(unwinder_stats.unwinder_index());
+    storage->SetIndexedStats(
+        stats::perf_unwinder_samples_unwound, index,
+        static_cast<int64_t>(unwinder_stats.samples_unwound()));
+    storage->SetIndexedStats(
+        stats::perf_unwinder_max_queue_depth, index,
+        static_cast<int64_t>(unwinder_stats.max_queue_depth()));
+    storage->SetIndexedStats(
+        stats::perf_unwinder_unwind_time_total_us, index,
+        static_cast<int64_t>(unwinder_stats.unwind_time_total_us()));
+    storage->SetIndexedStats(
+        stats::perf_unwinder_unwind_time_max_us, index,
+        static_cast<int64_t>(unwinder_stats.unwind_time_max_us()));
+    if (unwinder_stats.has_elf_cache_hits()) {
+      storage->SetIndexedStats(
+          stats::perf_unwinder_elf_cache_hits, index,
+          static_cast<int64_t>(unwinder_stats.elf_cache_hits()));
+      storage->SetIndexedStats(
+          stats::perf_unwinder_elf_cache_misses, index,
+          static_cast<int64_t>(unwinder_stats.elf_cache_misses()));
+    }
+    return;
+  }
+
   // Sample has incomplete stack sampling payload (not necessarily an error).
   if (sample.has_sample_skipped_reason()) {
     switch (sample.sample_skipped_reason()) {
@@ -180,6 +180,13 @@ ProtoTraceReader::ProtoTraceReader(TraceProcessorContext* ctx)
     return context_->sorter->CreateStream(
         std::make_unique<InlineSchedWakingSink>(parser_.get(), cpu));
   };
+  if (context_->ingestion_thread_pool) {
+    // Allow twice as many packets as threads to be in flight so the workers
+    // don't go idle while this thread is parsing the output of one of them.
+    tokenizer_.EnableParallelDecompression(
+        context_->ingestion_thread_pool.get(),
+        2 * context_->config.ingestion_thread_count);
+  }
   RegisterDefaultModules(&module_context_, context_);
   if (context_->register_additional_proto_modules) {
     context_->register_additional_proto_modules(&module_context_, context_);
@@ -616,12 +623,20 @@ void ProtoTraceReader::ParseInternedData(
     return;
   }
 
-  // Store references to interned data submessages into the sequence's state.
+  // Store references to interned data submessages into the sequence's state,
+  // or into the state shared with the other sequences of the same scope.
+  bool shared = packet_decoder.sequence_flags() &
+                protos::pbzero::TracePacket::SEQ_SHARED_INTERNED_DATA;
   protozero::ProtoDecoder decoder(interned_data.data(), interned_data.length());
   for (protozero::Field f = decoder.ReadField(); f.valid();
        f = decoder.ReadField()) {
     auto bytes = f.as_bytes();
-    state->InternMessage(f.id(), interned_data.slice(bytes.data, bytes.size));
+    auto message = interned_data.slice(bytes.data, bytes.size);
+    if (shared) {
+      state->InternSharedMessage(f.id(), std::move(message));
+    } else {
+      state->InternMessage(f.id(), std::move(message));
+    }
   }
 }
 
@@ -966,6 +981,31 @@ void ProtoTraceReader::ParseTraceStats(ConstBytes blob) {
     }
   }
 
+  if (evt.has_write_into_file_stats()) {
+    protos::pbzero::TraceStats::WriteIntoFileStats::Decoder wstat(
+        evt.write_into_file_stats());
+    storage->SetStats(stats::traced_write_into_file_bytes_copied,
+                      static_cast<int64_t>(wstat.bytes_copied()));
+    storage->SetStats(stats::traced_write_into_file_bytes_zero_copy,
+                      static_cast<int64_t>(wstat.bytes_zero_copy()));
+    storage->SetStats(stats::traced_write_into_file_max_queued_bytes,
+                      static_cast<int64_t>(wstat.max_queued_bytes()));
+    storage->SetStats(stats::traced_write_into_file_queue_full_events,
+                      static_cast<int64_t>(wstat.queue_full_events()));
+    storage->SetStats(stats::traced_write_into_file_writev_calls,
+                      static_cast<int64_t>(wstat.writev_calls()));
+  }
+
+  if (evt.has_commit_stats()) {
+    protos::pbzero::TraceStats::CommitStats::Decoder cstat(evt.commit_stats());
+    storage->SetStats(stats::traced_commit_data_requests,
+                      static_cast<int64_t>(cstat.commit_data_requests()));
+    storage->SetStats(stats::traced_commit_chunks_committed,
+                      static_cast<int64_t>(cstat.chunks_committed()));
+    storage->SetStats(stats::traced_commit_duration_ms,
+                      static_cast<int64_t>(cstat.duration_ms()));
+  }
+
   switch (evt.final_flush_outcome()) {
     case protos::pbzero::TraceStats::FINAL_FLUSH_SUCCEEDED:
       storage->IncrementStats(stats::traced_final_flush_succeeded, 1);
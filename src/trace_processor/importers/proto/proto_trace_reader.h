@@ -129,7 +129,7 @@ class ProtoTraceReader : public ChunkedTraceReader {
       uint32_t sequence_id) {
     auto& builder = sequence_state_.Find(sequence_id)->sequence_state_builder;
     if (!builder) {
-      builder = PacketSequenceStateBuilder(context_);
+      builder = PacketSequenceStateBuilder(context_, &shared_interned_data_);
     }
     return &*builder;
   }
@@ -148,6 +148,9 @@ class ProtoTraceReader : public ChunkedTraceReader {
   int64_t latest_timestamp_ = 0;
 
   base::FlatHashMap<uint32_t, SequenceScopedState> sequence_state_;
+  // Interned data shared by the sequences of a process, by scope. Referenced
+  // by the PacketSequenceStateGenerations of all the sequences.
+  SharedInternedDataMap shared_interned_data_;
   StringId skipped_packet_key_id_;
   StringId invalid_incremental_state_key_id_;
   StringId packet_sequence_id_key_id_;
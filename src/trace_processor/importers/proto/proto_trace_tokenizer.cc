@@ -15,36 +15,137 @@
  */
 
 #include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
-#include "perfetto/trace_processor/trace_blob.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/utils.h"
+#include "perfetto/protozero/field.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+#include "src/trace_processor/util/gzip_utils.h"
+#include "src/trace_processor/util/zstd_utils.h"
 
 namespace perfetto {
 namespace trace_processor {
 
 ProtoTraceTokenizer::ProtoTraceTokenizer() = default;
 
-base::Status ProtoTraceTokenizer::Decompress(TraceBlobView input,
-                                             TraceBlobView* output) {
+ProtoTraceTokenizer::~ProtoTraceTokenizer() {
+  // Tokenize() never returns with decompression tasks in flight.
+  PERFETTO_DCHECK(tasks_in_flight_ == 0);
+}
+
+void ProtoTraceTokenizer::EnableParallelDecompression(
+    base::ThreadPool* pool,
+    uint32_t max_tasks_in_flight) {
+  PERFETTO_CHECK(pending_packets_.empty());
+  pool_ = pool;
+  max_tasks_in_flight_ = std::max(max_tasks_in_flight, 1u);
+}
+
+base::Status ProtoTraceTokenizer::EnqueuePacket(TraceBlobView packet) {
+  protos::pbzero::TracePacket::Decoder decoder(packet.data(), packet.length());
+  if (!decoder.has_compressed_packets()) {
+    pending_packets_.push_back(PendingPacket{std::move(packet), nullptr});
+    return base::OkStatus();
+  }
+
+  protozero::ConstBytes field = decoder.compressed_packets();
+  RETURN_IF_ERROR(CheckDecompressionSupported(field));
+  auto task = std::make_unique<DecompressionTask>();
+  task->input = field.data;
+  task->input_size = field.size;
+
+  DecompressionTask* raw_task = task.get();
+  pending_packets_.push_back(
+      PendingPacket{packet.slice(field.data, field.size), std::move(task)});
+  ++tasks_in_flight_;
+  pool_->PostTask([raw_task] {
+    // Decompressors are cheap compared to the size of a typical
+    // |compressed_packets| field so just create one per task rather than
+    // pinning one to each thread of the pool.
+    util::GzipDecompressor decompressor;
+    raw_task->status = Decompress(&decompressor, raw_task->input,
+                                  raw_task->input_size, &raw_task->output);
+    raw_task->done.store(true, std::memory_order_release);
+    raw_task->done_event.Notify();
+  });
+  return base::OkStatus();
+}
+
+void ProtoTraceTokenizer::DiscardPendingPackets() {
+  for (PendingPacket& pending : pending_packets_) {
+    if (pending.task) {
+      pending.task->done_event.Wait();
+      --tasks_in_flight_;
+    }
+  }
+  pending_packets_.clear();
+  PERFETTO_DCHECK(tasks_in_flight_ == 0);
+}
+
+base::Status ProtoTraceTokenizer::CheckDecompressionSupported(
+    protozero::ConstBytes compressed_packets) {
+  if (util::IsZstdFrame(compressed_packets.data, compressed_packets.size)) {
+    if (!util::IsZstdSupported()) {
+      return base::ErrStatus(
+          "Cannot decode zstd compressed packets. Zstd not enabled");
+    }
+    return base::OkStatus();
+  }
+  if (!util::IsGzipSupported()) {
+    return base::ErrStatus(
+        "Cannot decode compressed packets. Zlib not enabled");
+  }
+  return base::OkStatus();
+}
+
+base::Status ProtoTraceTokenizer::Decompress(
+    util::GzipDecompressor* decompressor,
+    const uint8_t* data,
+    size_t size,
+    std::vector<uint8_t>* output) {
+  if (util::IsZstdFrame(data, size)) {
+    PERFETTO_DCHECK(util::IsZstdSupported());
+    if (!util::ZstdDecompressFully(data, size, output))
+      return base::ErrStatus("Failed to decompress zstd compressed packets");
+    return base::OkStatus();
+  }
+
   PERFETTO_DCHECK(util::IsGzipSupported());
 
-  std::vector<uint8_t> data;
-  data.reserve(input.length());
+  output->reserve(size);
 
   // Ensure that the decompressor is able to cope with a new stream of data.
-  decompressor_.Reset();
+  decompressor->Reset();
   using ResultCode = util::GzipDecompressor::ResultCode;
-  ResultCode ret = decompressor_.FeedAndExtract(
-      input.data(), input.length(),
-      [&data](const uint8_t* buffer, size_t buffer_len) {
-        data.insert(data.end(), buffer, buffer + buffer_len);
+  ResultCode ret = decompressor->FeedAndExtract(
+      data, size, [output](const uint8_t* buffer, size_t buffer_len) {
+        output->insert(output->end(), buffer, buffer + buffer_len);
       });
 
   if (ret == ResultCode::kError || ret == ResultCode::kNeedsMoreInput) {
     return base::ErrStatus("Failed to decompress (error code: %d)",
                            static_cast<int>(ret));
   }
+  return base::OkStatus();
+}
 
+base::Status ProtoTraceTokenizer::Decompress(TraceBlobView input,
+                                             TraceBlobView* output) {
+  std::vector<uint8_t> data;
+  RETURN_IF_ERROR(
+      Decompress(&decompressor_, input.data(), input.length(), &data));
   TraceBlob out_blob = TraceBlob::CopyFrom(data.data(), data.size());
   *output = TraceBlobView(std::move(out_blob));
   return base::OkStatus();
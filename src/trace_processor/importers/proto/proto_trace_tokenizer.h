@@ -18,10 +18,14 @@
 #define SRC_TRACE_PROCESSOR_IMPORTERS_PROTO_PROTO_TRACE_TOKENIZER_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
@@ -33,9 +37,14 @@
 #include "src/trace_processor/util/gzip_utils.h"
 
 #include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/waitable_event.h"
 #include "protos/perfetto/trace/trace.pbzero.h"
 #include "src/trace_processor/util/trace_blob_view_reader.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
 // Reads a protobuf trace in chunks and extracts boundaries of trace packets
@@ -43,9 +52,66 @@ namespace perfetto::trace_processor {
 class ProtoTraceTokenizer {
  public:
   ProtoTraceTokenizer();
+  ~ProtoTraceTokenizer();
+
+  // Makes the tokenizer decompress |compressed_packets| on the threads of
+  // |pool| instead of on the calling thread, with at most
+  // |max_tasks_in_flight| packets being decompressed at any time.
+  //
+  // Packets are still passed to the Tokenize() callback on the calling thread
+  // and in exactly the same order as when decompressing serially. All the
+  // decompression tasks started by a Tokenize() call are completed before it
+  // returns.
+  void EnableParallelDecompression(base::ThreadPool* pool,
+                                   uint32_t max_tasks_in_flight);
 
   template <typename Callback = base::Status(TraceBlobView)>
   base::Status Tokenize(TraceBlobView tbv, Callback callback) {
+    if (!pool_) {
+      return SplitIntoPackets(std::move(tbv), [&](TraceBlobView packet) {
+        return HandlePacket(std::move(packet), callback);
+      });
+    }
+    base::Status status =
+        SplitIntoPackets(std::move(tbv), [&](TraceBlobView packet) {
+          RETURN_IF_ERROR(EnqueuePacket(std::move(packet)));
+          return EmitPendingPackets(callback, /*wait_for_all=*/false);
+        });
+    // The packets which were split off before any error would have been
+    // passed to |callback| by the serial path so do the same here.
+    RETURN_IF_ERROR(EmitPendingPackets(callback, /*wait_for_all=*/true));
+    return status;
+  }
+
+ private:
+  // A |compressed_packets| blob being decompressed on |pool_|. Only raw
+  // pointers are handed to the worker thread as TraceBlobView refcounting is
+  // not thread-safe: the memory is kept alive by the owning PendingPacket.
+  struct DecompressionTask {
+    const uint8_t* input = nullptr;
+    size_t input_size = 0;
+
+    // Written by the worker thread before setting |done|.
+    std::vector<uint8_t> output;
+    base::Status status;
+
+    std::atomic<bool> done{false};
+    base::WaitableEvent done_event;
+  };
+
+  // A packet split off the trace but not passed to the callback yet.
+  struct PendingPacket {
+    // Either the whole packet (if |task| is null) or its |compressed_packets|
+    // field.
+    TraceBlobView packet;
+    std::unique_ptr<DecompressionTask> task;
+  };
+
+  // Splits the trace into top-level TracePackets and passes each of them to
+  // |callback|. Packets spanning across |tbv| boundaries are buffered until
+  // the next call.
+  template <typename Callback>
+  base::Status SplitIntoPackets(TraceBlobView tbv, Callback callback) {
     reader_.PushBack(std::move(tbv));
 
     for (;;) {
@@ -174,58 +240,132 @@ class ProtoTraceTokenizer {
       auto packet = reader_.SliceOff(start_offset + hdr_size, field_size);
       PERFETTO_CHECK(packet);
       PERFETTO_CHECK(reader_.PopFrontBytes(hdr_size + field_size));
-      protos::pbzero::TracePacket::Decoder decoder(packet->data(),
-                                                   packet->length());
-      if (!decoder.has_compressed_packets()) {
-        RETURN_IF_ERROR(callback(std::move(*packet)));
-        continue;
-      }
+      RETURN_IF_ERROR(callback(std::move(*packet)));
+    }
+  }
+
+  // Passes |packet| to |callback|, first decompressing it on the calling
+  // thread if it contains |compressed_packets|.
+  template <typename Callback>
+  base::Status HandlePacket(TraceBlobView packet, Callback& callback) {
+    protos::pbzero::TracePacket::Decoder decoder(packet.data(),
+                                                 packet.length());
+    if (!decoder.has_compressed_packets()) {
+      return callback(std::move(packet));
+    }
 
-      if (!util::IsGzipSupported()) {
-        return base::ErrStatus(
-            "Cannot decode compressed packets. Zlib not enabled");
+    protozero::ConstBytes field = decoder.compressed_packets();
+    RETURN_IF_ERROR(CheckDecompressionSupported(field));
+    TraceBlobView compressed_packets = packet.slice(field.data, field.size);
+    TraceBlobView packets;
+    RETURN_IF_ERROR(Decompress(std::move(compressed_packets), &packets));
+    return ForEachDecompressedPacket(packets, callback);
+  }
+
+  // Passes each of the TracePackets in the decompressed |packets| blob to
+  // |callback|.
+  template <typename Callback>
+  static base::Status ForEachDecompressedPacket(const TraceBlobView& packets,
+                                                Callback& callback) {
+    const uint8_t* start = packets.data();
+    const uint8_t* end = packets.data() + packets.length();
+    const uint8_t* ptr = start;
+    while ((end - ptr) > 2) {
+      const uint8_t* packet_outer = ptr;
+      if (PERFETTO_UNLIKELY(*ptr != kTracePacketTag)) {
+        return base::ErrStatus("Expected TracePacket tag");
       }
+      uint64_t packet_size = 0;
+      ptr = protozero::proto_utils::ParseVarInt(++ptr, end, &packet_size);
+      const uint8_t* packet_start = ptr;
+      ptr += packet_size;
+      if (PERFETTO_UNLIKELY((ptr - packet_outer) < 2 || ptr > end)) {
+        return base::ErrStatus("Invalid packet size");
+      }
+      TraceBlobView sliced =
+          packets.slice(packet_start, static_cast<size_t>(packet_size));
+      RETURN_IF_ERROR(callback(std::move(sliced)));
+    }
+    return base::OkStatus();
+  }
 
-      protozero::ConstBytes field = decoder.compressed_packets();
-      TraceBlobView compressed_packets = packet->slice(field.data, field.size);
-      TraceBlobView packets;
-      RETURN_IF_ERROR(Decompress(std::move(compressed_packets), &packets));
-
-      const uint8_t* start = packets.data();
-      const uint8_t* end = packets.data() + packets.length();
-      const uint8_t* ptr = start;
-      while ((end - ptr) > 2) {
-        const uint8_t* packet_outer = ptr;
-        if (PERFETTO_UNLIKELY(*ptr != kTracePacketTag)) {
-          return base::ErrStatus("Expected TracePacket tag");
-        }
-        uint64_t packet_size = 0;
-        ptr = protozero::proto_utils::ParseVarInt(++ptr, end, &packet_size);
-        const uint8_t* packet_start = ptr;
-        ptr += packet_size;
-        if (PERFETTO_UNLIKELY((ptr - packet_outer) < 2 || ptr > end)) {
-          return base::ErrStatus("Invalid packet size");
+  // Passes the packets at the front of |pending_packets_| to |callback| in
+  // order. Stops at the first packet still being decompressed unless
+  // |wait_for_all| is set or too many decompression tasks are in flight.
+  template <typename Callback>
+  base::Status EmitPendingPackets(Callback& callback, bool wait_for_all) {
+    while (!pending_packets_.empty()) {
+      PendingPacket& pending = pending_packets_.front();
+      if (!pending.task) {
+        base::Status status = callback(std::move(pending.packet));
+        pending_packets_.pop_front();
+        if (!status.ok()) {
+          DiscardPendingPackets();
+          return status;
         }
-        TraceBlobView sliced =
-            packets.slice(packet_start, static_cast<size_t>(packet_size));
-        RETURN_IF_ERROR(callback(std::move(sliced)));
+        continue;
+      }
+      DecompressionTask* task = pending.task.get();
+      if (!task->done.load(std::memory_order_acquire) && !wait_for_all &&
+          tasks_in_flight_ <= max_tasks_in_flight_) {
+        return base::OkStatus();
+      }
+      // Wait on the event even if |done| is already set: the worker might
+      // still be inside Notify() and |task| is about to be destroyed.
+      task->done_event.Wait();
+      --tasks_in_flight_;
+      base::Status status = task->status;
+      if (status.ok()) {
+        TraceBlobView packets(
+            TraceBlob::CopyFrom(task->output.data(), task->output.size()));
+        status = ForEachDecompressedPacket(packets, callback);
+      }
+      pending_packets_.pop_front();
+      if (!status.ok()) {
+        DiscardPendingPackets();
+        return status;
       }
     }
+    return base::OkStatus();
   }
 
- private:
   static constexpr uint8_t kTracePacketTag =
       protozero::proto_utils::MakeTagLengthDelimited(
           protos::pbzero::Trace::kPacketFieldNumber);
 
+  // Returns an error if the build lacks the codec (deflate or zstd) that
+  // |compressed_packets| was written with.
+  static base::Status CheckDecompressionSupported(
+      protozero::ConstBytes compressed_packets);
+
+  // Decompresses |data| into |output|, picking zstd or deflate based on the
+  // frame magic. |decompressor| is only used for deflate.
+  static base::Status Decompress(util::GzipDecompressor* decompressor,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 std::vector<uint8_t>* output);
   base::Status Decompress(TraceBlobView input, TraceBlobView* output);
 
+  // Appends |packet| to |pending_packets_|, posting a decompression task to
+  // |pool_| if it contains |compressed_packets|.
+  base::Status EnqueuePacket(TraceBlobView packet);
+
+  // Waits for all the in-flight decompression tasks and drops the pending
+  // packets. Used when an error stops tokenization.
+  void DiscardPendingPackets();
+
   // Used to glue together trace packets that span across two (or more)
   // Parse() boundaries.
   util::TraceBlobViewReader reader_;
 
   // Allows support for compressed trace packets.
   util::GzipDecompressor decompressor_;
+
+  // Only set when parallel decompression is enabled.
+  base::ThreadPool* pool_ = nullptr;
+  uint32_t max_tasks_in_flight_ = 0;
+  uint32_t tasks_in_flight_ = 0;
+  std::deque<PendingPacket> pending_packets_;
 };
 
 }  // namespace perfetto::trace_processor
@@ -16,9 +16,19 @@
 
 #include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
 
+#include <string>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
 #include "test/gtest_and_gmock.h"
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+#include <zlib.h>
+#endif
+
 namespace perfetto::trace_processor {
 namespace {
 
@@ -29,6 +39,28 @@ std::string_view ToStringView(const TraceBlobView& tbv) {
                           tbv.size());
 }
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+// Returns a TracePacket whose |compressed_packets| contains one packet for
+// each of |payloads|.
+std::vector<uint8_t> CompressedPacket(
+    const std::vector<std::string>& payloads) {
+  protozero::HeapBuffered<protozero::Message> inner;
+  for (const std::string& payload : payloads) {
+    inner->AppendString(/*field_id=*/1, payload);
+  }
+  std::vector<uint8_t> raw = inner.SerializeAsArray();
+
+  uLongf compressed_size = compressBound(static_cast<uLong>(raw.size()));
+  std::vector<uint8_t> compressed(compressed_size);
+  PERFETTO_CHECK(compress(compressed.data(), &compressed_size, raw.data(),
+                          static_cast<uLong>(raw.size())) == Z_OK);
+
+  protozero::HeapBuffered<protos::pbzero::TracePacket> packet;
+  packet->set_compressed_packets(compressed.data(), compressed_size);
+  return packet.SerializeAsArray();
+}
+#endif
+
 TEST(ProtoTraceTokenizerTest, TwoPacketsSingleBlob) {
   protozero::HeapBuffered<protozero::Message> message;
   message->AppendString(/*field_id=*/1, "payload1");
@@ -144,5 +176,44 @@ TEST(ProtoTraceTokenizerTest, SkipFieldsSingleByteByByte) {
   }
 }
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+TEST(ProtoTraceTokenizerTest, ParallelDecompressionPreservesOrder) {
+  std::vector<std::string> expected;
+  protozero::HeapBuffered<protozero::Message> message;
+  for (uint32_t i = 0; i < 16; ++i) {
+    // Interleave plain packets with compressed ones of varying sizes so that
+    // the decompression tasks finish out of order.
+    std::string plain = "plain" + std::to_string(i);
+    message->AppendString(/*field_id=*/1, plain);
+    expected.push_back(plain);
+
+    std::vector<std::string> payloads;
+    for (uint32_t j = 0; j < (i % 4 + 1) * 100; ++j) {
+      payloads.push_back("compressed" + std::to_string(i) + "_" +
+                         std::to_string(j));
+    }
+    std::vector<uint8_t> compressed = CompressedPacket(payloads);
+    message->AppendBytes(/*field_id=*/1, compressed.data(), compressed.size());
+    expected.insert(expected.end(), payloads.begin(), payloads.end());
+  }
+  std::vector<uint8_t> data = message.SerializeAsArray();
+
+  base::ThreadPool pool(4);
+  ProtoTraceTokenizer tokenizer;
+  tokenizer.EnableParallelDecompression(&pool, /*max_tasks_in_flight=*/3);
+
+  std::vector<std::string> actual;
+  auto bv = TraceBlobView(TraceBlob::CopyFrom(data.data(), data.size()));
+  ASSERT_TRUE(tokenizer
+                  .Tokenize(std::move(bv),
+                            [&actual](TraceBlobView packet) {
+                              actual.emplace_back(ToStringView(packet));
+                              return base::OkStatus();
+                            })
+                  .ok());
+  ASSERT_EQ(actual, expected);
+}
+#endif
+
 }  // namespace
 }  // namespace perfetto::trace_processor
@@ -26,6 +26,7 @@
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/iterator.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/storage/trace_storage.h"
 #include "src/trace_processor/trace_processor_impl.h"
@@ -37,7 +38,16 @@ IteratorImpl::IteratorImpl(
     base::StatusOr<PerfettoSqlEngine::ExecutionResult> result,
     uint32_t sql_stats_row)
     : trace_processor_(trace_processor),
-      result_(std::move(result)),
+      query_(std::move(result)),
+      sql_stats_row_(sql_stats_row) {}
+
+IteratorImpl::IteratorImpl(TraceProcessorImpl* trace_processor,
+                           std::unique_ptr<DataframeScan> scan,
+                           std::string sql,
+                           uint32_t sql_stats_row)
+    : trace_processor_(trace_processor),
+      query_(std::move(scan)),
+      scan_sql_(std::move(sql)),
       sql_stats_row_(sql_stats_row) {}
 
 IteratorImpl::~IteratorImpl() {
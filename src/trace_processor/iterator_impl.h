@@ -20,7 +20,9 @@
 #include <sqlite3.h>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <variant>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
@@ -28,6 +30,7 @@
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/iterator.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/sqlite/sqlite_engine.h"
 
@@ -41,6 +44,12 @@ class IteratorImpl {
   IteratorImpl(TraceProcessorImpl* impl,
                base::StatusOr<PerfettoSqlEngine::ExecutionResult>,
                uint32_t sql_stats_row);
+  // Creates an iterator over the rows of |scan|, for queries executed
+  // directly on a dataframe without going through SQLite.
+  IteratorImpl(TraceProcessorImpl* impl,
+               std::unique_ptr<DataframeScan> scan,
+               std::string sql,
+               uint32_t sql_stats_row);
   ~IteratorImpl();
 
   IteratorImpl(IteratorImpl&) noexcept = delete;
@@ -66,25 +75,35 @@ class IteratorImpl {
       // file.
       RecordFirstNextInSqlStats();
       called_next_ = true;
-      return result_.ok() && !result_->stmt.IsDone();
+      if (DataframeScan* df_scan = scan(); df_scan) {
+        return df_scan->Next();
+      }
+      return result().ok() && !result()->stmt.IsDone();
     }
-    if (!result_.ok()) {
+    if (DataframeScan* df_scan = scan(); df_scan) {
+      return df_scan->Next();
+    }
+    SqliteResult& sqlite_result = result();
+    if (!sqlite_result.ok()) {
       return false;
     }
 
-    bool has_more = result_->stmt.Step();
-    if (!result_->stmt.status().ok()) {
+    bool has_more = sqlite_result->stmt.Step();
+    if (!sqlite_result->stmt.status().ok()) {
       PERFETTO_DCHECK(!has_more);
-      result_ = result_->stmt.status();
+      sqlite_result = sqlite_result->stmt.status();
     }
     return has_more;
   }
 
   SqlValue Get(uint32_t col) const {
-    PERFETTO_DCHECK(result_.ok());
+    if (const DataframeScan* df_scan = scan(); df_scan) {
+      return df_scan->Get(col);
+    }
+    PERFETTO_DCHECK(result().ok());
 
     auto column = static_cast<int>(col);
-    sqlite3_stmt* stmt = result_->stmt.sqlite_stmt();
+    sqlite3_stmt* stmt = result()->stmt.sqlite_stmt();
     auto col_type = sqlite3_column_type(stmt, column);
     SqlValue value;
     switch (col_type) {
@@ -115,30 +134,49 @@ class IteratorImpl {
   }
 
   std::string GetColumnName(uint32_t col) const {
-    return result_.ok() ? sqlite3_column_name(result_->stmt.sqlite_stmt(),
-                                              static_cast<int>(col))
-                        : "";
+    if (const DataframeScan* df_scan = scan(); df_scan) {
+      return df_scan->column_name(col);
+    }
+    return result().ok() ? sqlite3_column_name(result()->stmt.sqlite_stmt(),
+                                               static_cast<int>(col))
+                         : "";
   }
 
-  base::Status Status() const { return result_.status(); }
+  base::Status Status() const {
+    return scan() ? base::OkStatus() : result().status();
+  }
 
   uint32_t ColumnCount() const {
-    return result_.ok() ? result_->stats.column_count : 0;
+    if (const DataframeScan* df_scan = scan(); df_scan) {
+      return df_scan->column_count();
+    }
+    return result().ok() ? result()->stats.column_count : 0;
   }
 
   uint32_t StatementCount() const {
-    return result_.ok() ? result_->stats.statement_count : 0;
+    if (scan()) {
+      return 1;
+    }
+    return result().ok() ? result()->stats.statement_count : 0;
   }
 
   uint32_t StatementCountWithOutput() const {
-    return result_.ok() ? result_->stats.statement_count_with_output : 0;
+    if (scan()) {
+      return 1;
+    }
+    return result().ok() ? result()->stats.statement_count_with_output : 0;
   }
 
   std::string LastStatementSql() const {
-    return result_.ok() ? result_->stmt.sql() : "";
+    if (scan()) {
+      return scan_sql_;
+    }
+    return result().ok() ? result()->stmt.sql() : "";
   }
 
  private:
+  using SqliteResult = base::StatusOr<PerfettoSqlEngine::ExecutionResult>;
+
   // Dummy function to pass to ScopedResource.
   static int DummyClose(TraceProcessorImpl*) { return 0; }
 
@@ -153,8 +191,22 @@ class IteratorImpl {
 
   void RecordFirstNextInSqlStats();
 
+  // Returns the scan executing the query, or nullptr if the query is executed
+  // by SQLite.
+  DataframeScan* scan() const {
+    auto* ptr = std::get_if<std::unique_ptr<DataframeScan>>(&query_);
+    return ptr ? ptr->get() : nullptr;
+  }
+
+  SqliteResult& result() { return std::get<SqliteResult>(query_); }
+  const SqliteResult& result() const { return std::get<SqliteResult>(query_); }
+
   ScopedTraceProcessor trace_processor_;
-  base::StatusOr<PerfettoSqlEngine::ExecutionResult> result_;
+  // Either the result of executing the query with SQLite or the scan
+  // executing it directly on a dataframe.
+  std::variant<SqliteResult, std::unique_ptr<DataframeScan>> query_;
+  // Only set for scans: SQLite results keep the SQL in their statement.
+  std::string scan_sql_;
   uint32_t sql_stats_row_ = 0;
   bool called_next_ = false;
 };
@@ -168,12 +168,20 @@ int DataframeModule::Create(sqlite3* db,
   std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
   res->id_col_idx = FindIdColumnIndex(state->dataframe->column_names());
   res->state = ctx->OnCreate(argc, argv, std::move(state));
+  res->context = ctx;
   res->name = argv[2];
   *vtab = res.release();
   return SQLITE_OK;
 }
 
 int DataframeModule::Destroy(sqlite3_vtab* vtab) {
+  auto* s = sqlite::ModuleStateManager<DataframeModule>::GetState(
+      GetVtab(vtab)->state);
+  if (s->active_scans > 0) {
+    // Same error as SQLite returns when dropping a table which is being read
+    // by an active statement.
+    return sqlite::utils::SetError(vtab, "database table is locked");
+  }
   std::unique_ptr<Vtab> v(GetVtab(vtab));
   sqlite::ModuleStateManager<DataframeModule>::OnDestroy(v->state);
   return SQLITE_OK;
@@ -187,7 +195,8 @@ int DataframeModule::Connect(sqlite3* db,
                              char**) {
   PERFETTO_CHECK(argc == 3);
 
-  auto* vtab_state = GetContext(raw_ctx)->OnConnect(argc, argv);
+  auto* ctx = GetContext(raw_ctx);
+  auto* vtab_state = ctx->OnConnect(argc, argv);
   auto* state =
       sqlite::ModuleStateManager<DataframeModule>::GetState(vtab_state);
   std::string create_stmt = CreateTableStmt(state->dataframe->CreateSpec());
@@ -196,6 +205,7 @@ int DataframeModule::Connect(sqlite3* db,
   }
   std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
   res->state = vtab_state;
+  res->context = ctx;
   res->id_col_idx = FindIdColumnIndex(state->dataframe->column_names());
   res->name = argv[2];
   *vtab = res.release();
@@ -451,7 +461,8 @@ int DataframeModule::Filter(sqlite3_vtab_cursor* cur,
         });
     auto* v = GetVtab(cur->pVtab);
     auto* s = sqlite::ModuleStateManager<DataframeModule>::GetState(v->state);
-    s->dataframe->PrepareCursor(plan, c->df_cursor);
+    s->dataframe->PrepareCursor(plan, c->df_cursor,
+                                v->context->query_thread_pool);
     c->last_idx_str = idxStr;
     c->id_col_idx = v->id_col_idx;
   }
@@ -53,9 +53,17 @@ struct DataframeModule : sqlite::Module<DataframeModule> {
     std::unique_ptr<dataframe::Dataframe> owned_dataframe;
     dataframe::Dataframe* dataframe;
     std::vector<std::string> named_indexes;
+
+    // Number of DataframeScans reading |dataframe| outside of SQLite. The
+    // table cannot be dropped while this is non-zero.
+    uint32_t active_scans = 0;
   };
   struct Context : sqlite::ModuleStateManager<DataframeModule> {
     std::unique_ptr<State> temporary_create_state;
+
+    // If set, large scans over dataframes are executed in parallel on this
+    // pool.
+    base::ThreadPool* query_thread_pool = nullptr;
   };
   struct SqliteValueFetcher : dataframe::ValueFetcher {
     using Type = sqlite::Type;
@@ -98,6 +106,7 @@ struct DataframeModule : sqlite::Module<DataframeModule> {
   };
   struct Vtab : sqlite::Module<DataframeModule>::Vtab {
     sqlite::ModuleStateManager<DataframeModule>::PerVtabState* state;
+    Context* context;
     std::string name;
     int best_idx_num = 0;
     uint32_t id_col_idx = 0;
@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/core/dataframe/cursor_impl.h"  // IWYU pragma: keep
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
+#include "src/trace_processor/perfetto_sql/grammar/perfettosql_grammar.h"
+#include "src/trace_processor/perfetto_sql/tokenizer/sqlite_tokenizer.h"
+#include "src/trace_processor/sqlite/sql_source.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Number of rows copied out of the dataframe at a time.
+constexpr uint32_t kBatchRowCount = 1024;
+
+using Token = SqliteTokenizer::Token;
+
+// Only plain identifiers are accepted: quoted identifiers and keywords used as
+// identifiers are left to SQLite.
+bool IsIdentifier(const Token& t) {
+  return t.token_type == TK_ID && !t.str.empty() && t.str[0] != '"' &&
+         t.str[0] != '`' && t.str[0] != '[';
+}
+
+std::optional<int64_t> ParseInteger(std::string_view str, bool negate) {
+  // Hex literals and digit separators are left to SQLite.
+  for (char c : str) {
+    if (c < '0' || c > '9') {
+      return std::nullopt;
+    }
+  }
+  std::optional<int64_t> value = base::StringToInt64(std::string(str));
+  if (!value || (negate && *value == std::numeric_limits<int64_t>::min())) {
+    return std::nullopt;
+  }
+  return negate ? -*value : *value;
+}
+
+std::string UnquoteString(std::string_view str) {
+  PERFETTO_DCHECK(str.size() >= 2 && str.front() == '\'');
+  std::string res;
+  res.reserve(str.size() - 2);
+  for (size_t i = 1; i + 1 < str.size(); ++i) {
+    res.push_back(str[i]);
+    // Quotes are escaped by doubling them.
+    if (str[i] == '\'') {
+      ++i;
+    }
+  }
+  return res;
+}
+
+std::optional<dataframe::Op> ComparisonOp(int token_type) {
+  switch (token_type) {
+    case TK_EQ:
+      return dataframe::Eq();
+    case TK_NE:
+      return dataframe::Ne();
+    case TK_LT:
+      return dataframe::Lt();
+    case TK_LE:
+      return dataframe::Le();
+    case TK_GT:
+      return dataframe::Gt();
+    case TK_GE:
+      return dataframe::Ge();
+    default:
+      return std::nullopt;
+  }
+}
+
+class QueryParser {
+ public:
+  explicit QueryParser(const std::string& sql)
+      : tokenizer_(SqlSource::FromTraceProcessorImplementation(sql)) {
+    Advance();
+  }
+
+  std::optional<DataframeScan::Query> Parse() {
+    DataframeScan::Query query;
+    if (!Consume(TK_SELECT) || !ParseColumns(query) || !Consume(TK_FROM)) {
+      return std::nullopt;
+    }
+    if (!IsIdentifier(token_)) {
+      return std::nullopt;
+    }
+    query.table = std::string(token_.str);
+    Advance();
+    if (Consume(TK_WHERE) && !ParseConstraints(query)) {
+      return std::nullopt;
+    }
+    if (Consume(TK_ORDER) && (!Consume(TK_BY) || !ParseOrders(query))) {
+      return std::nullopt;
+    }
+    if (Consume(TK_LIMIT) && !ParseLimit(query)) {
+      return std::nullopt;
+    }
+    // Only a single statement is supported.
+    if (Consume(TK_SEMI)) {
+      return token_.str.empty() ? std::make_optional(std::move(query))
+                                : std::nullopt;
+    }
+    return token_.IsTerminal() ? std::make_optional(std::move(query))
+                               : std::nullopt;
+  }
+
+ private:
+  void Advance() { token_ = tokenizer_.NextNonWhitespace(); }
+
+  bool Consume(int token_type) {
+    if (token_.token_type != token_type || token_.str.empty()) {
+      return false;
+    }
+    Advance();
+    return true;
+  }
+
+  bool ParseColumns(DataframeScan::Query& query) {
+    if (Consume(TK_STAR)) {
+      return true;
+    }
+    do {
+      if (!IsIdentifier(token_)) {
+        return false;
+      }
+      DataframeScan::Query::Column column{std::string(token_.str), {}};
+      Advance();
+      if (Consume(TK_AS)) {
+        if (!IsIdentifier(token_)) {
+          return false;
+        }
+        column.alias = std::string(token_.str);
+        Advance();
+      }
+      query.columns.emplace_back(std::move(column));
+    } while (Consume(TK_COMMA));
+    return true;
+  }
+
+  bool ParseConstraints(DataframeScan::Query& query) {
+    do {
+      if (!IsIdentifier(token_)) {
+        return false;
+      }
+      std::string column(token_.str);
+      Advance();
+      if (Consume(TK_ISNULL)) {
+        query.constraints.push_back({std::move(column), dataframe::IsNull(),
+                                     std::monostate()});
+        continue;
+      }
+      if (Consume(TK_NOTNULL)) {
+        query.constraints.push_back({std::move(column),
+                                     dataframe::IsNotNull(), std::monostate()});
+        continue;
+      }
+      if (Consume(TK_IS)) {
+        bool is_not = Consume(TK_NOT);
+        if (!Consume(TK_NULL)) {
+          return false;
+        }
+        query.constraints.push_back(
+            {std::move(column),
+             is_not ? dataframe::Op(dataframe::IsNotNull())
+                    : dataframe::Op(dataframe::IsNull()),
+             std::monostate()});
+        continue;
+      }
+      std::optional<dataframe::Op> op = ComparisonOp(token_.token_type);
+      if (!op && token_.token_type == TK_LIKE_KW &&
+          base::CaseInsensitiveEqual(std::string(token_.str), "glob")) {
+        op = dataframe::Glob();
+      }
+      if (!op) {
+        return false;
+      }
+      Advance();
+      bool negate = Consume(TK_MINUS);
+      if (token_.token_type == TK_INTEGER) {
+        std::optional<int64_t> value = ParseInteger(token_.str, negate);
+        if (!value || op->Is<dataframe::Glob>()) {
+          return false;
+        }
+        query.constraints.push_back({std::move(column), *op, *value});
+      } else if (token_.token_type == TK_STRING && !negate &&
+                 token_.str.front() == '\'') {
+        query.constraints.push_back(
+            {std::move(column), *op, UnquoteString(token_.str)});
+      } else {
+        return false;
+      }
+      Advance();
+    } while (Consume(TK_AND));
+    return true;
+  }
+
+  bool ParseOrders(DataframeScan::Query& query) {
+    do {
+      if (!IsIdentifier(token_)) {
+        return false;
+      }
+      DataframeScan::Query::Order order{std::string(token_.str),
+                                        dataframe::SortDirection::kAscending};
+      Advance();
+      if (Consume(TK_DESC)) {
+        order.direction = dataframe::SortDirection::kDescending;
+      } else {
+        Consume(TK_ASC);
+      }
+      query.orders.emplace_back(std::move(order));
+    } while (Consume(TK_COMMA));
+    return true;
+  }
+
+  bool ParseLimit(DataframeScan::Query& query) {
+    std::optional<uint32_t> limit = ParseUint32();
+    if (!limit) {
+      return false;
+    }
+    query.limit.limit = limit;
+    if (Consume(TK_OFFSET)) {
+      query.limit.offset = ParseUint32();
+      return query.limit.offset.has_value();
+    }
+    return true;
+  }
+
+  std::optional<uint32_t> ParseUint32() {
+    if (token_.token_type != TK_INTEGER) {
+      return std::nullopt;
+    }
+    std::optional<int64_t> value = ParseInteger(token_.str, false);
+    if (!value || *value > std::numeric_limits<uint32_t>::max()) {
+      return std::nullopt;
+    }
+    Advance();
+    return static_cast<uint32_t>(*value);
+  }
+
+  SqliteTokenizer tokenizer_;
+  Token token_;
+};
+
+std::optional<uint32_t> FindColumn(const std::vector<std::string>& names,
+                                   const std::string& name) {
+  for (uint32_t i = 0; i < names.size(); ++i) {
+    if (base::CaseInsensitiveEqual(names[i], name)) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+struct BatchCallback : dataframe::CellCallback {
+  void OnCell(int64_t v) { *out = SqlValue::Long(v); }
+  void OnCell(double v) { *out = SqlValue::Double(v); }
+  void OnCell(NullTermStringView v) {
+    *out = v.data() ? SqlValue::String(v.data()) : SqlValue();
+  }
+  void OnCell(std::nullptr_t) { *out = SqlValue(); }
+  void OnCell(uint32_t v) { *out = SqlValue::Long(v); }
+  void OnCell(int32_t v) { *out = SqlValue::Long(v); }
+  SqlValue* out;
+};
+
+}  // namespace
+
+std::optional<DataframeScan::Query> DataframeScan::Parse(
+    const std::string& sql) {
+  return QueryParser(sql).Parse();
+}
+
+std::unique_ptr<DataframeScan> DataframeScan::Create(
+    const Query& query,
+    DataframeModule::State* state,
+    base::ThreadPool* thread_pool) {
+  const dataframe::Dataframe& df = *state->dataframe;
+  dataframe::DataframeSpec spec = df.CreateSpec();
+  const std::vector<std::string>& names = spec.column_names;
+
+  std::unique_ptr<DataframeScan> scan(new DataframeScan(state));
+  if (query.columns.empty()) {
+    // Matches the columns returned by SQLite for SELECT *.
+    for (uint32_t i = 0; i < names.size(); ++i) {
+      if (names[i] != "_auto_id") {
+        scan->columns_.push_back(i);
+        scan->column_names_.push_back(names[i]);
+      }
+    }
+  } else {
+    for (const Query::Column& column : query.columns) {
+      std::optional<uint32_t> col = FindColumn(names, column.name);
+      if (!col) {
+        return nullptr;
+      }
+      scan->columns_.push_back(*col);
+      scan->column_names_.push_back(column.alias.empty() ? names[*col]
+                                                         : column.alias);
+    }
+  }
+
+  std::vector<dataframe::FilterSpec> filter_specs;
+  for (uint32_t i = 0; i < query.constraints.size(); ++i) {
+    const Query::Constraint& c = query.constraints[i];
+    std::optional<uint32_t> col = FindColumn(names, c.column);
+    if (!col) {
+      return nullptr;
+    }
+    // Comparisons between strings and numbers go through SQLite's type
+    // affinity rules: leave them to SQLite.
+    bool is_string_col = spec.column_specs[*col].type.Is<dataframe::String>();
+    if ((std::holds_alternative<int64_t>(c.value) && is_string_col) ||
+        (std::holds_alternative<std::string>(c.value) && !is_string_col)) {
+      return nullptr;
+    }
+    filter_specs.push_back({*col, i, c.op, std::nullopt});
+  }
+
+  std::vector<dataframe::SortSpec> sort_specs;
+  for (const Query::Order& order : query.orders) {
+    // Like SQLite, resolve the name to the alias of a result column before
+    // the columns of the table.
+    std::optional<uint32_t> col;
+    for (uint32_t i = 0; i < query.columns.size(); ++i) {
+      if (base::CaseInsensitiveEqual(query.columns[i].alias, order.column)) {
+        col = scan->columns_[i];
+        break;
+      }
+    }
+    if (!col) {
+      col = FindColumn(names, order.column);
+    }
+    if (!col) {
+      return nullptr;
+    }
+    sort_specs.push_back({*col, order.direction});
+  }
+
+  uint64_t cols_used = 0;
+  for (uint32_t col : scan->columns_) {
+    // Mirrors SQLite's colUsed: all columns past 63 share the last bit.
+    cols_used |= uint64_t(1) << std::min(col, 63u);
+  }
+  auto plan = df.PlanQuery(filter_specs, {}, sort_specs, query.limit,
+                           cols_used);
+  if (!plan.ok()) {
+    return nullptr;
+  }
+
+  LiteralValueFetcher fetcher;
+  for (const dataframe::FilterSpec& fs : filter_specs) {
+    if (!fs.value_index) {
+      continue;
+    }
+    if (fetcher.values.size() <= *fs.value_index) {
+      fetcher.values.resize(*fs.value_index + 1);
+    }
+    const auto& value = query.constraints[fs.source_index].value;
+    SqlValue& out = fetcher.values[*fs.value_index];
+    if (const auto* i = std::get_if<int64_t>(&value); i) {
+      out = SqlValue::Long(*i);
+    } else if (const auto* s = std::get_if<std::string>(&value); s) {
+      out = SqlValue::String(s->c_str());
+    }
+  }
+  df.PrepareCursor(*plan, scan->cursor_, thread_pool);
+  scan->cursor_.Execute(fetcher);
+  scan->batch_.resize(kBatchRowCount * scan->column_count());
+  return scan;
+}
+
+DataframeScan::DataframeScan(DataframeModule::State* state) : state_(state) {
+  ++state_->active_scans;
+}
+
+DataframeScan::~DataframeScan() {
+  PERFETTO_DCHECK(state_->active_scans > 0);
+  --state_->active_scans;
+}
+
+void DataframeScan::FillBatch() {
+  batch_row_ = 0;
+  batch_row_count_ = 0;
+  BatchCallback callback;
+  callback.out = batch_.data();
+  for (; batch_row_count_ < kBatchRowCount && !cursor_.Eof();
+       ++batch_row_count_, cursor_.Next()) {
+    for (uint32_t col : columns_) {
+      cursor_.Cell(col, callback);
+      ++callback.out;
+    }
+  }
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_DATAFRAME_SCAN_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_DATAFRAME_SCAN_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/core/dataframe/cursor.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
+
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
+namespace perfetto::trace_processor {
+
+// Executes simple queries over a single dataframe table without going through
+// SQLite: the query is planned and executed directly by the dataframe and the
+// results are copied out of the dataframe in batches of rows, instead of one
+// xColumn call (and one sqlite3_column_* call) per cell.
+//
+// Only queries of the following form are supported:
+//   SELECT * | col [AS alias], ...
+//   FROM table
+//   [WHERE col op literal AND ...]
+//   [ORDER BY col [ASC | DESC], ...]
+//   [LIMIT n [OFFSET m]]
+// where op is one of =, !=, <, <=, >, >=, GLOB, IS NULL and IS NOT NULL and
+// literals are integers or strings. Every other query should be executed by
+// SQLite.
+class DataframeScan {
+ public:
+  // The parsed form of a supported query.
+  struct Query {
+    struct Column {
+      std::string name;
+      std::string alias;
+    };
+    struct Constraint {
+      std::string column;
+      dataframe::Op op;
+      // Unset for IS NULL and IS NOT NULL.
+      std::variant<std::monostate, int64_t, std::string> value;
+    };
+    struct Order {
+      std::string column;
+      dataframe::SortDirection direction;
+    };
+    std::string table;
+    // Empty for SELECT *.
+    std::vector<Column> columns;
+    std::vector<Constraint> constraints;
+    std::vector<Order> orders;
+    dataframe::LimitSpec limit;
+  };
+
+  // Parses |sql|, returning std::nullopt if it is not a supported query.
+  static std::optional<Query> Parse(const std::string& sql);
+
+  // Plans and executes |query| on the dataframe of |state|, returning nullptr
+  // if the query does not match the dataframe (e.g. unknown columns or
+  // literals whose type differs from the type of the column) and should be
+  // executed by SQLite instead.
+  //
+  // |state| must outlive the returned scan: the table cannot be dropped while
+  // the scan is alive (see DataframeModule::State::active_scans).
+  static std::unique_ptr<DataframeScan> Create(const Query& query,
+                                               DataframeModule::State* state,
+                                               base::ThreadPool* thread_pool);
+
+  ~DataframeScan();
+
+  DataframeScan(const DataframeScan&) = delete;
+  DataframeScan& operator=(const DataframeScan&) = delete;
+
+  // Moves to the next row, returning false once all the rows were returned.
+  bool Next() {
+    if (batch_row_ + 1 < batch_row_count_) {
+      ++batch_row_;
+      return true;
+    }
+    FillBatch();
+    return batch_row_count_ > 0;
+  }
+
+  // Returns the value of |col| in the current row. Strings point into the
+  // string pool and stay valid for the lifetime of trace processor.
+  const SqlValue& Get(uint32_t col) const {
+    PERFETTO_DCHECK(col < column_count());
+    PERFETTO_DCHECK(batch_row_ < batch_row_count_);
+    return batch_[batch_row_ * column_count() + col];
+  }
+
+  const std::string& column_name(uint32_t col) const {
+    return column_names_[col];
+  }
+  uint32_t column_count() const {
+    return static_cast<uint32_t>(columns_.size());
+  }
+
+ private:
+  struct LiteralValueFetcher : dataframe::ValueFetcher {
+    using Type = SqlValue::Type;
+    static const Type kInt64 = SqlValue::kLong;
+    static const Type kDouble = SqlValue::kDouble;
+    static const Type kString = SqlValue::kString;
+    static const Type kNull = SqlValue::kNull;
+
+    int64_t GetInt64Value(uint32_t idx) const {
+      return values[idx].long_value;
+    }
+    double GetDoubleValue(uint32_t idx) const {
+      return values[idx].double_value;
+    }
+    const char* GetStringValue(uint32_t idx) const {
+      return values[idx].string_value;
+    }
+    Type GetValueType(uint32_t idx) const { return values[idx].type; }
+    static bool IteratorInit(uint32_t) {
+      PERFETTO_FATAL("IN is not supported");
+    }
+    static bool IteratorNext(uint32_t) {
+      PERFETTO_FATAL("IN is not supported");
+    }
+    std::vector<SqlValue> values;
+  };
+
+  explicit DataframeScan(DataframeModule::State* state);
+
+  // Copies the next batch of rows out of |cursor_| into |batch_|.
+  void FillBatch();
+
+  DataframeModule::State* state_;
+  dataframe::Cursor<LiteralValueFetcher> cursor_;
+
+  // The dataframe column and the name of each output column.
+  std::vector<uint32_t> columns_;
+  std::vector<std::string> column_names_;
+
+  // The current batch of rows, stored row-major.
+  std::vector<SqlValue> batch_;
+  uint32_t batch_row_count_ = 0;
+  uint32_t batch_row_ = 0;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_DATAFRAME_SCAN_H_
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares scans of the slice and sched tables of a real trace executed by
+// SQLite, which pulls every cell through the xColumn call of the dataframe
+// virtual table, with the same scans executed directly on the dataframe
+// (Config::enable_dataframe_scans).
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/read_trace.h"
+#include "perfetto/trace_processor/trace_processor.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+constexpr char kTracePath[] = "test/data/example_android_trace_30s.pb";
+
+void RunQuery(benchmark::State& state,
+              bool dataframe_scans,
+              const std::string& query) {
+  Config config;
+  config.enable_dataframe_scans = dataframe_scans;
+  auto tp = TraceProcessor::CreateInstance(config);
+  if (!ReadTrace(tp.get(), kTracePath).ok()) {
+    state.SkipWithError(
+        "Test data missing. Please ensure "
+        "test/data/example_android_trace_30s.pb exists.");
+    return;
+  }
+  int64_t rows = 0;
+  for (auto _ : state) {
+    rows = 0;
+    auto it = tp->ExecuteQuery(query);
+    uint32_t cols = it.ColumnCount();
+    while (it.Next()) {
+      for (uint32_t i = 0; i < cols; ++i) {
+        benchmark::DoNotOptimize(it.Get(i));
+      }
+      rows++;
+    }
+    PERFETTO_CHECK(it.Status().ok());
+    benchmark::ClobberMemory();
+  }
+  state.counters["rows"] = static_cast<double>(rows);
+}
+
+constexpr char kSliceScan[] =
+    "SELECT ts, dur, track_id, name, depth FROM __intrinsic_slice";
+constexpr char kSliceFilterSort[] =
+    "SELECT id, ts, dur, name FROM __intrinsic_slice "
+    "WHERE depth = 0 AND dur > 1000 ORDER BY dur DESC";
+constexpr char kSchedScan[] =
+    "SELECT ts, dur, ucpu, utid, end_state, priority "
+    "FROM __intrinsic_sched_slice";
+
+}  // namespace
+
+static void BM_DataframeScanSliceSqlite(benchmark::State& state) {
+  RunQuery(state, false, kSliceScan);
+}
+
+static void BM_DataframeScanSliceDirect(benchmark::State& state) {
+  RunQuery(state, true, kSliceScan);
+}
+
+static void BM_DataframeScanSliceFilterSortSqlite(benchmark::State& state) {
+  RunQuery(state, false, kSliceFilterSort);
+}
+
+static void BM_DataframeScanSliceFilterSortDirect(benchmark::State& state) {
+  RunQuery(state, true, kSliceFilterSort);
+}
+
+static void BM_DataframeScanSchedSqlite(benchmark::State& state) {
+  RunQuery(state, false, kSchedScan);
+}
+
+static void BM_DataframeScanSchedDirect(benchmark::State& state) {
+  RunQuery(state, true, kSchedScan);
+}
+
+BENCHMARK(BM_DataframeScanSliceSqlite);
+BENCHMARK(BM_DataframeScanSliceDirect);
+BENCHMARK(BM_DataframeScanSliceFilterSortSqlite);
+BENCHMARK(BM_DataframeScanSliceFilterSortDirect);
+BENCHMARK(BM_DataframeScanSchedSqlite);
+BENCHMARK(BM_DataframeScanSchedDirect);
+
+}  // namespace perfetto::trace_processor
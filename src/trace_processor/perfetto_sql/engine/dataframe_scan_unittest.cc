@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using testing::ElementsAre;
+
+class DataframeScanTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dataframe::AdhocDataframeBuilder builder({"id", "ts", "name"}, &pool_);
+    int64_t ts[] = {30, 10, 20, 10};
+    const char* name[] = {"foo", "bar", nullptr, "baz"};
+    for (int64_t i = 0; i < 4; ++i) {
+      builder.PushNonNull(0, i);
+      builder.PushNonNull(1, ts[i]);
+      if (name[i]) {
+        builder.PushNonNull(2, pool_.InternString(name[i]));
+      } else {
+        builder.PushNull(2);
+      }
+    }
+    auto df = std::move(builder).Build();
+    ASSERT_TRUE(df.ok()) << df.status().c_message();
+    state_ = std::make_unique<DataframeModule::State>(
+        std::make_unique<dataframe::Dataframe>(std::move(*df)));
+  }
+
+  std::unique_ptr<DataframeScan> Prepare(const std::string& sql) {
+    std::optional<DataframeScan::Query> query = DataframeScan::Parse(sql);
+    if (!query) {
+      return nullptr;
+    }
+    return DataframeScan::Create(*query, state_.get(), nullptr);
+  }
+
+  // Returns the rows of |sql| as comma separated values.
+  std::vector<std::string> Run(const std::string& sql) {
+    auto scan = Prepare(sql);
+    EXPECT_TRUE(scan) << sql;
+    std::vector<std::string> rows;
+    while (scan && scan->Next()) {
+      std::string row;
+      for (uint32_t i = 0; i < scan->column_count(); ++i) {
+        const SqlValue& v = scan->Get(i);
+        row += i == 0 ? "" : ",";
+        switch (v.type) {
+          case SqlValue::kLong:
+            row += std::to_string(v.long_value);
+            break;
+          case SqlValue::kString:
+            row += v.string_value;
+            break;
+          case SqlValue::kNull:
+            row += "NULL";
+            break;
+          case SqlValue::kDouble:
+          case SqlValue::kBytes:
+            ADD_FAILURE() << "Unexpected value type";
+        }
+      }
+      rows.push_back(std::move(row));
+    }
+    return rows;
+  }
+
+  StringPool pool_;
+  std::unique_ptr<DataframeModule::State> state_;
+};
+
+TEST_F(DataframeScanTest, ParseSupported) {
+  auto query = DataframeScan::Parse(
+      "select ts AS t, name from foo where ts >= -5 and name glob 'a''b*' "
+      "and name is not null order by ts desc, id limit 10 offset 2;");
+  ASSERT_TRUE(query.has_value());
+  EXPECT_EQ(query->table, "foo");
+  ASSERT_EQ(query->columns.size(), 2u);
+  EXPECT_EQ(query->columns[0].name, "ts");
+  EXPECT_EQ(query->columns[0].alias, "t");
+  EXPECT_EQ(query->columns[1].alias, "");
+  ASSERT_EQ(query->constraints.size(), 3u);
+  EXPECT_EQ(std::get<int64_t>(query->constraints[0].value), -5);
+  EXPECT_TRUE(query->constraints[1].op.Is<dataframe::Glob>());
+  EXPECT_EQ(std::get<std::string>(query->constraints[1].value), "a'b*");
+  EXPECT_TRUE(query->constraints[2].op.Is<dataframe::IsNotNull>());
+  ASSERT_EQ(query->orders.size(), 2u);
+  EXPECT_EQ(query->orders[0].direction,
+            dataframe::SortDirection::kDescending);
+  EXPECT_EQ(query->orders[1].direction, dataframe::SortDirection::kAscending);
+  EXPECT_EQ(query->limit.limit, 10u);
+  EXPECT_EQ(query->limit.offset, 2u);
+}
+
+TEST_F(DataframeScanTest, ParseUnsupported) {
+  for (const char* sql : {
+           "SELECT DISTINCT ts FROM foo",
+           "SELECT ts + 1 FROM foo",
+           "SELECT ts t FROM foo",
+           "SELECT f.ts FROM foo f",
+           "SELECT ts FROM foo JOIN bar USING (id)",
+           "SELECT ts FROM foo WHERE ts = 1 OR ts = 2",
+           "SELECT ts FROM foo WHERE ts IN (1, 2)",
+           "SELECT ts FROM foo WHERE ts = NULL",
+           "SELECT ts FROM foo WHERE ts = 1.5",
+           "SELECT ts FROM foo WHERE ts = 0x10",
+           "SELECT ts FROM foo WHERE 1 = ts",
+           "SELECT ts FROM foo WHERE ts = $x",
+           "SELECT ts FROM foo GROUP BY ts",
+           "SELECT ts FROM foo ORDER BY 1",
+           "SELECT ts FROM foo LIMIT 1, 2",
+           "SELECT \"ts\" FROM foo",
+           "SELECT ts FROM foo; SELECT ts FROM foo",
+           "INCLUDE PERFETTO MODULE foo",
+       }) {
+    EXPECT_FALSE(DataframeScan::Parse(sql).has_value()) << sql;
+  }
+}
+
+TEST_F(DataframeScanTest, SelectStar) {
+  auto scan = Prepare("SELECT * FROM foo");
+  ASSERT_TRUE(scan);
+  ASSERT_EQ(scan->column_count(), 3u);
+  EXPECT_EQ(scan->column_name(0), "id");
+  EXPECT_EQ(scan->column_name(1), "ts");
+  EXPECT_EQ(scan->column_name(2), "name");
+  EXPECT_THAT(Run("SELECT * FROM foo"),
+              ElementsAre("0,30,foo", "1,10,bar", "2,20,NULL", "3,10,baz"));
+}
+
+TEST_F(DataframeScanTest, FilterSortLimit) {
+  EXPECT_THAT(Run("SELECT name, id FROM foo WHERE ts = 10"),
+              ElementsAre("bar,1", "baz,3"));
+  EXPECT_THAT(Run("SELECT id FROM foo WHERE name IS NULL"), ElementsAre("2"));
+  EXPECT_THAT(Run("SELECT id FROM foo WHERE name GLOB 'ba*' AND id > 1"),
+              ElementsAre("3"));
+  EXPECT_THAT(Run("SELECT id, ts FROM foo ORDER BY ts DESC, id DESC"),
+              ElementsAre("0,30", "2,20", "3,10", "1,10"));
+  EXPECT_THAT(Run("SELECT id FROM foo ORDER BY ts LIMIT 2 OFFSET 1"),
+              ElementsAre("3", "2"));
+}
+
+TEST_F(DataframeScanTest, OrderByAlias) {
+  // Aliases shadow the columns of the table with the same name.
+  EXPECT_THAT(Run("SELECT ts AS id FROM foo ORDER BY id, ts"),
+              ElementsAre("10", "10", "20", "30"));
+  EXPECT_THAT(Run("SELECT id AS ts, ts AS t FROM foo ORDER BY TS DESC"),
+              ElementsAre("3,10", "2,20", "1,10", "0,30"));
+  EXPECT_THAT(Run("SELECT ts AS start, id FROM foo ORDER BY start, id"),
+              ElementsAre("10,1", "10,3", "20,2", "30,0"));
+}
+
+TEST_F(DataframeScanTest, ColumnNames) {
+  auto scan = Prepare("SELECT TS AS start, NAME FROM foo");
+  ASSERT_TRUE(scan);
+  EXPECT_EQ(scan->column_name(0), "start");
+  EXPECT_EQ(scan->column_name(1), "name");
+}
+
+TEST_F(DataframeScanTest, FallsBackOnMismatch) {
+  EXPECT_FALSE(Prepare("SELECT missing FROM foo"));
+  EXPECT_FALSE(Prepare("SELECT ts FROM foo WHERE missing = 1"));
+  EXPECT_FALSE(Prepare("SELECT ts FROM foo ORDER BY missing"));
+  EXPECT_FALSE(Prepare("SELECT ts FROM foo WHERE ts = '10'"));
+  EXPECT_FALSE(Prepare("SELECT ts FROM foo WHERE name = 10"));
+}
+
+TEST_F(DataframeScanTest, MultipleBatches) {
+  dataframe::AdhocDataframeBuilder builder({"value"}, &pool_);
+  for (int64_t i = 0; i < 2500; ++i) {
+    builder.PushNonNull(0, i * 2);
+  }
+  auto df = std::move(builder).Build();
+  ASSERT_TRUE(df.ok()) << df.status().c_message();
+  DataframeModule::State state(
+      std::make_unique<dataframe::Dataframe>(std::move(*df)));
+
+  auto query = DataframeScan::Parse("SELECT value FROM t WHERE value >= 10");
+  ASSERT_TRUE(query.has_value());
+  auto scan = DataframeScan::Create(*query, &state, nullptr);
+  ASSERT_TRUE(scan);
+  int64_t expected = 10;
+  while (scan->Next()) {
+    ASSERT_EQ(scan->Get(0).long_value, expected);
+    expected += 2;
+  }
+  EXPECT_EQ(expected, 5000);
+}
+
+TEST_F(DataframeScanTest, TracksActiveScans) {
+  {
+    auto scan = Prepare("SELECT * FROM foo");
+    ASSERT_TRUE(scan);
+    EXPECT_EQ(state_->active_scans, 1u);
+  }
+  EXPECT_EQ(state_->active_scans, 0u);
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
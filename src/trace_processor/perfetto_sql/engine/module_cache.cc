@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/time.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/fnv_hash.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/scoped_mmap.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "perfetto/ext/base/uuid.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/dataframe_snapshot.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/util/sql_modules.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Each file holds the cached table and a single row dataframe with the time
+// it took to compute it.
+constexpr char kTableName[] = "table";
+constexpr char kInfoName[] = "__module_cache_info";
+
+constexpr auto kInfoSpec = dataframe::CreateTypedDataframeSpec(
+    {"dur"},
+    dataframe::CreateTypedColumnSpec(dataframe::Int64{},
+                                     dataframe::NonNull{},
+                                     dataframe::Unsorted{}));
+
+}  // namespace
+
+ModuleCache::ModuleCache(std::string dir) : dir_(std::move(dir)) {}
+
+ModuleCache::~ModuleCache() {
+  DiscardPrefetched();
+}
+
+void ModuleCache::AddCacheablePackage(std::string name) {
+  cacheable_packages_.emplace_back(std::move(name));
+}
+
+bool ModuleCache::IsCacheable(const std::string& module) const {
+  if (dir_.empty() || !trace_hash_) {
+    return false;
+  }
+  std::string package = sql_modules::GetPackageName(module);
+  return std::find(cacheable_packages_.begin(), cacheable_packages_.end(),
+                   package) != cacheable_packages_.end();
+}
+
+void ModuleCache::Prefetch(const std::vector<TableKey>& tables,
+                           base::ThreadPool* thread_pool,
+                           StringPool* pool) {
+  for (const TableKey& key : tables) {
+    if (!IsCacheable(key.module)) {
+      continue;
+    }
+    std::string path = GetPath(key);
+    auto [slot, inserted] = prefetched_.Insert(path, nullptr);
+    if (!inserted) {
+      continue;
+    }
+    *slot = std::make_unique<PrefetchedTable>();
+    PrefetchedTable* table = slot->get();
+    thread_pool->PostTask([table, path = std::move(path), pool]() {
+      int64_t start = base::GetWallTimeNs().count();
+      table->table = LoadFile(path, pool, &table->computed_dur);
+      table->dur = base::GetWallTimeNs().count() - start;
+      table->done.Notify();
+    });
+  }
+}
+
+std::optional<dataframe::Dataframe> ModuleCache::Load(const TableKey& key,
+                                                      StringPool* pool) {
+  PERFETTO_DCHECK(IsCacheable(key.module));
+  std::string path = GetPath(key);
+  std::optional<dataframe::Dataframe> table;
+  int64_t dur = 0;
+  int64_t computed_dur = 0;
+  bool prefetched = false;
+  if (auto* slot_ptr = prefetched_.Find(path)) {
+    std::unique_ptr<PrefetchedTable> slot = std::move(*slot_ptr);
+    prefetched_.Erase(path);
+    slot->done.Wait();
+    table = std::move(slot->table);
+    dur = slot->dur;
+    computed_dur = slot->computed_dur;
+    prefetched = true;
+  } else {
+    int64_t start = base::GetWallTimeNs().count();
+    table = LoadFile(path, pool, &computed_dur);
+    dur = base::GetWallTimeNs().count() - start;
+  }
+  if (table) {
+    entries_.push_back(Entry{key.module, key.table_name, true, prefetched,
+                             dur, std::max<int64_t>(computed_dur - dur, 0)});
+  }
+  return table;
+}
+
+void ModuleCache::DiscardPrefetched() {
+  // The workers write to the prefetched tables: wait for all of them to be
+  // done before freeing them.
+  for (auto it = prefetched_.GetIterator(); it; ++it) {
+    it.value()->done.Wait();
+  }
+  prefetched_.Clear();
+}
+
+std::optional<dataframe::Dataframe> ModuleCache::LoadFile(
+    const std::string& path,
+    StringPool* pool,
+    int64_t* computed_dur) {
+  base::ScopedMmap mapped = base::ReadMmapWholeFile(path);
+  if (!mapped.IsValid()) {
+    return std::nullopt;
+  }
+  auto reader = dataframe::DataframeSnapshotReader::Create(
+      static_cast<const uint8_t*>(mapped.data()), mapped.length());
+  if (!reader.ok()) {
+    PERFETTO_ELOG("Module cache: ignoring invalid entry %s: %s", path.c_str(),
+                  reader.status().c_message());
+    return std::nullopt;
+  }
+  auto info = reader->Load(kInfoName, pool);
+  auto table = reader->Load(kTableName, pool);
+  if (!info.ok() || !table.ok() || info->row_count() != 1 ||
+      info->column_names() !=
+          dataframe::Dataframe::CreateFromTypedSpec(kInfoSpec, pool)
+              .column_names()) {
+    PERFETTO_ELOG("Module cache: ignoring invalid entry %s", path.c_str());
+    return std::nullopt;
+  }
+  *computed_dur = info->GetCellUnchecked<0>(kInfoSpec, 0);
+  return std::move(*table);
+}
+
+void ModuleCache::Store(const TableKey& key,
+                        const dataframe::Dataframe& table,
+                        int64_t dur,
+                        StringPool* pool) {
+  PERFETTO_DCHECK(IsCacheable(key.module));
+  entries_.push_back(Entry{key.module, key.table_name, false, false, dur, 0});
+
+  auto info = dataframe::Dataframe::CreateFromTypedSpec(kInfoSpec, pool);
+  info.InsertUnchecked(kInfoSpec, dur);
+  info.Finalize();
+  dataframe::DataframeSnapshotWriter writer;
+  writer.AddDataframe(kTableName, table);
+  writer.AddDataframe(kInfoName, info);
+  std::vector<uint8_t> data = std::move(writer).Finish();
+
+  // Mkdir fails if the directory already exists: rely on the open failing
+  // below for any other error.
+  base::Mkdir(dir_);
+  std::string path = GetPath(key);
+  std::string tmp_path = path + "." + base::Uuidv4().ToPrettyString();
+  {
+    base::ScopedFile fd(
+        base::OpenFile(tmp_path, O_CREAT | O_WRONLY | O_TRUNC, 0644));
+    if (!fd) {
+      PERFETTO_ELOG("Module cache: unable to open %s", tmp_path.c_str());
+      return;
+    }
+    if (base::WriteAll(*fd, data.data(), data.size()) !=
+        static_cast<ssize_t>(data.size())) {
+      PERFETTO_ELOG("Module cache: failed to write %s", tmp_path.c_str());
+      fd.reset();
+      remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    // Another instance might have stored the same table concurrently: the
+    // contents are the same so keeping either file is fine.
+    remove(tmp_path.c_str());
+  }
+}
+
+std::string ModuleCache::GetPath(const TableKey& key) const {
+  PERFETTO_DCHECK(trace_hash_);
+  base::FnvHasher hasher;
+  hasher.Update(sources_hash_);
+  for (const std::string* s : {&key.module, &key.table_name}) {
+    hasher.Update(s->size());
+    hasher.Update(*s);
+  }
+  hasher.Update(key.index);
+  // Group the files by trace so that the entries of a trace are easy to
+  // find and delete.
+  base::StackString<64> name("/%016" PRIx64 "-%016" PRIx64 ".pftc",
+                             *trace_hash_, hasher.digest());
+  return dir_ + name.ToStdString();
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_MODULE_CACHE_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_MODULE_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/waitable_event.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
+namespace perfetto::trace_processor {
+
+// On-disk cache of the tables created by CREATE PERFETTO TABLE statements in
+// modules.
+//
+// The contents of such a table only depend on the trace and on the sources
+// of the modules, so the cache is keyed by (hash of the trace contents, hash
+// of the module sources, module, table, index of the statement in the
+// module): any instance of trace processor loading the same trace with the
+// same modules can reuse the table instead of executing the statement again.
+// Each table is stored in its own file as a dataframe snapshot (see
+// DataframeSnapshotWriter).
+//
+// As the key does not depend on the statement itself, the tables of modules
+// which are about to be included can be loaded on worker threads ahead of
+// their statements being executed (see Prefetch).
+//
+// Writes go through a temporary file which is renamed into place so that
+// several processes can share the same directory.
+class ModuleCache {
+ public:
+  // A lookup of the cache, as reported by the module_cache_stats table.
+  struct Entry {
+    std::string module;
+    std::string table_name;
+    bool hit = false;
+    // Whether the table was loaded ahead of time by Prefetch.
+    bool prefetched = false;
+    // The time spent loading the table on hits or computing it on misses.
+    int64_t dur = 0;
+    // On hits, the time it took to compute the table minus |dur|.
+    int64_t saved_dur = 0;
+  };
+
+  // Identifies the |index|-th CREATE PERFETTO TABLE statement of |module|,
+  // which creates |table_name|.
+  struct TableKey {
+    std::string module;
+    std::string table_name;
+    uint32_t index = 0;
+  };
+
+  // Creates a cache storing its files in |dir|. The cache is disabled if
+  // |dir| is empty.
+  explicit ModuleCache(std::string dir);
+  ~ModuleCache();
+
+  ModuleCache(const ModuleCache&) = delete;
+  ModuleCache& operator=(const ModuleCache&) = delete;
+
+  // Sets the hash of the contents of the trace. Nothing is cached until this
+  // is called, i.e. until the trace is fully loaded.
+  void SetTraceHash(uint64_t trace_hash) { trace_hash_ = trace_hash; }
+
+  // Sets the hash of everything besides the trace which the tables depend on
+  // (e.g. the version of trace processor and the sources of all the modules).
+  // Must be updated whenever any of those changes.
+  void SetSourcesHash(uint64_t sources_hash) { sources_hash_ = sources_hash; }
+
+  // Marks the modules of the package |name| as cacheable. Only packages whose
+  // modules solely depend on the trace and on other modules should be added.
+  void AddCacheablePackage(std::string name);
+
+  // Returns true if the tables created by |module| should be looked up in and
+  // stored to the cache.
+  bool IsCacheable(const std::string& module) const;
+
+  // Starts loading the cached tables of |tables| on |thread_pool|, in order.
+  // Tables which are not cacheable or already being loaded are skipped.
+  // |pool| must have locking enabled as it is written to by the workers.
+  void Prefetch(const std::vector<TableKey>& tables,
+                base::ThreadPool* thread_pool,
+                StringPool* pool);
+
+  // Returns the table |key| if it is in the cache, interning its strings into
+  // |pool|. If the table is being prefetched, waits for it to be loaded
+  // instead.
+  std::optional<dataframe::Dataframe> Load(const TableKey& key,
+                                           StringPool* pool);
+
+  // Drops the prefetched tables which were not loaded, waiting for the ones
+  // still being read. Must be called once the INCLUDE which prefetched them is
+  // done: a table it did not create won't be looked up anymore.
+  void DiscardPrefetched();
+
+  // Stores the table |key|, which took |dur| ns to compute. |pool| must be
+  // the string pool of |table|. Failures to write are not fatal: the table is
+  // simply recomputed next time.
+  void Store(const TableKey& key,
+             const dataframe::Dataframe& table,
+             int64_t dur,
+             StringPool* pool);
+
+  const std::vector<Entry>& entries() const { return entries_; }
+
+ private:
+  // A table being loaded on a worker thread. Only accessed by the worker until
+  // |done| is notified.
+  struct PrefetchedTable {
+    std::optional<dataframe::Dataframe> table;
+    int64_t dur = 0;
+    int64_t computed_dur = 0;
+    base::WaitableEvent done;
+  };
+
+  // Loads the file at |path|, setting |computed_dur| to the time the table
+  // took to compute. Can be called from any thread.
+  static std::optional<dataframe::Dataframe> LoadFile(const std::string& path,
+                                                      StringPool* pool,
+                                                      int64_t* computed_dur);
+
+  std::string GetPath(const TableKey& key) const;
+
+  const std::string dir_;
+  std::optional<uint64_t> trace_hash_;
+  uint64_t sources_hash_ = 0;
+  std::vector<std::string> cacheable_packages_;
+  std::vector<Entry> entries_;
+  base::FlatHashMap<std::string, std::unique_ptr<PrefetchedTable>>
+      prefetched_;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_MODULE_CACHE_H_
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/module_cache_stats_module.h"
+
+#include <sqlite3.h>
+#include <memory>
+
+#include "perfetto/base/logging.h"
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_result.h"
+
+namespace perfetto::trace_processor {
+
+int ModuleCacheStatsModule::Connect(sqlite3* db,
+                                    void* aux,
+                                    int,
+                                    const char* const*,
+                                    sqlite3_vtab** vtab,
+                                    char**) {
+  static constexpr char kSchema[] = R"(
+    CREATE TABLE x(
+      module TEXT,
+      table_name TEXT,
+      hit BOOL,
+      prefetched BOOL,
+      dur BIGINT,
+      saved_dur BIGINT
+    )
+  )";
+  if (int ret = sqlite3_declare_vtab(db, kSchema); ret != SQLITE_OK) {
+    return ret;
+  }
+  std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
+  res->cache = GetContext(aux);
+  *vtab = res.release();
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Disconnect(sqlite3_vtab* vtab) {
+  delete GetVtab(vtab);
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::BestIndex(sqlite3_vtab*, sqlite3_index_info*) {
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Open(sqlite3_vtab* raw_vtab,
+                                 sqlite3_vtab_cursor** cursor) {
+  std::unique_ptr<Cursor> c = std::make_unique<Cursor>();
+  c->cache = GetVtab(raw_vtab)->cache;
+  *cursor = c.release();
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Close(sqlite3_vtab_cursor* cursor) {
+  delete GetCursor(cursor);
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Filter(sqlite3_vtab_cursor* cursor,
+                                   int,
+                                   const char*,
+                                   int,
+                                   sqlite3_value**) {
+  auto* c = GetCursor(cursor);
+  c->row = 0;
+  c->num_rows = c->cache->entries().size();
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Next(sqlite3_vtab_cursor* cursor) {
+  GetCursor(cursor)->row++;
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Eof(sqlite3_vtab_cursor* cursor) {
+  auto* c = GetCursor(cursor);
+  return c->row >= c->num_rows;
+}
+
+int ModuleCacheStatsModule::Column(sqlite3_vtab_cursor* cursor,
+                                   sqlite3_context* ctx,
+                                   int N) {
+  auto* c = GetCursor(cursor);
+  const ModuleCache::Entry& entry = c->cache->entries()[c->row];
+  switch (N) {
+    case Column::kModuleName:
+      sqlite::result::TransientString(ctx, entry.module.c_str());
+      break;
+    case Column::kTableName:
+      sqlite::result::TransientString(ctx, entry.table_name.c_str());
+      break;
+    case Column::kHit:
+      sqlite::result::Long(ctx, entry.hit);
+      break;
+    case Column::kPrefetched:
+      sqlite::result::Long(ctx, entry.prefetched);
+      break;
+    case Column::kDur:
+      sqlite::result::Long(ctx, entry.dur);
+      break;
+    case Column::kSavedDur:
+      sqlite::result::Long(ctx, entry.saved_dur);
+      break;
+    default:
+      PERFETTO_FATAL("Unknown column %d", N);
+      break;
+  }
+  return SQLITE_OK;
+}
+
+int ModuleCacheStatsModule::Rowid(sqlite3_vtab_cursor* cursor,
+                                  sqlite_int64* rowid) {
+  *rowid = static_cast<sqlite_int64>(GetCursor(cursor)->row);
+  return SQLITE_OK;
+}
+
+}  // namespace perfetto::trace_processor
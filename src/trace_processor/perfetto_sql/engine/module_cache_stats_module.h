@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_MODULE_CACHE_STATS_MODULE_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_MODULE_CACHE_STATS_MODULE_H_
+
+#include <cstddef>
+
+#include "src/trace_processor/sqlite/bindings/sqlite_module.h"
+
+namespace perfetto::trace_processor {
+
+class ModuleCache;
+
+// A virtual table listing every lookup of the module cache (see ModuleCache)
+// with whether it was a hit and how much time it saved.
+struct ModuleCacheStatsModule : sqlite::Module<ModuleCacheStatsModule> {
+  using Context = ModuleCache;
+  struct Vtab : sqlite::Module<ModuleCacheStatsModule>::Vtab {
+    const ModuleCache* cache = nullptr;
+  };
+  struct Cursor : sqlite::Module<ModuleCacheStatsModule>::Cursor {
+    const ModuleCache* cache = nullptr;
+    size_t row = 0;
+    size_t num_rows = 0;
+  };
+  enum Column {
+    kModuleName = 0,
+    kTableName = 1,
+    kHit = 2,
+    kPrefetched = 3,
+    kDur = 4,
+    kSavedDur = 5,
+  };
+
+  static constexpr auto kType = kEponymousOnly;
+  static constexpr bool kSupportsWrites = false;
+  static constexpr bool kDoesOverloadFunctions = false;
+
+  static int Connect(sqlite3*,
+                     void*,
+                     int,
+                     const char* const*,
+                     sqlite3_vtab**,
+                     char**);
+  static int Disconnect(sqlite3_vtab*);
+
+  static int BestIndex(sqlite3_vtab*, sqlite3_index_info*);
+
+  static int Open(sqlite3_vtab*, sqlite3_vtab_cursor**);
+  static int Close(sqlite3_vtab_cursor*);
+
+  static int Filter(sqlite3_vtab_cursor*,
+                    int,
+                    const char*,
+                    int,
+                    sqlite3_value**);
+  static int Next(sqlite3_vtab_cursor*);
+  static int Eof(sqlite3_vtab_cursor*);
+  static int Column(sqlite3_vtab_cursor*, sqlite3_context*, int);
+  static int Rowid(sqlite3_vtab_cursor*, sqlite_int64*);
+
+  // This needs to happen at the end as it depends on the functions
+  // defined above.
+  static constexpr sqlite3_module kModule = CreateModule();
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_MODULE_CACHE_STATS_MODULE_H_
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
+
+#include <fcntl.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "src/base/test/tmp_dir_tree.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+constexpr auto kSpec = dataframe::CreateTypedDataframeSpec(
+    {"ts", "name"},
+    dataframe::CreateTypedColumnSpec(dataframe::Int64{},
+                                     dataframe::NonNull{},
+                                     dataframe::Sorted{}),
+    dataframe::CreateTypedColumnSpec(dataframe::String{},
+                                     dataframe::DenseNull{},
+                                     dataframe::Unsorted{}));
+
+const ModuleCache::TableKey kKey{"foo.bar", "t", 0};
+
+class ModuleCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tmp_.AddDir("cache");
+    cache_dir_ = tmp_.AbsolutePath("cache");
+  }
+
+  void TearDown() override {
+    // Let TmpDirTree delete all the files created by the cache.
+    std::vector<std::string> files;
+    ASSERT_TRUE(base::ListFilesRecursive(cache_dir_, files).ok());
+    for (const auto& file : files) {
+      tmp_.TrackFile("cache/" + file);
+    }
+  }
+
+  dataframe::Dataframe CreateTable() {
+    auto df = dataframe::Dataframe::CreateFromTypedSpec(kSpec, &pool_);
+    df.InsertUnchecked(kSpec, int64_t(10),
+                       std::make_optional(pool_.InternString("foo")));
+    df.InsertUnchecked(kSpec, int64_t(20), std::nullopt);
+    df.Finalize();
+    return df;
+  }
+
+  base::TmpDirTree tmp_;
+  std::string cache_dir_;
+  StringPool pool_;
+};
+
+TEST_F(ModuleCacheTest, StoreAndLoad) {
+  {
+    ModuleCache cache(cache_dir_);
+    cache.AddCacheablePackage("foo");
+    cache.SetTraceHash(1);
+    ASSERT_TRUE(cache.IsCacheable("foo.bar"));
+    EXPECT_FALSE(cache.Load(kKey, &pool_));
+    cache.Store(kKey, CreateTable(), 1000, &pool_);
+  }
+
+  // Load from another instance with its own string pool.
+  StringPool pool;
+  ModuleCache cache(cache_dir_);
+  cache.AddCacheablePackage("foo");
+  cache.SetTraceHash(1);
+  auto df = cache.Load(kKey, &pool);
+  ASSERT_TRUE(df);
+  ASSERT_EQ(df->row_count(), 2u);
+  EXPECT_EQ(df->GetCellUnchecked<0>(kSpec, 0), 10);
+  EXPECT_EQ(df->GetCellUnchecked<0>(kSpec, 1), 20);
+  auto name = df->GetCellUnchecked<1>(kSpec, 0);
+  ASSERT_TRUE(name);
+  EXPECT_EQ(pool.Get(*name), "foo");
+  EXPECT_FALSE(df->GetCellUnchecked<1>(kSpec, 1));
+
+  ASSERT_EQ(cache.entries().size(), 1u);
+  EXPECT_EQ(cache.entries()[0].module, "foo.bar");
+  EXPECT_EQ(cache.entries()[0].table_name, "t");
+  EXPECT_TRUE(cache.entries()[0].hit);
+  EXPECT_LE(cache.entries()[0].saved_dur, 1000);
+}
+
+TEST_F(ModuleCacheTest, KeyedByTraceAndSources) {
+  ModuleCache cache(cache_dir_);
+  cache.AddCacheablePackage("foo");
+  cache.SetTraceHash(1);
+  cache.SetSourcesHash(2);
+  cache.Store(kKey, CreateTable(), 1000, &pool_);
+  ASSERT_EQ(cache.entries().size(), 1u);
+  EXPECT_FALSE(cache.entries()[0].hit);
+
+  EXPECT_FALSE(cache.Load({"foo.bar", "t", 1}, &pool_));
+  EXPECT_FALSE(cache.Load({"foo.bar", "u", 0}, &pool_));
+  EXPECT_FALSE(cache.Load({"foo.baz", "t", 0}, &pool_));
+  cache.SetSourcesHash(3);
+  EXPECT_FALSE(cache.Load(kKey, &pool_));
+  cache.SetSourcesHash(2);
+  cache.SetTraceHash(4);
+  EXPECT_FALSE(cache.Load(kKey, &pool_));
+  cache.SetTraceHash(1);
+  EXPECT_TRUE(cache.Load(kKey, &pool_));
+  EXPECT_EQ(cache.entries().size(), 2u);
+}
+
+TEST_F(ModuleCacheTest, Prefetch) {
+  {
+    ModuleCache cache(cache_dir_);
+    cache.AddCacheablePackage("foo");
+    cache.SetTraceHash(1);
+    cache.Store(kKey, CreateTable(), 1000, &pool_);
+  }
+
+  StringPool pool;
+  pool.set_locking(true);
+  base::ThreadPool thread_pool(2);
+  ModuleCache cache(cache_dir_);
+  cache.AddCacheablePackage("foo");
+  cache.SetTraceHash(1);
+  cache.Prefetch({kKey, {"foo.bar", "u", 1}, {"baz.qux", "t", 0}},
+                 &thread_pool, &pool);
+  auto df = cache.Load(kKey, &pool);
+  ASSERT_TRUE(df);
+  ASSERT_EQ(df->row_count(), 2u);
+  auto name = df->GetCellUnchecked<1>(kSpec, 0);
+  ASSERT_TRUE(name);
+  EXPECT_EQ(pool.Get(*name), "foo");
+  EXPECT_FALSE(cache.Load({"foo.bar", "u", 1}, &pool));
+
+  // Prefetched tables are consumed by the first load.
+  EXPECT_TRUE(cache.Load(kKey, &pool));
+  ASSERT_EQ(cache.entries().size(), 2u);
+  EXPECT_TRUE(cache.entries()[0].prefetched);
+  EXPECT_FALSE(cache.entries()[1].prefetched);
+}
+
+TEST_F(ModuleCacheTest, DiscardPrefetched) {
+  {
+    ModuleCache cache(cache_dir_);
+    cache.AddCacheablePackage("foo");
+    cache.SetTraceHash(1);
+    cache.Store(kKey, CreateTable(), 1000, &pool_);
+  }
+
+  StringPool pool;
+  pool.set_locking(true);
+  base::ThreadPool thread_pool(2);
+  ModuleCache cache(cache_dir_);
+  cache.AddCacheablePackage("foo");
+  cache.SetTraceHash(1);
+  cache.Prefetch({kKey}, &thread_pool, &pool);
+  cache.DiscardPrefetched();
+
+  // The table is read again.
+  EXPECT_TRUE(cache.Load(kKey, &pool));
+  ASSERT_EQ(cache.entries().size(), 1u);
+  EXPECT_TRUE(cache.entries()[0].hit);
+  EXPECT_FALSE(cache.entries()[0].prefetched);
+}
+
+TEST_F(ModuleCacheTest, IsCacheable) {
+  ModuleCache disabled("");
+  disabled.AddCacheablePackage("foo");
+  disabled.SetTraceHash(1);
+  EXPECT_FALSE(disabled.IsCacheable("foo.bar"));
+
+  ModuleCache cache(cache_dir_);
+  cache.AddCacheablePackage("foo");
+  EXPECT_FALSE(cache.IsCacheable("foo.bar"));
+  cache.SetTraceHash(1);
+  EXPECT_TRUE(cache.IsCacheable("foo"));
+  EXPECT_TRUE(cache.IsCacheable("foo.bar.baz"));
+  EXPECT_FALSE(cache.IsCacheable("foobar.baz"));
+  EXPECT_FALSE(cache.IsCacheable("bar.foo"));
+}
+
+TEST_F(ModuleCacheTest, InvalidEntryIsMiss) {
+  ModuleCache cache(cache_dir_);
+  cache.AddCacheablePackage("foo");
+  cache.SetTraceHash(1);
+  cache.Store(kKey, CreateTable(), 1000, &pool_);
+
+  std::vector<std::string> files;
+  ASSERT_TRUE(base::ListFilesRecursive(cache_dir_, files).ok());
+  ASSERT_EQ(files.size(), 1u);
+  base::ScopedFile fd(base::OpenFile(cache_dir_ + "/" + files[0],
+                                     O_WRONLY | O_TRUNC));
+  ASSERT_TRUE(fd);
+  ASSERT_EQ(base::WriteAll(*fd, "junk", 4), 4);
+  fd.reset();
+  EXPECT_FALSE(cache.Load(kKey, &pool_));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
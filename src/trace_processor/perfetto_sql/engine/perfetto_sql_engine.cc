@@ -34,11 +34,13 @@
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
+#include "perfetto/base/time.h"
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
 #include "src/trace_processor/core/dataframe/dataframe.h"
@@ -46,12 +48,16 @@
 #include "src/trace_processor/core/dataframe/specs.h"
 #include "src/trace_processor/perfetto_sql/engine/created_function.h"
 #include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
 #include "src/trace_processor/perfetto_sql/engine/runtime_table_function.h"
 #include "src/trace_processor/perfetto_sql/engine/static_table_function_module.h"
+#include "src/trace_processor/perfetto_sql/grammar/perfettosql_grammar.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/table_functions/static_table_function.h"
 #include "src/trace_processor/perfetto_sql/parser/function_util.h"
 #include "src/trace_processor/perfetto_sql/parser/perfetto_sql_parser.h"
 #include "src/trace_processor/perfetto_sql/preprocessor/perfetto_sql_preprocessor.h"
+#include "src/trace_processor/perfetto_sql/tokenizer/sqlite_tokenizer.h"
 #include "src/trace_processor/sqlite/bindings/sqlite_column.h"
 #include "src/trace_processor/sqlite/bindings/sqlite_type.h"
 #include "src/trace_processor/sqlite/bindings/sqlite_value.h"
@@ -395,6 +401,63 @@ GetTypesFromSelectStatement(
   return types;
 }
 
+// The modules included and the tables created by a module.
+struct ModuleStatements {
+  std::vector<std::string> includes;
+  std::vector<std::string> tables;
+};
+
+// Finds the INCLUDE PERFETTO MODULE and CREATE PERFETTO TABLE statements of
+// |sql| by only tokenizing it. This is a best effort as it is only used to
+// prefetch tables: anything missed here is simply loaded when executed.
+ModuleStatements ScanModuleStatements(const std::string& sql) {
+  ModuleStatements statements;
+  SqliteTokenizer tokenizer(SqlSource::FromTraceProcessorImplementation(sql));
+  auto next = [&tokenizer]() { return tokenizer.NextNonWhitespace(); };
+  for (auto t = next(); !t.str.empty(); t = next()) {
+    if (t.token_type == TK_INCLUDE) {
+      if (next().token_type != TK_PERFETTO || next().token_type != TK_MODULE) {
+        continue;
+      }
+      std::string key;
+      for (t = next(); !t.IsTerminal(); t = next()) {
+        key.append(t.str);
+      }
+      statements.includes.push_back(std::move(key));
+    } else if (t.token_type == TK_CREATE) {
+      t = next();
+      if (t.token_type == TK_OR) {
+        next();
+        t = next();
+      }
+      if (t.token_type != TK_PERFETTO || next().token_type != TK_TABLE) {
+        continue;
+      }
+      statements.tables.emplace_back(next().str);
+    }
+  }
+  return statements;
+}
+
+// Returns whether a temporary table or view named |name| exists. As the temp
+// schema is searched first, such an object hides the table of the same name in
+// the main schema.
+bool IsTempTableOrView(sqlite3* db, const std::string& name) {
+  constexpr char kSql[] =
+      "SELECT 1 FROM sqlite_temp_master "
+      "WHERE type IN ('table', 'view') AND name = ?1 COLLATE NOCASE";
+  sqlite3_stmt* raw_stmt = nullptr;
+  int err = sqlite3_prepare_v2(db, kSql, -1, &raw_stmt, nullptr);
+  ScopedStmt stmt(raw_stmt);
+  if (err != SQLITE_OK) {
+    // Let SQLite execute the query if in doubt.
+    return true;
+  }
+  sqlite3_bind_text(*stmt, 1, name.c_str(), static_cast<int>(name.size()),
+                    SQLITE_STATIC);
+  return sqlite3_step(*stmt) != SQLITE_DONE;
+}
+
 }  // namespace
 
 PerfettoSqlEngine::PerfettoSqlEngine(StringPool* pool, bool enable_extra_checks)
@@ -548,6 +611,8 @@ PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
     }
     execution_stack_.pop_back();
   }
+  // Includes which failed don't get to the end of their modules.
+  DiscardPrefetchedModuleTables();
   return result;
 }
 
@@ -581,7 +646,8 @@ base::StatusOr<PerfettoSqlEngine::FrameResult> PerfettoSqlEngine::ProcessFrame(
              /*wildcard_modules=*/{},
              /*wildcard_index=*/0,
              /*wildcard_traceback_sql=*/
-             SqlSource::FromTraceProcessorImplementation("")});
+             SqlSource::FromTraceProcessorImplementation(""),
+             /*created_tables=*/0});
         return FrameResult::kContinue;
       }
     }
@@ -752,7 +818,8 @@ PerfettoSqlEngine::ExecuteUntilLastStatementImpl(SqlSource sql_source) {
        /*traceback_sql=*/SqlSource::FromTraceProcessorImplementation(""),
        /*wildcard_modules=*/{}, /*wildcard_index=*/0,
        /*wildcard_traceback_sql=*/
-       SqlSource::FromTraceProcessorImplementation("")});
+       SqlSource::FromTraceProcessorImplementation(""),
+       /*created_tables=*/0});
 
   // Main loop - process frames from the stack.
   while (!execution_stack_.empty()) {
@@ -765,6 +832,7 @@ PerfettoSqlEngine::ExecuteUntilLastStatementImpl(SqlSource sql_source) {
         continue;
       case FrameResult::kFrameDone:
         execution_stack_.pop_back();
+        DiscardPrefetchedModuleTables();
         continue;
       case FrameResult::kReturnResult: {
         auto& frame = execution_stack_.back();
@@ -786,6 +854,25 @@ const dataframe::Dataframe* PerfettoSqlEngine::GetDataframeOrNull(
   return state ? state->dataframe : nullptr;
 }
 
+std::unique_ptr<DataframeScan> PerfettoSqlEngine::PrepareDataframeScan(
+    const std::string& sql) {
+  std::optional<DataframeScan::Query> query = DataframeScan::Parse(sql);
+  if (!query) {
+    return nullptr;
+  }
+  auto* state = dataframe_context_->GetStateByName(query->table);
+  if (!state) {
+    return nullptr;
+  }
+  // Dataframe tables live in the main schema: an unqualified name refers to a
+  // temporary table or view instead if one has the same name.
+  if (IsTempTableOrView(sqlite_engine()->db(), query->table)) {
+    return nullptr;
+  }
+  return DataframeScan::Create(*query, state,
+                               dataframe_context_->query_thread_pool);
+}
+
 base::Status PerfettoSqlEngine::RegisterLegacyRuntimeFunction(
     bool replace,
     const FunctionPrototype& prototype,
@@ -824,24 +911,32 @@ base::Status PerfettoSqlEngine::ExecuteCreateTable(
                     [&create_table](metatrace::Record* record) {
                       record->AddArg("table_name", create_table.name);
                     });
-  auto stmt_or = engine_->PrepareStatement(create_table.sql);
-  RETURN_IF_ERROR(stmt_or.status());
-  SqliteEngine::PreparedStatement stmt = std::move(stmt_or);
-  ASSIGN_OR_RETURN(auto column_names, GetColumnNamesFromSelectStatement(
-                                          stmt, "CREATE PERFETTO TABLE"));
-  ASSIGN_OR_RETURN(auto schema, ValidateAndGetEffectiveSchema(
-                                    column_names, create_table.schema,
-                                    "CREATE PERFETTO TABLE"));
-  ASSIGN_OR_RETURN(auto types, GetTypesFromSelectStatement(
-                                   false, schema, column_names,
-                                   create_table.name, "CREATE PERFETTO TABLE"));
-  auto* sqlite_stmt = stmt.sqlite_stmt();
-  SqliteStmtValueFetcher fetcher{{}, sqlite_stmt};
-  ASSIGN_OR_RETURN(
-      auto dataframe,
-      CreateDataframeFromSqliteStatement(
-          engine_->db(), pool_, std::move(column_names), std::move(types),
-          sqlite_stmt, create_table.name, &fetcher, "CREATE PERFETTO TABLE"));
+
+  // Tables created by cacheable modules are looked up in the module cache
+  // before being computed. Copy the key as executing statements can
+  // reallocate the execution stack.
+  std::optional<ModuleCache::TableKey> cache_key;
+  if (ExecutionFrame& frame = execution_stack_.back();
+      frame.type == FrameType::kInclude) {
+    uint32_t index = frame.created_tables++;
+    if (module_cache_ && module_cache_->IsCacheable(frame.include_key)) {
+      cache_key = ModuleCache::TableKey{frame.include_key, create_table.name,
+                                        index};
+    }
+  }
+  std::optional<dataframe::Dataframe> dataframe;
+  if (cache_key) {
+    dataframe = module_cache_->Load(*cache_key, pool_);
+  }
+  if (!dataframe) {
+    int64_t start_ns = base::GetWallTimeNs().count();
+    ASSIGN_OR_RETURN(auto computed, ComputeCreateTable(create_table));
+    if (cache_key) {
+      module_cache_->Store(*cache_key, computed,
+                           base::GetWallTimeNs().count() - start_ns, pool_);
+    }
+    dataframe = std::move(computed);
+  }
 
   base::StackString<1024> drop("DROP TABLE IF EXISTS %s;",
                                create_table.name.c_str());
@@ -859,7 +954,7 @@ base::Status PerfettoSqlEngine::ExecuteCreateTable(
   PERFETTO_CHECK(!dataframe_context_->temporary_create_state);
   dataframe_context_->temporary_create_state =
       std::make_unique<DataframeModule::State>(
-          std::make_unique<dataframe::Dataframe>(std::move(dataframe)));
+          std::make_unique<dataframe::Dataframe>(std::move(*dataframe)));
 
   auto exec_res = Execute(
       SqlSource::FromTraceProcessorImplementation(sql_str.ToStdString()));
@@ -886,6 +981,26 @@ base::Status PerfettoSqlEngine::ExecuteCreateTable(
   return exec_res.status();
 }
 
+base::StatusOr<dataframe::Dataframe> PerfettoSqlEngine::ComputeCreateTable(
+    const PerfettoSqlParser::CreateTable& create_table) {
+  auto stmt_or = engine_->PrepareStatement(create_table.sql);
+  RETURN_IF_ERROR(stmt_or.status());
+  SqliteEngine::PreparedStatement stmt = std::move(stmt_or);
+  ASSIGN_OR_RETURN(auto column_names, GetColumnNamesFromSelectStatement(
+                                          stmt, "CREATE PERFETTO TABLE"));
+  ASSIGN_OR_RETURN(auto schema, ValidateAndGetEffectiveSchema(
+                                    column_names, create_table.schema,
+                                    "CREATE PERFETTO TABLE"));
+  ASSIGN_OR_RETURN(auto types, GetTypesFromSelectStatement(
+                                   false, schema, column_names,
+                                   create_table.name, "CREATE PERFETTO TABLE"));
+  auto* sqlite_stmt = stmt.sqlite_stmt();
+  SqliteStmtValueFetcher fetcher{{}, sqlite_stmt};
+  return CreateDataframeFromSqliteStatement(
+      engine_->db(), pool_, std::move(column_names), std::move(types),
+      sqlite_stmt, create_table.name, &fetcher, "CREATE PERFETTO TABLE");
+}
+
 base::Status PerfettoSqlEngine::ExecuteCreateView(
     const PerfettoSqlParser::CreateView& create_view) {
   PERFETTO_TP_TRACE(metatrace::Category::QUERY_TIMELINE, "CREATE PERFETTO VIEW",
@@ -957,6 +1072,7 @@ base::Status PerfettoSqlEngine::ExecuteInclude(
       [&](metatrace::Record* r) { r->AddArg("include", include.key); });
 
   const std::string& key = include.key;
+  PrefetchModuleTables(key);
   if (key == "*") {
     for (auto package = packages_.GetIterator(); package; ++package) {
       RETURN_IF_ERROR(IncludePackageImpl(package.value(), key, parser));
@@ -984,6 +1100,99 @@ base::Status PerfettoSqlEngine::ExecuteInclude(
   return IncludePackageImpl(*package, key, parser);
 }
 
+void PerfettoSqlEngine::PrefetchModuleTables(const std::string& include_key) {
+  base::ThreadPool* thread_pool = dataframe_context_->query_thread_pool;
+  if (!module_cache_ || !thread_pool) {
+    return;
+  }
+  // The modules included by a module being included were already covered by
+  // the outermost INCLUDE.
+  if (IsIncludingModule()) {
+    return;
+  }
+
+  // Walk the include graph depth first, emitting the tables of each module
+  // after the ones of its dependencies, in the order the statements will be
+  // executed. Already included modules are skipped as their tables exist.
+  struct PendingModule {
+    std::string key;
+    ModuleStatements statements;
+    size_t next_include = 0;
+  };
+  std::vector<PendingModule> stack;
+  base::FlatHashMap<std::string, bool> visited;
+  auto push = [&](const std::string& key) {
+    for (auto& [module_key, file] : MatchModules(key)) {
+      if (file->included || !visited.Insert(module_key, true).second) {
+        continue;
+      }
+      stack.push_back({module_key, ScanModuleStatements(file->sql)});
+    }
+  };
+  std::vector<ModuleCache::TableKey> tables;
+  push(include_key);
+  while (!stack.empty()) {
+    PendingModule& module = stack.back();
+    if (module.next_include < module.statements.includes.size()) {
+      // Copy the key as |stack| can be reallocated.
+      std::string dep = module.statements.includes[module.next_include++];
+      push(dep);
+      continue;
+    }
+    for (uint32_t i = 0; i < module.statements.tables.size(); ++i) {
+      tables.push_back({module.key, module.statements.tables[i], i});
+    }
+    stack.pop_back();
+  }
+  module_cache_->Prefetch(tables, thread_pool, pool_);
+}
+
+void PerfettoSqlEngine::DiscardPrefetchedModuleTables() {
+  // The statements of a module can run nested queries (e.g. to create
+  // functions) while the module is being included: only discard once the
+  // whole include is done.
+  if (module_cache_ && !IsIncludingModule()) {
+    module_cache_->DiscardPrefetched();
+  }
+}
+
+bool PerfettoSqlEngine::IsIncludingModule() const {
+  return std::any_of(execution_stack_.begin(), execution_stack_.end(),
+                     [](const ExecutionFrame& frame) {
+                       return frame.type != FrameType::kRoot;
+                     });
+}
+
+std::vector<
+    std::pair<std::string, sql_modules::RegisteredPackage::ModuleFile*>>
+PerfettoSqlEngine::MatchModules(const std::string& include_key) {
+  std::vector<
+      std::pair<std::string, sql_modules::RegisteredPackage::ModuleFile*>>
+      modules;
+  auto match = [&](sql_modules::RegisteredPackage& package) {
+    if (include_key.empty() || include_key.back() != '*') {
+      if (auto* file = package.modules.Find(include_key); file) {
+        modules.emplace_back(include_key, file);
+      }
+      return;
+    }
+    std::string prefix = include_key.substr(0, include_key.size() - 1);
+    for (auto module = package.modules.GetIterator(); module; ++module) {
+      if (base::StartsWith(module.key(), prefix)) {
+        modules.emplace_back(module.key(), &module.value());
+      }
+    }
+  };
+  if (include_key == "*") {
+    for (auto package = packages_.GetIterator(); package; ++package) {
+      match(package.value());
+    }
+  } else if (auto* package = FindPackageForModule(include_key); package) {
+    match(*package);
+  }
+  return modules;
+}
+
 base::Status PerfettoSqlEngine::ExecuteCreateIndex(
     const PerfettoSqlParser::CreateIndex& create_index) {
   PERFETTO_TP_TRACE(
@@ -1097,7 +1306,8 @@ base::Status PerfettoSqlEngine::IncludePackageImpl(
          /*include_key=*/{}, /*file_ptr=*/nullptr,
          /*traceback_sql=*/SqlSource::FromTraceProcessorImplementation(""),
          std::move(matching_modules), /*wildcard_index=*/0,
-         /*wildcard_traceback_sql=*/parser.statement_sql()});
+         /*wildcard_traceback_sql=*/parser.statement_sql(),
+         /*created_tables=*/0});
     return base::OkStatus();
   }
   auto* module_file = package.modules.Find(include_key);
@@ -1124,7 +1334,8 @@ base::Status PerfettoSqlEngine::IncludeModuleImpl(
                               /*traceback_sql=*/parser.statement_sql(),
                               /*wildcard_modules=*/{}, /*wildcard_index=*/0,
                               /*wildcard_traceback_sql=*/
-                              SqlSource::FromTraceProcessorImplementation("")});
+                              SqlSource::FromTraceProcessorImplementation(""),
+                              /*created_tables=*/0});
 
   return base::OkStatus();
 }
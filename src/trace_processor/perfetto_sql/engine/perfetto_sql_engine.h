@@ -33,6 +33,7 @@
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/core/dataframe/dataframe.h"
 #include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
 #include "src/trace_processor/perfetto_sql/engine/runtime_table_function.h"
 #include "src/trace_processor/perfetto_sql/engine/static_table_function_module.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/table_functions/static_table_function.h"
@@ -50,6 +51,8 @@
 
 namespace perfetto::trace_processor {
 
+class ModuleCache;
+
 // Intermediary class which translates high-level concepts and algorithms used
 // in trace processor into lower-level concepts and functions can be understood
 // by and executed against SQLite.
@@ -277,6 +280,21 @@ class PerfettoSqlEngine {
   // Find dataframe registered with engine with provided name.
   const dataframe::Dataframe* GetDataframeOrNull(const std::string& name) const;
 
+  // Returns a DataframeScan executing |sql| directly on a dataframe table if
+  // |sql| is a query supported by DataframeScan, or nullptr if |sql| should
+  // be executed by SQLite.
+  std::unique_ptr<DataframeScan> PrepareDataframeScan(const std::string& sql);
+
+  // Sets the thread pool used to execute large scans over dataframes in
+  // parallel. |pool| must outlive this engine.
+  void SetQueryThreadPool(base::ThreadPool* pool) {
+    dataframe_context_->query_thread_pool = pool;
+  }
+
+  // Sets the cache used to load the tables created by modules instead of
+  // computing them. |cache| must outlive this engine.
+  void SetModuleCache(ModuleCache* cache) { module_cache_ = cache; }
+
   // Registers a function with the prototype |prototype| which returns a value
   // of |return_type| and is implemented by executing the SQL statement |sql|.
   //
@@ -318,6 +336,10 @@ class PerfettoSqlEngine {
         wildcard_modules;
     size_t wildcard_index = 0;
     SqlSource wildcard_traceback_sql;
+
+    // For include frames: the number of CREATE PERFETTO TABLE statements
+    // executed so far, used to identify tables in the module cache.
+    uint32_t created_tables = 0;
   };
 
   void RegisterStaticTable(dataframe::Dataframe*, const std::string&);
@@ -339,10 +361,38 @@ class PerfettoSqlEngine {
   base::Status ExecuteInclude(const PerfettoSqlParser::Include&,
                               const PerfettoSqlParser& parser);
 
+  // Starts loading the cached tables of the modules matched by |include_key|
+  // and of all the modules they transitively include on the query thread
+  // pool, dependencies first, so that the tables are ready by the time their
+  // statements are executed.
+  //
+  // This only helps warm includes: a table missing from the cache is still
+  // computed by executing its statement on this thread, in module order, as
+  // all SQL runs on the single SQLite connection of the engine.
+  void PrefetchModuleTables(const std::string& include_key);
+
+  // Drops the prefetched tables which were not used once the outermost
+  // INCLUDE is done.
+  void DiscardPrefetchedModuleTables();
+
+  // Returns true if a module is being included, i.e. if any frame of the
+  // execution stack is not a root frame.
+  bool IsIncludingModule() const;
+
+  // Returns the registered modules matched by |include_key|, which can end
+  // with a wildcard.
+  std::vector<
+      std::pair<std::string, sql_modules::RegisteredPackage::ModuleFile*>>
+  MatchModules(const std::string& include_key);
+
   // Creates a runtime table and registers it with SQLite.
   base::Status ExecuteCreateTable(
       const PerfettoSqlParser::CreateTable& create_table);
 
+  // Executes the select statement of |create_table| and returns its result.
+  base::StatusOr<dataframe::Dataframe> ComputeCreateTable(
+      const PerfettoSqlParser::CreateTable& create_table);
+
   base::Status ExecuteCreateView(const PerfettoSqlParser::CreateView&);
 
   base::Status ExecuteCreateMacro(const PerfettoSqlParser::CreateMacro&);
@@ -425,6 +475,7 @@ class PerfettoSqlEngine {
   RuntimeTableFunctionModule::Context* runtime_table_fn_context_ = nullptr;
   StaticTableFunctionModule::Context* static_table_fn_context_ = nullptr;
   DataframeModule::Context* dataframe_context_ = nullptr;
+  ModuleCache* module_cache_ = nullptr;
   base::FlatHashMap<std::string, sql_modules::RegisteredPackage> packages_;
   base::FlatHashMap<std::string, PerfettoSqlPreprocessor::Macro> macros_;
 
@@ -20,7 +20,12 @@
 #include <utility>
 #include <vector>
 
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "src/base/test/tmp_dir_tree.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_scan.h"
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
 #include "src/trace_processor/sqlite/bindings/sqlite_result.h"
 #include "src/trace_processor/sqlite/sql_source.h"
 #include "src/trace_processor/util/sql_modules.h"
@@ -29,6 +34,8 @@
 namespace perfetto::trace_processor {
 namespace {
 
+using ::testing::ElementsAre;
+
 class PerfettoSqlEngineTest : public ::testing::Test {
  protected:
   StringPool pool_;
@@ -204,6 +211,19 @@ TEST_F(PerfettoSqlEngineTest, Table_Duplicates) {
   ASSERT_TRUE(res.ok()) << res.status().c_message();
 }
 
+TEST_F(PerfettoSqlEngineTest, Table_DataframeScan) {
+  auto res = engine_.Execute(SqlSource::FromExecuteQuery(
+      "CREATE PERFETTO TABLE foo AS SELECT 42 AS bar"));
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+  EXPECT_NE(engine_.PrepareDataframeScan("SELECT bar FROM foo"), nullptr);
+
+  // Unqualified names resolve to temporary tables and views first.
+  res = engine_.Execute(
+      SqlSource::FromExecuteQuery("CREATE TEMP VIEW FOO AS SELECT 1 AS bar"));
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+  EXPECT_EQ(engine_.PrepareDataframeScan("SELECT bar FROM foo"), nullptr);
+}
+
 TEST_F(PerfettoSqlEngineTest, View_Create) {
   auto res = engine_.Execute(SqlSource::FromExecuteQuery(
       "CREATE PERFETTO VIEW foo AS SELECT 42 AS bar"));
@@ -322,6 +342,57 @@ TEST_F(PerfettoSqlEngineTest, Include_Module) {
   ASSERT_FALSE(engine_.FindPackage("bar")->modules["bar.bar"].included);
 }
 
+TEST_F(PerfettoSqlEngineTest, Include_PrefetchesCachedTables) {
+  // The prefetched tables are found by tokenizing the modules: the statements
+  // which only look like table creations must not shift the indices of the
+  // tables relative to the ones counted when executing the module.
+  const std::vector<std::pair<std::string, std::string>> kModules{
+      {"foo.base", "CREATE PERFETTO TABLE base AS SELECT 1 AS x"},
+      {"foo.tables",
+       "INCLUDE PERFETTO MODULE foo.base;\n"
+       "-- CREATE PERFETTO TABLE in_comment AS SELECT 1 AS x;\n"
+       "CREATE PERFETTO VIEW v AS SELECT 'CREATE PERFETTO TABLE t' AS x;\n"
+       "CREATE OR REPLACE PERFETTO TABLE t1 AS SELECT x FROM base;\n"
+       "CREATE PERFETTO FUNCTION f() RETURNS INT AS SELECT 1;\n"
+       "CREATE PERFETTO TABLE t2(x INT) AS SELECT x FROM t1;"},
+  };
+  base::TmpDirTree tmp;
+  tmp.AddDir("cache");
+  base::ThreadPool thread_pool(2);
+
+  // Includes foo.tables in a new engine sharing the cache directory.
+  auto include = [&]() {
+    StringPool pool;
+    pool.set_locking(true);
+    ModuleCache cache(tmp.AbsolutePath("cache"));
+    cache.AddCacheablePackage("foo");
+    cache.SetTraceHash(1);
+    PerfettoSqlEngine engine(&pool, true);
+    engine.SetModuleCache(&cache);
+    engine.SetQueryThreadPool(&thread_pool);
+    engine.RegisterPackage("foo", CreateTestPackage(kModules));
+    auto res = engine.Execute(
+        SqlSource::FromExecuteQuery("INCLUDE PERFETTO MODULE foo.tables"));
+    EXPECT_TRUE(res.ok()) << res.status().c_message();
+    std::vector<std::string> lookups;
+    for (const ModuleCache::Entry& entry : cache.entries()) {
+      lookups.push_back(entry.table_name + (entry.hit ? " hit" : " miss") +
+                        (entry.prefetched ? " prefetched" : ""));
+    }
+    return lookups;
+  };
+  EXPECT_THAT(include(), ElementsAre("base miss", "t1 miss", "t2 miss"));
+  EXPECT_THAT(include(), ElementsAre("base hit prefetched",
+                                     "t1 hit prefetched",
+                                     "t2 hit prefetched"));
+
+  std::vector<std::string> files;
+  ASSERT_TRUE(base::ListFilesRecursive(tmp.AbsolutePath("cache"), files).ok());
+  for (const auto& file : files) {
+    tmp.TrackFile("cache/" + file);
+  }
+}
+
 TEST_F(PerfettoSqlEngineTest, DelegatingFunction_Error_TargetNotFound) {
   // Test error when target function doesn't exist in registry
   auto res = engine_.Execute(
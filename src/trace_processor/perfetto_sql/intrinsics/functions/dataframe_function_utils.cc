@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_function_utils.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_result.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_type.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_value.h"
+#include "src/trace_processor/sqlite/sqlite_utils.h"
+
+namespace perfetto::trace_processor::perfetto_sql {
+
+base::StatusOr<std::vector<std::string>> ReadTextArgs(const char* fn,
+                                                      const char* usage,
+                                                      int min_argc,
+                                                      int argc,
+                                                      sqlite3_value** argv) {
+  if (argc < min_argc) {
+    return base::ErrStatus("%s: expected at least %d arguments (%s)", fn,
+                           min_argc, usage);
+  }
+  std::vector<std::string> args;
+  args.reserve(static_cast<size_t>(argc));
+  for (int i = 0; i < argc; ++i) {
+    if (sqlite::value::Type(argv[i]) != sqlite::Type::kText) {
+      return base::ErrStatus("%s: arguments must be strings", fn);
+    }
+    args.emplace_back(sqlite::value::Text(argv[i]));
+  }
+  return args;
+}
+
+base::StatusOr<const dataframe::Dataframe*> GetDataframeArg(
+    const char* fn,
+    PerfettoSqlEngine* engine,
+    const std::string& table_name) {
+  const dataframe::Dataframe* df = engine->GetDataframeOrNull(table_name);
+  if (!df) {
+    return base::ErrStatus(
+        "%s: table '%s' does not exist or is not backed by a dataframe", fn,
+        table_name.c_str());
+  }
+  return df;
+}
+
+void ReturnDataframe(sqlite3_context* ctx,
+                     base::StatusOr<dataframe::Dataframe> result) {
+  if (!result.ok()) {
+    return sqlite::utils::SetError(ctx, result.status());
+  }
+  return sqlite::result::UniquePointer(
+      ctx, std::make_unique<dataframe::Dataframe>(std::move(*result)),
+      "TABLE");
+}
+
+}  // namespace perfetto::trace_processor::perfetto_sql
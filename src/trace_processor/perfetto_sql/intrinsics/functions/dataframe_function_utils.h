@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_INTRINSICS_FUNCTIONS_DATAFRAME_FUNCTION_UTILS_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_INTRINSICS_FUNCTIONS_DATAFRAME_FUNCTION_UTILS_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_value.h"
+
+namespace perfetto::trace_processor::perfetto_sql {
+
+// Helpers for the functions which compute a dataframe natively from
+// dataframe-backed tables (e.g. __intrinsic_group_by, __intrinsic_hash_join).
+// These take table names, column names and spec strings as arguments and
+// return the result as a TABLE pointer.
+
+// The user data of such functions.
+struct DataframeFunctionUserData {
+  PerfettoSqlEngine* engine;
+  StringPool* pool;
+};
+
+// Returns the text of all the arguments. |fn| prefixes the error messages and
+// |usage| describes the expected arguments if there are less than |min_argc|.
+base::StatusOr<std::vector<std::string>> ReadTextArgs(const char* fn,
+                                                      const char* usage,
+                                                      int min_argc,
+                                                      int argc,
+                                                      sqlite3_value** argv);
+
+// Returns the dataframe backing the table |table_name|.
+base::StatusOr<const dataframe::Dataframe*> GetDataframeArg(
+    const char* fn,
+    PerfettoSqlEngine* engine,
+    const std::string& table_name);
+
+// Parses each of the arguments of |args| starting at |first| with |parse|, a
+// function returning a base::StatusOr<Spec> for a spec string.
+template <typename Parse>
+auto ParseSpecArgs(const std::vector<std::string>& args,
+                   size_t first,
+                   Parse parse)
+    -> base::StatusOr<
+        std::vector<typename decltype(parse(std::string()))::value_type>> {
+  std::vector<typename decltype(parse(std::string()))::value_type> specs;
+  for (size_t i = first; i < args.size(); ++i) {
+    ASSIGN_OR_RETURN(auto spec, parse(args[i]));
+    specs.push_back(std::move(spec));
+  }
+  return specs;
+}
+
+// Returns |result| to SQLite as a TABLE pointer.
+void ReturnDataframe(sqlite3_context* ctx,
+                     base::StatusOr<dataframe::Dataframe> result);
+
+}  // namespace perfetto::trace_processor::perfetto_sql
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_INTRINSICS_FUNCTIONS_DATAFRAME_FUNCTION_UTILS_H_
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/group_by.h"
+
+#include <memory>
+
+#include "perfetto/base/status.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/aggregate/aggregate_spec.h"
+#include "src/trace_processor/core/aggregate/group_by_aggregator.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_function_utils.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_function.h"
+#include "src/trace_processor/sqlite/sqlite_utils.h"
+
+namespace perfetto::trace_processor::perfetto_sql {
+namespace {
+
+// Groups the rows of a dataframe-backed table by a key column and computes
+// aggregates for every group natively, without going through SQLite.
+//
+// Takes the name of the table, the name of the key column and one or more
+// spec strings of the form 'AGG(source_col) AS output_col'. Returns a TABLE
+// pointer with the key column followed by one column per spec.
+struct GroupBy : public sqlite::Function<GroupBy> {
+  static constexpr char kName[] = "__intrinsic_group_by";
+  static constexpr int kArgCount = -1;
+
+  using UserData = DataframeFunctionUserData;
+
+  static void Step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto args,
+        ReadTextArgs("group_by",
+                     "table_name, key_col, 'AGG(col) AS alias', ...", 3, argc,
+                     argv));
+    UserData* data = GetUserData(ctx);
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto* df, GetDataframeArg("group_by", data->engine, args[0]));
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto specs,
+        ParseSpecArgs(args, 2, aggregate::ParseAggregateSpec));
+    return ReturnDataframe(ctx, aggregate::GroupByAggregator::Aggregate(
+                                    *df, args[1], specs, data->pool));
+  }
+};
+
+}  // namespace
+
+base::Status RegisterGroupByFunctions(PerfettoSqlEngine& engine,
+                                      StringPool* pool) {
+  return engine.RegisterFunction<GroupBy>(
+      std::make_unique<DataframeFunctionUserData>(
+          DataframeFunctionUserData{&engine, pool}));
+}
+
+}  // namespace perfetto::trace_processor::perfetto_sql
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares SQLite's GROUP BY, which pulls every row of the table through the
+// vtable cursor, with the native group by of std.aggregation.group_by on the
+// slice and sched tables of a real trace.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/read_trace.h"
+#include "perfetto/trace_processor/trace_processor.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+constexpr char kTracePath[] = "test/data/example_android_trace_30s.pb";
+
+std::unique_ptr<TraceProcessor> CreateTp(benchmark::State& state) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  if (!ReadTrace(tp.get(), kTracePath).ok()) {
+    state.SkipWithError(
+        "Test data missing. Please ensure "
+        "test/data/example_android_trace_30s.pb exists.");
+    return nullptr;
+  }
+  auto it =
+      tp->ExecuteQuery("INCLUDE PERFETTO MODULE std.aggregation.group_by");
+  while (it.Next()) {
+  }
+  PERFETTO_CHECK(it.Status().ok());
+  return tp;
+}
+
+void RunQuery(benchmark::State& state, const std::string& query) {
+  auto tp = CreateTp(state);
+  if (!tp) {
+    return;
+  }
+  int64_t groups = 0;
+  for (auto _ : state) {
+    groups = 0;
+    auto it = tp->ExecuteQuery(query);
+    while (it.Next()) {
+      groups++;
+    }
+    PERFETTO_CHECK(it.Status().ok());
+    benchmark::ClobberMemory();
+  }
+  state.counters["groups"] = static_cast<double>(groups);
+}
+
+}  // namespace
+
+static void BM_GroupBySliceTrackSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT track_id, COUNT(*) AS cnt, SUM(dur) AS total_dur
+    FROM __intrinsic_slice
+    GROUP BY track_id
+  )");
+}
+
+static void BM_GroupBySliceTrackNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _group_by_to_table!(
+      _group_by('__intrinsic_slice', 'track_id',
+                'COUNT() AS cnt', 'SUM(dur) AS total_dur'),
+      track_id,
+      (cnt, total_dur)
+    )
+  )");
+}
+
+static void BM_GroupBySchedUtidSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT utid, SUM(dur) AS total_dur, MAX(dur) AS max_dur
+    FROM __intrinsic_sched_slice
+    GROUP BY utid
+  )");
+}
+
+static void BM_GroupBySchedUtidNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _group_by_to_table!(
+      _group_by('__intrinsic_sched_slice', 'utid',
+                'SUM(dur) AS total_dur', 'MAX(dur) AS max_dur'),
+      utid,
+      (total_dur, max_dur)
+    )
+  )");
+}
+
+static void BM_GroupBySchedCpuSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT ucpu, COUNT(*) AS cnt, AVG(dur) AS avg_dur
+    FROM __intrinsic_sched_slice
+    GROUP BY ucpu
+  )");
+}
+
+static void BM_GroupBySchedCpuNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _group_by_to_table!(
+      _group_by('__intrinsic_sched_slice', 'ucpu',
+                'COUNT() AS cnt', 'AVG(dur) AS avg_dur'),
+      ucpu,
+      (cnt, avg_dur)
+    )
+  )");
+}
+
+BENCHMARK(BM_GroupBySliceTrackSqlite);
+BENCHMARK(BM_GroupBySliceTrackNative);
+BENCHMARK(BM_GroupBySchedUtidSqlite);
+BENCHMARK(BM_GroupBySchedUtidNative);
+BENCHMARK(BM_GroupBySchedCpuSqlite);
+BENCHMARK(BM_GroupBySchedCpuNative);
+
+}  // namespace perfetto::trace_processor
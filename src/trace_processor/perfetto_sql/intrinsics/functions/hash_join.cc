@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/hash_join.h"
+
+#include <memory>
+
+#include "perfetto/base/status.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/join/hash_joiner.h"
+#include "src/trace_processor/core/join/join_spec.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_function_utils.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_function.h"
+#include "src/trace_processor/sqlite/sqlite_utils.h"
+
+namespace perfetto::trace_processor::perfetto_sql {
+namespace {
+
+// Computes the inner equi-join of two dataframe-backed tables natively,
+// without going through SQLite's nested loop join.
+//
+// Takes the name and key column of the left table, the name and key column
+// of the right table and one or more column spec strings of the form
+// 'left.col [AS alias]' or 'right.col [AS alias]'. Returns a TABLE pointer
+// with one column per spec.
+struct HashJoin : public sqlite::Function<HashJoin> {
+  static constexpr char kName[] = "__intrinsic_hash_join";
+  static constexpr int kArgCount = -1;
+
+  using UserData = DataframeFunctionUserData;
+
+  static void Step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto args,
+        ReadTextArgs("hash_join",
+                     "left_table, left_key, right_table, right_key, "
+                     "'side.col AS alias', ...",
+                     5, argc, argv));
+    UserData* data = GetUserData(ctx);
+    SQLITE_ASSIGN_OR_RETURN(ctx, auto* left,
+                            GetDataframeArg("hash_join", data->engine,
+                                            args[0]));
+    SQLITE_ASSIGN_OR_RETURN(ctx, auto* right,
+                            GetDataframeArg("hash_join", data->engine,
+                                            args[2]));
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto columns,
+        ParseSpecArgs(args, 4, join::ParseJoinColumnSpec));
+    return ReturnDataframe(
+        ctx, join::HashJoiner::InnerJoin(*left, args[1], *right, args[3],
+                                         columns, data->pool));
+  }
+};
+
+}  // namespace
+
+base::Status RegisterHashJoinFunctions(PerfettoSqlEngine& engine,
+                                       StringPool* pool) {
+  return engine.RegisterFunction<HashJoin>(
+      std::make_unique<DataframeFunctionUserData>(
+          DataframeFunctionUserData{&engine, pool}));
+}
+
+}  // namespace perfetto::trace_processor::perfetto_sql
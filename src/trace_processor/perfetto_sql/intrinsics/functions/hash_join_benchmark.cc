@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares SQLite's nested loop JOIN, which filters the inner table once per
+// row of the outer one, with the native hash join of std.join.hash_join on
+// the join shapes most common in the stdlib, on a real trace.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/read_trace.h"
+#include "perfetto/trace_processor/trace_processor.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+constexpr char kTracePath[] = "test/data/example_android_trace_30s.pb";
+
+std::unique_ptr<TraceProcessor> CreateTp(benchmark::State& state) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  if (!ReadTrace(tp.get(), kTracePath).ok()) {
+    state.SkipWithError(
+        "Test data missing. Please ensure "
+        "test/data/example_android_trace_30s.pb exists.");
+    return nullptr;
+  }
+  auto it =
+      tp->ExecuteQuery("INCLUDE PERFETTO MODULE std.join.hash_join");
+  while (it.Next()) {
+  }
+  PERFETTO_CHECK(it.Status().ok());
+  return tp;
+}
+
+void RunQuery(benchmark::State& state, const std::string& query) {
+  auto tp = CreateTp(state);
+  if (!tp) {
+    return;
+  }
+  int64_t rows = 0;
+  for (auto _ : state) {
+    rows = 0;
+    auto it = tp->ExecuteQuery(query);
+    while (it.Next()) {
+      rows++;
+    }
+    PERFETTO_CHECK(it.Status().ok());
+    benchmark::ClobberMemory();
+  }
+  state.counters["rows"] = static_cast<double>(rows);
+}
+
+}  // namespace
+
+// Id key: SQLite looks up every thread by id.
+static void BM_HashJoinSchedThreadSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT s.ts, s.dur, t.name AS thread_name
+    FROM __intrinsic_sched_slice s
+    JOIN __intrinsic_thread t ON s.utid = t.id
+  )");
+}
+
+static void BM_HashJoinSchedThreadNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _hash_join_to_table!(
+      _hash_join('__intrinsic_sched_slice', 'utid', '__intrinsic_thread', 'id',
+                 'left.ts', 'left.dur', 'right.name AS thread_name'),
+      (ts, dur, thread_name)
+    )
+  )");
+}
+
+static void BM_HashJoinThreadStateThreadSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT s.ts, s.state, t.name AS thread_name
+    FROM __intrinsic_thread_state s
+    JOIN __intrinsic_thread t ON s.utid = t.id
+  )");
+}
+
+static void BM_HashJoinThreadStateThreadNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _hash_join_to_table!(
+      _hash_join('__intrinsic_thread_state', 'utid', '__intrinsic_thread',
+                 'id', 'left.ts', 'left.state', 'right.name AS thread_name'),
+      (ts, state, thread_name)
+    )
+  )");
+}
+
+static void BM_HashJoinSliceTrackSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT s.ts, s.dur, t.name AS track_name
+    FROM __intrinsic_slice s
+    JOIN __intrinsic_track t ON s.track_id = t.id
+  )");
+}
+
+static void BM_HashJoinSliceTrackNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _hash_join_to_table!(
+      _hash_join('__intrinsic_slice', 'track_id', '__intrinsic_track', 'id',
+                 'left.ts', 'left.dur', 'right.name AS track_name'),
+      (ts, dur, track_name)
+    )
+  )");
+}
+
+// Non-id key: SQLite filters the args by arg set id for every slice.
+static void BM_HashJoinSliceArgsSqlite(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT s.id AS slice_id, a.key
+    FROM __intrinsic_slice s
+    JOIN __intrinsic_args a ON s.arg_set_id = a.arg_set_id
+  )");
+}
+
+static void BM_HashJoinSliceArgsNative(benchmark::State& state) {
+  RunQuery(state, R"(
+    SELECT * FROM _hash_join_to_table!(
+      _hash_join('__intrinsic_slice', 'arg_set_id', '__intrinsic_args',
+                 'arg_set_id', 'left.id AS slice_id', 'right.key'),
+      (slice_id, key)
+    )
+  )");
+}
+
+BENCHMARK(BM_HashJoinSchedThreadSqlite);
+BENCHMARK(BM_HashJoinSchedThreadNative);
+BENCHMARK(BM_HashJoinThreadStateThreadSqlite);
+BENCHMARK(BM_HashJoinThreadStateThreadNative);
+BENCHMARK(BM_HashJoinSliceTrackSqlite);
+BENCHMARK(BM_HashJoinSliceTrackNative);
+BENCHMARK(BM_HashJoinSliceArgsSqlite);
+BENCHMARK(BM_HashJoinSliceArgsNative);
+
+}  // namespace perfetto::trace_processor
@@ -68,6 +68,8 @@ std::vector<TableInfoTable::Row> GetColInfoRows(const dataframe::Dataframe* df,
     }
     row.nullable = col_spec.nullability.index();
     row.sorted = col_spec.sort_state.index();
+    row.encoding = pool->InternString(df->GetColumnEncoding(i));
+    row.size_bytes = static_cast<int64_t>(df->GetColumnMemoryUsage(i));
     rows.push_back(row);
   }
   return rows;
@@ -48,6 +48,10 @@ TABLE_INFO_TABLE = Table(
           cpp_access=CppAccess.READ_AND_HIGH_PERF_WRITE),
         C('nullable', CppInt64()),
         C('sorted', CppInt64()),
+        C('encoding',
+          CppString(),
+          cpp_access=CppAccess.READ_AND_HIGH_PERF_WRITE),
+        C('size_bytes', CppInt64()),
     ])
 
 SLICE_SUBSET_TABLE = Table(
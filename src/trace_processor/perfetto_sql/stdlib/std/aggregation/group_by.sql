@@ -0,0 +1,87 @@
+--
+-- Copyright 2026 The Android Open Source Project
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     https://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+-- sqlformat file off
+
+-- Groups the rows of a table by a key column and computes aggregates for
+-- every group natively, without going through SQLite's GROUP BY.
+--
+-- The table must be backed by a dataframe: intrinsic tables (e.g.
+-- `__intrinsic_slice`) and PERFETTO TABLEs are, views are not. The key column
+-- can have any type but DOUBLE; all NULL keys form a single group.
+--
+-- Each spec is a string of the form 'AGG(source_col) AS output_col' where AGG
+-- is one of COUNT, SUM, MIN, MAX, AVG (case-insensitive). COUNT takes no
+-- source column and counts the rows of the group. Like in SQLite, the other
+-- aggregates skip NULL values.
+--
+-- Example usage:
+-- ```
+-- SELECT * FROM _group_by_to_table!(
+--   _group_by('__intrinsic_slice', 'track_id',
+--             'SUM(dur) AS total_dur', 'COUNT() AS cnt'),
+--   track_id,
+--   (total_dur, cnt)
+-- );
+-- ```
+CREATE PERFETTO FUNCTION _group_by(
+    -- Name of the table to group.
+    table_name STRING,
+    -- Name of the column to group by.
+    key_col STRING,
+    -- Aggregate specs: 'AGG(source_col) AS output_col' (variadic)
+    specs ANY...
+)
+-- Returns a TABLE pointer with the key column and the aggregated columns.
+RETURNS ANY
+DELEGATES TO __intrinsic_group_by;
+
+-- Helper macro to generate column selection for _group_by_to_table.
+-- Maps column index (c1, c2, ...) to column name.
+CREATE PERFETTO MACRO _group_by_col_select(idx ColumnName, col ColumnName)
+RETURNS _ProjectionFragment AS $idx AS $col;
+
+-- Helper macro to generate column binding for _group_by_to_table.
+CREATE PERFETTO MACRO _group_by_col_bind(idx ColumnName, col ColumnName)
+RETURNS Expr AS
+  __intrinsic_table_ptr_bind($idx, __intrinsic_stringify!($col));
+
+-- Converts the result of _group_by to a table with one row per group.
+CREATE PERFETTO MACRO _group_by_to_table(
+    -- A TABLE pointer returned by _group_by.
+    group_by_ptr Expr,
+    -- The key column passed to _group_by.
+    key_col ColumnName,
+    -- The output columns of the specs passed to _group_by, in order.
+    columns ColumnNameList
+)
+RETURNS TableOrSubquery AS
+(
+  SELECT
+    c0 AS $key_col,
+    __intrinsic_token_apply!(
+      _group_by_col_select,
+      (c1, c2, c3, c4, c5, c6, c7, c8),
+      $columns
+    )
+  FROM __intrinsic_table_ptr($group_by_ptr)
+  WHERE
+    __intrinsic_table_ptr_bind(c0, __intrinsic_stringify!($key_col))
+    AND __intrinsic_token_apply_and!(
+      _group_by_col_bind,
+      (c1, c2, c3, c4, c5, c6, c7, c8),
+      $columns
+    )
+);
@@ -0,0 +1,91 @@
+--
+-- Copyright 2026 The Android Open Source Project
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     https://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+-- sqlformat file off
+
+-- Joins two tables on the equality of a key column of each, natively,
+-- without going through SQLite's nested loop join.
+--
+-- SQLite executes `a JOIN b ON a.x = b.y` by filtering `b` once for every row
+-- of `a`: if `b.y` is not indexed (or is not an id column) every filter is a
+-- full scan of `b`. _hash_join instead reads the right table once, building a
+-- hash table on its key, and probes it with every row of the left table.
+-- Prefer it for joins of large tables on non-indexed keys; for small tables
+-- a plain JOIN is just as fast.
+--
+-- Both tables must be backed by a dataframe: intrinsic tables (e.g.
+-- `__intrinsic_slice`) and PERFETTO TABLEs are, views are not. The key
+-- columns can have any type but DOUBLE; NULL keys match nothing.
+--
+-- Each column spec is a string of the form 'side.col' or 'side.col AS alias'
+-- where side is LEFT or RIGHT (case-insensitive).
+--
+-- Example usage:
+-- ```
+-- SELECT * FROM _hash_join_to_table!(
+--   _hash_join('__intrinsic_sched_slice', 'utid', '__intrinsic_thread', 'id',
+--              'left.ts', 'left.dur', 'right.name AS thread_name'),
+--   (ts, dur, thread_name)
+-- );
+-- ```
+CREATE PERFETTO FUNCTION _hash_join(
+    -- Name of the left table.
+    left_table STRING,
+    -- Name of the key column of the left table.
+    left_key STRING,
+    -- Name of the right table.
+    right_table STRING,
+    -- Name of the key column of the right table.
+    right_key STRING,
+    -- Column specs: 'side.col [AS alias]' (variadic)
+    columns ANY...
+)
+-- Returns a TABLE pointer with one column per spec.
+RETURNS ANY
+DELEGATES TO __intrinsic_hash_join;
+
+-- Helper macro to generate column selection for _hash_join_to_table.
+-- Maps column index (c0, c1, ...) to column name.
+CREATE PERFETTO MACRO _hash_join_col_select(idx ColumnName, col ColumnName)
+RETURNS _ProjectionFragment AS $idx AS $col;
+
+-- Helper macro to generate column binding for _hash_join_to_table.
+CREATE PERFETTO MACRO _hash_join_col_bind(idx ColumnName, col ColumnName)
+RETURNS Expr AS
+  __intrinsic_table_ptr_bind($idx, __intrinsic_stringify!($col));
+
+-- Converts the result of _hash_join to a table with one row per match.
+CREATE PERFETTO MACRO _hash_join_to_table(
+    -- A TABLE pointer returned by _hash_join.
+    hash_join_ptr Expr,
+    -- The output columns of the specs passed to _hash_join, in order.
+    columns ColumnNameList
+)
+RETURNS TableOrSubquery AS
+(
+  SELECT
+    __intrinsic_token_apply!(
+      _hash_join_col_select,
+      (c0, c1, c2, c3, c4, c5, c6, c7),
+      $columns
+    )
+  FROM __intrinsic_table_ptr($hash_join_ptr)
+  WHERE
+    __intrinsic_token_apply_and!(
+      _hash_join_col_bind,
+      (c0, c1, c2, c3, c4, c5, c6, c7),
+      $columns
+    )
+);
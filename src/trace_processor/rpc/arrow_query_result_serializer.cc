@@ -0,0 +1,596 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/rpc/arrow_query_result_serializer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/base/time.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/string_view.h"
+#include "perfetto/protozero/message.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/public/compiler.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/iterator.h"
+#include "src/trace_processor/iterator_impl.h"
+
+#include "protos/perfetto/trace_processor/trace_processor.pbzero.h"
+
+namespace perfetto::trace_processor {
+
+namespace {
+
+using ResultProto = protos::pbzero::QueryResult;
+
+// Constants from the Arrow flatbuffer schemas (Schema.fbs and Message.fbs in
+// https://github.com/apache/arrow/tree/main/format).
+constexpr int16_t kMetadataVersionV5 = 4;
+constexpr uint8_t kMessageHeaderSchema = 1;
+constexpr uint8_t kMessageHeaderRecordBatch = 3;
+constexpr uint8_t kTypeNull = 1;
+constexpr uint8_t kTypeInt = 2;
+constexpr uint8_t kTypeFloatingPoint = 3;
+constexpr uint8_t kTypeBinary = 4;
+constexpr uint8_t kTypeUtf8 = 5;
+constexpr int16_t kPrecisionDouble = 2;
+
+// Every encapsulated IPC message starts with this marker.
+constexpr uint32_t kContinuationMarker = 0xFFFFFFFF;
+
+uint32_t AlignUp(size_t value, uint32_t align) {
+  return static_cast<uint32_t>((value + align - 1) & ~size_t(align - 1));
+}
+
+// A minimal writer for the flatbuffers used by the Arrow IPC metadata. See
+// https://flatbuffers.dev/internals/ for the format.
+//
+// Unlike the official flatbuffers builder, which writes buffers back to
+// front, this writer appends objects front to back: a table is written
+// before the objects it references and the offset fields pointing to them
+// are filled in with SetOffset() once the referenced objects have been
+// written. This works because offsets to objects only need to point
+// forward.
+class FlatBufferWriter {
+ public:
+  // Describes one table being written. Fields are added with AddScalar() and
+  // AddOffset() and the table is written by FlatBufferWriter::WriteTable().
+  class Table {
+   public:
+    explicit Table(uint16_t slot_count) : slot_count_(slot_count) {}
+
+    template <typename T>
+    void AddScalar(uint16_t slot, T value) {
+      Field f{slot, sizeof(T), {}, 0};
+      memcpy(f.value, &value, sizeof(T));
+      fields_.push_back(f);
+    }
+
+    // Adds an offset to another object: the value must be set with
+    // FlatBufferWriter::SetOffset(table.OffsetPos(slot), ...).
+    void AddOffset(uint16_t slot) { AddScalar<uint32_t>(slot, 0); }
+
+    // Returns the position of the field in `slot` in the buffer. Only valid
+    // after the table has been written.
+    uint32_t OffsetPos(uint16_t slot) const {
+      for (const Field& f : fields_) {
+        if (f.slot == slot) {
+          return f.pos;
+        }
+      }
+      PERFETTO_FATAL("Slot not found");
+    }
+
+   private:
+    friend class FlatBufferWriter;
+
+    struct Field {
+      uint16_t slot;
+      uint8_t size;
+      uint8_t value[8];
+      uint32_t pos;
+    };
+
+    uint16_t slot_count_;
+    std::vector<Field> fields_;
+  };
+
+  // Reserves the space for the offset to the root table.
+  FlatBufferWriter() : buf_(sizeof(uint32_t)) {}
+
+  // Writes `table` and its vtable and returns the position of the table.
+  uint32_t WriteTable(Table& table) {
+    // Lay out the fields from the largest to the smallest so that every
+    // field is naturally aligned without padding. The first 4 bytes of the
+    // table are the offset to its vtable.
+    std::stable_sort(
+        table.fields_.begin(), table.fields_.end(),
+        [](const Table::Field& a, const Table::Field& b) {
+          return a.size > b.size;
+        });
+    std::vector<uint16_t> field_offsets(table.fields_.size());
+    uint32_t table_size = sizeof(int32_t);
+    for (uint32_t i = 0; i < table.fields_.size(); ++i) {
+      table_size = AlignUp(table_size, table.fields_[i].size);
+      field_offsets[i] = static_cast<uint16_t>(table_size);
+      table_size += table.fields_[i].size;
+    }
+    table_size = AlignUp(table_size, sizeof(int32_t));
+
+    auto vtable_size =
+        static_cast<uint32_t>(sizeof(uint16_t) * (2 + table.slot_count_));
+    uint32_t vtable_pos = Reserve(vtable_size, sizeof(uint16_t));
+    Write<uint16_t>(vtable_pos, static_cast<uint16_t>(vtable_size));
+    Write<uint16_t>(vtable_pos + 2, static_cast<uint16_t>(table_size));
+
+    uint32_t table_pos = Reserve(table_size, sizeof(uint64_t));
+    Write<int32_t>(table_pos, static_cast<int32_t>(table_pos - vtable_pos));
+    for (uint32_t i = 0; i < table.fields_.size(); ++i) {
+      Table::Field& f = table.fields_[i];
+      PERFETTO_DCHECK(f.slot < table.slot_count_);
+      Write<uint16_t>(vtable_pos + 4 + 2 * f.slot, field_offsets[i]);
+      f.pos = table_pos + field_offsets[i];
+      memcpy(buf_.data() + f.pos, f.value, f.size);
+    }
+    return table_pos;
+  }
+
+  // Writes a string and returns its position.
+  uint32_t WriteString(base::StringView str) {
+    auto size = static_cast<uint32_t>(str.size());
+    uint32_t pos = Reserve(sizeof(uint32_t) + size + 1, sizeof(uint32_t));
+    Write<uint32_t>(pos, size);
+    if (size > 0) {
+      memcpy(buf_.data() + pos + sizeof(uint32_t), str.data(), size);
+    }
+    return pos;
+  }
+
+  // Writes the header of a vector of `count` elements of `elem_size` bytes
+  // each and reserves the space for the elements. Returns the position of the
+  // vector: the elements start at `pos + 4`.
+  uint32_t WriteVector(uint32_t count, uint32_t elem_size, uint32_t align) {
+    // The length of the vector directly precedes the elements which need to
+    // be aligned to `align`.
+    uint32_t elems_pos =
+        AlignUp(buf_.size() + sizeof(uint32_t), std::max(align, 4u));
+    buf_.resize(elems_pos + count * elem_size);
+    Write<uint32_t>(elems_pos - sizeof(uint32_t), count);
+    return elems_pos - static_cast<uint32_t>(sizeof(uint32_t));
+  }
+
+  // Sets the offset field at `pos` to point to `target`.
+  void SetOffset(uint32_t pos, uint32_t target) {
+    PERFETTO_DCHECK(target > pos);
+    Write<uint32_t>(pos, target - pos);
+  }
+
+  template <typename T>
+  void Write(uint32_t pos, T value) {
+    memcpy(buf_.data() + pos, &value, sizeof(T));
+  }
+
+  // Sets the root table and returns the finished buffer.
+  std::vector<uint8_t> Finish(uint32_t root_table_pos) {
+    SetOffset(0, root_table_pos);
+    buf_.resize(AlignUp(buf_.size(), 8));
+    return std::move(buf_);
+  }
+
+ private:
+  uint32_t Reserve(uint32_t size, uint32_t align) {
+    uint32_t pos = AlignUp(buf_.size(), align);
+    buf_.resize(pos + size);
+    return pos;
+  }
+
+  std::vector<uint8_t> buf_;
+};
+
+// Writes a Message table with the given header at the start of `fb`. Returns
+// the Message table to allow setting the offset to the header.
+FlatBufferWriter::Table WriteMessage(FlatBufferWriter& fb,
+                                     uint8_t header_type,
+                                     int64_t body_length,
+                                     uint32_t* message_pos) {
+  FlatBufferWriter::Table message(5);
+  message.AddScalar<int16_t>(0, kMetadataVersionV5);
+  message.AddScalar<uint8_t>(1, header_type);
+  message.AddOffset(2);
+  message.AddScalar<int64_t>(3, body_length);
+  *message_pos = fb.WriteTable(message);
+  return message;
+}
+
+// Appends an encapsulated IPC message with the given metadata to `out`. The
+// body of the message must be appended by the caller.
+void AppendMessageMetadata(const std::vector<uint8_t>& metadata,
+                           protozero::Message* out) {
+  PERFETTO_DCHECK(metadata.size() % 8 == 0);
+  uint32_t prefix[2] = {kContinuationMarker,
+                        static_cast<uint32_t>(metadata.size())};
+  out->AppendRawProtoBytes(prefix, sizeof(prefix));
+  out->AppendRawProtoBytes(metadata.data(), metadata.size());
+}
+
+}  // namespace
+
+ArrowQueryResultSerializer::ArrowQueryResultSerializer(
+    Iterator iter,
+    std::optional<base::TimeNanos> t_start)
+    : iter_(iter.take_impl()),
+      num_cols_(iter_->ColumnCount()),
+      t_start_(t_start),
+      columns_(num_cols_) {
+  ResetColumns();
+}
+
+ArrowQueryResultSerializer::~ArrowQueryResultSerializer() = default;
+
+bool ArrowQueryResultSerializer::Serialize(std::vector<uint8_t>* buf) {
+  protozero::HeapBuffered<protos::pbzero::QueryResult> result;
+  bool has_more = Serialize(result.get());
+  auto arr = result.SerializeAsArray();
+  buf->insert(buf->end(), arr.begin(), arr.end());
+  return has_more;
+}
+
+bool ArrowQueryResultSerializer::Serialize(protos::pbzero::QueryResult* res) {
+  PERFETTO_CHECK(!eof_reached_);
+
+  if (!did_write_metadata_) {
+    SerializeMetadata(res);
+    did_write_metadata_ = true;
+  }
+
+  FillBatch();
+
+  auto* chunk = res->BeginNestedMessage<protozero::Message>(
+      ResultProto::kArrowIpcChunkFieldNumber);
+  if (!did_write_schema_) {
+    WriteSchema(chunk);
+    did_write_schema_ = true;
+  }
+  if (rows_ > 0 && status_.ok()) {
+    WriteRecordBatch(chunk);
+  }
+  if (eof_reached_) {
+    // The end-of-stream marker.
+    uint32_t eos[2] = {kContinuationMarker, 0};
+    chunk->AppendRawProtoBytes(eos, sizeof(eos));
+  }
+  chunk->Finalize();
+
+  if (eof_reached_) {
+    res->add_batch()->set_is_last_batch(true);
+    if (!status_.ok()) {
+      // Make sure the |error| field is always non-empty if the query failed,
+      // so the client can tell some error happened.
+      res->set_error(status_.message().empty() ? "Unknown error"
+                                               : status_.message());
+    }
+  }
+
+  if (t_start_) {
+    const double elapsed_time_ms =
+        static_cast<double>((base::GetWallTimeNs() - *t_start_).count()) / 1e6;
+    res->set_elapsed_time_ms(elapsed_time_ms);
+  }
+  return !eof_reached_;
+}
+
+void ArrowQueryResultSerializer::FillBatch() {
+  ResetColumns();
+  while (rows_ < rows_per_batch_ && batch_size_ < batch_split_threshold_) {
+    if (!iter_->Next()) {
+      status_ = iter_->Status();
+      eof_reached_ = true;
+      return;
+    }
+    for (uint32_t col = 0; col < num_cols_; ++col) {
+      status_ = AppendCell(columns_[col], iter_->Get(col));
+      if (!status_.ok()) {
+        status_ = base::ErrStatus("Column '%s': %s",
+                                  iter_->GetColumnName(col).c_str(),
+                                  status_.c_message());
+        eof_reached_ = true;
+        return;
+      }
+    }
+    ++rows_;
+  }
+}
+
+base::Status ArrowQueryResultSerializer::AppendCell(Column& col,
+                                                    const SqlValue& value) {
+  ColumnType type;
+  switch (value.type) {
+    case SqlValue::kNull:
+      if ((rows_ & 7) == 0) {
+        col.validity.push_back(0);
+      }
+      col.null_count++;
+      switch (col.type) {
+        case ColumnType::kNull:
+          break;
+        case ColumnType::kInt64:
+        case ColumnType::kDouble:
+          col.fixed.push_back(0);
+          break;
+        case ColumnType::kString:
+        case ColumnType::kBytes:
+          col.offsets.push_back(col.offsets.back());
+          break;
+      }
+      return base::OkStatus();
+    case SqlValue::kLong:
+      type = ColumnType::kInt64;
+      break;
+    case SqlValue::kDouble:
+      type = ColumnType::kDouble;
+      break;
+    case SqlValue::kString:
+      type = ColumnType::kString;
+      break;
+    case SqlValue::kBytes:
+      type = ColumnType::kBytes;
+      break;
+  }
+  if (type != col.type &&
+      !(type == ColumnType::kInt64 && col.type == ColumnType::kDouble)) {
+    RETURN_IF_ERROR(SetColumnType(col, type));
+  }
+
+  if ((rows_ & 7) == 0) {
+    col.validity.push_back(0);
+  }
+  col.validity.back() |= static_cast<uint8_t>(1u << (rows_ & 7));
+  switch (col.type) {
+    case ColumnType::kInt64:
+      col.fixed.push_back(value.long_value);
+      batch_size_ += sizeof(int64_t);
+      break;
+    case ColumnType::kDouble: {
+      double d = value.type == SqlValue::kLong
+                     ? static_cast<double>(value.long_value)
+                     : value.double_value;
+      int64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      col.fixed.push_back(bits);
+      batch_size_ += sizeof(int64_t);
+      break;
+    }
+    case ColumnType::kString: {
+      auto len = static_cast<uint32_t>(strlen(value.string_value));
+      col.data.insert(col.data.end(), value.string_value,
+                      value.string_value + len);
+      col.offsets.push_back(static_cast<int32_t>(col.data.size()));
+      batch_size_ += len + sizeof(int32_t);
+      break;
+    }
+    case ColumnType::kBytes: {
+      const auto* bytes = static_cast<const uint8_t*>(value.bytes_value);
+      col.data.insert(col.data.end(), bytes, bytes + value.bytes_count);
+      col.offsets.push_back(static_cast<int32_t>(col.data.size()));
+      batch_size_ += value.bytes_count + sizeof(int32_t);
+      break;
+    }
+    case ColumnType::kNull:
+      PERFETTO_FATAL("Non-null value in null column");
+  }
+  if (PERFETTO_UNLIKELY(col.data.size() > INT32_MAX)) {
+    return base::ErrStatus(
+        "more than 2GB of strings in a single batch are not supported");
+  }
+  return base::OkStatus();
+}
+
+base::Status ArrowQueryResultSerializer::SetColumnType(Column& col,
+                                                       ColumnType type) {
+  // The schema is written after the first batch is filled: after that, the
+  // type of the columns cannot be changed anymore.
+  if (!did_write_schema_) {
+    if (col.type == ColumnType::kNull) {
+      // All the values so far are NULLs.
+      col.type = type;
+      if (type == ColumnType::kInt64 || type == ColumnType::kDouble) {
+        col.fixed.assign(rows_, 0);
+      } else {
+        col.offsets.assign(rows_ + 1, 0);
+      }
+      return base::OkStatus();
+    }
+    if (col.type == ColumnType::kInt64 && type == ColumnType::kDouble) {
+      for (int64_t& v : col.fixed) {
+        auto d = static_cast<double>(v);
+        memcpy(&v, &d, sizeof(v));
+      }
+      col.type = type;
+      return base::OkStatus();
+    }
+  }
+  static constexpr const char* kTypeNames[] = {"null", "int64", "double",
+                                               "string", "bytes"};
+  return base::ErrStatus(
+      "found a %s value in a column of type %s: columns with mixed types are "
+      "not supported by the Arrow result format",
+      kTypeNames[static_cast<uint32_t>(type)],
+      kTypeNames[static_cast<uint32_t>(col.type)]);
+}
+
+void ArrowQueryResultSerializer::WriteSchema(protozero::Message* out) {
+  FlatBufferWriter fb;
+  uint32_t message_pos;
+  auto message = WriteMessage(fb, kMessageHeaderSchema, 0, &message_pos);
+
+  FlatBufferWriter::Table schema(4);
+  schema.AddOffset(1);
+  fb.SetOffset(message.OffsetPos(2), fb.WriteTable(schema));
+
+  uint32_t fields_pos = fb.WriteVector(num_cols_, sizeof(uint32_t), 4);
+  fb.SetOffset(schema.OffsetPos(1), fields_pos);
+  for (uint32_t i = 0; i < num_cols_; ++i) {
+    FlatBufferWriter::Table field(7);
+    field.AddOffset(0);
+    field.AddScalar<uint8_t>(1, true);
+    FlatBufferWriter::Table type(2);
+    switch (columns_[i].type) {
+      case ColumnType::kNull:
+        field.AddScalar<uint8_t>(2, kTypeNull);
+        break;
+      case ColumnType::kInt64:
+        field.AddScalar<uint8_t>(2, kTypeInt);
+        type.AddScalar<int32_t>(0, 64);
+        type.AddScalar<uint8_t>(1, true);
+        break;
+      case ColumnType::kDouble:
+        field.AddScalar<uint8_t>(2, kTypeFloatingPoint);
+        type.AddScalar<int16_t>(0, kPrecisionDouble);
+        break;
+      case ColumnType::kString:
+        field.AddScalar<uint8_t>(2, kTypeUtf8);
+        break;
+      case ColumnType::kBytes:
+        field.AddScalar<uint8_t>(2, kTypeBinary);
+        break;
+    }
+    field.AddOffset(3);
+    field.AddOffset(5);
+    uint32_t field_pos = fb.WriteTable(field);
+    fb.SetOffset(fields_pos + 4 + 4 * i, field_pos);
+
+    std::string name = iter_->GetColumnName(i);
+    fb.SetOffset(field.OffsetPos(0), fb.WriteString(base::StringView(name)));
+    fb.SetOffset(field.OffsetPos(3), fb.WriteTable(type));
+    // Arrow readers require the children to be present even if empty.
+    fb.SetOffset(field.OffsetPos(5),
+                 fb.WriteVector(0, sizeof(uint32_t), sizeof(uint32_t)));
+  }
+  AppendMessageMetadata(fb.Finish(message_pos), out);
+}
+
+void ArrowQueryResultSerializer::WriteRecordBatch(protozero::Message* out) {
+  // The buffers of all the columns, in the order expected by Arrow.
+  struct Buffer {
+    const void* data;
+    uint64_t size;
+  };
+  std::vector<Buffer> buffers;
+  for (const Column& col : columns_) {
+    Buffer validity{col.validity.data(), col.validity.size()};
+    // The validity bitmap can be omitted if there are no NULLs.
+    if (col.null_count == 0) {
+      validity = {nullptr, 0};
+    }
+    switch (col.type) {
+      case ColumnType::kNull:
+        break;
+      case ColumnType::kInt64:
+      case ColumnType::kDouble:
+        buffers.push_back(validity);
+        buffers.push_back({col.fixed.data(), rows_ * sizeof(int64_t)});
+        break;
+      case ColumnType::kString:
+      case ColumnType::kBytes:
+        buffers.push_back(validity);
+        buffers.push_back(
+            {col.offsets.data(), (rows_ + 1) * sizeof(int32_t)});
+        buffers.push_back({col.data.data(), col.data.size()});
+        break;
+    }
+  }
+
+  // Every buffer in the body must start at a multiple of 8 bytes.
+  uint64_t body_length = 0;
+  for (const Buffer& b : buffers) {
+    body_length += AlignUp(b.size, 8);
+  }
+
+  FlatBufferWriter fb;
+  uint32_t message_pos;
+  auto message = WriteMessage(fb, kMessageHeaderRecordBatch,
+                              static_cast<int64_t>(body_length), &message_pos);
+
+  FlatBufferWriter::Table batch(5);
+  batch.AddScalar<int64_t>(0, rows_);
+  batch.AddOffset(1);
+  batch.AddOffset(2);
+  fb.SetOffset(message.OffsetPos(2), fb.WriteTable(batch));
+
+  // Vector of FieldNode structs: {int64 length, int64 null_count}.
+  uint32_t nodes_pos = fb.WriteVector(num_cols_, 16, 8);
+  fb.SetOffset(batch.OffsetPos(1), nodes_pos);
+  for (uint32_t i = 0; i < num_cols_; ++i) {
+    const Column& col = columns_[i];
+    uint32_t null_count =
+        col.type == ColumnType::kNull ? rows_ : col.null_count;
+    fb.Write<int64_t>(nodes_pos + 4 + 16 * i, rows_);
+    fb.Write<int64_t>(nodes_pos + 12 + 16 * i, null_count);
+  }
+
+  // Vector of Buffer structs: {int64 offset, int64 length}.
+  auto buffer_count = static_cast<uint32_t>(buffers.size());
+  uint32_t buffers_pos = fb.WriteVector(buffer_count, 16, 8);
+  fb.SetOffset(batch.OffsetPos(2), buffers_pos);
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < buffer_count; ++i) {
+    fb.Write<int64_t>(buffers_pos + 4 + 16 * i, static_cast<int64_t>(offset));
+    fb.Write<int64_t>(buffers_pos + 12 + 16 * i,
+                      static_cast<int64_t>(buffers[i].size));
+    offset += AlignUp(buffers[i].size, 8);
+  }
+  AppendMessageMetadata(fb.Finish(message_pos), out);
+
+  static constexpr uint8_t kPadding[8] = {};
+  for (const Buffer& b : buffers) {
+    if (b.size > 0) {
+      out->AppendRawProtoBytes(b.data, b.size);
+    }
+    out->AppendRawProtoBytes(kPadding, AlignUp(b.size, 8) - b.size);
+  }
+}
+
+void ArrowQueryResultSerializer::ResetColumns() {
+  rows_ = 0;
+  batch_size_ = 0;
+  for (Column& col : columns_) {
+    col.null_count = 0;
+    col.validity.clear();
+    col.fixed.clear();
+    col.data.clear();
+    col.offsets.clear();
+    col.offsets.push_back(0);
+  }
+}
+
+void ArrowQueryResultSerializer::SerializeMetadata(
+    protos::pbzero::QueryResult* res) {
+  for (uint32_t c = 0; c < num_cols_; c++)
+    res->add_column_names(iter_->GetColumnName(c));
+  res->set_statement_count(iter_->StatementCount());
+  res->set_statement_with_output_count(iter_->StatementCountWithOutput());
+  res->set_last_statement_sql(iter_->LastStatementSql());
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_RPC_ARROW_QUERY_RESULT_SERIALIZER_H_
+#define SRC_TRACE_PROCESSOR_RPC_ARROW_QUERY_RESULT_SERIALIZER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "perfetto/base/time.h"
+#include "perfetto/trace_processor/basic_types.h"
+
+namespace protozero {
+class Message;
+}  // namespace protozero
+
+namespace perfetto {
+
+namespace protos::pbzero {
+class QueryResult;
+}  // namespace protos::pbzero
+
+namespace trace_processor {
+
+class Iterator;
+class IteratorImpl;
+
+// Serializes a TraceProcessor query result (i.e. an Iterator) into an Apache
+// Arrow IPC stream, split across QueryResult messages (see |arrow_ipc_chunk|
+// in trace_processor.proto).
+//
+// Unlike QueryResultSerializer, which encodes every cell in row order, this
+// class accumulates rows into one buffer per column and emits them as Arrow
+// record batches: integers and doubles as flat little-endian arrays and
+// strings and blobs as offsets + data. Clients (e.g. pyarrow) can then use
+// the results directly, without decoding individual cells.
+//
+// The usage is the same as QueryResultSerializer: the client is expected to
+// call Serialize() until it returns false.
+class ArrowQueryResultSerializer {
+ public:
+  static constexpr uint32_t kDefaultRowsPerBatch = 64 * 1024;
+  static constexpr uint32_t kDefaultBatchSplitThreshold = 4 * 1024 * 1024;
+
+  explicit ArrowQueryResultSerializer(
+      Iterator,
+      std::optional<base::TimeNanos> t_start = {});
+  ~ArrowQueryResultSerializer();
+
+  // No copy or move.
+  ArrowQueryResultSerializer(const ArrowQueryResultSerializer&) = delete;
+  ArrowQueryResultSerializer& operator=(const ArrowQueryResultSerializer&) =
+      delete;
+
+  // Appends the next chunk of the stream to the passed protozero message. It
+  // returns true if more chunks are available. The caller is supposed to keep
+  // calling this function until it returns false.
+  bool Serialize(protos::pbzero::QueryResult*);
+
+  // Like the above but stitches everything together in a vector. Incurs in
+  // extra copies.
+  bool Serialize(std::vector<uint8_t>*);
+
+  void set_batch_size_for_testing(uint32_t rows_per_batch, uint32_t thres) {
+    rows_per_batch_ = rows_per_batch;
+    batch_split_threshold_ = thres;
+  }
+
+ private:
+  // The type of a column. Decided based on the values in the first batch.
+  enum class ColumnType : uint8_t {
+    kNull,
+    kInt64,
+    kDouble,
+    kString,
+    kBytes,
+  };
+
+  // The values of one column in the current batch, in the Arrow layout.
+  struct Column {
+    ColumnType type = ColumnType::kNull;
+    uint32_t null_count = 0;
+    // Validity bitmap: bit i is set if the i-th value is not NULL.
+    std::vector<uint8_t> validity;
+    // Only used for kInt64 and kDouble columns.
+    std::vector<int64_t> fixed;
+    // Only used for kString and kBytes columns.
+    std::vector<int32_t> offsets;
+    std::vector<uint8_t> data;
+  };
+
+  void SerializeMetadata(protos::pbzero::QueryResult*);
+  void FillBatch();
+  base::Status AppendCell(Column&, const SqlValue&);
+  base::Status SetColumnType(Column&, ColumnType);
+  void WriteSchema(protozero::Message*);
+  void WriteRecordBatch(protozero::Message*);
+  void ResetColumns();
+
+  std::unique_ptr<IteratorImpl> iter_;
+  const uint32_t num_cols_;
+  const std::optional<base::TimeNanos> t_start_;
+  std::vector<Column> columns_;
+  // The number of rows in the current batch.
+  uint32_t rows_ = 0;
+  // The approximate size of the current batch in bytes.
+  uint64_t batch_size_ = 0;
+  base::Status status_;
+  bool did_write_metadata_ = false;
+  bool did_write_schema_ = false;
+  bool eof_reached_ = false;
+
+  // Like in QueryResultSerializer, batches are split when either the number
+  // of rows or the approximate size of the batch in bytes is reached. The
+  // byte limit is higher as column-major batches are only worth it when they
+  // are large.
+  uint32_t rows_per_batch_ = kDefaultRowsPerBatch;
+  uint32_t batch_split_threshold_ = kDefaultBatchSplitThreshold;
+};
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_RPC_ARROW_QUERY_RESULT_SERIALIZER_H_
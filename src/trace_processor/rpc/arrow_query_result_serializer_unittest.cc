@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/rpc/arrow_query_result_serializer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/string_view.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/trace_processor.h"
+#include "test/gtest_and_gmock.h"
+
+#include "protos/perfetto/trace_processor/trace_processor.pbzero.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ResultProto = protos::pbzero::QueryResult;
+
+// Arrow type ids, see Schema.fbs.
+constexpr uint8_t kTypeNull = 1;
+constexpr uint8_t kTypeInt = 2;
+constexpr uint8_t kTypeFloatingPoint = 3;
+constexpr uint8_t kTypeBinary = 4;
+constexpr uint8_t kTypeUtf8 = 5;
+
+template <typename T>
+T ReadAt(const uint8_t* buf, size_t pos) {
+  T value;
+  memcpy(&value, buf + pos, sizeof(T));
+  return value;
+}
+
+// Minimal reader for the flatbuffer tables in the Arrow IPC metadata.
+class FbTable {
+ public:
+  FbTable(const uint8_t* buf, uint32_t pos) : buf_(buf), pos_(pos) {}
+
+  template <typename T>
+  T Get(uint16_t slot) const {
+    uint16_t off = FieldOffset(slot);
+    return off ? ReadAt<T>(buf_, pos_ + off) : T();
+  }
+
+  bool Has(uint16_t slot) const { return FieldOffset(slot) != 0; }
+
+  FbTable GetTable(uint16_t slot) const {
+    return FbTable(buf_, Deref(pos_ + FieldOffset(slot)));
+  }
+
+  // Returns the position of the first element and the size of a vector.
+  std::pair<uint32_t, uint32_t> GetVector(uint16_t slot) const {
+    uint32_t vec = Deref(pos_ + FieldOffset(slot));
+    return {vec + 4, ReadAt<uint32_t>(buf_, vec)};
+  }
+
+  FbTable GetVectorTable(uint16_t slot, uint32_t i) const {
+    return FbTable(buf_, Deref(GetVector(slot).first + 4 * i));
+  }
+
+  std::string GetString(uint16_t slot) const {
+    auto [pos, size] = GetVector(slot);
+    return std::string(reinterpret_cast<const char*>(buf_ + pos), size);
+  }
+
+ private:
+  uint32_t Deref(uint32_t pos) const {
+    return pos + ReadAt<uint32_t>(buf_, pos);
+  }
+
+  uint16_t FieldOffset(uint16_t slot) const {
+    uint32_t vtable = pos_ - static_cast<uint32_t>(ReadAt<int32_t>(buf_, pos_));
+    uint16_t vtable_size = ReadAt<uint16_t>(buf_, vtable);
+    if (4u + 2u * slot >= vtable_size) {
+      return 0;
+    }
+    return ReadAt<uint16_t>(buf_, vtable + 4 + 2 * slot);
+  }
+
+  const uint8_t* buf_;
+  uint32_t pos_;
+};
+
+// Implements a minimal deserializer for ArrowQueryResultSerializer. Cells are
+// converted to SQL-like literals to make them easy to compare.
+class TestArrowDeserializer {
+ public:
+  void SerializeAndDeserialize(ArrowQueryResultSerializer* serializer) {
+    std::vector<uint8_t> buf;
+    for (bool has_more = true; has_more;) {
+      has_more = serializer->Serialize(&buf);
+      ResultProto::Decoder result(buf.data(), buf.size());
+      error += result.error().ToStdString();
+      for (auto it = result.column_names(); it; ++it) {
+        columns.push_back(it->as_std_string());
+      }
+      for (auto it = result.batch(); it; ++it) {
+        ResultProto::CellsBatch::Decoder batch(it->as_bytes());
+        EXPECT_EQ(batch.is_last_batch(), !has_more);
+        EXPECT_FALSE(batch.has_cells());
+      }
+      auto chunk = result.arrow_ipc_chunk();
+      stream_.insert(stream_.end(), chunk.data, chunk.data + chunk.size);
+      buf.clear();
+    }
+    ParseStream();
+  }
+
+  std::vector<std::string> columns;
+  std::string error;
+
+  // Decoded from the Arrow stream.
+  std::vector<std::string> field_names;
+  std::vector<uint8_t> field_types;
+  std::vector<std::string> cells;
+  uint32_t record_batch_count = 0;
+  bool eos_reached = false;
+
+ private:
+  void ParseStream() {
+    for (size_t pos = 0; pos < stream_.size();) {
+      ASSERT_EQ(pos % 8, 0u);
+      ASSERT_EQ(ReadAt<uint32_t>(stream_.data(), pos), 0xFFFFFFFFu);
+      auto metadata_size = ReadAt<uint32_t>(stream_.data(), pos + 4);
+      pos += 8;
+      if (metadata_size == 0) {
+        eos_reached = true;
+        ASSERT_EQ(pos, stream_.size());
+        return;
+      }
+      ASSERT_EQ(metadata_size % 8, 0u);
+      const uint8_t* metadata = stream_.data() + pos;
+      FbTable message(metadata, ReadAt<uint32_t>(metadata, 0));
+      pos += metadata_size;
+      auto body_length = static_cast<size_t>(message.Get<int64_t>(3));
+      ASSERT_EQ(message.Get<int16_t>(0), 4);  // V5
+      switch (message.Get<uint8_t>(1)) {
+        case 1:
+          ParseSchema(message.GetTable(2));
+          break;
+        case 3:
+          ParseRecordBatch(message.GetTable(2), metadata,
+                           stream_.data() + pos);
+          break;
+        default:
+          FAIL() << "Unexpected message";
+      }
+      pos += body_length;
+    }
+  }
+
+  void ParseSchema(const FbTable& schema) {
+    ASSERT_TRUE(field_names.empty());
+    for (uint32_t i = 0; i < schema.GetVector(1).second; ++i) {
+      FbTable field = schema.GetVectorTable(1, i);
+      field_names.push_back(field.GetString(0));
+      field_types.push_back(field.Get<uint8_t>(2));
+      EXPECT_TRUE(field.Get<bool>(1));
+      EXPECT_TRUE(field.Has(5));
+      FbTable type = field.GetTable(3);
+      if (field_types.back() == kTypeInt) {
+        EXPECT_EQ(type.Get<int32_t>(0), 64);
+        EXPECT_TRUE(type.Get<bool>(1));
+      } else if (field_types.back() == kTypeFloatingPoint) {
+        EXPECT_EQ(type.Get<int16_t>(0), 2);
+      }
+    }
+  }
+
+  // `fb` is the flatbuffer containing `batch`.
+  void ParseRecordBatch(const FbTable& batch,
+                        const uint8_t* fb,
+                        const uint8_t* body) {
+    ++record_batch_count;
+    auto rows = static_cast<uint32_t>(batch.Get<int64_t>(0));
+    auto [nodes, node_count] = batch.GetVector(1);
+    auto [buffers, buffer_count] = batch.GetVector(2);
+    ASSERT_EQ(node_count, field_types.size());
+
+    // Returns the address of the i-th buffer in the body.
+    auto buffer = [&, buffers = buffers](uint32_t i) {
+      EXPECT_EQ(ReadAt<int64_t>(fb, buffers + 16 * i) % 8, 0);
+      return std::make_pair(
+          body + ReadAt<int64_t>(fb, buffers + 16 * i),
+          static_cast<size_t>(ReadAt<int64_t>(fb, buffers + 16 * i + 8)));
+    };
+
+    std::vector<std::vector<std::string>> cols;
+    uint32_t buf_idx = 0;
+    for (uint32_t c = 0; c < node_count; ++c) {
+      EXPECT_EQ(ReadAt<int64_t>(fb, nodes + 16 * c), rows);
+      std::vector<std::string> col;
+      if (field_types[c] == kTypeNull) {
+        col.assign(rows, "NULL");
+        cols.push_back(std::move(col));
+        continue;
+      }
+      auto [validity, validity_size] = buffer(buf_idx++);
+      auto is_valid = [&, validity = validity,
+                       validity_size = validity_size](uint32_t r) {
+        return validity_size == 0 || (validity[r / 8] >> (r % 8)) & 1;
+      };
+      if (field_types[c] == kTypeInt || field_types[c] == kTypeFloatingPoint) {
+        const uint8_t* values = buffer(buf_idx++).first;
+        for (uint32_t r = 0; r < rows; ++r) {
+          if (!is_valid(r)) {
+            col.emplace_back("NULL");
+          } else if (field_types[c] == kTypeInt) {
+            col.push_back(std::to_string(ReadAt<int64_t>(values, 8 * r)));
+          } else {
+            col.push_back(base::StackString<32>(
+                              "%.2f", ReadAt<double>(values, 8 * r))
+                              .ToStdString());
+          }
+        }
+      } else {
+        const uint8_t* offsets = buffer(buf_idx++).first;
+        const uint8_t* data = buffer(buf_idx++).first;
+        for (uint32_t r = 0; r < rows; ++r) {
+          if (!is_valid(r)) {
+            col.emplace_back("NULL");
+            continue;
+          }
+          auto start = ReadAt<int32_t>(offsets, 4 * r);
+          auto end = ReadAt<int32_t>(offsets, 4 * (r + 1));
+          std::string str(reinterpret_cast<const char*>(data + start),
+                          static_cast<size_t>(end - start));
+          col.push_back(field_types[c] == kTypeUtf8
+                            ? "'" + str + "'"
+                            : "x'" + base::ToHex(str.data(), str.size()) +
+                                  "'");
+        }
+      }
+      cols.push_back(std::move(col));
+    }
+    EXPECT_EQ(buf_idx, buffer_count);
+    for (uint32_t r = 0; r < rows; ++r) {
+      for (const auto& col : cols) {
+        cells.push_back(col[r]);
+      }
+    }
+  }
+
+  std::vector<uint8_t> stream_;
+};
+
+void RunQueryChecked(TraceProcessor* tp, const std::string& query) {
+  auto iter = tp->ExecuteQuery(query);
+  iter.Next();
+  ASSERT_TRUE(iter.Status().ok()) << iter.Status().message();
+}
+
+TEST(ArrowQueryResultSerializerTest, Types) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  ArrowQueryResultSerializer serializer(tp->ExecuteQuery(
+      "select 42 as i, 2.5 as d, 'foo' as s, x'0102' as b, null as n"));
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_EQ(deser.error, "");
+  EXPECT_TRUE(deser.eos_reached);
+  EXPECT_THAT(deser.columns, ElementsAre("i", "d", "s", "b", "n"));
+  EXPECT_THAT(deser.field_names, ElementsAre("i", "d", "s", "b", "n"));
+  EXPECT_THAT(deser.field_types, ElementsAre(kTypeInt, kTypeFloatingPoint,
+                                             kTypeUtf8, kTypeBinary,
+                                             kTypeNull));
+  EXPECT_EQ(deser.record_batch_count, 1u);
+  EXPECT_THAT(deser.cells, ElementsAre("42", "2.50", "'foo'", "x'0102'",
+                                       "NULL"));
+}
+
+TEST(ArrowQueryResultSerializerTest, NullsAndPromotion) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  ArrowQueryResultSerializer serializer(tp->ExecuteQuery(
+      "select column1 as a, column2 as b from "
+      "(values (1, null), (null, 'x'), (2.5, ''), (3, null))"));
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_EQ(deser.error, "");
+  EXPECT_THAT(deser.field_types, ElementsAre(kTypeFloatingPoint, kTypeUtf8));
+  EXPECT_THAT(deser.cells, ElementsAre("1.00", "NULL", "NULL", "'x'", "2.50",
+                                       "''", "3.00", "NULL"));
+}
+
+TEST(ArrowQueryResultSerializerTest, MultipleBatches) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  RunQueryChecked(tp.get(),
+                  "create perfetto table t as "
+                  "with recursive nums(x) as "
+                  "(select 0 union all select x + 1 from nums where x < 999) "
+                  "select x, x * 0.5 as half, 'r' || x as str from nums");
+  ArrowQueryResultSerializer serializer(
+      tp->ExecuteQuery("select x, half, str from t"));
+  serializer.set_batch_size_for_testing(128, 1024 * 1024);
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_EQ(deser.error, "");
+  EXPECT_TRUE(deser.eos_reached);
+  EXPECT_EQ(deser.record_batch_count, 8u);
+  ASSERT_EQ(deser.cells.size(), 3000u);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    ASSERT_EQ(deser.cells[3 * i], std::to_string(i));
+    ASSERT_EQ(deser.cells[3 * i + 1],
+              base::StackString<32>("%.2f", i * 0.5).ToStdString());
+    ASSERT_EQ(deser.cells[3 * i + 2], "'r" + std::to_string(i) + "'");
+  }
+}
+
+TEST(ArrowQueryResultSerializerTest, SplitOnBatchSize) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  ArrowQueryResultSerializer serializer(
+      tp->ExecuteQuery("with recursive nums(x) as "
+                       "(select 0 union all select x + 1 from nums where x < 9)"
+                       "select printf('%0100d', x) as s from nums"));
+  serializer.set_batch_size_for_testing(1000, 256);
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_EQ(deser.error, "");
+  EXPECT_EQ(deser.record_batch_count, 4u);
+  EXPECT_EQ(deser.cells.size(), 10u);
+}
+
+TEST(ArrowQueryResultSerializerTest, MixedTypes) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  ArrowQueryResultSerializer serializer(tp->ExecuteQuery(
+      "select column1 as a from (values (1), (2), ('x'), (3))"));
+  serializer.set_batch_size_for_testing(2, 1024);
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_THAT(deser.error, HasSubstr("Column 'a'"));
+  EXPECT_THAT(deser.error, HasSubstr("mixed types"));
+  EXPECT_TRUE(deser.eos_reached);
+  EXPECT_THAT(deser.cells, ElementsAre("1", "2"));
+}
+
+TEST(ArrowQueryResultSerializerTest, QueryError) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  ArrowQueryResultSerializer serializer(
+      tp->ExecuteQuery("select * from table_which_does_not_exist"));
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_THAT(deser.error, HasSubstr("no such table"));
+  EXPECT_TRUE(deser.eos_reached);
+  EXPECT_TRUE(deser.field_names.empty());
+  EXPECT_EQ(deser.record_batch_count, 0u);
+}
+
+TEST(ArrowQueryResultSerializerTest, NoRows) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  ArrowQueryResultSerializer serializer(
+      tp->ExecuteQuery("select 1 as a, 'x' as b where 0"));
+  TestArrowDeserializer deser;
+  deser.SerializeAndDeserialize(&serializer);
+
+  EXPECT_EQ(deser.error, "");
+  EXPECT_TRUE(deser.eos_reached);
+  EXPECT_THAT(deser.field_names, ElementsAre("a", "b"));
+  EXPECT_THAT(deser.field_types, ElementsAre(kTypeNull, kTypeNull));
+  EXPECT_EQ(deser.record_batch_count, 0u);
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
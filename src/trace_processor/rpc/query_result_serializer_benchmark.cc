@@ -20,13 +20,16 @@
 #include <benchmark/benchmark.h>
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/rpc/arrow_query_result_serializer.h"
 
+using perfetto::trace_processor::ArrowQueryResultSerializer;
 using perfetto::trace_processor::Config;
 using perfetto::trace_processor::QueryResultSerializer;
 using perfetto::trace_processor::TraceProcessor;
@@ -38,63 +41,93 @@ bool IsBenchmarkFunctionalOnly() {
   return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
 }
 
-void BenchmarkArgs(benchmark::internal::Benchmark* b) {
+// The arguments are: rows per batch, batch split threshold and the number of
+// rows in the result.
+void BenchmarkArgs(benchmark::internal::Benchmark* b, int64_t rows) {
   if (IsBenchmarkFunctionalOnly()) {
-    b->Ranges({{1024, 1024}, {4096, 4096}});
+    b->Ranges({{1024, 1024}, {4096, 4096}, {rows, rows}});
   } else {
-    b->RangeMultiplier(8)->Ranges({{128, 8192}, {4096, 1024 * 512}});
+    b->RangeMultiplier(8)->Ranges(
+        {{128, 8192}, {4096, 1024 * 512}, {rows, rows}});
   }
 }
 
+void MixedArgs(benchmark::internal::Benchmark* b) {
+  BenchmarkArgs(b, 50000);
+}
+
+void StringsArgs(benchmark::internal::Benchmark* b) {
+  BenchmarkArgs(b, 100000);
+}
+
 void RunQueryChecked(TraceProcessor* tp, const std::string& query) {
   auto iter = tp->ExecuteQuery(query);
   iter.Next();
   PERFETTO_CHECK(iter.Status().ok());
 }
 
-}  // namespace
-
-static void BM_QueryResultSerializer_Mixed(benchmark::State& state) {
+// Creates a TraceProcessor with a `win` table of `rows` rows.
+std::unique_ptr<TraceProcessor> CreateWindowTp(int64_t rows) {
   auto tp = TraceProcessor::CreateInstance(Config());
-  RunQueryChecked(
-      tp.get(),
-      "create virtual table win using __intrinsic_window(0, 50000, 1);");
+  RunQueryChecked(tp.get(),
+                  "create virtual table win using __intrinsic_window(0, " +
+                      std::to_string(rows) + ", 1);");
+  return tp;
+}
+
+// Serializes the result of `query` with `Serializer` (either
+// QueryResultSerializer or ArrowQueryResultSerializer) once per iteration.
+template <typename Serializer>
+void RunSerializer(benchmark::State& state,
+                   TraceProcessor* tp,
+                   const std::string& query) {
   VectorType buf;
+  int64_t rows = 0;
   for (auto _ : state) {
-    auto iter = tp->ExecuteQuery(
-        "select dur || dur as x, ts, dur * 1.0 as dur, quantum_ts from win");
-    QueryResultSerializer serializer(std::move(iter));
+    auto iter = tp->ExecuteQuery(query);
+    Serializer serializer(std::move(iter));
     serializer.set_batch_size_for_testing(
         static_cast<uint32_t>(state.range(0)),
         static_cast<uint32_t>(state.range(1)));
     while (serializer.Serialize(&buf)) {
     }
     benchmark::DoNotOptimize(buf.data());
+    state.counters["bytes"] = static_cast<double>(buf.size());
     buf.clear();
+    rows += state.range(2);
   }
+  state.SetItemsProcessed(rows);
   benchmark::ClobberMemory();
 }
 
+constexpr char kMixedQuery[] =
+    "select dur || dur as x, ts, dur * 1.0 as dur, quantum_ts from win";
+constexpr char kStringsQuery[] =
+    "select  ts || '-' || ts , (dur * 1.0) || dur from win";
+
+}  // namespace
+
+static void BM_QueryResultSerializer_Mixed(benchmark::State& state) {
+  auto tp = CreateWindowTp(state.range(2));
+  RunSerializer<QueryResultSerializer>(state, tp.get(), kMixedQuery);
+}
+
 static void BM_QueryResultSerializer_Strings(benchmark::State& state) {
-  auto tp = TraceProcessor::CreateInstance(Config());
-  RunQueryChecked(
-      tp.get(),
-      "create virtual table win using __intrinsic_window(0, 100000, 1);");
-  VectorType buf;
-  for (auto _ : state) {
-    auto iter = tp->ExecuteQuery(
-        "select  ts || '-' || ts , (dur * 1.0) || dur from win");
-    QueryResultSerializer serializer(std::move(iter));
-    serializer.set_batch_size_for_testing(
-        static_cast<uint32_t>(state.range(0)),
-        static_cast<uint32_t>(state.range(1)));
-    while (serializer.Serialize(&buf)) {
-    }
-    benchmark::DoNotOptimize(buf.data());
-    buf.clear();
-  }
-  benchmark::ClobberMemory();
+  auto tp = CreateWindowTp(state.range(2));
+  RunSerializer<QueryResultSerializer>(state, tp.get(), kStringsQuery);
+}
+
+static void BM_ArrowQueryResultSerializer_Mixed(benchmark::State& state) {
+  auto tp = CreateWindowTp(state.range(2));
+  RunSerializer<ArrowQueryResultSerializer>(state, tp.get(), kMixedQuery);
+}
+
+static void BM_ArrowQueryResultSerializer_Strings(benchmark::State& state) {
+  auto tp = CreateWindowTp(state.range(2));
+  RunSerializer<ArrowQueryResultSerializer>(state, tp.get(), kStringsQuery);
 }
 
-BENCHMARK(BM_QueryResultSerializer_Mixed)->Apply(BenchmarkArgs);
-BENCHMARK(BM_QueryResultSerializer_Strings)->Apply(BenchmarkArgs);
+BENCHMARK(BM_QueryResultSerializer_Mixed)->Apply(MixedArgs);
+BENCHMARK(BM_QueryResultSerializer_Strings)->Apply(StringsArgs);
+BENCHMARK(BM_ArrowQueryResultSerializer_Mixed)->Apply(MixedArgs);
+BENCHMARK(BM_ArrowQueryResultSerializer_Strings)->Apply(StringsArgs);
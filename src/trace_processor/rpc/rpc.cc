@@ -39,6 +39,7 @@
 #include "perfetto/protozero/scattered_heap_buffer.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/rpc/arrow_query_result_serializer.h"
 #include "src/trace_processor/tp_metatrace.h"
 
 #include "protos/perfetto/trace_processor/metatrace_categories.pbzero.h"
@@ -96,6 +97,30 @@ void Response::Send(Rpc::RpcResponseFunction send_fn) {
   }
 }
 
+// Appends the next batch of the results of a query to a QueryResult message
+// and returns true if there are more batches.
+using SerializeQueryResultFn =
+    std::function<bool(protos::pbzero::QueryResult*)>;
+
+// Creates a function serializing the results of `it` in the format requested
+// by the QueryArgs of the query.
+SerializeQueryResultFn CreateQueryResultSerializer(Iterator it,
+                                                   base::TimeNanos t_start,
+                                                   int32_t result_format) {
+  if (result_format == protos::pbzero::QueryArgs::RESULT_FORMAT_ARROW_IPC) {
+    auto serializer =
+        std::make_shared<ArrowQueryResultSerializer>(std::move(it), t_start);
+    return [serializer](protos::pbzero::QueryResult* res) {
+      return serializer->Serialize(res);
+    };
+  }
+  auto serializer =
+      std::make_shared<QueryResultSerializer>(std::move(it), t_start);
+  return [serializer](protos::pbzero::QueryResult* res) {
+    return serializer->Serialize(res);
+  };
+}
+
 }  // namespace
 
 Rpc::Rpc(std::unique_ptr<TraceProcessor> preloaded_instance,
@@ -266,11 +291,12 @@ void Rpc::ParseRpcRequest(const uint8_t* data, size_t len) {
         const auto t_start = base::GetWallTimeNs();
         auto it = trace_processor_->ExecuteQuery(sql);
 
-        QueryResultSerializer serializer(std::move(it), t_start);
+        auto serialize = CreateQueryResultSerializer(std::move(it), t_start,
+                                                     query.result_format());
         for (bool has_more = true; has_more;) {
           const auto seq_id = tx_seq_id_++;
           Response resp(seq_id, req_type);
-          has_more = serializer.Serialize(resp->set_query_result());
+          has_more = serialize(resp->set_query_result());
           const uint32_t resp_size = resp->Finalize();
           if (resp_size < protozero::proto_utils::kMaxMessageLength) {
             // This is the nominal case.
@@ -630,12 +656,13 @@ void Rpc::Query(const uint8_t* args,
   const auto t_start = base::GetWallTimeNs();
   auto it = trace_processor_->ExecuteQuery(sql);
 
-  QueryResultSerializer serializer(std::move(it), t_start);
+  auto serialize = CreateQueryResultSerializer(std::move(it), t_start,
+                                               query.result_format());
 
   protozero::HeapBuffered<protos::pbzero::QueryResult> buffered(kSliceSize,
                                                                 kSliceSize);
   for (bool has_more = true; has_more;) {
-    has_more = serializer.Serialize(buffered.get());
+    has_more = serialize(buffered.get());
     const auto& res = buffered.GetSlices();
     for (uint32_t i = 0; i < res.size(); ++i) {
       auto used = res[i].GetUsedRange();
@@ -16,6 +16,9 @@
 
 #include "src/trace_processor/shell/common_flags.h"
 
+#include <fcntl.h>
+
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -29,7 +32,9 @@
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
 #include "perfetto/base/time.h"
+#include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/getopt.h"
+#include "perfetto/ext/base/scoped_file.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_splitter.h"
@@ -40,6 +45,7 @@
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/metatrace_config.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/core/dataframe/dataframe_snapshot.h"
 #include "src/trace_processor/shell/metatrace.h"
 #include "src/trace_processor/shell/metrics.h"
 #include "src/trace_processor/shell/shell_utils.h"
@@ -67,6 +73,19 @@ void AppendFlagList(std::string* out, const std::vector<FlagSpec>& flags) {
   }
 }
 
+// Returns true if |path| is a snapshot written by TraceProcessor::SaveSnapshot.
+bool IsSnapshotFile(const std::string& path) {
+  base::ScopedFile fd(base::OpenFile(path, O_RDONLY));
+  if (!fd) {
+    return false;
+  }
+  uint8_t magic[8];
+  ssize_t rsize = base::Read(*fd, magic, sizeof(magic));
+  return rsize == static_cast<ssize_t>(sizeof(magic)) &&
+         core::dataframe::DataframeSnapshotReader::IsSnapshot(magic,
+                                                              sizeof(magic));
+}
+
 }  // namespace
 
 std::string FormatSubcommandUsage(const char* argv0, Subcommand* cmd) {
@@ -109,6 +128,31 @@ std::vector<FlagSpec> GetGlobalFlagSpecs(GlobalOptions* opts) {
   flags.push_back(BoolFlag("crop-track-events", '\0',
                            "Ignores track events outside range of interest.",
                            &opts->crop_track_events));
+  flags.push_back(
+      {/*long_name=*/"ingestion-threads", /*short_name=*/'\0',
+       /*has_arg=*/true, /*arg_name=*/"N",
+       /*help=*/"Decompresses proto trace packets on N worker threads.",
+       [opts](const char* v) {
+         opts->ingestion_threads = static_cast<uint32_t>(atoi(v));
+       }});
+  flags.push_back(
+      {/*long_name=*/"query-threads", /*short_name=*/'\0',
+       /*has_arg=*/true, /*arg_name=*/"N",
+       /*help=*/"Executes large table scans on N worker threads.",
+       [opts](const char* v) {
+         opts->query_threads = static_cast<uint32_t>(atoi(v));
+       }});
+  flags.push_back(BoolFlag("compress-columns", '\0',
+                           "Compresses low-cardinality integer columns after "
+                           "loading the trace.",
+                           &opts->compress_columns));
+  flags.push_back(BoolFlag("dataframe-scans", '\0',
+                           "Executes simple single-table queries without "
+                           "going through SQLite.",
+                           &opts->dataframe_scans));
+  flags.push_back(StringFlag("module-cache-dir", '\0', "DIR",
+                             "Caches the tables of stdlib modules in DIR.",
+                             &opts->module_cache_dir));
   flags.push_back(
       BoolFlag("dev", '\0', "Enables local development features.", &opts->dev));
   flags.push_back({/*long_name=*/"dev-flag", /*short_name=*/'\0',
@@ -282,6 +326,11 @@ Config BuildConfig(const GlobalOptions& opts,
       opts.crop_track_events
           ? DropTrackEventDataBefore::kTrackEventRangeOfInterest
           : DropTrackEventDataBefore::kNoDrop;
+  config.ingestion_thread_count = opts.ingestion_threads;
+  config.query_thread_count = opts.query_threads;
+  config.enable_column_compression = opts.compress_columns;
+  config.enable_dataframe_scans = opts.dataframe_scans;
+  config.module_cache_dir = opts.module_cache_dir;
 
   for (const auto& ext : opts.metric_extensions) {
     config.skip_builtin_metric_paths.push_back(ext.virtual_path());
@@ -379,6 +428,18 @@ base::StatusOr<base::TimeNanos> LoadTraceFile(
     TraceProcessorShell_PlatformInterface* platform,
     const std::string& trace_file) {
   base::TimeNanos t_load_start = base::GetWallTimeNs();
+
+  // Snapshots already contain the result of symbolization and deobfuscation
+  // so none of the steps below apply.
+  if (IsSnapshotFile(trace_file)) {
+    RETURN_IF_ERROR(tp->LoadSnapshot(trace_file));
+    base::TimeNanos t_load = base::GetWallTimeNs() - t_load_start;
+    PERFETTO_ILOG("Snapshot loaded in %.2fs",
+                  static_cast<double>(t_load.count()) / 1E9);
+    RETURN_IF_ERROR(PrintStats(tp));
+    return t_load;
+  }
+
   double size_mb = 0;
 
   base::Status load_status =
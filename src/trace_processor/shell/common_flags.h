@@ -18,6 +18,7 @@
 #define SRC_TRACE_PROCESSOR_SHELL_COMMON_FLAGS_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -47,6 +48,11 @@ struct GlobalOptions {
   bool no_ftrace_raw = false;
   bool analyze_trace_proto_content = false;
   bool crop_track_events = false;
+  uint32_t ingestion_threads = 0;
+  uint32_t query_threads = 0;
+  bool compress_columns = false;
+  bool dataframe_scans = false;
+  std::string module_cache_dir;
 
   bool dev = false;
   std::vector<std::string> dev_flags;
@@ -32,7 +32,7 @@ const char* ExportSubcommand::name() const {
 }
 
 const char* ExportSubcommand::description() const {
-  return "Export trace to a database file.";
+  return "Export trace to a database or snapshot file.";
 }
 
 const char* ExportSubcommand::usage_args() const {
@@ -40,11 +40,16 @@ const char* ExportSubcommand::usage_args() const {
 }
 
 const char* ExportSubcommand::detailed_help() const {
-  return R"(Load a trace and export it to a database file.
+  return R"(Load a trace and export it to a database or snapshot file.
 
-Currently the only supported format is "sqlite", which exports all trace
-processor tables to a SQLite database. The format is the first positional
-argument, and -o specifies the output path.)";
+Supported formats:
+  sqlite    Exports all trace processor tables to a SQLite database.
+  snapshot  Writes a columnar snapshot of all trace processor tables. The
+            snapshot can be passed in place of a trace file to any other
+            subcommand and loads much faster than the original trace.
+
+The format is the first positional argument, and -o specifies the output
+path.)";
 }
 
 std::vector<FlagSpec> ExportSubcommand::GetFlags() {
@@ -56,13 +61,14 @@ std::vector<FlagSpec> ExportSubcommand::GetFlags() {
 base::Status ExportSubcommand::Run(const SubcommandContext& ctx) {
   // First positional arg is the format.
   if (ctx.positional_args.empty()) {
-    return base::ErrStatus("export: must specify format (sqlite)");
+    return base::ErrStatus("export: must specify format (sqlite, snapshot)");
   }
   const std::string& format = ctx.positional_args[0];
 
-  if (format != "sqlite") {
-    return base::ErrStatus("export: unknown format '%s' (expected sqlite)",
-                           format.c_str());
+  if (format != "sqlite" && format != "snapshot") {
+    return base::ErrStatus(
+        "export: unknown format '%s' (expected sqlite or snapshot)",
+        format.c_str());
   }
 
   if (output_path_.empty()) {
@@ -80,6 +86,9 @@ base::Status ExportSubcommand::Run(const SubcommandContext& ctx) {
                    SetupTraceProcessor(*ctx.global, config, ctx.platform));
   RETURN_IF_ERROR(LoadTraceFile(tp.get(), ctx.platform, trace_file).status());
 
+  if (format == "snapshot") {
+    return tp->SaveSnapshot(output_path_);
+  }
   return ExportTraceToDatabase(tp.get(), output_path_);
 }
 
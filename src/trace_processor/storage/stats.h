@@ -246,6 +246,15 @@ namespace perfetto::trace_processor::stats {
     "The timestamp when trigger for the clone snapshot operation for this "    \
     "trace was received"), \
   F(traced_chunks_discarded,              kSingle,  kInfo,     kTrace,    ""), \
+  F(traced_commit_chunks_committed,       kSingle,  kInfo,     kTrace,         \
+       "Number of chunks moved into the trace buffers by CommitDataRequest "   \
+       "IPCs. Divide by traced_commit_data_requests for the average number "   \
+       "of chunks per commit."),                                               \
+  F(traced_commit_data_requests,          kSingle,  kInfo,     kTrace,         \
+       "Number of CommitDataRequest IPCs received by traced for this trace."), \
+  F(traced_commit_duration_ms,            kSingle,  kInfo,     kTrace,         \
+       "Time over which traced_commit_data_requests were received, to "        \
+       "compute the commit rate."),                                            \
   F(traced_data_sources_registered,       kSingle,  kInfo,     kTrace,    ""), \
   F(traced_data_sources_seen,             kSingle,  kInfo,     kTrace,    ""), \
   F(traced_final_flush_failed,            kSingle,  kDataLoss, kTrace,    ""), \
@@ -258,6 +267,24 @@ namespace perfetto::trace_processor::stats {
   F(traced_producers_seen,                kSingle,  kInfo,     kTrace,    ""), \
   F(traced_total_buffers,                 kSingle,  kInfo,     kTrace,    ""), \
   F(traced_tracing_sessions,              kSingle,  kInfo,     kTrace,    ""), \
+  F(traced_write_into_file_bytes_copied,  kSingle,  kInfo,     kTrace,         \
+       "Bytes written into the trace file by traced out of memory it owns: "   \
+       "preambles, service-generated packets and the output of TraceFilter "   \
+       "or compression."),                                                     \
+  F(traced_write_into_file_bytes_zero_copy,                                    \
+                                          kSingle,  kInfo,     kTrace,         \
+       "Bytes written into the trace file by traced straight out of the "      \
+       "trace buffers, without copying them first."),                          \
+  F(traced_write_into_file_max_queued_bytes,                                   \
+                                          kSingle,  kInfo,     kTrace,         \
+       "Peak size of the queue of the traced file writer thread (see "         \
+       "TraceConfig.file_write_queue_size_kb)."),                              \
+  F(traced_write_into_file_queue_full_events,                                  \
+                                          kSingle,  kInfo,     kTrace,         \
+       "Number of times traced stopped a periodic write pass early because "   \
+       "the queue of its file writer thread was full. The data stays in the "  \
+       "trace buffers, so this can lead to buffer overruns."),                 \
+  F(traced_write_into_file_writev_calls,  kSingle,  kInfo,     kTrace,    ""), \
   F(track_event_parser_errors,            kSingle,  kInfo,     kAnalysis, ""), \
   F(track_event_dropped_packets_outside_of_range_of_interest,                  \
                                           kSingle,  kInfo,     kAnalysis,      \
@@ -400,6 +427,21 @@ namespace perfetto::trace_processor::stats {
   F(perf_chosen_process_shard,            kIndexed, kInfo,     kTrace,    ""), \
   F(perf_guardrail_stop_ts,               kIndexed, kDataLoss, kTrace,    ""), \
   F(perf_unknown_record_type,             kIndexed, kInfo,     kAnalysis, ""), \
+  F(perf_unwinder_elf_cache_hits,         kIndexed, kInfo,     kTrace,         \
+       "Mappings whose parsed library was reused from the traced_perf ELF "    \
+       "cache, per traced_perf unwinder thread."),                             \
+  F(perf_unwinder_elf_cache_misses,       kIndexed, kInfo,     kTrace,         \
+       "Libraries parsed and added to the traced_perf ELF cache, per "         \
+       "traced_perf unwinder thread."),                                        \
+  F(perf_unwinder_max_queue_depth,        kIndexed, kInfo,     kTrace,         \
+       "Highest number of samples in the queue of each traced_perf unwinder "  \
+       "thread (indexed by unwinder). Samples are dropped when it's full."),   \
+  F(perf_unwinder_samples_unwound,        kIndexed, kInfo,     kTrace,         \
+       "Number of samples unwound by each traced_perf unwinder thread."),      \
+  F(perf_unwinder_unwind_time_max_us,     kIndexed, kInfo,     kTrace,         \
+       "Slowest unwind of a single sample, per traced_perf unwinder thread."), \
+  F(perf_unwinder_unwind_time_total_us,   kIndexed, kInfo,     kTrace,         \
+       "Time spent unwinding samples, per traced_perf unwinder thread."),      \
   F(perf_record_skipped,                  kIndexed, kError,    kAnalysis, ""), \
   F(perf_samples_skipped,                 kSingle,  kError,    kAnalysis,      \
       "Count of skipped perf samples that otherwise matched the tracing "      \
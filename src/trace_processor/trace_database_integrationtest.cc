@@ -39,12 +39,14 @@
 #include "protos/perfetto/trace_processor/trace_processor.pbzero.h"
 
 #include "src/base/test/status_matchers.h"
+#include "src/base/test/tmp_dir_tree.h"
 #include "src/base/test/utils.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto::trace_processor {
 namespace {
 
+using testing::ElementsAre;
 using testing::HasSubstr;
 
 constexpr size_t kMaxChunkSize = 4ul * 1024 * 1024;
@@ -102,6 +104,87 @@ TEST(TraceProcessorCustomConfigTest, HandlesMalformedMountPath) {
   ASSERT_EQ(it.Get(0).long_value, 1);
 }
 
+class ModuleCacheIntegrationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tmp_.AddDir("cache");
+    config_.module_cache_dir = tmp_.AbsolutePath("cache");
+  }
+
+  void TearDown() override {
+    // Let TmpDirTree delete all the files created by the cache.
+    std::vector<std::string> files;
+    ASSERT_TRUE(base::ListFilesRecursive(config_.module_cache_dir, files).ok());
+    for (const auto& file : files) {
+      tmp_.TrackFile("cache/" + file);
+    }
+  }
+
+  // Loads a trace with |config_| and includes |module|, returning the
+  // lookups of the module cache as "<table> <hit|miss>[ prefetched]".
+  std::vector<std::string> LoadAndInclude(const std::string& module) {
+    auto processor = TraceProcessor::CreateInstance(config_);
+    // A single empty TracePacket.
+    static constexpr uint8_t kTrace[] = {0x0a, 0x00};
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[sizeof(kTrace)]);
+    memcpy(buf.get(), kTrace, sizeof(kTrace));
+    EXPECT_OK(processor->Parse(std::move(buf), sizeof(kTrace)));
+    EXPECT_OK(processor->NotifyEndOfFile());
+
+    auto it = processor->ExecuteQuery("INCLUDE PERFETTO MODULE " + module);
+    while (it.Next()) {
+    }
+    EXPECT_OK(it.Status());
+
+    std::vector<std::string> lookups;
+    it = processor->ExecuteQuery(
+        "SELECT table_name || IIF(hit, ' hit', ' miss') || "
+        "IIF(prefetched, ' prefetched', '') FROM module_cache_stats");
+    while (it.Next()) {
+      lookups.emplace_back(it.Get(0).AsString());
+    }
+    EXPECT_OK(it.Status());
+    return lookups;
+  }
+
+  base::TmpDirTree tmp_;
+  Config config_;
+};
+
+TEST_F(ModuleCacheIntegrationTest, ConfigChangeIsMiss) {
+  const std::vector<std::string> kMiss{"cpu_idle_counters miss"};
+  const std::vector<std::string> kHit{"cpu_idle_counters hit"};
+
+  ASSERT_EQ(LoadAndInclude("linux.cpu.idle"), kMiss);
+  ASSERT_EQ(LoadAndInclude("linux.cpu.idle"), kHit);
+
+  // Options which change the imported data invalidate the cached tables.
+  config_.window_size_ns = 1000;
+  ASSERT_EQ(LoadAndInclude("linux.cpu.idle"), kMiss);
+  ASSERT_EQ(LoadAndInclude("linux.cpu.idle"), kHit);
+
+  config_.sorting_mode = SortingMode::kForceFullSort;
+  ASSERT_EQ(LoadAndInclude("linux.cpu.idle"), kMiss);
+
+  // Others don't.
+  config_.enable_column_compression = true;
+  ASSERT_EQ(LoadAndInclude("linux.cpu.idle"), kHit);
+}
+
+TEST_F(ModuleCacheIntegrationTest, PrefetchesModuleChain) {
+  // linux.cpu.idle_stats includes linux.cpu.idle, which includes
+  // counters.intervals.
+  config_.query_thread_count = 2;
+  ASSERT_THAT(LoadAndInclude("linux.cpu.idle_stats"),
+              ElementsAre("cpu_idle_counters miss", "cpu_idle_stats miss"));
+
+  // With a warm cache, all the tables of the chain are loaded ahead of their
+  // statements.
+  ASSERT_THAT(LoadAndInclude("linux.cpu.idle_stats"),
+              ElementsAre("cpu_idle_counters hit prefetched",
+                          "cpu_idle_stats hit prefetched"));
+}
+
 class TraceProcessorIntegrationTest : public ::testing::Test {
  public:
   TraceProcessorIntegrationTest()
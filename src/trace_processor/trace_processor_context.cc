@@ -22,6 +22,7 @@
 #include <utility>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
 #include "src/trace_processor/importers/common/args_translation_table.h"
@@ -174,6 +175,14 @@ void InitGlobalState(TraceProcessorContext* context, const Config& config) {
   context->stack_profile_tracker = Ptr<StackProfileTracker>::MakeRoot(context);
   context->deobfuscation_tracker = nullptr;
   context->blob_packet_writer = Ptr<BlobPacketWriter>::MakeRoot();
+  if (config.ingestion_thread_count > 0) {
+    context->ingestion_thread_pool =
+        Ptr<base::ThreadPool>::MakeRoot(config.ingestion_thread_count);
+  }
+  if (config.query_thread_count > 0) {
+    context->query_thread_pool =
+        Ptr<base::ThreadPool>::MakeRoot(config.query_thread_count);
+  }
   context->register_additional_proto_modules = nullptr;
 
   // Per-Trace State (Miscategorized).
@@ -209,6 +218,8 @@ void CopyGlobalState(const TraceProcessorContext* source,
   dest->heap_graph_tracker = source->heap_graph_tracker.Fork();
   dest->deobfuscation_tracker = source->deobfuscation_tracker.Fork();
   dest->blob_packet_writer = source->blob_packet_writer.Fork();
+  dest->ingestion_thread_pool = source->ingestion_thread_pool.Fork();
+  dest->query_thread_pool = source->query_thread_pool.Fork();
   dest->stack_profile_tracker = source->stack_profile_tracker.Fork();
 }
 
@@ -16,6 +16,8 @@
 
 #include "src/trace_processor/trace_processor_impl.h"
 
+#include <fcntl.h>
+
 #include <algorithm>
 #include <cinttypes>
 #include <cstddef>
@@ -35,12 +37,17 @@
 #include "perfetto/base/thread_utils.h"
 #include "perfetto/base/time.h"
 #include "perfetto/ext/base/clock_snapshots.h"
+#include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/fnv_hash.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/scoped_mmap.h"
 #include "perfetto/ext/base/small_vector.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_splitter.h"
 #include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/version.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
 #include "perfetto/public/compiler.h"
 #include "perfetto/trace_processor/basic_types.h"
@@ -49,6 +56,10 @@
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/dataframe_snapshot.h"
+#include "src/trace_processor/core/dataframe/specs.h"
 #include "src/trace_processor/core/plugin/plugin.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
 #include "src/trace_processor/importers/android_bugreport/android_dumpstate_event_parser.h"
@@ -85,6 +96,8 @@
 #include "src/trace_processor/metrics/metrics.descriptor.h"
 #include "src/trace_processor/metrics/metrics.h"
 #include "src/trace_processor/metrics/sql/amalgamated_sql_metrics.h"
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
+#include "src/trace_processor/perfetto_sql/engine/module_cache_stats_module.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/perfetto_sql/engine/table_pointer_module.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/args.h"
@@ -98,6 +111,8 @@
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/dominator_tree.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/graph_scan.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/graph_traversal.h"
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/group_by.h"
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/hash_join.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/import.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/interval_intersect.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/layout_functions.h"
@@ -137,6 +152,7 @@
 #include "src/trace_processor/sqlite/sql_source.h"
 #include "src/trace_processor/sqlite/sql_stats_table.h"
 #include "src/trace_processor/sqlite/stats_table.h"
+#include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/storage/trace_storage.h"
 #include "src/trace_processor/tables/android_tables_py.h"   // IWYU pragma: keep
 #include "src/trace_processor/tables/jit_tables_py.h"       // IWYU pragma: keep
@@ -509,10 +525,109 @@ std::pair<int64_t, int64_t> GetTraceTimestampBoundsNs(
   return std::make_pair(start_ns, end_ns);
 }
 
+// Snapshots store the state of TraceProcessor which does not live in tables
+// as extra dataframes. The names are chosen to never clash with a table.
+constexpr char kSnapshotStatsName[] = "__snapshot_stats";
+constexpr char kSnapshotTraceBoundsName[] = "__snapshot_trace_bounds";
+
+// Stats are keyed by name rather than by index so that adding or removing
+// stats does not invalidate existing snapshots.
+constexpr auto kSnapshotStatsSpec = dataframe::CreateTypedDataframeSpec(
+    {"name", "idx", "value"},
+    dataframe::CreateTypedColumnSpec(dataframe::String{},
+                                     dataframe::NonNull{},
+                                     dataframe::Unsorted{}),
+    dataframe::CreateTypedColumnSpec(dataframe::Int64{},
+                                     dataframe::DenseNull{},
+                                     dataframe::Unsorted{}),
+    dataframe::CreateTypedColumnSpec(dataframe::Int64{},
+                                     dataframe::NonNull{},
+                                     dataframe::Unsorted{}));
+
+constexpr auto kSnapshotTraceBoundsSpec = dataframe::CreateTypedDataframeSpec(
+    {"start_ts", "end_ts"},
+    dataframe::CreateTypedColumnSpec(dataframe::Int64{},
+                                     dataframe::NonNull{},
+                                     dataframe::Unsorted{}),
+    dataframe::CreateTypedColumnSpec(dataframe::Int64{},
+                                     dataframe::NonNull{},
+                                     dataframe::Unsorted{}));
+
+dataframe::Dataframe CreateSnapshotStats(TraceStorage* storage) {
+  StringPool* pool = storage->mutable_string_pool();
+  auto df = dataframe::Dataframe::CreateFromTypedSpec(kSnapshotStatsSpec, pool);
+  const auto& stats = storage->stats();
+  for (size_t key = 0; key < stats::kNumKeys; ++key) {
+    StringPool::Id name = pool->InternString(stats::kNames[key]);
+    if (stats::kTypes[key] == stats::kSingle) {
+      if (stats[key].value != 0) {
+        df.InsertUnchecked(kSnapshotStatsSpec, name, std::nullopt,
+                           stats[key].value);
+      }
+      continue;
+    }
+    for (const auto& [idx, value] : stats[key].indexed_values) {
+      df.InsertUnchecked(kSnapshotStatsSpec, name,
+                         std::make_optional(int64_t(idx)), value);
+    }
+  }
+  df.Finalize();
+  return df;
+}
+
+void RestoreSnapshotStats(const dataframe::Dataframe& df,
+                          TraceStorage* storage) {
+  base::FlatHashMap<std::string, size_t> keys;
+  for (size_t key = 0; key < stats::kNumKeys; ++key) {
+    keys.Insert(stats::kNames[key], key);
+  }
+  const StringPool& pool = storage->string_pool();
+  for (uint32_t row = 0; row < df.row_count(); ++row) {
+    auto name = df.GetCellUnchecked<0>(kSnapshotStatsSpec, row);
+    size_t* key = keys.Find(pool.Get(name).ToStdString());
+    if (!key) {
+      // Stat removed since the snapshot was taken.
+      continue;
+    }
+    auto idx = df.GetCellUnchecked<1>(kSnapshotStatsSpec, row);
+    int64_t value = df.GetCellUnchecked<2>(kSnapshotStatsSpec, row);
+    if (idx && stats::kTypes[*key] == stats::kIndexed) {
+      storage->SetIndexedStats(*key, static_cast<int>(*idx), value);
+    } else if (!idx && stats::kTypes[*key] == stats::kSingle) {
+      storage->SetStats(*key, value);
+    }
+  }
+}
+
+// Returns an error if a dataframe loaded from a snapshot does not have the
+// schema of the table it is meant to replace.
+base::Status CheckSnapshotSpecMatches(const std::string& name,
+                                      const dataframe::DataframeSpec& expected,
+                                      const dataframe::DataframeSpec& actual) {
+  bool matches = expected.column_names == actual.column_names &&
+                 expected.column_specs.size() == actual.column_specs.size();
+  for (size_t i = 0; matches && i < expected.column_specs.size(); ++i) {
+    const auto& e = expected.column_specs[i];
+    const auto& a = actual.column_specs[i];
+    matches = e.type == a.type && e.nullability == a.nullability &&
+              e.sort_state == a.sort_state &&
+              e.duplicate_state == a.duplicate_state;
+  }
+  if (!matches) {
+    return base::ErrStatus(
+        "Snapshot: schema of table '%s' does not match this version of trace "
+        "processor",
+        name.c_str());
+  }
+  return base::OkStatus();
+}
+
 }  // namespace
 
 TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
-    : TraceProcessorStorageImpl(cfg), config_(cfg) {
+    : TraceProcessorStorageImpl(cfg),
+      config_(cfg),
+      module_cache_(cfg.module_cache_dir) {
   // Initialize plugins using the statically pre-computed PluginSet.
   // Dep indices are resolved once at static init time; here we just
   // instantiate, resolve dep pointers, and register importers.
@@ -644,6 +759,9 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
         /*modules=*/package.value(),
         /*allow_override=*/false,
     });
+    // The standard library only depends on the trace and on itself so its
+    // tables can be cached.
+    module_cache_.AddCacheablePackage(package.key());
   }
 
   // Compute initial trace bounds before any tables are finalized.
@@ -661,6 +779,7 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
       notify_eof_called_,
       cached_trace_bounds_,
       plugins_,
+      &module_cache_,
   });
 
   sqlite_objects_post_prelude_ = engine_->SqliteRegisteredObjectCount();
@@ -738,10 +857,13 @@ base::Status TraceProcessorImpl::NotifyEndOfFile() {
   CacheBoundsAndBuildTable();
 
   // Stage 3: reduce memory usage by both destroying parser context *and*
-  // finalizing dataframes.
+  // finalizing (and optionally compressing) dataframes.
   TraceProcessorStorageImpl::DestroyContext();
   for (const auto& table : GetStaticTables(context()->storage.get())) {
     table.dataframe->Finalize();
+    if (config_.enable_column_compression) {
+      table.dataframe->CompressColumns();
+    }
   }
   // Also finalize plugin-owned tables.
   {
@@ -751,10 +873,22 @@ base::Status TraceProcessorImpl::NotifyEndOfFile() {
     }
     for (const auto& table : plugin_tables) {
       table.dataframe->Finalize();
+      if (config_.enable_column_compression) {
+        table.dataframe->CompressColumns();
+      }
     }
   }
 
   // Stage 4: prepare the engine for queries.
+  if (trace_content_hash_) {
+    UpdateModuleCacheSourcesHash();
+    module_cache_.SetTraceHash(trace_content_hash_->digest());
+    // Cached tables are prefetched on the query threads, which intern their
+    // strings concurrently with the queries running on this thread.
+    if (context()->query_thread_pool) {
+      context()->storage->mutable_string_pool()->set_locking(true);
+    }
+  }
   IncludeAfterEofPrelude(engine_.get());
   sqlite_objects_post_prelude_ = engine_->SqliteRegisteredObjectCount();
 
@@ -783,6 +917,13 @@ Iterator TraceProcessorImpl::ExecuteQuery(const std::string& sql) {
       context()->storage->mutable_sql_stats()->RecordQueryBegin(
           sql, base::GetWallTimeNs().count());
   std::string non_breaking_sql = base::ReplaceAll(sql, "\u00A0", " ");
+  if (config_.enable_dataframe_scans) {
+    if (auto scan = engine_->PrepareDataframeScan(non_breaking_sql); scan) {
+      std::unique_ptr<IteratorImpl> impl(new IteratorImpl(
+          this, std::move(scan), std::move(non_breaking_sql), sql_stats_row));
+      return Iterator(std::move(impl));
+    }
+  }
   base::StatusOr<PerfettoSqlEngine::ExecutionResult> result =
       engine_->ExecuteUntilLastStatement(
           SqlSource::FromExecuteQuery(std::move(non_breaking_sql)));
@@ -836,9 +977,61 @@ base::Status TraceProcessorImpl::RegisterSqlPackage(SqlPackage sql_package) {
   std::string pkg_name = name;
   registered_sql_packages_.emplace_back(std::move(sql_package));
   engine_->RegisterPackage(pkg_name, std::move(new_package));
+  UpdateModuleCacheSourcesHash();
   return base::OkStatus();
 }
 
+void TraceProcessorImpl::UpdateModuleCacheSourcesHash() {
+  if (config_.module_cache_dir.empty()) {
+    return;
+  }
+  base::FnvHasher hasher;
+  auto update_string = [&hasher](const std::string& s) {
+    hasher.Update(s.size());
+    hasher.Update(s);
+  };
+  update_string(base::GetVersionString());
+
+  // The config options which change the contents of the tables. The others
+  // only affect how the data is stored (e.g. enable_column_compression), how
+  // it is computed (e.g. the thread counts) or the SQL outside of the standard
+  // library (skip_builtin_metric_paths).
+  hasher.UpdateAll(static_cast<int>(config_.parsing_mode),
+                   static_cast<int>(config_.sorting_mode),
+                   config_.ingest_ftrace_in_raw_table,
+                   static_cast<int>(config_.drop_ftrace_data_before),
+                   static_cast<int>(config_.soft_drop_ftrace_data_before),
+                   static_cast<int>(config_.drop_track_event_data_before),
+                   config_.analyze_trace_proto_content,
+                   config_.enable_dev_features, config_.window_size_ns);
+  std::vector<std::pair<std::string, std::string>> dev_flags(
+      config_.dev_flags.begin(), config_.dev_flags.end());
+  std::sort(dev_flags.begin(), dev_flags.end());
+  for (const auto& [key, value] : dev_flags) {
+    update_string(key);
+    update_string(value);
+  }
+  for (const std::string& descriptor : config_.extra_parsing_descriptors) {
+    update_string(descriptor);
+  }
+
+  // Modules can include modules of any package so hash all of them, in a
+  // stable order.
+  std::vector<const std::pair<std::string, std::string>*> modules;
+  for (const SqlPackage& package : registered_sql_packages_) {
+    for (const auto& module : package.modules) {
+      modules.push_back(&module);
+    }
+  }
+  std::sort(modules.begin(), modules.end(),
+            [](const auto* a, const auto* b) { return *a < *b; });
+  for (const auto* module : modules) {
+    update_string(module->first);
+    update_string(module->second);
+  }
+  module_cache_.SetSourcesHash(hasher.digest());
+}
+
 // =================================================================
 // |  Trace-based metrics (v2) related functionality starts here   |
 // =================================================================
@@ -989,6 +1182,7 @@ size_t TraceProcessorImpl::RestoreInitialTables() {
       notify_eof_called_,
       cached_trace_bounds_,
       plugins_,
+      &module_cache_,
   });
 
   // The registered count should now be the same as it was in the constructor.
@@ -997,6 +1191,149 @@ size_t TraceProcessorImpl::RestoreInitialTables() {
   return static_cast<size_t>(registered_count_before - registered_count_after);
 }
 
+base::Status TraceProcessorImpl::SaveSnapshot(const std::string& path) {
+  if (!notify_eof_called_) {
+    return base::ErrStatus(
+        "SaveSnapshot: NotifyEndOfFile must be called before saving a "
+        "snapshot");
+  }
+  TraceStorage* storage = context()->storage.get();
+  dataframe::DataframeSnapshotWriter writer;
+  for (const auto& table : GetSnapshotTables()) {
+    writer.AddDataframe(table.name, *table.dataframe);
+  }
+  dataframe::Dataframe stats = CreateSnapshotStats(storage);
+  writer.AddDataframe(kSnapshotStatsName, stats);
+  auto bounds = dataframe::Dataframe::CreateFromTypedSpec(
+      kSnapshotTraceBoundsSpec, storage->mutable_string_pool());
+  bounds.InsertUnchecked(kSnapshotTraceBoundsSpec, cached_trace_bounds_.first,
+                         cached_trace_bounds_.second);
+  bounds.Finalize();
+  writer.AddDataframe(kSnapshotTraceBoundsName, bounds);
+  std::vector<uint8_t> data = std::move(writer).Finish();
+
+  base::ScopedFile fd(base::OpenFile(path, O_CREAT | O_WRONLY | O_TRUNC, 0644));
+  if (!fd) {
+    return base::ErrStatus("SaveSnapshot: unable to open '%s'", path.c_str());
+  }
+  if (base::WriteAll(*fd, data.data(), data.size()) !=
+      static_cast<ssize_t>(data.size())) {
+    return base::ErrStatus("SaveSnapshot: failed to write '%s'", path.c_str());
+  }
+  return base::OkStatus();
+}
+
+base::Status TraceProcessorImpl::LoadSnapshot(const std::string& path) {
+  if (notify_eof_called_ || bytes_parsed_ != 0) {
+    return base::ErrStatus(
+        "LoadSnapshot: must be called on a new instance instead of parsing a "
+        "trace");
+  }
+  PERFETTO_TP_TRACE(metatrace::Category::API_TIMELINE, "LOAD_SNAPSHOT");
+
+  // Prefer mapping the file: columns are then copied straight out of the page
+  // cache.
+  base::ScopedMmap mapped = base::ReadMmapWholeFile(path);
+  std::string buffer;
+  const uint8_t* data;
+  size_t size;
+  if (mapped.IsValid()) {
+    data = static_cast<const uint8_t*>(mapped.data());
+    size = mapped.length();
+  } else {
+    if (!base::ReadFile(path, &buffer)) {
+      return base::ErrStatus("LoadSnapshot: unable to read '%s'",
+                             path.c_str());
+    }
+    data = reinterpret_cast<const uint8_t*>(buffer.data());
+    size = buffer.size();
+  }
+  ASSIGN_OR_RETURN(auto reader,
+                   dataframe::DataframeSnapshotReader::Create(data, size));
+
+  // Load and validate everything before replacing any table so that a bad
+  // snapshot leaves this instance untouched.
+  TraceStorage* storage = context()->storage.get();
+  StringPool* pool = storage->mutable_string_pool();
+  std::vector<PerfettoSqlEngine::StaticTable> tables = GetSnapshotTables();
+  std::vector<dataframe::Dataframe> loaded;
+  loaded.reserve(tables.size());
+  for (const auto& table : tables) {
+    ASSIGN_OR_RETURN(auto df, reader.Load(table.name, pool));
+    RETURN_IF_ERROR(CheckSnapshotSpecMatches(
+        table.name, table.dataframe->CreateSpec(), df.CreateSpec()));
+    loaded.emplace_back(std::move(df));
+  }
+  ASSIGN_OR_RETURN(auto stats, reader.Load(kSnapshotStatsName, pool));
+  RETURN_IF_ERROR(CheckSnapshotSpecMatches(
+      kSnapshotStatsName,
+      dataframe::Dataframe::CreateFromTypedSpec(kSnapshotStatsSpec, pool)
+          .CreateSpec(),
+      stats.CreateSpec()));
+  ASSIGN_OR_RETURN(auto bounds, reader.Load(kSnapshotTraceBoundsName, pool));
+  RETURN_IF_ERROR(CheckSnapshotSpecMatches(
+      kSnapshotTraceBoundsName,
+      dataframe::Dataframe::CreateFromTypedSpec(kSnapshotTraceBoundsSpec, pool)
+          .CreateSpec(),
+      bounds.CreateSpec()));
+  if (bounds.row_count() != 1) {
+    return base::ErrStatus("LoadSnapshot: invalid trace bounds");
+  }
+
+  for (size_t i = 0; i < tables.size(); ++i) {
+    *tables[i].dataframe = std::move(loaded[i]);
+  }
+  RestoreSnapshotStats(stats, storage);
+
+  // A snapshot is the state of trace processor after NotifyEndOfFile so
+  // mirror what that function would have done.
+  eof_ = true;
+  notify_eof_called_ = true;
+  if (current_trace_name_.empty()) {
+    current_trace_name_ = "Unnamed trace";
+  }
+  bytes_parsed_ = size;
+  TraceProcessorStorageImpl::DestroyContext();
+  cached_trace_bounds_ = {
+      bounds.GetCellUnchecked<0>(kSnapshotTraceBoundsSpec, 0),
+      bounds.GetCellUnchecked<1>(kSnapshotTraceBoundsSpec, 0),
+  };
+  bounds_tables_mutations_ = GetBoundsMutationCount(*storage);
+
+  // Tables were swapped under the engine: recreate it so that nothing refers
+  // to the old dataframes.
+  engine_ = InitPerfettoSqlEngine({
+      context(),
+      storage,
+      config_,
+      registered_sql_packages_,
+      sql_metrics_,
+      &metrics_descriptor_pool_,
+      &proto_fn_name_to_path_,
+      this,
+      notify_eof_called_,
+      cached_trace_bounds_,
+      plugins_,
+      &module_cache_,
+  });
+  sqlite_objects_post_prelude_ = engine_->SqliteRegisteredObjectCount();
+  return base::OkStatus();
+}
+
+std::vector<PerfettoSqlEngine::StaticTable>
+TraceProcessorImpl::GetSnapshotTables() {
+  std::vector<PerfettoSqlEngine::StaticTable> tables =
+      GetStaticTables(context()->storage.get());
+  std::vector<PluginDataframe> plugin_tables;
+  for (auto& p : plugins_) {
+    p->RegisterDataframes(plugin_tables);
+  }
+  for (auto& df : plugin_tables) {
+    tables.push_back({df.dataframe, std::move(df.name)});
+  }
+  return tables;
+}
+
 // =================================================================
 // |  Trace-based metrics (v1) related functionality starts here   |
 // =================================================================
@@ -1293,6 +1630,8 @@ std::unique_ptr<PerfettoSqlEngine> TraceProcessorImpl::InitPerfettoSqlEngine(
 
   auto engine = std::make_unique<PerfettoSqlEngine>(
       storage->mutable_string_pool(), config.enable_extra_checks);
+  engine->SetQueryThreadPool(context->query_thread_pool.get());
+  engine->SetModuleCache(args.module_cache);
 
   auto functions =
       CreateStaticTableFunctions(context, storage, config, engine.get());
@@ -1438,6 +1777,18 @@ std::unique_ptr<PerfettoSqlEngine> TraceProcessorImpl::InitPerfettoSqlEngine(
     base::Status status = perfetto_sql::RegisterIntervalCreateFunctions(
         *engine, storage->mutable_string_pool());
   }
+  {
+    base::Status status = perfetto_sql::RegisterGroupByFunctions(
+        *engine, storage->mutable_string_pool());
+    if (!status.ok())
+      PERFETTO_FATAL("%s", status.c_message());
+  }
+  {
+    base::Status status = perfetto_sql::RegisterHashJoinFunctions(
+        *engine, storage->mutable_string_pool());
+    if (!status.ok())
+      PERFETTO_FATAL("%s", status.c_message());
+  }
   {
     base::Status status =
         RegisterTreeFunctions(*engine, *storage->mutable_string_pool());
@@ -1497,6 +1848,8 @@ std::unique_ptr<PerfettoSqlEngine> TraceProcessorImpl::InitPerfettoSqlEngine(
 
   // Legacy tables.
   engine->RegisterVirtualTableModule<SqlStatsModule>("sqlstats", storage);
+  engine->RegisterVirtualTableModule<ModuleCacheStatsModule>(
+      "module_cache_stats", args.module_cache);
   engine->RegisterVirtualTableModule<StatsModule>("stats", storage);
   engine->RegisterVirtualTableModule<TablePointerModule>(
       "__intrinsic_table_ptr", nullptr);
@@ -37,6 +37,7 @@
 #include "src/trace_processor/core/plugin/plugin.h"
 #include "src/trace_processor/iterator_impl.h"
 #include "src/trace_processor/metrics/metrics.h"
+#include "src/trace_processor/perfetto_sql/engine/module_cache.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/create_function.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/create_view_function.h"
@@ -111,6 +112,9 @@ class TraceProcessorImpl : public TraceProcessor,
 
   size_t RestoreInitialTables() override;
 
+  base::Status SaveSnapshot(const std::string& path) override;
+  base::Status LoadSnapshot(const std::string& path) override;
+
   // =================================================================
   // |  Trace-based metrics (v1) related functionality starts here   |
   // =================================================================
@@ -158,6 +162,7 @@ class TraceProcessorImpl : public TraceProcessor,
     bool notify_eof_called;
     std::pair<int64_t, int64_t> cached_trace_bounds;
     std::vector<std::unique_ptr<PluginBase>>& plugins;
+    ModuleCache* module_cache;
   };
 
   static std::unique_ptr<PerfettoSqlEngine> InitPerfettoSqlEngine(
@@ -174,11 +179,22 @@ class TraceProcessorImpl : public TraceProcessor,
 
   static void IncludeAfterEofPrelude(PerfettoSqlEngine*);
 
+  // Hashes the inputs of the tables cached by |module_cache_| besides the
+  // trace and passes it to the cache.
+  void UpdateModuleCacheSourcesHash();
+
+  // Returns all the tables which are saved in and restored from snapshots:
+  // the static tables and the tables owned by plugins.
+  std::vector<PerfettoSqlEngine::StaticTable> GetSnapshotTables();
+
   const Config config_;
 
   // Registered plugins, topologically sorted by dependency order.
   std::vector<std::unique_ptr<PluginBase>> plugins_;
 
+  // Must outlive |engine_|, which refers to it.
+  ModuleCache module_cache_;
+
   std::unique_ptr<PerfettoSqlEngine> engine_;
 
   DescriptorPool metrics_descriptor_pool_;
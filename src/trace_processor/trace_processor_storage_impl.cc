@@ -65,6 +65,9 @@ TraceProcessorStorageImpl::TraceProcessorStorageImpl(const Config& cfg)
         reinterpret_cast<const uint8_t*>(raw_bytes.data()), raw_bytes.size(),
         {}, true);
   }
+  if (!cfg.module_cache_dir.empty()) {
+    trace_content_hash_.emplace();
+  }
 }
 
 TraceProcessorStorageImpl::~TraceProcessorStorageImpl() {}
@@ -101,6 +104,11 @@ base::Status TraceProcessorStorageImpl::Parse(TraceBlobView blob) {
         Variadic::String(id_for_uuid));
   }
 
+  if (trace_content_hash_) {
+    trace_content_hash_->Update(reinterpret_cast<const char*>(blob.data()),
+                                blob.size());
+  }
+
   base::Status status = parser_->Parse(std::move(blob));
   if (!status.ok()) {
     unrecoverable_parse_error_ = true;
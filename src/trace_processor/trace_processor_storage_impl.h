@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/fnv_hash.h"
@@ -53,6 +54,9 @@ class TraceProcessorStorageImpl : public TraceProcessorStorage {
   bool unrecoverable_parse_error_ = false;
   bool eof_ = false;
   size_t hash_input_size_remaining_ = 4096;
+  // Hash of the full contents of the trace. Only computed when the module
+  // cache is enabled as it identifies the trace in the cache.
+  std::optional<base::FnvHasher> trace_content_hash_;
   std::unique_ptr<ForwardingTraceParser> parser_;
 };
 
@@ -30,6 +30,10 @@
 #include "src/trace_processor/types/destructible.h"
 #include "src/trace_processor/types/trace_processor_context_ptr.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
 class ArgsTranslationTable;
@@ -158,6 +162,12 @@ class TraceProcessorContext {
   GlobalPtr<Destructible> deobfuscation_tracker;  // DeobfuscationTracker
   GlobalPtr<BlobPacketWriter> blob_packet_writer;
 
+  // Only set when Config::ingestion_thread_count > 0.
+  GlobalPtr<base::ThreadPool> ingestion_thread_pool;
+
+  // Only set when Config::query_thread_count > 0.
+  GlobalPtr<base::ThreadPool> query_thread_pool;
+
   // The registration function for additional proto modules.
   // This is populated by TraceProcessorImpl to allow for late registration of
   // modules.
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/zstd_utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace perfetto::trace_processor::util {
+
+bool IsZstdFrame(const uint8_t* data, size_t size) {
+  // ZSTD_MAGICNUMBER (0xFD2FB528), little endian.
+  static constexpr uint8_t kMagic[] = {0x28, 0xB5, 0x2F, 0xFD};
+  if (size < sizeof(kMagic))
+    return false;
+  for (size_t i = 0; i < sizeof(kMagic); ++i) {
+    if (data[i] != kMagic[i])
+      return false;
+  }
+  return true;
+}
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+
+bool ZstdDecompressFully(const uint8_t* data,
+                         size_t size,
+                         std::vector<uint8_t>* out) {
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  if (!dctx)
+    return false;
+
+  // The compressor writes a single frame without a content size, so start from
+  // a guess and grow as needed.
+  size_t out_pos = out->size();
+  out->resize(out_pos + std::max<size_t>(size * 4, ZSTD_DStreamOutSize()));
+
+  ZSTD_inBuffer in{data, size, 0};
+  size_t ret = 0;
+  bool ok = true;
+  while (in.pos < in.size) {
+    if (out_pos == out->size())
+      out->resize(out->size() * 2);
+    ZSTD_outBuffer out_buf{out->data() + out_pos, out->size() - out_pos, 0};
+    ret = ZSTD_decompressStream(dctx, &out_buf, &in);
+    out_pos += out_buf.pos;
+    if (ZSTD_isError(ret)) {
+      ok = false;
+      break;
+    }
+  }
+  // Flush whatever is buffered inside the decoder for the last frame.
+  while (ok && ret != 0) {
+    if (out_pos == out->size())
+      out->resize(out->size() * 2);
+    ZSTD_outBuffer out_buf{out->data() + out_pos, out->size() - out_pos, 0};
+    ret = ZSTD_decompressStream(dctx, &out_buf, &in);
+    if (ZSTD_isError(ret) || (out_buf.pos == 0 && ret != 0)) {
+      // No progress with no more input: the frame is truncated.
+      ok = false;
+      break;
+    }
+    out_pos += out_buf.pos;
+  }
+  out->resize(out_pos);
+  ZSTD_freeDCtx(dctx);
+  return ok;
+}
+
+#else  // PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+
+bool ZstdDecompressFully(const uint8_t*, size_t, std::vector<uint8_t>*) {
+  return false;
+}
+
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+
+}  // namespace perfetto::trace_processor::util
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_UTIL_ZSTD_UTILS_H_
+#define SRC_TRACE_PROCESSOR_UTIL_ZSTD_UTILS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+
+namespace perfetto::trace_processor::util {
+
+// Returns whether zstd related functionality is supported with the current
+// build flags.
+constexpr bool IsZstdSupported() {
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Returns true if |data| starts with the Zstd frame magic number. Does not
+// depend on zstd being supported, so callers can emit a meaningful error.
+bool IsZstdFrame(const uint8_t* data, size_t size);
+
+// Decompresses all the Zstd frames in |data| and appends the output to |out|.
+// Returns false if the input is corrupted or truncated, or if zstd is not
+// supported; |out| is left with any partial output in that case.
+bool ZstdDecompressFully(const uint8_t* data,
+                         size_t size,
+                         std::vector<uint8_t>* out);
+
+}  // namespace perfetto::trace_processor::util
+
+#endif  // SRC_TRACE_PROCESSOR_UTIL_ZSTD_UTILS_H_
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/zstd_utils.h"
+
+#include <zstd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::util {
+namespace {
+
+std::vector<uint8_t> Compress(const std::string& input) {
+  std::vector<uint8_t> out(ZSTD_compressBound(input.size()));
+  size_t size = ZSTD_compress(out.data(), out.size(), input.data(),
+                              input.size(), /*compressionLevel=*/3);
+  PERFETTO_CHECK(!ZSTD_isError(size));
+  out.resize(size);
+  return out;
+}
+
+std::string ToString(const std::vector<uint8_t>& data) {
+  return std::string(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+TEST(ZstdUtilsTest, IsZstdFrame) {
+  std::vector<uint8_t> compressed = Compress("abc");
+  EXPECT_TRUE(IsZstdFrame(compressed.data(), compressed.size()));
+  EXPECT_FALSE(IsZstdFrame(compressed.data(), 3));
+
+  const uint8_t kGzipMagic[] = {0x1f, 0x8b, 0x08, 0x00};
+  EXPECT_FALSE(IsZstdFrame(kGzipMagic, sizeof(kGzipMagic)));
+}
+
+TEST(ZstdUtilsTest, DecompressFully) {
+  std::string input;
+  for (int i = 0; i < 10000; i++)
+    input += "perfetto-" + std::to_string(i % 13) + ";";
+  std::vector<uint8_t> compressed = Compress(input);
+
+  std::vector<uint8_t> out;
+  ASSERT_TRUE(ZstdDecompressFully(compressed.data(), compressed.size(), &out));
+  EXPECT_EQ(ToString(out), input);
+}
+
+TEST(ZstdUtilsTest, DecompressConcatenatedFrames) {
+  std::vector<uint8_t> compressed = Compress("hello ");
+  std::vector<uint8_t> second = Compress("world");
+  compressed.insert(compressed.end(), second.begin(), second.end());
+
+  std::vector<uint8_t> out;
+  ASSERT_TRUE(ZstdDecompressFully(compressed.data(), compressed.size(), &out));
+  EXPECT_EQ(ToString(out), "hello world");
+}
+
+TEST(ZstdUtilsTest, Truncated) {
+  std::string input(100000, 'x');
+  for (size_t i = 0; i < input.size(); i += 7)
+    input[i] = static_cast<char>('a' + i % 26);
+  std::vector<uint8_t> compressed = Compress(input);
+
+  std::vector<uint8_t> out;
+  EXPECT_FALSE(
+      ZstdDecompressFully(compressed.data(), compressed.size() - 4, &out));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::util
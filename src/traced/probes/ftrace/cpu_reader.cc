@@ -172,12 +172,13 @@ bool SetBlocking(int fd, bool is_blocking) {
 }
 
 void SetParseError(const std::set<FtraceDataSource*>& started_data_sources,
+                   size_t reader_shard,
                    size_t cpu,
                    FtraceParseStatus status) {
   PERFETTO_DPLOG("[cpu%zu]: unexpected ftrace read error: %s", cpu,
                  protos::pbzero::FtraceParseStatus_Name(status));
   for (FtraceDataSource* data_source : started_data_sources) {
-    data_source->mutable_parse_errors()->insert(status);
+    data_source->mutable_parse_errors(reader_shard)->insert(status);
   }
 }
 
@@ -231,7 +232,8 @@ size_t CpuReader::ReadCycle(
     ParsingBuffers* parsing_bufs,
     size_t max_pages,
     const std::set<FtraceDataSource*>& started_data_sources,
-    const std::optional<FtraceClockSnapshot>& clock_snapshot) {
+    const std::optional<FtraceClockSnapshot>& clock_snapshot,
+    size_t reader_shard) {
   PERFETTO_DCHECK(max_pages > 0 && parsing_bufs->ftrace_data_buf_pages() > 0);
   metatrace::ScopedEvent evt(metatrace::TAG_FTRACE,
                              metatrace::FTRACE_CPU_READ_CYCLE);
@@ -244,7 +246,7 @@ size_t CpuReader::ReadCycle(
     size_t pages_read =
         ReadAndProcessBatch(parsing_bufs->ftrace_data_buf(), batch_pages,
                             is_first_batch, parsing_bufs->compact_sched_buf(),
-                            started_data_sources, clock_snapshot);
+                            started_data_sources, clock_snapshot, reader_shard);
 
     PERFETTO_DCHECK(pages_read <= batch_pages);
     total_pages_read += pages_read;
@@ -272,7 +274,8 @@ size_t CpuReader::ReadAndProcessBatch(
     bool first_batch_in_cycle,
     CompactSchedBuffer* compact_sched_buf,
     const std::set<FtraceDataSource*>& started_data_sources,
-    const std::optional<FtraceClockSnapshot>& clock_snapshot) {
+    const std::optional<FtraceClockSnapshot>& clock_snapshot,
+    size_t reader_shard) {
   const uint32_t sys_page_size = base::GetSysPageSize();
   size_t pages_read = 0;
   {
@@ -288,7 +291,7 @@ size_t CpuReader::ReadAndProcessBatch(
         // ENODEV: the cpu is offline (b/145583318).
         if (errno != EAGAIN && errno != ENOMEM && errno != EBUSY &&
             errno != ENODEV) {
-          SetParseError(started_data_sources, cpu_,
+          SetParseError(started_data_sources, reader_shard, cpu_,
                         FtraceParseStatus::FTRACE_STATUS_UNEXPECTED_READ_ERROR);
         }
         break;  // stop reading regardless of errno
@@ -307,7 +310,7 @@ size_t CpuReader::ReadAndProcessBatch(
         break;
       }
       if (res != static_cast<ssize_t>(sys_page_size)) {
-        SetParseError(started_data_sources, cpu_,
+        SetParseError(started_data_sources, reader_shard, cpu_,
                       FtraceParseStatus::FTRACE_STATUS_PARTIAL_PAGE_READ);
         break;
       }
@@ -356,8 +359,10 @@ size_t CpuReader::ReadAndProcessBatch(
 
   for (FtraceDataSource* data_source : started_data_sources) {
     ProcessPagesForDataSource(
-        data_source->trace_writer(), data_source->mutable_metadata(), cpu_,
-        data_source->parsing_config(), data_source->mutable_parse_errors(),
+        data_source->trace_writer(reader_shard),
+        data_source->mutable_metadata(reader_shard), cpu_,
+        data_source->parsing_config(),
+        data_source->mutable_parse_errors(reader_shard),
         data_source->mutable_bundle_end_timestamp(cpu_), parsing_buf,
         pages_read, compact_sched_buf, table_, symbolizer_, clock_snapshot);
   }
@@ -420,8 +425,9 @@ void CpuReader::Bundler::FinalizeAndRunSymbolizer() {
   bundle_->Finalize();
   bundle_ = nullptr;
   // Write the kernel symbol index (mangled address) -> name table.
-  // |metadata| is shared across all cpus, is distinct per |data_source| (i.e.
-  // tracing session) and is cleared after each FtraceController::ReadTick().
+  // |metadata| is shared across all cpus of a reader shard, is distinct per
+  // |data_source| (i.e. tracing session) and is cleared after each
+  // FtraceController::ReadTick().
   if (symbolizer_) {
     // Symbol indexes are assigned mononically as |kernel_addrs.size()|,
     // starting from index 1 (no symbol has index 0). Here we remember the
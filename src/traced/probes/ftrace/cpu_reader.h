@@ -212,10 +212,14 @@ class CpuReader {
 
   // Reads and parses all ftrace data for this cpu (in batches), until we catch
   // up to the writer, or hit |max_pages|. Returns number of pages read.
+  // |reader_shard| selects the writer, metadata and parse errors used for each
+  // data source (see FtraceDataSource::AddReaderShard). Can be called from a
+  // reader thread, as long as no two threads use the same shard at once.
   size_t ReadCycle(ParsingBuffers* parsing_bufs,
                    size_t max_pages,
                    const std::set<FtraceDataSource*>& started_data_sources,
-                   const std::optional<FtraceClockSnapshot>& clock_snapshot);
+                   const std::optional<FtraceClockSnapshot>& clock_snapshot,
+                   size_t reader_shard = 0);
 
   // Niche version of ReadCycle for FrozenFtraceDataSource, assumes a stopped
   // tracefs instance. Don't add new callers.
@@ -437,7 +441,8 @@ class CpuReader {
       bool first_batch_in_cycle,
       CompactSchedBuffer* compact_sched_buf,
       const std::set<FtraceDataSource*>& started_data_sources,
-      const std::optional<FtraceClockSnapshot>& clock_snapshot);
+      const std::optional<FtraceClockSnapshot>& clock_snapshot,
+      size_t reader_shard);
 
   size_t cpu_;
   const ProtoTranslationTable* table_;
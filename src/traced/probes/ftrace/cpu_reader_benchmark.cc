@@ -14,10 +14,14 @@
 
 #include <benchmark/benchmark.h>
 
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include "perfetto/base/flat_set.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/utils.h"
+#include "perfetto/ext/base/waitable_event.h"
 #include "perfetto/protozero/root_message.h"
 #include "perfetto/protozero/scattered_stream_null_delegate.h"
 #include "perfetto/protozero/scattered_stream_writer.h"
@@ -998,5 +1002,77 @@ void BM_ProcessPagesFullOfPrint(benchmark::State& state) {
 }
 BENCHMARK(BM_ProcessPagesFullOfPrint)->Range(1, 64);
 
+// Models FtraceConfig.reader_threads: the pages of |kNumCpus| simulated
+// per-cpu buffers are parsed by state.range(0) threads, each one with its own
+// writer and metadata, sharding cpus as FtraceController::ReadAllCpus does.
+// Compare the pages/s counter across thread counts to see the scaling.
+void BM_ProcessPagesReaderThreads(benchmark::State& state) {
+  constexpr size_t kNumCpus = 8;
+  constexpr size_t kPagesPerCpu = 32;
+  const size_t num_threads = static_cast<size_t>(state.range(0));
+
+  ProtoTranslationTable* table = GetTable(g_full_page_sched_switch.name);
+  auto repeated_pages =
+      std::make_unique<uint8_t[]>(base::GetSysPageSize() * kPagesPerCpu);
+  {
+    auto page = PageFromXxd(g_full_page_sched_switch.data);
+    for (size_t i = 0; i < kPagesPerCpu; i++) {
+      memcpy(&repeated_pages[i * base::GetSysPageSize()], &page[0],
+             base::GetSysPageSize());
+    }
+  }
+
+  FtraceDataSourceConfig ds_config =
+      ConfigForTesting(DisabledCompactSchedConfigForTesting());
+  ds_config.event_filter.AddEnabledEvent(
+      table->EventToFtraceId(GroupAndName("sched", "sched_switch")));
+
+  struct Shard {
+    NullTraceWriter writer;
+    FtraceMetadata metadata;
+    CompactSchedBuffer compact_sched_buf;
+    base::FlatSet<protos::pbzero::FtraceParseStatus> parse_errors;
+    uint64_t bundle_end_ts[kNumCpus]{};
+  };
+  std::vector<std::unique_ptr<Shard>> shards;
+  for (size_t i = 0; i < num_threads; i++)
+    shards.emplace_back(new Shard());
+
+  auto process_shard = [&](size_t shard_idx) {
+    Shard* shard = shards[shard_idx].get();
+    for (size_t cpu = shard_idx; cpu < kNumCpus; cpu += num_threads) {
+      CpuReader::ProcessPagesForDataSource(
+          &shard->writer, &shard->metadata, cpu, &ds_config,
+          &shard->parse_errors, &shard->bundle_end_ts[cpu],
+          repeated_pages.get(), kPagesPerCpu, &shard->compact_sched_buf, table,
+          /*symbolizer=*/nullptr, /*clock_snapshot=*/std::nullopt);
+    }
+    shard->metadata.Clear();
+  };
+
+  // As in the controller, shard 0 runs on the calling thread.
+  base::ThreadPool pool(static_cast<uint32_t>(num_threads - 1));
+  while (state.KeepRunning()) {
+    base::WaitableEvent shards_done;
+    for (size_t i = 1; i < num_threads; i++) {
+      pool.PostTask([&process_shard, &shards_done, i] {
+        process_shard(i);
+        shards_done.Notify();
+      });
+    }
+    process_shard(0);
+    shards_done.Wait(num_threads - 1);
+  }
+  state.counters["pages/s"] =
+      benchmark::Counter(static_cast<double>(kNumCpus * kPagesPerCpu),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_ProcessPagesReaderThreads)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace perfetto
@@ -26,8 +26,13 @@
 #include <unistd.h>
 #include <cstdint>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <tuple>
@@ -41,6 +46,7 @@
 #include "perfetto/ext/base/scoped_file.h"
 #include "perfetto/ext/base/string_splitter.h"
 #include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/tracing/core/trace_writer.h"
 #include "src/kallsyms/kernel_symbol_map.h"
 #include "src/kallsyms/lazy_kernel_symbolizer.h"
@@ -300,6 +306,10 @@ void FtraceController::StartIfNeeded(FtraceInstanceState* instance,
 // want to yield to the event loop, re-enqueueing a continuation task at the end
 // of the immediate queue (letting other enqueued tasks to run before
 // continuing). Therefore we introduce |kMaxPagesPerCpuPerReadTick|.
+//
+// If the data sources ask for FtraceConfig.reader_threads, the cpus are split
+// across that many reader threads for the duration of a pass (see
+// ReadAllCpus), but the pass as a whole still runs within a single task.
 void FtraceController::ReadTick(int generation) {
   metatrace::ScopedEvent evt(metatrace::TAG_FTRACE,
                              metatrace::FTRACE_READ_TICK);
@@ -349,23 +359,101 @@ bool FtraceController::ReadPassForInstance(FtraceInstanceState* instance) {
   if (instance->started_data_sources.empty())
     return true;
 
+  return ReadAllCpus(instance, kMaxPagesPerCpuPerReadTick);
+}
+
+// Returns true if no cpu hit the |max_pages| limit.
+bool FtraceController::ReadAllCpus(FtraceInstanceState* instance,
+                                   size_t max_pages) {
   std::optional<CpuReader::FtraceClockSnapshot> clock_snapshot =
       SnapshotFtraceClockIfNotBoot(instance);
 
-  bool all_cpus_done = true;
-  for (size_t i = 0; i < instance->cpu_readers.size(); i++) {
-    size_t max_pages = kMaxPagesPerCpuPerReadTick;
-    size_t pages_read = instance->cpu_readers[i].ReadCycle(
-        &parsing_mem_, max_pages, instance->started_data_sources,
-        clock_snapshot);
-    PERFETTO_DCHECK(pages_read <= max_pages);
-    if (pages_read == max_pages) {
-      all_cpus_done = false;
+  // Cpus are assigned round-robin to the reader shards. Shard 0 is always
+  // read on the main thread.
+  const size_t num_cpus = instance->cpu_readers.size();
+  const size_t num_shards = GetReaderShardCount(instance);
+  std::atomic<bool> all_cpus_done{true};
+  auto read_shard = [&](size_t shard, CpuReader::ParsingBuffers* parsing_mem) {
+    for (size_t cpu = shard; cpu < num_cpus; cpu += num_shards) {
+      size_t pages_read = instance->cpu_readers[cpu].ReadCycle(
+          parsing_mem, max_pages, instance->started_data_sources,
+          clock_snapshot, shard);
+      PERFETTO_DCHECK(pages_read <= max_pages);
+      if (pages_read == max_pages) {
+        all_cpus_done = false;
+      }
     }
+  };
+
+  if (num_shards <= 1) {
+    read_shard(0, &parsing_mem_);
+    return all_cpus_done;
+  }
+
+  // Anything that the CpuReader-s would otherwise create lazily must be set up
+  // here, before the reader threads start.
+  bool symbolize_ksyms = false;
+  for (FtraceDataSource* ds : instance->started_data_sources) {
+    ds->mutable_bundle_end_timestamp(num_cpus - 1);
+    symbolize_ksyms |= ds->parsing_config()->symbolize_ksyms;
   }
+  if (symbolize_ksyms)
+    symbolizer_.GetOrCreateKernelSymbolMap();
+
+  if (reader_pool_size_ < num_shards - 1) {
+    reader_pool_.reset();
+    reader_pool_size_ = num_shards - 1;
+    reader_pool_ = std::make_unique<base::ThreadPool>(
+        static_cast<uint32_t>(reader_pool_size_));
+  }
+  if (reader_parsing_mem_.size() < num_shards - 1)
+    reader_parsing_mem_.resize(num_shards - 1);
+
+  // The main thread blocks until all the shards are read, so nothing else in
+  // the controller or in the data sources can observe a pass in progress.
+  std::mutex mutex;
+  std::condition_variable shard_read;
+  size_t shards_pending = num_shards - 1;
+  for (size_t shard = 1; shard < num_shards; shard++) {
+    CpuReader::ParsingBuffers* parsing_mem = &reader_parsing_mem_[shard - 1];
+    parsing_mem->AllocateIfNeeded();
+    reader_pool_->PostTask([&, shard, parsing_mem] {
+      read_shard(shard, parsing_mem);
+      // Notify while holding the lock: the main thread destroys
+      // |shard_read| as soon as it observes the last shard.
+      std::lock_guard<std::mutex> lock(mutex);
+      shards_pending--;
+      shard_read.notify_one();
+    });
+  }
+  read_shard(0, &parsing_mem_);
+
+  // The reader threads stall once the shared memory buffer is full, until the
+  // service is told about the chunks they completed. Those commits are sent
+  // from this thread, so keep sending them while waiting.
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!shard_read.wait_for(
+      lock, std::chrono::milliseconds(kReaderThreadsCommitIntervalMs),
+      [&shards_pending] { return shards_pending == 0; })) {
+    lock.unlock();
+    observer_->OnWaitingForFtraceReaderThreads();
+    lock.lock();
+  }
+  lock.unlock();
+
+  for (FtraceDataSource* ds : instance->started_data_sources)
+    ds->MergeReaderShards();
   return all_cpus_done;
 }
 
+size_t FtraceController::GetReaderShardCount(FtraceInstanceState* instance) {
+  // Every started data source needs one writer per shard.
+  size_t num_shards = instance->cpu_readers.size();
+  for (FtraceDataSource* ds : instance->started_data_sources)
+    num_shards = std::min(num_shards, ds->num_reader_shards());
+  return std::max(num_shards, size_t{1});
+}
+
 uint32_t FtraceController::GetTickPeriodMs() {
   if (data_sources_.empty())
     return kDefaultTickPeriodMs;
@@ -517,18 +605,11 @@ void FtraceController::FlushForInstance(FtraceInstanceState* instance) {
   if (instance->started_data_sources.empty())
     return;
 
-  std::optional<CpuReader::FtraceClockSnapshot> clock_snapshot =
-      SnapshotFtraceClockIfNotBoot(instance);
-
   // Read all cpus in one go, limiting the per-cpu read amount to make sure we
   // don't get stuck chasing the writer if there's a very high bandwidth of
   // events.
   size_t max_pages = instance->ftrace_config_muxer->GetPerCpuBufferSizePages();
-  for (size_t i = 0; i < instance->cpu_readers.size(); i++) {
-    instance->cpu_readers[i].ReadCycle(&parsing_mem_, max_pages,
-                                       instance->started_data_sources,
-                                       clock_snapshot);
-  }
+  ReadAllCpus(instance, max_pages);
 }
 
 // We are not implicitly flushing on Stop. The tracing service is supposed to
@@ -564,6 +645,9 @@ void FtraceController::StopIfNeeded(FtraceInstanceState* instance) {
 
   // Note: might have never been allocated if data sources were rejected.
   parsing_mem_.Release();
+  reader_pool_.reset();
+  reader_pool_size_ = 0;
+  reader_parsing_mem_.clear();
 }
 
 bool FtraceController::AddDataSource(FtraceDataSource* data_source) {
@@ -24,6 +24,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "perfetto/base/task_runner.h"
 #include "perfetto/ext/base/weak_ptr.h"
@@ -35,6 +36,10 @@
 
 namespace perfetto {
 
+namespace base {
+class ThreadPool;
+}  // namespace base
+
 class FtraceConfigMuxer;
 class FtraceDataSource;
 class Tracefs;
@@ -61,8 +66,19 @@ class FtraceController {
    public:
     virtual ~Observer();
     virtual void OnFtraceDataWrittenIntoDataSourceBuffers() = 0;
+    // Called periodically while the main thread waits for the reader threads
+    // (see FtraceConfig.reader_threads). Must send the pending commits of the
+    // shared memory buffer to the service, as the reader threads cannot make
+    // progress when the buffer is full otherwise.
+    virtual void OnWaitingForFtraceReaderThreads() = 0;
   };
 
+  // Upper bound for FtraceConfig.reader_threads.
+  static constexpr uint32_t kMaxReaderThreads = 32;
+
+  // How often OnWaitingForFtraceReaderThreads() is called.
+  static constexpr uint32_t kReaderThreadsCommitIntervalMs = 10;
+
   // The passed Observer must outlive the returned FtraceController instance.
   static std::unique_ptr<FtraceController> Create(base::TaskRunner*, Observer*);
   virtual ~FtraceController();
@@ -135,6 +151,8 @@ class FtraceController {
   // instances.
   void ReadTick(int generation);
   bool ReadPassForInstance(FtraceInstanceState* instance);
+  bool ReadAllCpus(FtraceInstanceState* instance, size_t max_pages);
+  size_t GetReaderShardCount(FtraceInstanceState* instance);
   uint32_t GetTickPeriodMs();
   // Optional: additional reads based on buffer capacity. Per tracefs instance.
   void UpdateBufferWatermarkWatches(FtraceInstanceState* instance,
@@ -164,6 +182,11 @@ class FtraceController {
   base::TaskRunner* const task_runner_;
   Observer* const observer_;
   CpuReader::ParsingBuffers parsing_mem_;
+  // Only used when FtraceConfig.reader_threads > 1. Reader thread N uses
+  // |reader_parsing_mem_[N - 1]|, while the main thread uses |parsing_mem_|.
+  std::unique_ptr<base::ThreadPool> reader_pool_;
+  size_t reader_pool_size_ = 0;
+  std::vector<CpuReader::ParsingBuffers> reader_parsing_mem_;
   LazyKernelSymbolizer symbolizer_;
   FtraceConfigId next_cfg_id_ = 1;
   int tick_generation_ = 0;
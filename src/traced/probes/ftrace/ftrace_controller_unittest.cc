@@ -20,9 +20,15 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <cstring>
+#include <functional>
 #include <memory>
 
 #include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/tracing/core/commit_data_request.h"
+#include "perfetto/ext/tracing/core/shared_memory_abi.h"
+#include "src/base/test/test_task_runner.h"
+#include "src/base/test/tmp_dir_tree.h"
 #include "src/traced/probes/ftrace/compact_sched.h"
 #include "src/traced/probes/ftrace/cpu_reader.h"
 #include "src/traced/probes/ftrace/ftrace_config_muxer.h"
@@ -30,7 +36,11 @@
 #include "src/traced/probes/ftrace/ftrace_data_source.h"
 #include "src/traced/probes/ftrace/proto_translation_table.h"
 #include "src/traced/probes/ftrace/tracefs.h"
+#include "src/tracing/core/in_process_shared_memory.h"
+#include "src/tracing/core/patch_list.h"
+#include "src/tracing/core/shared_memory_arbiter_impl.h"
 #include "src/tracing/core/trace_writer_for_testing.h"
+#include "src/tracing/test/mock_producer_endpoint.h"
 #include "test/gtest_and_gmock.h"
 
 #include "protos/perfetto/trace/ftrace/ftrace_stats.gen.h"
@@ -191,9 +201,12 @@ class MockTracefs : public Tracefs {
   }
 
   base::ScopedFile OpenPipeForCpu(size_t /*cpu*/) override {
-    return base::ScopedFile(base::OpenFile("/dev/null", O_RDONLY));
+    return base::ScopedFile(base::OpenFile(cpu_pipe_path_, O_RDONLY));
   }
 
+  // Every cpu buffer reads the contents of |path| instead of being empty.
+  void set_cpu_pipe_path(const std::string& path) { cpu_pipe_path_ = path; }
+
   MOCK_METHOD(bool,
               WriteToFile,
               (const std::string& path, const std::string& str),
@@ -213,6 +226,7 @@ class MockTracefs : public Tracefs {
  private:
   bool tracing_on_ = true;
   std::string current_tracer_ = "nop";
+  std::string cpu_pipe_path_ = "/dev/null";
 };
 
 class MockAtraceWrapper : public AtraceWrapper {
@@ -256,6 +270,14 @@ class TestFtraceController : public FtraceController,
 
   uint64_t NowMs() const override { return 0; }
   void OnFtraceDataWrittenIntoDataSourceBuffers() override {}
+  void OnWaitingForFtraceReaderThreads() override {
+    if (on_waiting_for_reader_threads_)
+      on_waiting_for_reader_threads_();
+  }
+
+  void set_on_waiting_for_reader_threads(std::function<void()> fn) {
+    on_waiting_for_reader_threads_ = std::move(fn);
+  }
 
   bool InstanceExists(const std::string& instance_name) {
     auto* instance = GetInstance(instance_name);
@@ -291,6 +313,7 @@ class TestFtraceController : public FtraceController,
 
   std::unique_ptr<MockTaskRunner> runner_;
   MockTracefs* primary_tracefs_;
+  std::function<void()> on_waiting_for_reader_threads_;
   std::map<std::string, std::unique_ptr<MockTracefs>> pending_instance_tracefs_;
 };
 
@@ -581,6 +604,83 @@ TEST(FtraceControllerTest, PeriodicDrainConfig) {
   }
 }
 
+// The reader threads write into the shared memory buffer while the main thread
+// waits for them. When the buffer is full, they must not depend on the main
+// thread running tasks to make progress.
+TEST(FtraceControllerTest, ReaderThreadsWithFullSharedMemoryBuffer) {
+  const size_t page_size = base::GetSysPageSize();
+
+  // A page ending with a truncated time extend record: every cpu reader fails
+  // to parse it and writes a packet with the parse error.
+  std::string page(page_size, '\0');
+  const uint64_t timestamp = 1;
+  const uint64_t commit_size = 4;
+  const uint32_t time_extend_header = 30;
+  memcpy(&page[0], &timestamp, sizeof(timestamp));
+  memcpy(&page[8], &commit_size, sizeof(commit_size));
+  memcpy(&page[16], &time_extend_header, sizeof(time_extend_header));
+  base::TmpDirTree tmp;
+  tmp.AddFile("trace_pipe_raw", page);
+
+  auto controller = CreateTestController(true /* nice tracefs */, 2);
+  controller->tracefs()->set_cpu_pipe_path(tmp.AbsolutePath("trace_pipe_raw"));
+
+  // A shared memory buffer with a single chunk, completed but not committed
+  // to the service yet.
+  auto default_layout =
+      SharedMemoryArbiterImpl::default_page_layout_for_testing();
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv1);
+  auto shmem = InProcessSharedMemory::Create(page_size);
+  base::TestTaskRunner task_runner;
+  NiceMock<MockProducerEndpoint> endpoint;
+  SharedMemoryArbiterImpl arbiter(shmem->start(), shmem->size(),
+                                  SharedMemoryABI::ShmemMode::kDefault,
+                                  page_size, &endpoint, &task_runner);
+  PatchList patches;
+  arbiter.ReturnCompletedChunk(
+      arbiter.GetNewChunk({}, BufferExhaustedPolicy::kDrop),
+      /*target_buffer=*/1, &patches);
+
+  // Free the committed chunks, like the service does.
+  std::vector<uint32_t> committed_buffers;
+  SharedMemoryABI* abi = arbiter.shmem_abi_for_testing();
+  ON_CALL(endpoint, CommitData(_, _))
+      .WillByDefault([&](const CommitDataRequest& req,
+                         MockProducerEndpoint::CommitDataCallback) {
+        for (const auto& chunk : req.chunks_to_move()) {
+          committed_buffers.push_back(chunk.target_buffer());
+          auto read_chunk =
+              abi->TryAcquireChunkForReading(chunk.page(), chunk.chunk());
+          if (read_chunk.is_valid())
+            abi->ReleaseChunkAsFree(std::move(read_chunk));
+        }
+      });
+  controller->set_on_waiting_for_reader_threads(
+      [&arbiter] { arbiter.FlushPendingCommitDataRequests(); });
+
+  FtraceConfig config = CreateFtraceConfig({"group/foo"});
+  std::unique_ptr<FtraceDataSource> data_source(new FtraceDataSource(
+      controller->GetWeakPtr(), 0 /* session id */, config,
+      std::make_unique<TraceWriterForTesting>()));
+  data_source->AddReaderShard(
+      arbiter.CreateTraceWriter(2, BufferExhaustedPolicy::kStallThenDrop));
+  ASSERT_TRUE(controller->AddDataSource(data_source.get()));
+  ASSERT_TRUE(controller->StartDataSource(data_source.get()));
+
+  bool flushed = false;
+  data_source->Flush(1, [&flushed] { flushed = true; });
+  EXPECT_TRUE(flushed);
+
+  // The reader thread got the chunk freed by the commit sent while the main
+  // thread was waiting, instead of dropping its packet, which was committed
+  // by the flush.
+  EXPECT_THAT(committed_buffers, ElementsAre(1u, 2u));
+
+  data_source.reset();
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(default_layout);
+}
+
 TEST(FtraceMetadataTest, Clear) {
   FtraceMetadata metadata;
   metadata.inode_and_device.insert(std::make_pair(1, 1));
@@ -628,6 +728,26 @@ TEST(FtraceMetadataTest, AddPid) {
   EXPECT_THAT(metadata.pids, ElementsAre(1, 2, 3));
 }
 
+TEST(FtraceMetadataTest, MergeFrom) {
+  FtraceMetadata metadata;
+  metadata.AddPid(1);
+  metadata.AddSymbolAddr(0x1000);
+
+  FtraceMetadata other;
+  other.AddPid(1);
+  other.AddPid(4);
+  other.AddRenamePid(5);
+  other.inode_and_device.insert(std::make_pair(6, 7));
+  other.AddSymbolAddr(0x2000);
+
+  metadata.MergeFrom(other);
+  EXPECT_THAT(metadata.pids, ElementsAre(1, 4));
+  EXPECT_THAT(metadata.rename_pids, ElementsAre(5));
+  EXPECT_THAT(metadata.inode_and_device, ElementsAre(Pair(6, 7)));
+  // Kernel symbols are interned per sequence and never merged.
+  EXPECT_EQ(metadata.kernel_addrs.size(), 1u);
+}
+
 TEST(FtraceStatsTest, Write) {
   FtraceStats stats{};
   FtraceCpuStats cpu_stats{};
@@ -102,6 +102,23 @@ void FtraceDataSource::Initialize(
   parsing_config_ = parsing_config;
 }
 
+void FtraceDataSource::AddReaderShard(std::unique_ptr<TraceWriter> writer) {
+  ReaderShard shard;
+  shard.writer = std::move(writer);
+  reader_shards_.emplace_back(std::move(shard));
+}
+
+void FtraceDataSource::MergeReaderShards() {
+  for (ReaderShard& shard : reader_shards_) {
+    metadata_.MergeFrom(shard.metadata);
+    shard.metadata.Clear();
+    for (auto error : shard.parse_errors) {
+      parse_errors_.insert(error);
+    }
+    shard.parse_errors.clear();
+  }
+}
+
 void FtraceDataSource::Start() {
   if (!controller_weak_)
     return;
@@ -153,6 +170,11 @@ void FtraceDataSource::OnFtraceFlushComplete(FlushRequestID flush_request_id) {
   pending_flushes_.erase(it);
   if (writer_) {
     WriteStats();
+    // The shards' commits go through the same IPC channel ahead of the main
+    // writer's, so acking the latter implies the former made it too.
+    for (ReaderShard& shard : reader_shards_) {
+      shard.writer->Flush();
+    }
     writer_->Flush(std::move(callback));
   }
 }
@@ -20,6 +20,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "perfetto/base/flat_set.h"
 #include "perfetto/ext/base/weak_ptr.h"
@@ -91,6 +92,27 @@ class FtraceDataSource : public ProbesDataSource {
   }
   TraceWriter* trace_writer() { return writer_.get(); }
 
+  // Reader shards, used when FtraceConfig.reader_threads > 1. Shard 0 is the
+  // data source's own writer, metadata and parse errors. Every other shard has
+  // its own writer (i.e. its own packet sequence) and is only touched by one
+  // reader thread during a read pass.
+  void AddReaderShard(std::unique_ptr<TraceWriter>);
+  size_t num_reader_shards() const { return 1 + reader_shards_.size(); }
+  TraceWriter* trace_writer(size_t shard) {
+    return shard ? reader_shards_[shard - 1].writer.get() : writer_.get();
+  }
+  FtraceMetadata* mutable_metadata(size_t shard) {
+    return shard ? &reader_shards_[shard - 1].metadata : &metadata_;
+  }
+  base::FlatSet<protos::pbzero::FtraceParseStatus>* mutable_parse_errors(
+      size_t shard) {
+    return shard ? &reader_shards_[shard - 1].parse_errors : &parse_errors_;
+  }
+
+  // Moves the metadata and parse errors collected by the other shards into
+  // shard 0. Called on the main thread once a parallel read pass is over.
+  void MergeReaderShards();
+
   uint64_t* mutable_bundle_end_timestamp(size_t cpu) {
     if (cpu >= bundle_end_ts_by_cpu_.size())
       bundle_end_ts_by_cpu_.resize(cpu + 1);
@@ -98,6 +120,12 @@ class FtraceDataSource : public ProbesDataSource {
   }
 
  private:
+  struct ReaderShard {
+    std::unique_ptr<TraceWriter> writer;
+    FtraceMetadata metadata;
+    base::FlatSet<protos::pbzero::FtraceParseStatus> parse_errors;
+  };
+
   void WriteStats();
 
   const FtraceConfig config_;
@@ -115,6 +143,7 @@ class FtraceDataSource : public ProbesDataSource {
   // -- Fields initialized by the Initialize() call:
   FtraceConfigId config_id_ = 0;
   std::unique_ptr<TraceWriter> writer_;
+  std::vector<ReaderShard> reader_shards_;
   base::WeakPtr<FtraceController> controller_weak_;
   // Muxer-held state for parsing ftrace according to this data source's
   // configuration. Not the raw FtraceConfig proto (held by |config_|).
@@ -68,9 +68,8 @@ struct FtraceMetadata {
   void AddDevice(BlockDeviceID device_id) { last_seen_device_id = device_id; }
 
   void AddInode(Inode inode_number) {
-    static int32_t cached_pid = 0;
-    if (!cached_pid)
-      cached_pid = getpid();
+    // Can be called concurrently by the ftrace reader threads.
+    static const int32_t cached_pid = getpid();
 
     PERFETTO_DCHECK(last_seen_common_pid);
     PERFETTO_DCHECK(cached_pid == getpid());
@@ -111,6 +110,20 @@ struct FtraceMetadata {
     return it_and_inserted.first->index;
   }
 
+  // Merges the pids, inodes and fds collected by another reader thread.
+  // |kernel_addrs| are not merged: their indexes are interned per packet
+  // sequence, and each reader thread writes on its own sequence.
+  void MergeFrom(const FtraceMetadata& other) {
+    for (const InodeBlockPair& inode : other.inode_and_device)
+      inode_and_device.insert(inode);
+    for (int32_t pid : other.rename_pids)
+      rename_pids.insert(pid);
+    for (int32_t pid : other.pids)
+      AddPid(pid);
+    for (const std::pair<pid_t, uint64_t>& fd : other.fds)
+      fds.insert(fd);
+  }
+
   void Clear() {
     inode_and_device.clear();
     rename_pids.clear();
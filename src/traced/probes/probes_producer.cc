@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -30,6 +31,7 @@
 #include "perfetto/ext/base/weak_ptr.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
 #include "perfetto/ext/tracing/core/priority_boost_config.h"
+#include "perfetto/ext/tracing/core/shared_memory_arbiter.h"
 #include "perfetto/ext/tracing/ipc/producer_ipc_client.h"
 #include "perfetto/tracing/buffer_exhausted_policy.h"
 #include "perfetto/tracing/core/data_source_config.h"
@@ -141,9 +143,18 @@ ProbesProducer::CreateDSInstance<FtraceDataSource>(
 
   PERFETTO_LOG("Ftrace setup (target_buf=%" PRIu32 ")", config.target_buffer());
   const BufferID buffer_id = static_cast<BufferID>(config.target_buffer());
+  const uint32_t reader_threads = std::min(
+      ftrace_config.reader_threads(), FtraceController::kMaxReaderThreads);
   std::unique_ptr<FtraceDataSource> data_source(new FtraceDataSource(
       ftrace_controller_->GetWeakPtr(), session_id, std::move(ftrace_config),
       endpoint_->CreateTraceWriter(buffer_id, BufferExhaustedPolicy::kStall)));
+  // Each additional reader thread writes on its own sequence. These writers
+  // run while this thread waits for them: drop data rather than crash if the
+  // service stops consuming the shared memory buffer.
+  for (uint32_t i = 1; i < reader_threads; i++) {
+    data_source->AddReaderShard(endpoint_->CreateTraceWriter(
+        buffer_id, BufferExhaustedPolicy::kStallThenDrop));
+  }
   if (!ftrace_controller_->AddDataSource(data_source.get())) {
     PERFETTO_ELOG("Failed to setup ftrace");
     return nullptr;
@@ -701,6 +712,14 @@ void ProbesProducer::ClearIncrementalState(
   }
 }
 
+// Commits the chunks filled by the ftrace reader threads so far.
+void ProbesProducer::OnWaitingForFtraceReaderThreads() {
+  if (!endpoint_)
+    return;
+  if (SharedMemoryArbiter* arbiter = endpoint_->MaybeSharedMemoryArbiter())
+    arbiter->FlushPendingCommitDataRequests();
+}
+
 // This function is called by the FtraceController in batches, whenever it has
 // read one or more pages from one or more cpus and written that into the
 // userspace tracing buffer. If more than one ftrace data sources are active,
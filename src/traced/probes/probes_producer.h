@@ -65,6 +65,7 @@ class ProbesProducer : public Producer, public FtraceController::Observer {
 
   // FtraceController::Observer implementation.
   void OnFtraceDataWrittenIntoDataSourceBuffers() override;
+  void OnWaitingForFtraceReaderThreads() override;
 
   // Our Impl
   void ConnectWithRetries(const char* socket_name,
@@ -41,6 +41,9 @@
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
 #include "src/tracing/service/zlib_compressor.h"
 #endif
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include "src/tracing/service/zstd_compressor.h"
+#endif
 
 namespace perfetto {
 namespace {
@@ -137,6 +140,9 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
   init_opts.compressor_fn = &ZlibCompressFn;
 #endif
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+  init_opts.zstd_compressor_fn = &ZstdCompressFn;
+#endif
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
   // See /rfcs/0017-out-of-tree-protos.md .
   std::vector<base::ScopedMmap> extension_descriptor_mmaps;
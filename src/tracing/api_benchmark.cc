@@ -14,7 +14,11 @@
 
 #include <benchmark/benchmark.h>
 
+#include <thread>
+#include <vector>
+
 #include "perfetto/tracing.h"
+#include "protos/perfetto/config/track_event/track_event_config.gen.h"
 #include "protos/perfetto/trace/test_event.pbzero.h"
 #include "protos/perfetto/trace/trace.pbzero.h"
 #include "protos/perfetto/trace/trace_packet.pbzero.h"
@@ -120,6 +124,32 @@ static void BM_TracingDataSourceLambdaDifferentPacketSize(
       static_cast<double>(GetForTestingPacketSizeFromTrace(trace));
 }
 
+// Writes packets from several threads at the same time. The packets are large
+// enough for each thread to fill up and acquire a new chunk every few dozens
+// of packets, which stresses the shared memory arbiter. Reports the number of
+// packets written per second across all threads.
+static void BM_TracingDataSourceThreads(benchmark::State& state) {
+  // Shared by all the threads (and all the runs) of the benchmark: the tracing
+  // session is never stopped as there is no point where all the threads are
+  // done writing.
+  static perfetto::TracingSession* tracing_session =
+      StartTracing("benchmark").release();
+  benchmark::DoNotOptimize(tracing_session);
+
+  for (auto _ : state) {
+    BenchmarkDataSource::Trace([&](BenchmarkDataSource::TraceContext ctx) {
+      auto packet = ctx.NewTracePacket();
+      packet->set_timestamp(42);
+      auto* payload = packet->set_for_testing()->set_payload();
+      for (size_t i = 0; i < 8; i++) {
+        payload->add_str("ABCDEFGH");
+      }
+    });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
 static void BM_TracingTrackEventDisabled(benchmark::State& state) {
   while (state.KeepRunning()) {
     TRACE_EVENT_BEGIN("benchmark", "DisabledEvent");
@@ -167,6 +197,73 @@ static void BM_TracingTrackEventLambda(benchmark::State& state) {
   PERFETTO_CHECK(!tracing_session->ReadTraceBlocking().empty());
 }
 
+// Emits the same few events from many threads and reports the size of the
+// trace per event, with and without process-wide interning of the event names
+// and categories (TrackEventConfig.enable_process_interning).
+void BM_TracingTrackEventInterning(benchmark::State& state,
+                                   bool process_interning) {
+  static const char* const kEventNames[] = {
+      "Message::Dispatch", "Task::Run",        "Layout::Update",
+      "Paint::Record",     "Raster::Tile",     "Compositor::Commit",
+      "Input::Dispatch",   "Network::Receive",
+  };
+  constexpr size_t kNumEventNames = sizeof(kEventNames) / sizeof(char*);
+  constexpr size_t kEventsPerThread = 1000;
+  const size_t num_threads = static_cast<size_t>(state.range(0));
+
+  perfetto::TracingInitArgs args;
+  args.backends = perfetto::kInProcessBackend;
+  perfetto::Tracing::Initialize(args);
+  perfetto::TrackEvent::Register();
+
+  perfetto::TraceConfig cfg;
+  cfg.add_buffers()->set_size_kb(64 * 1024);
+  auto* ds_cfg = cfg.add_data_sources()->mutable_config();
+  ds_cfg->set_name("track_event");
+  perfetto::protos::gen::TrackEventConfig te_cfg;
+  te_cfg.set_enable_process_interning(process_interning);
+  ds_cfg->set_track_event_config_raw(te_cfg.SerializeAsString());
+
+  size_t trace_bytes = 0;
+  for (auto _ : state) {
+    auto tracing_session =
+        perfetto::Tracing::NewTrace(perfetto::kInProcessBackend);
+    tracing_session->Setup(cfg);
+    tracing_session->StartBlocking();
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+      threads.emplace_back([] {
+        for (size_t i = 0; i < kEventsPerThread; i++) {
+          TRACE_EVENT_BEGIN("benchmark",
+                            perfetto::StaticString{
+                                kEventNames[i % kNumEventNames]});
+          TRACE_EVENT_END("benchmark");
+        }
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+
+    tracing_session->StopBlocking();
+    trace_bytes += tracing_session->ReadTraceBlocking().size();
+  }
+
+  const double events = static_cast<double>(state.iterations()) *
+                        static_cast<double>(num_threads * kEventsPerThread);
+  state.SetItemsProcessed(static_cast<int64_t>(events));
+  state.counters["bytes_per_event"] =
+      static_cast<double>(trace_bytes) / events;
+}
+
+void BM_TracingTrackEventPerThreadInterning(benchmark::State& state) {
+  BM_TracingTrackEventInterning(state, /*process_interning=*/false);
+}
+
+void BM_TracingTrackEventProcessInterning(benchmark::State& state) {
+  BM_TracingTrackEventInterning(state, /*process_interning=*/true);
+}
+
 }  // namespace
 
 BENCHMARK(BM_TracingDataSourceDisabled);
@@ -176,3 +273,23 @@ BENCHMARK(BM_TracingTrackEventBasic);
 BENCHMARK(BM_TracingTrackEventDebugAnnotations);
 BENCHMARK(BM_TracingTrackEventDisabled);
 BENCHMARK(BM_TracingTrackEventLambda);
+BENCHMARK(BM_TracingTrackEventPerThreadInterning)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_TracingTrackEventProcessInterning)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Registered last as it leaves the "benchmark" data source enabled.
+BENCHMARK(BM_TracingDataSourceThreads)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(64)
+    ->Threads(256)
+    ->UseRealTime();
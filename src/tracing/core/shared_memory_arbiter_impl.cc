@@ -122,88 +122,73 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
       break;
   }
 
-  for (;;) {
-    // TODO(primiano): Probably this lock is not really required and this code
-    // could be rewritten leveraging only the Try* atomic operations in
-    // SharedMemoryABI. But let's not be too adventurous for the moment.
-    {
-      std::unique_lock<base::MaybeRtMutex> scoped_lock(lock_);
-
-      // If ever unbound, we do not support stalling. In theory, we could
-      // support stalling for TraceWriters created after the arbiter and startup
-      // buffer reservations were bound, but to avoid raciness between the
-      // creation of startup writers and binding, we categorically forbid kStall
-      // mode.
-      PERFETTO_DCHECK(was_always_bound_ || !should_stall);
+#if PERFETTO_DCHECK_IS_ON()
+  {
+    // If ever unbound, we do not support stalling. In theory, we could support
+    // stalling for TraceWriters created after the arbiter and startup buffer
+    // reservations were bound, but to avoid raciness between the creation of
+    // startup writers and binding, we categorically forbid kStall mode.
+    std::lock_guard<base::MaybeRtMutex> scoped_lock(lock_);
+    PERFETTO_DCHECK(was_always_bound_ || !should_stall);
+  }
+#endif
 
-      task_runner_runs_on_current_thread =
-          task_runner_ && task_runner_->RunsTasksOnCurrentThread();
+  for (;;) {
+    // The fast path doesn't take |lock_|: the chunk is acquired only through
+    // the Try* atomic operations of SharedMemoryABI, which are safe against
+    // other writer threads in this process as well as against the service.
+    Chunk chunk = TryAcquireFreeChunk(header);
+    if (chunk.is_valid()) {
+      if (stall_count > kLogAfterNStalls) {
+        PERFETTO_DLOG("Recovered from stall after %d iterations", stall_count);
+      }
 
-      // If more than half of the SMB.size() is filled with completed chunks for
-      // which we haven't notified the service yet (i.e. they are still enqueued
-      // in |commit_data_req_|), force a synchronous CommitDataRequest() even if
-      // we acquire a chunk, to reduce the likeliness of stalling the writer.
+      // If more than half of the SMB.size() is filled with completed chunks
+      // for which we haven't notified the service yet (i.e. they are still
+      // enqueued in |commit_data_req_|), force a synchronous
+      // CommitDataRequest() even if we acquired a chunk, to reduce the
+      // likeliness of stalling the writer.
       //
-      // We can only do this if we're writing on the same thread that we access
-      // the producer endpoint on, since we cannot notify the producer endpoint
-      // to commit synchronously on a different thread. Attempting to flush
-      // synchronously on another thread will lead to subtle bugs caused by
-      // out-of-order commit requests (crbug.com/919187#c28).
-      bool should_commit_synchronously =
-          task_runner_runs_on_current_thread && should_stall &&
-          commit_data_req_ && bytes_pending_commit_ >= shmem_abi_.size() / 2;
-
-      const size_t initial_page_idx = page_idx_;
-      for (size_t i = 0; i < shmem_abi_.num_pages(); i++) {
-        page_idx_ = (initial_page_idx + i) % shmem_abi_.num_pages();
-        bool is_new_page = false;
-
-        // TODO(primiano): make the page layout dynamic.
-        auto layout = SharedMemoryArbiterImpl::default_page_layout;
-
-        if (shmem_abi_.is_page_free(page_idx_)) {
-          is_new_page = shmem_abi_.TryPartitionPage(page_idx_, layout);
-        }
-        uint32_t free_chunks;
-        if (is_new_page) {
-          free_chunks = (1 << SharedMemoryABI::kNumChunksForLayout[layout]) - 1;
-        } else {
-          free_chunks = shmem_abi_.GetFreeChunks(page_idx_);
-        }
-
-        for (uint32_t chunk_idx = 0; free_chunks;
-             chunk_idx++, free_chunks >>= 1) {
-          if (!(free_chunks & 1))
-            continue;
-          // We found a free chunk.
-          Chunk chunk = shmem_abi_.TryAcquireChunkForWriting(
-              page_idx_, chunk_idx, &header);
-          if (!chunk.is_valid())
-            continue;
-          if (stall_count > kLogAfterNStalls) {
-            PERFETTO_DLOG("Recovered from stall after %d iterations",
-                          stall_count);
-          }
-
-          if (should_commit_synchronously) {
-            // We can't flush while holding the lock.
-            scoped_lock.unlock();
-            FlushPendingCommitDataRequests();
-            return chunk;
-          } else {
-            return chunk;
-          }
+      // We can only do this if we're writing on the same thread that we
+      // access the producer endpoint on, since we cannot notify the producer
+      // endpoint to commit synchronously on a different thread. Attempting to
+      // flush synchronously on another thread will lead to subtle bugs caused
+      // by out-of-order commit requests (crbug.com/919187#c28).
+      //
+      // |bytes_pending_commit_| is checked first without the lock, so that
+      // the lock is only taken when the SMB is filling up.
+      const size_t pending_bytes =
+          bytes_pending_commit_.load(std::memory_order_relaxed);
+      if (should_stall && pending_bytes >= shmem_abi_.size() / 2) {
+        bool should_commit_synchronously;
+        {
+          std::lock_guard<base::MaybeRtMutex> scoped_lock(lock_);
+          should_commit_synchronously =
+              task_runner_ && task_runner_->RunsTasksOnCurrentThread() &&
+              commit_data_req_ &&
+              bytes_pending_commit_.load(std::memory_order_relaxed) >=
+                  shmem_abi_.size() / 2;
         }
+        // We can't flush while holding the lock.
+        if (should_commit_synchronously)
+          FlushPendingCommitDataRequests();
       }
-    }  // scoped_lock
+      return chunk;
+    }
 
     if (!should_stall) {
       PERFETTO_DLOG("Shared memory buffer exhausted, returning invalid Chunk!");
       return Chunk();
     }
 
-    // Stalling is not supported if we were ever unbound (see earlier comment).
-    PERFETTO_CHECK(was_always_bound_);
+    {
+      std::lock_guard<base::MaybeRtMutex> scoped_lock(lock_);
+      // Stalling is not supported if we were ever unbound (see earlier
+      // comment).
+      PERFETTO_CHECK(was_always_bound_);
+      task_runner_runs_on_current_thread =
+          task_runner_ && task_runner_->RunsTasksOnCurrentThread();
+    }
 
     // All chunks are taken (either kBeingWritten by us or kBeingRead by the
     // Service).
@@ -256,6 +241,45 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
   }
 }
 
+Chunk SharedMemoryArbiterImpl::TryAcquireFreeChunk(
+    const SharedMemoryABI::ChunkHeader& header) {
+  // Start from the page where the last chunk was acquired (by any thread):
+  // the pages before it are likely to be still in use.
+  const size_t initial_page_idx = page_idx_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < shmem_abi_.num_pages(); i++) {
+    const size_t page_idx = (initial_page_idx + i) % shmem_abi_.num_pages();
+    bool is_new_page = false;
+
+    // TODO(primiano): make the page layout dynamic.
+    auto layout = SharedMemoryArbiterImpl::default_page_layout;
+
+    if (shmem_abi_.is_page_free(page_idx)) {
+      is_new_page = shmem_abi_.TryPartitionPage(page_idx, layout);
+    }
+    uint32_t free_chunks;
+    if (is_new_page) {
+      free_chunks = (1 << SharedMemoryABI::kNumChunksForLayout[layout]) - 1;
+    } else {
+      free_chunks = shmem_abi_.GetFreeChunks(page_idx);
+    }
+
+    for (uint32_t chunk_idx = 0; free_chunks;
+         chunk_idx++, free_chunks >>= 1) {
+      if (!(free_chunks & 1))
+        continue;
+      // We found a free chunk. This can still fail if another thread (or the
+      // service) changed the state of the chunk in the meantime.
+      Chunk chunk =
+          shmem_abi_.TryAcquireChunkForWriting(page_idx, chunk_idx, &header);
+      if (!chunk.is_valid())
+        continue;
+      page_idx_.store(page_idx, std::memory_order_relaxed);
+      return chunk;
+    }
+  }
+  return Chunk();
+}
+
 void SharedMemoryArbiterImpl::ReturnCompletedChunk(
     Chunk chunk,
     MaybeUnboundBufferID target_buffer,
@@ -282,56 +306,96 @@ void SharedMemoryArbiterImpl::UpdateCommitDataRequest(
   base::TaskRunner* task_runner_to_post_delayed_callback_on = nullptr;
   // The delay with which the flush will be posted.
   uint32_t flush_delay_ms = 0;
+  // For the delayed flush of a batching period, the value of
+  // |delayed_flush_generation_| for that period. 0 for immediate flushes.
+  uint64_t flush_generation = 0;
   base::WeakPtr<SharedMemoryArbiterImpl> weak_this;
+
+  // Release the chunk before taking the lock: this only needs the atomic
+  // operations of SharedMemoryABI. The lock is only required to batch the
+  // chunk into |commit_data_req_|.
+  bool has_chunk = chunk.is_valid();
+  uint8_t chunk_idx = 0;
+  size_t chunk_size = 0;
+  size_t page_idx = 0;
+  if (has_chunk) {
+    PERFETTO_DCHECK(chunk.writer_id() == writer_id);
+    chunk_idx = chunk.chunk_idx();
+    chunk_size = chunk.size();
+    // If the chunk needs patching, it should not be marked as complete yet,
+    // because this would indicate to the service that the producer will not
+    // be writing to it anymore, while the producer might still apply patches
+    // to the chunk later on. In particular, when re-reading (e.g. because of
+    // periodic scraping) a completed chunk, the service expects the flags of
+    // that chunk not to be removed between reads. So, let's say the producer
+    // marked the chunk as complete here and the service then read it for the
+    // first time. If the producer then fully patched the chunk, thus removing
+    // the kChunkNeedsPatching flag, and the service re-read the chunk after
+    // the patching, the service would be thrown off by the removed flag.
+    if (direct_patching_enabled_.load(std::memory_order_relaxed) &&
+        (chunk.GetPacketCountAndFlags().second &
+         SharedMemoryABI::ChunkHeader::kChunkNeedsPatching)) {
+      page_idx = shmem_abi_.GetPageAndChunkIndex(std::move(chunk)).first;
+    } else {
+      // If the chunk doesn't need patching, we can mark it as complete
+      // immediately. This allows the service to read it in full while
+      // scraping, which would not be the case if the chunk was left in a
+      // kChunkBeingWritten state.
+      page_idx = shmem_abi_.ReleaseChunkAsComplete(std::move(chunk));
+    }
+    // DO NOT access |chunk| after this point, it has been std::move()-d
+    // above.
+  }
+
   {
     std::unique_lock<base::MaybeRtMutex> scoped_lock(lock_);
 
-    if (!commit_data_req_) {
+    // The writer can override the arbiter-wide batching thresholds (see
+    // SetBatchCommitsForWriter()).
+    uint32_t batch_commits_duration_ms = batch_commits_duration_ms_;
+    const bool has_writer_batching = !writer_commit_batching_.empty();
+    if (has_writer_batching) {
+      auto it = writer_commit_batching_.find(writer_id);
+      if (it != writer_commit_batching_.end()) {
+        if (it->second.duration_ms)
+          batch_commits_duration_ms = it->second.duration_ms;
+        if (it->second.size_bytes && has_chunk) {
+          commit_size_threshold_ =
+              std::min<size_t>(commit_size_threshold_, it->second.size_bytes);
+        }
+      }
+    }
+
+    if (!commit_data_req_)
       commit_data_req_.reset(new CommitDataRequest());
 
-      // Flushing the commit is only supported while we're |fully_bound_|. If we
-      // aren't, we'll flush when |fully_bound_| is updated.
-      if (fully_bound_ && !delayed_flush_scheduled_) {
+    // Flushing the commit is only supported while we're |fully_bound_|. If we
+    // aren't, we'll flush when |fully_bound_| is updated.
+    //
+    // A delayed flush is scheduled at the start of each batching period. If
+    // writers have different batching durations, a new one is scheduled when
+    // a writer needs its commits to be flushed earlier than the scheduled one.
+    if (fully_bound_) {
+      uint64_t deadline_ms = std::numeric_limits<uint64_t>::max();
+      if (has_writer_batching) {
+        deadline_ms = static_cast<uint64_t>(base::GetWallTimeMs().count()) +
+                      batch_commits_duration_ms;
+      }
+      if (!delayed_flush_scheduled_ ||
+          deadline_ms < delayed_flush_deadline_ms_) {
         weak_this = weak_ptr_factory_.GetWeakPtr();
         task_runner_to_post_delayed_callback_on = task_runner_;
-        flush_delay_ms = batch_commits_duration_ms_;
+        flush_delay_ms = batch_commits_duration_ms;
+        flush_generation = ++delayed_flush_generation_;
         delayed_flush_scheduled_ = true;
+        delayed_flush_deadline_ms_ = deadline_ms;
       }
     }
 
-    CommitDataRequest::ChunksToMove* ctm = nullptr;  // Set if chunk is valid.
-    // If a valid chunk is specified, return it and attach it to the request.
-    if (chunk.is_valid()) {
-      PERFETTO_DCHECK(chunk.writer_id() == writer_id);
-      uint8_t chunk_idx = chunk.chunk_idx();
-      bytes_pending_commit_ += chunk.size();
-      size_t page_idx;
-
-      ctm = commit_data_req_->add_chunks_to_move();
-      // If the chunk needs patching, it should not be marked as complete yet,
-      // because this would indicate to the service that the producer will not
-      // be writing to it anymore, while the producer might still apply patches
-      // to the chunk later on. In particular, when re-reading (e.g. because of
-      // periodic scraping) a completed chunk, the service expects the flags of
-      // that chunk not to be removed between reads. So, let's say the producer
-      // marked the chunk as complete here and the service then read it for the
-      // first time. If the producer then fully patched the chunk, thus removing
-      // the kChunkNeedsPatching flag, and the service re-read the chunk after
-      // the patching, the service would be thrown off by the removed flag.
-      if (direct_patching_enabled_ &&
-          (chunk.GetPacketCountAndFlags().second &
-           SharedMemoryABI::ChunkHeader::kChunkNeedsPatching)) {
-        page_idx = shmem_abi_.GetPageAndChunkIndex(std::move(chunk)).first;
-      } else {
-        // If the chunk doesn't need patching, we can mark it as complete
-        // immediately. This allows the service to read it in full while
-        // scraping, which would not be the case if the chunk was left in a
-        // kChunkBeingWritten state.
-        page_idx = shmem_abi_.ReleaseChunkAsComplete(std::move(chunk));
-      }
-
-      // DO NOT access |chunk| after this point, it has been std::move()-d
-      // above.
+    // If a valid chunk was specified, attach it to the request.
+    if (has_chunk) {
+      bytes_pending_commit_.fetch_add(chunk_size, std::memory_order_relaxed);
+      auto* ctm = commit_data_req_->add_chunks_to_move();
       ctm->set_page(static_cast<uint32_t>(page_idx));
       ctm->set_chunk(chunk_idx);
       ctm->set_target_buffer(target_buffer);
@@ -387,8 +451,10 @@ void SharedMemoryArbiterImpl::UpdateCommitDataRequest(
     // accumulate the patch and a crash occurs before the patch is sent, the
     // service will not know of the patch and won't be able to reconstruct the
     // trace.
-    if (fully_bound_ &&
-        (last_patch_req || bytes_pending_commit_ >= shmem_abi_.size() / 2)) {
+    const bool batch_full =
+        bytes_pending_commit_.load(std::memory_order_relaxed) >=
+        std::min(shmem_abi_.size() / 2, commit_size_threshold_);
+    if (fully_bound_ && (last_patch_req || batch_full)) {
       // Only post an immediate flush task if we haven't already posted one.
       // This prevents spamming the task runner with immediate flushes when
       // the buffer remains over 50% full while chunks continue to be
@@ -397,6 +463,7 @@ void SharedMemoryArbiterImpl::UpdateCommitDataRequest(
         weak_this = weak_ptr_factory_.GetWeakPtr();
         task_runner_to_post_delayed_callback_on = task_runner_;
         flush_delay_ms = 0;
+        flush_generation = 0;
         immediate_flush_scheduled_ = true;
       }
     }
@@ -429,6 +496,7 @@ void SharedMemoryArbiterImpl::UpdateCommitDataRequest(
           weak_this = weak_ptr_factory_.GetWeakPtr();
           task_runner_to_post_delayed_callback_on = task_runner_;
           flush_delay_ms = 0;
+          flush_generation = 0;
           immediate_flush_scheduled_ = true;
         }
       }
@@ -440,11 +508,18 @@ void SharedMemoryArbiterImpl::UpdateCommitDataRequest(
   // because |task_runner_| is never reset.
   if (task_runner_to_post_delayed_callback_on) {
     task_runner_to_post_delayed_callback_on->PostDelayedTask(
-        [weak_this] {
+        [weak_this, flush_generation] {
           if (!weak_this)
             return;
           {
             std::lock_guard<base::MaybeRtMutex> scoped_lock(weak_this->lock_);
+            // The delayed flush of an earlier batching period, superseded by
+            // the one of the current period: let that one flush the current
+            // batch at the end of its period.
+            if (flush_generation &&
+                flush_generation != weak_this->delayed_flush_generation_) {
+              return;
+            }
             // Clear |delayed_flush_scheduled_| and
             // |immediate_flush_scheduled_|, allowing the next call to
             // UpdateCommitDataRequest to start another batching period.
@@ -533,6 +608,19 @@ void SharedMemoryArbiterImpl::SetBatchCommitsDuration(
   batch_commits_duration_ms_ = batch_commits_duration_ms;
 }
 
+void SharedMemoryArbiterImpl::SetBatchCommitsForWriter(
+    WriterID writer_id,
+    uint32_t batch_commits_duration_ms,
+    size_t batch_commits_size_bytes) {
+  std::lock_guard<base::MaybeRtMutex> scoped_lock(lock_);
+  if (!batch_commits_duration_ms && !batch_commits_size_bytes) {
+    writer_commit_batching_.erase(writer_id);
+    return;
+  }
+  writer_commit_batching_[writer_id] = {batch_commits_duration_ms,
+                                        batch_commits_size_bytes};
+}
+
 bool SharedMemoryArbiterImpl::EnableDirectSMBPatching() {
   std::lock_guard<base::MaybeRtMutex> scoped_lock(lock_);
   if (!direct_patching_supported_by_service_) {
@@ -630,7 +718,8 @@ void SharedMemoryArbiterImpl::FlushPendingCommitDataRequests(
       }
 
       req = std::move(commit_data_req_);
-      bytes_pending_commit_ = 0;
+      bytes_pending_commit_.store(0, std::memory_order_relaxed);
+      commit_size_threshold_ = std::numeric_limits<size_t>::max();
     }
   }  // scoped_lock
 
@@ -1060,6 +1149,7 @@ void SharedMemoryArbiterImpl::ReleaseWriterID(WriterID id) {
   {
     std::lock_guard<base::MaybeRtMutex> scoped_lock(lock_);
     active_writer_ids_.Free(id);
+    writer_commit_batching_.erase(id);
 
     auto it = pending_writers_.find(id);
     if (it != pending_writers_.end()) {
@@ -19,7 +19,9 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -47,9 +49,11 @@ class TaskRunner;
 // This class handles the shared memory buffer on the producer side. It is used
 // to obtain thread-local chunks and to partition pages from several threads.
 // There is one arbiter instance per Producer.
-// This class is thread-safe and uses locks to do so. Data sources are supposed
-// to interact with this sporadically, only when they run out of space on their
-// current thread-local chunk.
+// This class is thread-safe. Data sources are supposed to interact with this
+// sporadically, only when they run out of space on their current thread-local
+// chunk. Acquiring and completing chunks only relies on the atomic operations
+// of SharedMemoryABI; a lock is taken only to batch the completed chunks into
+// the next CommitDataRequest.
 //
 // The arbiter can become "unbound" as a consequence of:
 //  (a) being created without an endpoint
@@ -237,6 +241,10 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
 
   void SetBatchCommitsDuration(uint32_t batch_commits_duration_ms) override;
 
+  void SetBatchCommitsForWriter(WriterID,
+                                uint32_t batch_commits_duration_ms,
+                                size_t batch_commits_size_bytes) override;
+
   bool EnableDirectSMBPatching() override;
 
   void SetDirectSMBPatchingSupportedByService() override;
@@ -274,6 +282,11 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   SharedMemoryArbiterImpl(const SharedMemoryArbiterImpl&) = delete;
   SharedMemoryArbiterImpl& operator=(const SharedMemoryArbiterImpl&) = delete;
 
+  // Tries to acquire a free chunk for writing without taking |lock_|. Returns
+  // an invalid chunk if all the chunks in the SMB are in use.
+  SharedMemoryABI::Chunk TryAcquireFreeChunk(
+      const SharedMemoryABI::ChunkHeader& header);
+
   void UpdateCommitDataRequest(SharedMemoryABI::Chunk chunk,
                                WriterID writer_id,
                                MaybeUnboundBufferID target_buffer,
@@ -340,15 +353,22 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   // endpoint that doesn't support shared memory (e.g. vsock).
   const bool use_shmem_emulation_ = false;
 
+  // Index of the page the last chunk was acquired from. Only a hint for where
+  // GetNewChunk() starts looking for a free chunk, so it is accessed without
+  // holding |lock_|.
+  std::atomic<size_t> page_idx_{0};
+
   // --- Begin lock-protected members ---
 
   base::MaybeRtMutex lock_;
 
   base::TaskRunner* task_runner_ = nullptr;
   SharedMemoryABI shmem_abi_;
-  size_t page_idx_ = 0;
   std::unique_ptr<CommitDataRequest> commit_data_req_;
-  size_t bytes_pending_commit_ = 0;  // SUM(chunk.size() : commit_data_req_).
+
+  // SUM(chunk.size() : commit_data_req_). Only modified while holding |lock_|
+  // but GetNewChunk() reads it without the lock to decide whether to flush.
+  std::atomic<size_t> bytes_pending_commit_{0};
   IdAllocator<WriterID> active_writer_ids_;
   bool did_shutdown_ = false;
 
@@ -377,8 +397,26 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   // See SharedMemoryArbiter::SetBatchCommitsDuration.
   uint32_t batch_commits_duration_ms_ = 0;
 
-  // See SharedMemoryArbiter::EnableDirectSMBPatching.
-  bool direct_patching_enabled_ = false;
+  // See SharedMemoryArbiter::SetBatchCommitsForWriter.
+  struct WriterCommitBatching {
+    uint32_t duration_ms = 0;
+    size_t size_bytes = 0;
+  };
+  std::map<WriterID, WriterCommitBatching> writer_commit_batching_;
+
+  // The wall time (in ms) at which the scheduled delayed flush will run.
+  // Only tracked while |writer_commit_batching_| is not empty, UINT64_MAX
+  // otherwise.
+  uint64_t delayed_flush_deadline_ms_ = std::numeric_limits<uint64_t>::max();
+
+  // |commit_data_req_| is flushed immediately once |bytes_pending_commit_|
+  // reaches this or half of the SMB. The minimum of the size thresholds of
+  // the writers which have chunks in |commit_data_req_|.
+  size_t commit_size_threshold_ = std::numeric_limits<size_t>::max();
+
+  // See SharedMemoryArbiter::EnableDirectSMBPatching. Only modified while
+  // holding |lock_| but read without it when returning chunks.
+  std::atomic<bool> direct_patching_enabled_{false};
 
   // See SharedMemoryArbiter::SetDirectSMBPatchingSupportedByService.
   bool direct_patching_supported_by_service_ = false;
@@ -392,6 +430,11 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   // batching period.
   bool delayed_flush_scheduled_ = false;
 
+  // Incremented whenever a delayed flush is scheduled, either for a new
+  // batching period or for an earlier deadline. Delayed flushes posted with
+  // an older value are skipped when they run.
+  uint64_t delayed_flush_generation_ = 0;
+
   // Indicates whether we have already scheduled an immediate flush due to the
   // shared memory buffer being more than half full. Set to true when the first
   // immediate flush is posted and cleared when the flush completes. This
@@ -17,6 +17,11 @@
 #include "src/tracing/core/shared_memory_arbiter_impl.h"
 
 #include <bitset>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
 #include "perfetto/ext/tracing/core/commit_data_request.h"
@@ -210,6 +215,105 @@ TEST_P(SharedMemoryArbiterImplTest, BatchCommits) {
   arbiter_->FlushPendingCommitDataRequests();
 }
 
+// Checks that the batching thresholds set for a writer apply only to the
+// chunks of that writer, and that the size threshold triggers a commit
+// without waiting for the end of the batching period.
+TEST_P(SharedMemoryArbiterImplTest, BatchCommitsForWriter) {
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv1);
+  const WriterID kBatchedWriter = 1;
+  const WriterID kOtherWriter = 2;
+  arbiter_->SetBatchCommitsForWriter(kBatchedWriter, UINT32_MAX,
+                                     static_cast<uint32_t>(page_size()));
+
+  auto get_chunk = [&](WriterID writer_id) {
+    SharedMemoryABI::ChunkHeader header{};
+    header.writer_id.store(writer_id);
+    return arbiter_->GetNewChunk(header, BufferExhaustedPolicy::kStall);
+  };
+
+  // The first chunk of the batched writer is smaller than the size threshold
+  // and stays in the pending batch.
+  SharedMemoryABI::Chunk chunk = get_chunk(kBatchedWriter);
+  ASSERT_TRUE(chunk.is_valid());
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _)).Times(0);
+  PatchList ignored;
+  arbiter_->ReturnCompletedChunk(std::move(chunk), 1, &ignored);
+  task_runner_->RunUntilIdle();
+  ASSERT_TRUE(Mock::VerifyAndClearExpectations(&mock_producer_endpoint_));
+
+  // The second one pushes the batch over the size threshold.
+  chunk = get_chunk(kBatchedWriter);
+  ASSERT_TRUE(chunk.is_valid());
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _))
+      .WillOnce([](const CommitDataRequest& req,
+                   MockProducerEndpoint::CommitDataCallback) {
+        ASSERT_EQ(2, req.chunks_to_move_size());
+      });
+  arbiter_->ReturnCompletedChunk(std::move(chunk), 1, &ignored);
+  task_runner_->RunUntilIdle();
+  ASSERT_TRUE(Mock::VerifyAndClearExpectations(&mock_producer_endpoint_));
+
+  // Writers without thresholds still use the arbiter-wide batching period
+  // (0 by default), so their chunks are committed right away.
+  chunk = get_chunk(kOtherWriter);
+  ASSERT_TRUE(chunk.is_valid());
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _)).Times(1);
+  arbiter_->ReturnCompletedChunk(std::move(chunk), 2, &ignored);
+  task_runner_->RunUntilIdle();
+  ASSERT_TRUE(Mock::VerifyAndClearExpectations(&mock_producer_endpoint_));
+
+  // Resetting the thresholds goes back to the arbiter-wide behavior.
+  arbiter_->SetBatchCommitsForWriter(kBatchedWriter, 0, 0);
+  chunk = get_chunk(kBatchedWriter);
+  ASSERT_TRUE(chunk.is_valid());
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _)).Times(1);
+  arbiter_->ReturnCompletedChunk(std::move(chunk), 1, &ignored);
+  task_runner_->RunUntilIdle();
+}
+
+// Checks that the delayed flush of a batching period which ended early,
+// because its batch was flushed when it reached the size threshold, doesn't
+// flush the batch of the next period before the end of that period.
+TEST_P(SharedMemoryArbiterImplTest, StaleDelayedFlushIsSkipped) {
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv1);
+  const WriterID kWriter = 1;
+  arbiter_->SetBatchCommitsForWriter(kWriter, 100, page_size());
+
+  auto return_chunk = [&] {
+    SharedMemoryABI::ChunkHeader header{};
+    header.writer_id.store(kWriter);
+    SharedMemoryABI::Chunk chunk =
+        arbiter_->GetNewChunk(header, BufferExhaustedPolicy::kStall);
+    ASSERT_TRUE(chunk.is_valid());
+    PatchList ignored;
+    arbiter_->ReturnCompletedChunk(std::move(chunk), 1, &ignored);
+  };
+
+  // The first period starts at t=0 and ends early once its batch is full.
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _)).Times(1);
+  return_chunk();
+  return_chunk();
+  task_runner_->RunUntilIdle();
+  ASSERT_TRUE(Mock::VerifyAndClearExpectations(&mock_producer_endpoint_));
+
+  // The second period starts at t=50 and ends at t=150: the delayed flush of
+  // the first period, at t=100, must not flush it.
+  task_runner_->AdvanceTimeAndRunUntilIdle(50);
+  return_chunk();
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _)).Times(0);
+  task_runner_->AdvanceTimeAndRunUntilIdle(60);
+  ASSERT_TRUE(Mock::VerifyAndClearExpectations(&mock_producer_endpoint_));
+
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _))
+      .WillOnce([](const CommitDataRequest& req,
+                   MockProducerEndpoint::CommitDataCallback) {
+        ASSERT_EQ(1, req.chunks_to_move_size());
+      });
+  task_runner_->AdvanceTimeAndRunUntilIdle(50);
+}
+
 TEST_P(SharedMemoryArbiterImplTest, UseShmemEmulation) {
   arbiter_.reset(new SharedMemoryArbiterImpl(
       buf(), buf_size(), ShmemMode::kShmemEmulation, page_size(),
@@ -362,6 +466,63 @@ TEST_P(SharedMemoryArbiterImplTest, BufferExhaustedPolicyDrop) {
   ASSERT_TRUE(chunks[0].is_valid());
 }
 
+// Acquires and returns all the chunks in the SMB from several threads at the
+// same time and checks that every chunk is handed out exactly once.
+TEST_P(SharedMemoryArbiterImplTest, ConcurrentGetAndReturnChunks) {
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv14);
+  static constexpr size_t kTotChunks = kNumPages * 14;
+  static constexpr size_t kNumThreads = 8;
+
+  std::vector<std::vector<SharedMemoryABI::Chunk>> chunks(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([this, &chunks, t] {
+      for (;;) {
+        SharedMemoryABI::ChunkHeader header{};
+        header.chunk_id.store(static_cast<ChunkID>(t));
+        auto chunk =
+            arbiter_->GetNewChunk(header, BufferExhaustedPolicy::kDrop);
+        if (!chunk.is_valid())
+          break;
+        chunks[t].push_back(std::move(chunk));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  std::set<std::pair<size_t, size_t>> acquired;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    for (const auto& chunk : chunks[t]) {
+      ASSERT_EQ(chunk.header()->chunk_id.load(), t);
+      auto* abi = arbiter_->shmem_abi_for_testing();
+      acquired.insert(abi->GetPageAndChunkIndex(chunk));
+    }
+  }
+  ASSERT_EQ(acquired.size(), kTotChunks);
+
+  size_t committed_chunks = 0;
+  EXPECT_CALL(mock_producer_endpoint_, CommitData(_, _))
+      .WillRepeatedly([&committed_chunks](
+                          const CommitDataRequest& req,
+                          MockProducerEndpoint::CommitDataCallback) {
+        committed_chunks += static_cast<size_t>(req.chunks_to_move_size());
+      });
+  threads.clear();
+  for (size_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([this, &chunks, t] {
+      PatchList ignored;
+      for (auto& chunk : chunks[t])
+        arbiter_->ReturnCompletedChunk(std::move(chunk), 1, &ignored);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  task_runner_->RunUntilIdle();
+  ASSERT_EQ(committed_chunks, kTotChunks);
+}
+
 TEST_P(SharedMemoryArbiterImplTest, CreateUnboundAndBind) {
   auto checkpoint_writer = task_runner_->CreateCheckpoint("writer_registered");
   auto checkpoint_flush = task_runner_->CreateCheckpoint("flush_completed");
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <limits>
 #include <mutex>
 #include <optional>
 #include <vector>
@@ -2368,8 +2369,27 @@ std::unique_ptr<TraceWriterBase> TracingMuxerImpl::CreateTraceWriter(
     return service->MaybeSharedMemoryArbiter()->CreateStartupTraceWriter(
         startup_buffer_reservation);
   }
-  return service->CreateTraceWriter(data_source->buffer_id,
-                                    buffer_exhausted_policy);
+  std::unique_ptr<TraceWriter> writer = service->CreateTraceWriter(
+      data_source->buffer_id, buffer_exhausted_policy);
+
+  // Apply the commit batching thresholds requested by the data source config.
+  // The config is not modified after the data source instance is set up, so
+  // it's safe to read it from any thread.
+  const DataSourceConfig* cfg = data_source->config.get();
+  if (cfg &&
+      (cfg->commit_batching_period_ms() || cfg->commit_batching_size_kb())) {
+    SharedMemoryArbiter* arbiter = service->MaybeSharedMemoryArbiter();
+    if (arbiter && writer->writer_id()) {
+      // Converted in 64 bits as large sizes don't fit in 32 bits once in
+      // bytes. Sizes which don't fit in a size_t can't be reached anyway.
+      uint64_t size_bytes = uint64_t{cfg->commit_batching_size_kb()} * 1024;
+      arbiter->SetBatchCommitsForWriter(
+          writer->writer_id(), cfg->commit_batching_period_ms(),
+          static_cast<size_t>(std::min<uint64_t>(
+              size_bytes, std::numeric_limits<size_t>::max())));
+    }
+  }
+  return writer;
 }
 
 // This is called via the public API Tracing::NewTrace().
@@ -21,7 +21,9 @@
 #include "perfetto/ext/base/no_destructor.h"
 #include "perfetto/tracing/core/data_source_config.h"
 #include "perfetto/tracing/data_source.h"
+#include "perfetto/tracing/internal/tracing_muxer.h"
 #include "perfetto/tracing/internal/track_event_interned_fields.h"
+#include "perfetto/tracing/internal/track_event_process_interning.h"
 #include "perfetto/tracing/track_event.h"
 #include "perfetto/tracing/track_event_category_registry.h"
 #include "perfetto/tracing/track_event_interned_data_index.h"
@@ -433,6 +435,7 @@ void TrackEventInternal::ResetIncrementalState(
   }
 
   incr_state->last_timestamp_ns = sequence_timestamp.value;
+  incr_state->process_interning = tls_state.process_interning.get();
   auto default_track = ThreadTrack::Current();
   auto ts_unit_multiplier = tls_state.timestamp_unit_multiplier;
   auto thread_time_counter_track =
@@ -449,6 +452,10 @@ void TrackEventInternal::ResetIncrementalState(
     auto defaults = packet->set_trace_packet_defaults();
     defaults->set_timestamp_clock_id(tls_state.default_clock);
     // Establish the default track for this event sequence.
+    if (tls_state.process_interning) {
+      defaults->set_shared_interned_data_scope(
+          tls_state.process_interning->scope());
+    }
     auto track_defaults = defaults->set_track_event_defaults();
     track_defaults->set_track_uuid(default_track.uuid);
     if (tls_state.enable_thread_time_sampling) {
@@ -648,6 +655,23 @@ void TrackEventDataSource::OnStart(const DataSourceBase::StartArgs& args) {
   TrackEventInternal::OnStart(args);
 }
 
+void TrackEventDataSource::SetUpProcessInterning(
+    const DataSourceBase::SetupArgs& args) {
+  DataSourceStaticState* static_state =
+      DataSourceHelper<TrackEventDataSource,
+                       TrackEventDataSourceTraits>::type()
+          .static_state();
+  DataSourceState* ds_state =
+      static_state->GetUnsafe(args.internal_instance_index);
+  // Interceptors resolve interned data within each sequence.
+  if (ds_state->interceptor_id)
+    return;
+  process_interning_ = std::make_shared<TrackEventProcessInterning>(
+      TracingMuxer::Get()->CreateTraceWriter(
+          static_state, args.internal_instance_index, ds_state,
+          ds_state->buffer_exhausted_policy));
+}
+
 }  // namespace internal
 
 PERFETTO_DEFINE_DATA_SOURCE_STATIC_MEMBERS_WITH_ATTRS(
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "perfetto/tracing/internal/track_event_process_interning.h"
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/uuid.h"
+#include "perfetto/tracing/internal/track_event_internal.h"
+#include "protos/perfetto/trace/trace_packet_defaults.pbzero.h"
+
+namespace perfetto {
+namespace internal {
+
+namespace {
+
+// Enough for the static strings of most processes, so that lookups rarely
+// have to walk more than one table.
+constexpr size_t kInitialCapacity = 1024;
+
+}  // namespace
+
+TrackEventProcessInterning::Table::Table(size_t capacity)
+    : mask(capacity - 1), slots(new Slot[capacity]) {
+  PERFETTO_DCHECK((capacity & mask) == 0);
+}
+
+TrackEventProcessInterning::TrackEventProcessInterning(
+    std::unique_ptr<TraceWriterBase> trace_writer)
+    : scope_(static_cast<uint64_t>(base::Uuidv4().lsb())),
+      trace_writer_(std::move(trace_writer)) {
+  tables_.emplace_back(new Table(kInitialCapacity));
+  first_table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+TrackEventProcessInterning::~TrackEventProcessInterning() = default;
+
+TrackEventProcessInterning::Slot*
+TrackEventProcessInterning::FindOrInsertLocked(size_t field_number,
+                                               const void* value) {
+  uint64_t hash = Hash(field_number, value);
+  for (const auto& table : tables_) {
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+      Slot& slot = table->slots[i];
+      const void* slot_value = slot.value.load(std::memory_order_relaxed);
+      if (!slot_value)
+        break;
+      if (slot_value == value && slot.field_number == field_number)
+        return &slot;
+    }
+  }
+
+  // Insert into the last table, chaining a new one if it is half full so
+  // that probe sequences stay short.
+  Table* table = tables_.back().get();
+  if ((table->size + 1) * 2 > table->mask + 1) {
+    tables_.emplace_back(new Table((table->mask + 1) * 2));
+    Table* next = tables_.back().get();
+    table->next.store(next, std::memory_order_release);
+    table = next;
+  }
+  size_t i = hash & table->mask;
+  while (table->slots[i].value.load(std::memory_order_relaxed))
+    i = (i + 1) & table->mask;
+  Slot& slot = table->slots[i];
+  slot.field_number = field_number;
+  slot.iid = ++next_iids_[field_number];
+  table->size++;
+  // Publishes |field_number| and |iid| to the lock-free readers.
+  slot.value.store(value, std::memory_order_release);
+  return &slot;
+}
+
+protozero::MessageHandle<protos::pbzero::TracePacket>
+TrackEventProcessInterning::NewTracePacketLocked() {
+  auto packet = trace_writer_->NewTracePacket();
+  packet->set_timestamp(TrackEventInternal::GetTimeNs());
+  packet->set_timestamp_clock_id(
+      static_cast<uint32_t>(TrackEventInternal::GetClockId()));
+  uint32_t seq_flags = protos::pbzero::TracePacket::SEQ_SHARED_INTERNED_DATA;
+  uint32_t generation = generation_.load(std::memory_order_relaxed);
+  if (packet_generation_ != generation) {
+    // First packet since the incremental state was cleared: the scope is
+    // re-emitted with it, in case the previous one was overwritten.
+    packet_generation_ = generation;
+    seq_flags |= protos::pbzero::TracePacket::SEQ_INCREMENTAL_STATE_CLEARED;
+    packet->set_trace_packet_defaults()->set_shared_interned_data_scope(
+        scope_);
+  } else {
+    seq_flags |= protos::pbzero::TracePacket::SEQ_NEEDS_INCREMENTAL_STATE;
+  }
+  packet->set_sequence_flags(seq_flags);
+  return packet;
+}
+
+void TrackEventProcessInterning::OnIncrementalStateCleared() {
+  generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrackEventProcessInterning::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  trace_writer_->Flush();
+}
+
+}  // namespace internal
+}  // namespace perfetto
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/async_file_writer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/thread_utils.h"
+
+namespace perfetto::tracing_service {
+
+AsyncFileWriter::AsyncFileWriter(int fd, size_t queue_limit_bytes)
+    : fd_(fd), queue_limit_bytes_(queue_limit_bytes) {
+  thread_ = std::thread(&AsyncFileWriter::ThreadMain, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  request_cv_.notify_one();
+  thread_.join();
+}
+
+void AsyncFileWriter::Write(std::vector<uint8_t> data) {
+  if (data.empty())
+    return;
+  Request req;
+  req.data = std::move(data);
+  Enqueue(std::move(req));
+}
+
+void AsyncFileWriter::Sync() {
+  Request req;
+  req.sync = true;
+  Enqueue(std::move(req));
+}
+
+void AsyncFileWriter::Enqueue(Request req) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_bytes_ += req.data.size();
+    max_queued_bytes_ = std::max(max_queued_bytes_, queued_bytes_);
+    queue_.emplace_back(std::move(req));
+  }
+  request_cv_.notify_one();
+}
+
+void AsyncFileWriter::Drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return queue_.empty() && !busy_; });
+}
+
+bool AsyncFileWriter::queue_full() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queued_bytes_ >= queue_limit_bytes_;
+}
+
+uint64_t AsyncFileWriter::max_queued_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_queued_bytes_;
+}
+
+void AsyncFileWriter::ThreadMain() {
+  base::MaybeSetThreadName("traced.fwrite");
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    // Drain the queue before honoring |quit_|, so that no data is lost when
+    // the session is torn down.
+    request_cv_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+    if (queue_.empty())
+      return;
+
+    Request req = std::move(queue_.front());
+    queue_.pop_front();
+    busy_ = true;
+    lock.unlock();
+
+    if (!has_error()) {
+      if (req.sync) {
+        base::FlushFile(fd_);
+      } else {
+        write_calls_.fetch_add(1, std::memory_order_relaxed);
+        ssize_t res = base::WriteAll(fd_, req.data.data(), req.data.size());
+        if (res != static_cast<ssize_t>(req.data.size())) {
+          PERFETTO_PLOG("AsyncFileWriter: write() failed");
+          error_.store(true, std::memory_order_relaxed);
+        }
+      }
+    }
+    size_t size = req.data.size();
+    // Release the memory before re-acquiring the lock.
+    req = Request();
+
+    lock.lock();
+    queued_bytes_ -= size;
+    busy_ = false;
+    if (queue_.empty())
+      idle_cv_.notify_all();
+  }
+}
+
+}  // namespace perfetto::tracing_service
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACING_SERVICE_ASYNC_FILE_WRITER_H_
+#define SRC_TRACING_SERVICE_ASYNC_FILE_WRITER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace perfetto::tracing_service {
+
+// Writes buffers into a file on a dedicated thread, so that a slow output
+// file doesn't block the service main thread. Used for write_into_file
+// sessions that set TraceConfig.file_write_queue_size_kb.
+//
+// The file descriptor is not owned and must outlive this object. All the
+// methods must be called on the same (service) thread.
+class AsyncFileWriter {
+ public:
+  AsyncFileWriter(int fd, size_t queue_limit_bytes);
+
+  // Waits for all the queued data to be written, then joins the thread.
+  ~AsyncFileWriter();
+
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+  // Queues |data| to be written at the end of the file. Never blocks, even if
+  // the queue is full: the caller is expected to check queue_full() and stop
+  // producing data until the writer catches up.
+  void Write(std::vector<uint8_t> data);
+
+  // Queues a sync of the file to storage after all the data queued so far.
+  void Sync();
+
+  // Blocks until all the data queued so far has been written.
+  void Drain();
+
+  // True if the bytes queued (including the ones being written) exceed the
+  // limit passed to the constructor.
+  bool queue_full() const;
+
+  // True if a previous write failed. Once set, further writes are dropped.
+  bool has_error() const { return error_.load(std::memory_order_relaxed); }
+
+  uint64_t write_calls() const {
+    return write_calls_.load(std::memory_order_relaxed);
+  }
+  uint64_t max_queued_bytes() const;
+
+ private:
+  struct Request {
+    std::vector<uint8_t> data;
+    bool sync = false;
+  };
+
+  void Enqueue(Request);
+  void ThreadMain();
+
+  const int fd_;
+  const size_t queue_limit_bytes_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable request_cv_;  // Signals the writer thread.
+  std::condition_variable idle_cv_;     // Signals Drain().
+  std::deque<Request> queue_;           // Guarded by |mutex_|.
+  size_t queued_bytes_ = 0;             // Guarded by |mutex_|.
+  size_t max_queued_bytes_ = 0;         // Guarded by |mutex_|.
+  bool busy_ = false;                   // Guarded by |mutex_|.
+  bool quit_ = false;                   // Guarded by |mutex_|.
+
+  std::atomic<bool> error_{false};
+  std::atomic<uint64_t> write_calls_{0};
+
+  std::thread thread_;
+};
+
+}  // namespace perfetto::tracing_service
+
+#endif  // SRC_TRACING_SERVICE_ASYNC_FILE_WRITER_H_
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/async_file_writer.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/pipe.h"
+#include "perfetto/ext/base/temp_file.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::tracing_service {
+namespace {
+
+std::vector<uint8_t> ToVector(const std::string& str) {
+  return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+TEST(AsyncFileWriterTest, WritesInOrder) {
+  base::TempFile tmp_file = base::TempFile::Create();
+  {
+    AsyncFileWriter writer(tmp_file.fd(), 1024);
+    writer.Write(ToVector("foo"));
+    writer.Write({});
+    writer.Write(ToVector("bar"));
+    writer.Sync();
+    writer.Write(ToVector("baz"));
+    writer.Drain();
+    EXPECT_FALSE(writer.queue_full());
+    EXPECT_FALSE(writer.has_error());
+    EXPECT_EQ(writer.write_calls(), 3u);
+  }
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path(), &contents));
+  EXPECT_EQ(contents, "foobarbaz");
+}
+
+TEST(AsyncFileWriterTest, DestructorDrainsQueue) {
+  base::TempFile tmp_file = base::TempFile::Create();
+  std::string expected;
+  {
+    AsyncFileWriter writer(tmp_file.fd(), 1024);
+    for (int i = 0; i < 100; i++) {
+      std::string chunk = std::to_string(i) + ",";
+      expected += chunk;
+      writer.Write(ToVector(chunk));
+    }
+  }
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path(), &contents));
+  EXPECT_EQ(contents, expected);
+}
+
+// The writer must not block its caller while the output fd is stalled, and
+// must report the queue as full so the caller can apply backpressure.
+TEST(AsyncFileWriterTest, StalledFdDoesNotBlockCaller) {
+  static constexpr size_t kQueueLimit = 256 * 1024;
+  static constexpr size_t kChunkSize = 64 * 1024;
+  base::Pipe pipe = base::Pipe::Create();
+  AsyncFileWriter writer(*pipe.wr, kQueueLimit);
+
+  // Nobody reads from the pipe yet: once the pipe buffer is full the writer
+  // thread blocks in write(), but Write() keeps returning immediately.
+  size_t total_size = 0;
+  while (!writer.queue_full()) {
+    writer.Write(std::vector<uint8_t>(kChunkSize, 'x'));
+    total_size += kChunkSize;
+    ASSERT_LE(total_size, 16 * kQueueLimit);
+  }
+  EXPECT_GE(writer.max_queued_bytes(), kQueueLimit);
+
+  std::thread reader([&pipe, total_size] {
+    std::vector<char> buf(kChunkSize);
+    size_t read_size = 0;
+    while (read_size < total_size) {
+      ssize_t rsize = base::Read(*pipe.rd, buf.data(), buf.size());
+      ASSERT_GT(rsize, 0);
+      read_size += static_cast<size_t>(rsize);
+    }
+  });
+  writer.Drain();
+  reader.join();
+  EXPECT_FALSE(writer.queue_full());
+  EXPECT_FALSE(writer.has_error());
+}
+
+}  // namespace
+}  // namespace perfetto::tracing_service
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/utils.h"
+#include "perfetto/ext/tracing/core/trace_packet.h"
+#include "perfetto/protozero/proto_decoder.h"
+#include "src/base/test/utils.h"
+
+#include "protos/perfetto/trace/trace.pbzero.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+#include "src/tracing/service/zlib_compressor.h"
+#endif
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include "src/tracing/service/zstd_compressor.h"
+#endif
+
+namespace perfetto {
+namespace {
+
+const char* const kTestTraces[] = {
+    "test/data/example_android_trace_30s.pb",
+    "test/data/android_calculator_startup.pb",
+    "test/data/chrome_scroll_without_vsync.pftrace",
+};
+
+const std::string& GetTraceData(size_t trace_idx) {
+  static std::string* data = new std::string[base::ArraySize(kTestTraces)];
+  std::string& trace = data[trace_idx];
+  if (trace.empty()) {
+    base::ReadFile(base::GetTestDataPath(kTestTraces[trace_idx]), &trace);
+    PERFETTO_CHECK(!trace.empty());
+  }
+  return trace;
+}
+
+// Splits the trace into one TracePacket per top-level packet, mimicking what
+// the service reads back from its buffers.
+std::vector<TracePacket> SplitIntoPackets(const std::string& trace) {
+  std::vector<TracePacket> packets;
+  protozero::ProtoDecoder decoder(trace.data(), trace.size());
+  for (auto field = decoder.ReadField(); field.valid();
+       field = decoder.ReadField()) {
+    if (field.id() != protos::pbzero::Trace::kPacketFieldNumber)
+      continue;
+    Slice slice = Slice::Allocate(field.size());
+    memcpy(slice.own_data(), field.data(), field.size());
+    TracePacket packet;
+    packet.AddSlice(std::move(slice));
+    packets.push_back(std::move(packet));
+  }
+  return packets;
+}
+
+template <typename CompressFn>
+void RunCompressBenchmark(benchmark::State& state, CompressFn compress) {
+  const std::string& trace = GetTraceData(static_cast<size_t>(state.range(0)));
+  std::vector<TracePacket> packets = SplitIntoPackets(trace);
+  size_t uncompressed_size = 0;
+  for (const TracePacket& packet : packets)
+    uncompressed_size += packet.size();
+
+  size_t compressed_size = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<TracePacket> copy;
+    copy.reserve(packets.size());
+    for (const TracePacket& packet : packets) {
+      TracePacket packet_copy;
+      for (const Slice& slice : packet.slices())
+        packet_copy.AddSlice(slice.start, slice.size);
+      copy.push_back(std::move(packet_copy));
+    }
+    state.ResumeTiming();
+
+    compress(&copy);
+
+    compressed_size = 0;
+    for (const TracePacket& packet : copy)
+      compressed_size += packet.size();
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetBytesProcessed(
+      static_cast<int64_t>(state.iterations() * uncompressed_size));
+  state.counters["ratio"] = benchmark::Counter(
+      static_cast<double>(uncompressed_size) /
+      static_cast<double>(compressed_size ? compressed_size : 1));
+  state.SetLabel(kTestTraces[state.range(0)]);
+}
+
+void TraceArgs(benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < base::ArraySize(kTestTraces); i++)
+    b->Arg(static_cast<int64_t>(i));
+}
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+void ZstdLevelArgs(benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < base::ArraySize(kTestTraces); i++) {
+    for (int level : {1, 3, 9, 19})
+      b->Args({static_cast<int64_t>(i), level});
+  }
+}
+#endif
+
+}  // namespace
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+static void BM_CompressDeflate(benchmark::State& state) {
+  RunCompressBenchmark(state, [](std::vector<TracePacket>* packets) {
+    ZlibCompressFn(packets);
+  });
+}
+BENCHMARK(BM_CompressDeflate)->Apply(TraceArgs);
+#endif
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+static void BM_CompressZstd(benchmark::State& state) {
+  int level = static_cast<int>(state.range(1));
+  RunCompressBenchmark(state, [level](std::vector<TracePacket>* packets) {
+    ZstdCompressFn(packets, level);
+  });
+}
+BENCHMARK(BM_CompressZstd)->Apply(ZstdLevelArgs);
+#endif
+
+}  // namespace perfetto
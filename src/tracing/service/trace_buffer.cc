@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/trace_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace perfetto {
+
+namespace {
+
+// Below this, starting a thread costs about as much as the copy it offloads.
+constexpr size_t kMinParallelCloneBytes = 1024 * 1024;
+
+// Cloning is bound by the memory bandwidth, which a few threads saturate.
+constexpr size_t kMaxCloneThreads = 4;
+
+}  // namespace
+
+// For the virtual base class.
+TraceBuffer::~TraceBuffer() = default;
+
+// static
+std::vector<std::unique_ptr<TraceBuffer>> TraceBuffer::CloneAllReadOnly(
+    const std::vector<const TraceBuffer*>& bufs) {
+  std::vector<std::unique_ptr<TraceBuffer>> clones(bufs.size());
+
+  // The largest buffers are cloned first, so that the threads finish at
+  // about the same time.
+  std::vector<size_t> order(bufs.size());
+  size_t num_large_bufs = 0;
+  for (size_t i = 0; i < bufs.size(); i++) {
+    order[i] = i;
+    if (bufs[i]->used_size() >= kMinParallelCloneBytes)
+      num_large_bufs++;
+  }
+  std::stable_sort(order.begin(), order.end(), [&bufs](size_t a, size_t b) {
+    return bufs[a]->used_size() > bufs[b]->used_size();
+  });
+
+  std::atomic<size_t> next{0};
+  auto clone_pending = [&bufs, &clones, &order, &next] {
+    for (;;) {
+      size_t i = next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= order.size())
+        return;
+      clones[order[i]] = bufs[order[i]]->CloneReadOnly();
+    }
+  };
+
+  size_t num_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+  size_t num_threads = std::min({num_large_bufs, kMaxCloneThreads, num_cpus});
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; t++)
+    threads.emplace_back(clone_pending);
+  clone_pending();  // The calling thread takes its share too.
+  for (std::thread& thread : threads)
+    thread.join();
+  return clones;
+}
+
+}  // namespace perfetto
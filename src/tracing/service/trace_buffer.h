@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <array>
 #include <memory>
+#include <vector>
 
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
@@ -113,6 +114,14 @@ class TraceBuffer {
   // new buffer will be reset, as if no Read() had been called.
   virtual std::unique_ptr<TraceBuffer> CloneReadOnly() const = 0;
 
+  // Calls CloneReadOnly() on each of |bufs|, copying the larger ones
+  // concurrently on a few short-lived threads, so that cloning N buffers takes
+  // about as long as cloning the largest one. Blocks until all the clones are
+  // done: |bufs| must not be written in the meantime. The returned vector is
+  // parallel to |bufs|, with nullptr entries for the clones that failed.
+  static std::vector<std::unique_ptr<TraceBuffer>> CloneAllReadOnly(
+      const std::vector<const TraceBuffer*>& bufs);
+
   virtual void set_read_only() = 0;
   virtual const TraceStats::BufferStats& stats() const = 0;
   virtual const WriterStats& writer_stats() const = 0;
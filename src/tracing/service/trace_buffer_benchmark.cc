@@ -14,14 +14,17 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
 #include <memory>
 #include <random>
+#include <type_traits>
 #include <vector>
 
 #include "perfetto/base/time.h"
 #include "perfetto/ext/tracing/core/client_identity.h"
 #include "perfetto/ext/tracing/core/shared_memory_abi.h"
 #include "perfetto/ext/tracing/core/trace_packet.h"
+#include "perfetto/protozero/proto_utils.h"
 #include "src/tracing/service/trace_buffer.h"
 #include "src/tracing/service/trace_buffer_v1.h"
 #include "src/tracing/service/trace_buffer_v2.h"
@@ -88,6 +91,41 @@ std::vector<ChunkTemplate> GenerateChunkTemplates(size_t num_templates) {
   return templates;
 }
 
+// Generate chunk templates laid out as TraceWriter does: each fragment has a
+// kPacketHeaderSize redundant varint header, and payloads are between
+// |min_payload| and |max_payload| bytes.
+std::vector<ChunkTemplate> GenerateTraceWriterChunkTemplates(
+    size_t num_templates,
+    size_t min_payload,
+    size_t max_payload) {
+  constexpr size_t kHdrSize = SharedMemoryABI::kPacketHeaderSize;
+  const size_t max_chunk_payload = kChunkSize - 16;  // Minus chunk header
+  std::vector<ChunkTemplate> templates;
+  templates.reserve(num_templates);
+  std::minstd_rand rnd(42);
+
+  for (size_t i = 0; i < num_templates; ++i) {
+    ChunkTemplate tmpl;
+    tmpl.flags = 0;
+    tmpl.num_fragments = 0;
+    while (tmpl.data.size() + kHdrSize + min_payload <= max_chunk_payload) {
+      size_t payload_size =
+          min_payload + (rnd() % (max_payload - min_payload + 1));
+      payload_size = std::min(payload_size,
+                              max_chunk_payload - tmpl.data.size() - kHdrSize);
+      size_t off = tmpl.data.size();
+      tmpl.data.resize(off + kHdrSize + payload_size,
+                       static_cast<uint8_t>('a' + (i % 26)));
+      protozero::proto_utils::WriteRedundantVarInt(
+          static_cast<uint32_t>(payload_size), &tmpl.data[off]);
+      tmpl.num_fragments++;
+    }
+    templates.push_back(std::move(tmpl));
+  }
+
+  return templates;
+}
+
 // Benchmark 1a: Write performance - Single writer
 template <typename BufferType>
 static void BM_TraceBuffer_WR_SingleWriter(benchmark::State& state) {
@@ -166,6 +204,57 @@ static void BM_TraceBuffer_WR_MultipleWriters(benchmark::State& state) {
   state.SetBytesProcessed(static_cast<int64_t>(total_bytes_written));
 }
 
+// Benchmark 1c: Write performance - TraceWriter-like chunks, with a mix of
+// small (16-128 bytes, scanning the fragment headers dominates) or large
+// (1-4 KB, copying dominates) packets. Reports MB/s in bytes_per_second.
+// For V2, |kFastHeaders| = false decodes the fragment headers with the generic
+// ParseVarInt() path, for comparison.
+template <typename BufferType, bool kFastHeaders = true>
+static void BM_TraceBuffer_WR_Mix(benchmark::State& state) {
+  constexpr size_t kBufferSize = 64 * 1024 * 1024;
+  if constexpr (std::is_same_v<BufferType, TraceBufferV2>) {
+    TraceBufferV2::SetFastFragmentHeadersForTesting(kFastHeaders);
+  }
+  const bool small = state.range(0) == 0;
+  auto chunk_templates =
+      small ? GenerateTraceWriterChunkTemplates(100, 16, 128)
+            : GenerateTraceWriterChunkTemplates(100, 1024, 4096);
+
+  auto buffer = BufferType::Create(kBufferSize);
+  PERFETTO_CHECK(buffer);
+  ClientIdentity client_identity(1000, 100);
+  ChunkID chunk_id = 0;
+  size_t template_idx = 0;
+  size_t total_bytes_written = 0;
+  size_t total_fragments = 0;
+
+  for (auto _ : state) {
+    size_t bytes_written = 0;
+    while (bytes_written < kBufferSize) {
+      const auto& tmpl = chunk_templates[template_idx % chunk_templates.size()];
+      ++template_idx;
+      buffer->CopyChunkUntrusted(ProducerID(1), client_identity, WriterID(1),
+                                 chunk_id++, tmpl.num_fragments, tmpl.flags,
+                                 /*chunk_complete=*/true, tmpl.data.data(),
+                                 tmpl.data.size());
+      bytes_written += tmpl.data.size();
+      total_fragments += tmpl.num_fragments;
+    }
+    total_bytes_written += bytes_written;
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(total_bytes_written));
+  state.SetItemsProcessed(static_cast<int64_t>(total_fragments));
+  if constexpr (std::is_same_v<BufferType, TraceBufferV2>) {
+    TraceBufferV2::SetFastFragmentHeadersForTesting(true);
+  }
+}
+
+static void MixArgs(benchmark::internal::Benchmark* b) {
+  BmArgs(b);
+  b->ArgNames({"large"})->Arg(0)->Arg(1);
+}
+
 // Benchmark 2: Read performance with mixed standalone and fragmented packets
 template <typename BufferType>
 static void BM_TraceBuffer_RD(benchmark::State& state) {
@@ -230,6 +319,74 @@ static void BM_TraceBuffer_RD(benchmark::State& state) {
   state.SetBytesProcessed(static_cast<int64_t>(total_bytes_read));
 }
 
+// Fills |buffer| with chunks up to (about) its size.
+void FillBuffer(TraceBuffer* buffer,
+                const std::vector<ChunkTemplate>& chunk_templates) {
+  ClientIdentity client_identity(1000, 100);
+  ChunkID chunk_id = 0;
+  for (size_t bytes_written = 0; bytes_written < buffer->size() - kChunkSize;
+       bytes_written += kChunkSize) {
+    const auto& tmpl = chunk_templates[chunk_id % chunk_templates.size()];
+    buffer->CopyChunkUntrusted(ProducerID(1), client_identity, WriterID(1),
+                               chunk_id++, tmpl.num_fragments, tmpl.flags,
+                               /*chunk_complete=*/true, tmpl.data.data(),
+                               tmpl.data.size());
+  }
+}
+
+static void CloneArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Iterations(1)->Args({1, 1})->Args({1, 4});
+    return;
+  }
+  // {buffer size in MB, number of buffers}.
+  for (int64_t size_mb : {1, 16, 64, 256})
+    b->Args({size_mb, 1});
+  for (int64_t size_mb : {16, 64, 256})
+    b->Args({size_mb, 4});
+}
+
+// Benchmark 3: Clone time of full buffers, as done by CloneSession.
+// * Sequential: one CloneReadOnly() after the other.
+// * Parallel: TraceBuffer::CloneAllReadOnly(), which copies the buffers
+//   concurrently.
+template <typename BufferType, bool kParallel>
+static void BM_TraceBuffer_Clone(benchmark::State& state) {
+  const size_t buffer_size = static_cast<size_t>(state.range(0)) * 1024 * 1024;
+  const size_t num_buffers = static_cast<size_t>(state.range(1));
+  auto chunk_templates = GenerateChunkTemplates(100);
+
+  std::vector<std::unique_ptr<BufferType>> buffers;
+  std::vector<const TraceBuffer*> srcs;
+  for (size_t i = 0; i < num_buffers; i++) {
+    buffers.push_back(BufferType::Create(buffer_size));
+    PERFETTO_CHECK(buffers.back());
+    FillBuffer(buffers.back().get(), chunk_templates);
+    srcs.push_back(buffers.back().get());
+  }
+
+  size_t total_bytes_cloned = 0;
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<TraceBuffer>> clones;
+    if (kParallel) {
+      clones = TraceBuffer::CloneAllReadOnly(srcs);
+    } else {
+      for (const TraceBuffer* src : srcs)
+        clones.push_back(src->CloneReadOnly());
+    }
+    for (const auto& clone : clones) {
+      PERFETTO_CHECK(clone);
+      total_bytes_cloned += clone->used_size();
+    }
+    // Unmapping the clones is not part of the clone time.
+    state.PauseTiming();
+    clones.clear();
+    state.ResumeTiming();
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(total_bytes_cloned));
+}
+
 // Instantiate benchmarks for both V1 and V2
 
 // Write benchmarks - Single writer
@@ -244,9 +401,27 @@ BENCHMARK_TEMPLATE(BM_TraceBuffer_WR_MultipleWriters, TraceBufferV1)
 BENCHMARK_TEMPLATE(BM_TraceBuffer_WR_MultipleWriters, TraceBufferV2)
     ->Apply(BmArgs);
 
+// Write benchmarks - TraceWriter-like chunks, small and large packets
+BENCHMARK_TEMPLATE(BM_TraceBuffer_WR_Mix, TraceBufferV1)->Apply(MixArgs);
+BENCHMARK_TEMPLATE(BM_TraceBuffer_WR_Mix, TraceBufferV2, true)
+    ->Apply(MixArgs);
+BENCHMARK_TEMPLATE(BM_TraceBuffer_WR_Mix, TraceBufferV2, false)
+    ->Apply(MixArgs);
+
 // Read benchmarks
 BENCHMARK_TEMPLATE(BM_TraceBuffer_RD, TraceBufferV1)->Apply(BmArgs);
 BENCHMARK_TEMPLATE(BM_TraceBuffer_RD, TraceBufferV2)->Apply(BmArgs);
 
+// Clone benchmarks
+BENCHMARK_TEMPLATE(BM_TraceBuffer_Clone, TraceBufferV1, false)
+    ->Apply(CloneArgs)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TraceBuffer_Clone, TraceBufferV2, false)
+    ->Apply(CloneArgs)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TraceBuffer_Clone, TraceBufferV2, true)
+    ->Apply(CloneArgs)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace perfetto
@@ -951,7 +951,4 @@ TraceBufferV1::TraceBufferV1(CloneCtor, const TraceBufferV1& src)
   read_iter_ = SequenceIterator();
 }
 
-// For the virtual base class.
-TraceBuffer::~TraceBuffer() = default;
-
 }  // namespace perfetto
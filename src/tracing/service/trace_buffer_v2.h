@@ -524,6 +524,10 @@ class TraceBufferV2 : public TraceBuffer {
 
   void DumpForTesting();
 
+  // Disables the single-load decoding of fragment headers, making all of them
+  // go through ParseVarInt(). Used by benchmarks to compare the two paths.
+  static void SetFastFragmentHeadersForTesting(bool enabled);
+
  private:
   using Frag = internal::Frag;
   using SequenceState = internal::SequenceState;
@@ -404,6 +404,28 @@ TEST_F(TraceBufferV2Test, ReadWrite_EmptyPacket) {
   EXPECT_EQ(0u, trace_buffer()->stats().abi_violations());
 }
 
+// TraceWriter writes the fragment headers as redundant varints of
+// kPacketHeaderSize bytes. Check that those and the shorter encodings are
+// parsed the same.
+TEST_F(TraceBufferV2Test, ReadWrite_RedundantVarintHeaders) {
+  ResetBuffer(4096);
+  CreateChunk(ProducerID(1), WriterID(1), ChunkID(0))
+      .AddPacket({0x83, 0x80, 0x80, 0x00, 'a', 'b', 'c'})
+      .AddPacket({0x81, 0x80, 0x00, 'd'})
+      .AddPacket({0x82, 0x00, 'e', 'f'})
+      .AddPacket({0x01, 'g'})
+      .CopyIntoTraceBuffer();
+
+  trace_buffer()->BeginRead();
+  ASSERT_THAT(ReadPacket(), ElementsAre(FakePacketFragment("abc", 3)));
+  ASSERT_THAT(ReadPacket(), ElementsAre(FakePacketFragment("d", 1)));
+  ASSERT_THAT(ReadPacket(), ElementsAre(FakePacketFragment("ef", 2)));
+  ASSERT_THAT(ReadPacket(), ElementsAre(FakePacketFragment("g", 1)));
+  ASSERT_THAT(ReadPacket(), IsEmpty());
+
+  EXPECT_EQ(0u, trace_buffer()->stats().abi_violations());
+}
+
 // --------------------------------------
 // Fragments stitching and skipping logic
 // --------------------------------------
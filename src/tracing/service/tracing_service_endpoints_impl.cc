@@ -483,6 +483,9 @@ void ProducerEndpointImpl::CommitData(const CommitDataRequest& req_untrusted,
     return;
   }
   PERFETTO_DCHECK(shmem_abi_.is_valid());
+  // Number of chunks moved into each target buffer, for the CommitStats.
+  // Requests typically target one or two buffers.
+  std::vector<std::pair<BufferID, uint32_t>> chunks_per_buffer;
   for (const auto& entry : req_untrusted.chunks_to_move()) {
     const uint32_t page_idx = entry.page();
     if (page_idx >= shmem_abi_.num_pages())
@@ -532,12 +535,19 @@ void ProducerEndpointImpl::CommitData(const CommitDataRequest& req_untrusted,
         chunk_flags, chunk_complete, chunk.payload_begin(),
         chunk.payload_size());
 
+    if (chunks_per_buffer.empty() ||
+        chunks_per_buffer.back().first != buffer_id) {
+      chunks_per_buffer.emplace_back(buffer_id, 0);
+    }
+    chunks_per_buffer.back().second++;
+
     if (!commit_data_over_ipc) {
       // This one has release-store semantics.
       shmem_abi_.ReleaseChunkAsFree(std::move(chunk));
     }
   }  // for(chunks_to_move)
 
+  service_->RecordCommitDataRequest(chunks_per_buffer);
   service_->ApplyChunkPatches(id_, req_untrusted.chunks_to_patch());
 
   if (req_untrusted.flush_request_id()) {
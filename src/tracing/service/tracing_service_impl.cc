@@ -106,6 +106,7 @@
 #include "src/protozero/filtering/message_filter_config.h"
 #include "src/protozero/filtering/string_filter.h"
 #include "src/tracing/core/shared_memory_arbiter_impl.h"
+#include "src/tracing/service/async_file_writer.h"
 #include "src/tracing/service/clock.h"
 #include "src/tracing/service/dependencies.h"
 #include "src/tracing/service/packet_stream_validator.h"
@@ -1142,6 +1143,11 @@ base::Status TracingServiceImpl::EnableTracing(ConsumerEndpointImpl* consumer,
     tracing_session->bytes_written_into_file = 0;
     tracing_session->fflush_post_write =
         cfg.fflush_post_write() == TraceConfig::FFLUSH_ENABLED;
+    if (cfg.file_write_queue_size_kb() > 0) {
+      tracing_session->file_writer = std::make_unique<AsyncFileWriter>(
+          *tracing_session->write_into_file,
+          static_cast<size_t>(cfg.file_write_queue_size_kb()) * 1024);
+    }
   }
 
   if (cfg.compression_type() == TraceConfig::COMPRESSION_TYPE_DEFLATE) {
@@ -1152,6 +1158,14 @@ base::Status TracingServiceImpl::EnableTracing(ConsumerEndpointImpl* consumer,
           "COMPRESSION_TYPE_DEFLATE is not supported in the current build "
           "configuration. Skipping compression");
     }
+  } else if (cfg.compression_type() == TraceConfig::COMPRESSION_TYPE_ZSTD) {
+    if (init_opts_.zstd_compressor_fn) {
+      tracing_session->compress_zstd = true;
+    } else {
+      PERFETTO_LOG(
+          "COMPRESSION_TYPE_ZSTD is not supported in the current build "
+          "configuration. Skipping compression");
+    }
   }
 
   // Initialize the log buffers.
@@ -1453,6 +1467,7 @@ void TracingServiceImpl::StartTracing(TracingSessionID tsid) {
   }
 
   tracing_session->state = TracingSession::STARTED;
+  tracing_session->started_at_ms = clock_->GetWallTimeMs().count();
 
   // We store the start of trace snapshot separately as it's important to make
   // sure we can interpret all the data in the trace and storing it in the ring
@@ -2558,7 +2573,17 @@ bool TracingServiceImpl::ReadBuffersIntoFile(
         // returning, to support the disable_immediately=true code paths.
         bool has_more = true;
         bool stop_writing_into_file = false;
+        AsyncFileWriter* file_writer = tracing_session->file_writer.get();
         do {
+          // If the I/O thread can't keep up, leave the data in the trace
+          // buffers and retry on the next period. The final pass (period 0)
+          // instead must read everything, see above.
+          if (file_writer && file_writer->queue_full() &&
+              tracing_session->write_period_ms != 0) {
+            tracing_session->file_write_queue_full_events++;
+            break;
+          }
+
           std::vector<TracePacket> packets =
               ReadBuffers(tracing_session, kWriteIntoFileChunkSize, &has_more);
 
@@ -2568,6 +2593,13 @@ bool TracingServiceImpl::ReadBuffersIntoFile(
 
         if (stop_writing_into_file || tracing_session->write_period_ms == 0) {
           // Ensure all data was written to the file before we close it.
+          if (file_writer) {
+            file_writer->Drain();
+            tracing_session->writev_calls += file_writer->write_calls();
+            tracing_session->file_write_max_queued_bytes =
+                file_writer->max_queued_bytes();
+            tracing_session->file_writer.reset();
+          }
           base::FlushFile(tracing_session->write_into_file.get());
           tracing_session->write_into_file.reset();
           tracing_session->write_period_ms = 0;
@@ -2578,7 +2610,11 @@ bool TracingServiceImpl::ReadBuffersIntoFile(
 
         if (tracing_session->fflush_post_write) {
           // Ensure all data was written to the file.
-          base::FlushFile(tracing_session->write_into_file.get());
+          if (file_writer) {
+            file_writer->Sync();
+          } else {
+            base::FlushFile(tracing_session->write_into_file.get());
+          }
         }
 
         weak_runner_.PostDelayedTask(
@@ -2892,11 +2928,12 @@ void TracingServiceImpl::MaybeFilterPackets(TracingSession* tracing_session,
 void TracingServiceImpl::MaybeCompressPackets(
     TracingSession* tracing_session,
     std::vector<TracePacket>* packets) {
-  if (!tracing_session->compress_deflate) {
-    return;
+  if (tracing_session->compress_deflate) {
+    init_opts_.compressor_fn(packets);
+  } else if (tracing_session->compress_zstd) {
+    init_opts_.zstd_compressor_fn(packets,
+                                  tracing_session->config.compression_level());
   }
-
-  init_opts_.compressor_fn(packets);
 }
 
 bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
@@ -2920,12 +2957,17 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
   size_t num_iovecs = 0;
   bool stop_writing_into_file = false;
   std::unique_ptr<struct iovec[]> iovecs(new struct iovec[max_iovecs]);
+  // Whether each iovec points straight into the trace buffers (i.e. the slice
+  // doesn't own its memory) or into memory allocated by the service. Only
+  // used for the stats.
+  std::unique_ptr<bool[]> iovec_is_zero_copy(new bool[max_iovecs]);
   size_t num_iovecs_at_last_packet = 0;
   uint64_t bytes_about_to_be_written = 0;
   for (TracePacket& packet : packets) {
     std::tie(iovecs[num_iovecs].iov_base, iovecs[num_iovecs].iov_len) =
         packet.GetProtoPreamble();
     bytes_about_to_be_written += iovecs[num_iovecs].iov_len;
+    iovec_is_zero_copy[num_iovecs] = false;
     num_iovecs++;
     for (const Slice& slice : packet.slices()) {
       // writev() doesn't change the passed pointer. However, struct iovec
@@ -2933,6 +2975,7 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
       // Hence the const_cast here.
       char* start = static_cast<char*>(const_cast<void*>(slice.start));
       bytes_about_to_be_written += slice.size;
+      iovec_is_zero_copy[num_iovecs] = !slice.has_own_data();
       iovecs[num_iovecs++] = {start, slice.size};
     }
 
@@ -2946,24 +2989,63 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
     num_iovecs_at_last_packet = num_iovecs;
   }
   PERFETTO_DCHECK(num_iovecs <= max_iovecs);
+
+  if (tracing_session->file_writer) {
+    // The slices point into the trace buffers, which can be overwritten as
+    // soon as we return. Copy them into a single buffer for the I/O thread.
+    std::vector<uint8_t> data;
+    data.reserve(static_cast<size_t>(bytes_about_to_be_written));
+    for (size_t i = 0; i < num_iovecs; i++) {
+      const uint8_t* start = static_cast<const uint8_t*>(iovecs[i].iov_base);
+      data.insert(data.end(), start, start + iovecs[i].iov_len);
+    }
+    tracing_session->bytes_written_into_file += data.size();
+    tracing_session->bytes_written_copied += data.size();
+    tracing_session->file_writer->Write(std::move(data));
+    return stop_writing_into_file || tracing_session->file_writer->has_error();
+  }
+
   int fd = *tracing_session->write_into_file;
 
   uint64_t total_wr_size = 0;
+  uint64_t zero_copy_wr_size = 0;
 
-  // writev() can take at most IOV_MAX entries per call. Batch them.
+  // writev() can take at most IOV_MAX entries per call. Batch them. writev()
+  // can also return after a partial write (e.g., if the fd is a pipe or a
+  // socket). In that case resume from the first byte that wasn't written,
+  // rather than silently dropping the tail of the batch.
   constexpr size_t kIOVMax = IOV_MAX;
-  for (size_t i = 0; i < num_iovecs; i += kIOVMax) {
+  size_t i = 0;
+  while (i < num_iovecs) {
     int iov_batch_size = static_cast<int>(std::min(num_iovecs - i, kIOVMax));
     ssize_t wr_size = PERFETTO_EINTR(writev(fd, &iovecs[i], iov_batch_size));
+    tracing_session->writev_calls++;
     if (wr_size <= 0) {
       PERFETTO_PLOG("writev() failed");
       stop_writing_into_file = true;
       break;
     }
     total_wr_size += static_cast<size_t>(wr_size);
+
+    // Skip the iovecs that were fully written and trim the partially written
+    // one, if any.
+    size_t left = static_cast<size_t>(wr_size);
+    while (i < num_iovecs && (left > 0 || iovecs[i].iov_len == 0)) {
+      struct iovec& iov = iovecs[i];
+      size_t consumed = std::min(left, iov.iov_len);
+      if (iovec_is_zero_copy[i])
+        zero_copy_wr_size += consumed;
+      left -= consumed;
+      iov.iov_base = static_cast<char*>(iov.iov_base) + consumed;
+      iov.iov_len -= consumed;
+      if (iov.iov_len == 0)
+        i++;
+    }
   }
 
   tracing_session->bytes_written_into_file += total_wr_size;
+  tracing_session->bytes_written_zero_copy += zero_copy_wr_size;
+  tracing_session->bytes_written_copied += total_wr_size - zero_copy_wr_size;
 
   PERFETTO_DLOG("Draining into file, written: %" PRIu64 " KB, stop: %d",
                 (total_wr_size + 1023) / 1024, stop_writing_into_file);
@@ -3534,6 +3616,29 @@ void TracingServiceImpl::CopyProducerPageIntoLogBuffer(
                           chunk_complete, src, size);
 }
 
+void TracingServiceImpl::RecordCommitDataRequest(
+    const std::vector<std::pair<BufferID, uint32_t>>& chunks_per_buffer) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  if (chunks_per_buffer.empty())
+    return;
+
+  // There are only a handful of sessions and buffers per session, a linear
+  // scan is cheaper than maintaining a buffer -> session map.
+  for (auto& id_and_session : tracing_sessions_) {
+    TracingSession& session = id_and_session.second;
+    uint64_t chunks = 0;
+    for (const auto& buf_and_chunks : chunks_per_buffer) {
+      const auto& idx = session.buffers_index;
+      if (std::find(idx.begin(), idx.end(), buf_and_chunks.first) != idx.end())
+        chunks += buf_and_chunks.second;
+    }
+    if (chunks == 0)
+      continue;
+    session.commit_data_requests++;
+    session.chunks_committed += chunks;
+  }
+}
+
 void TracingServiceImpl::ApplyChunkPatches(
     ProducerID producer_id_trusted,
     const std::vector<CommitDataRequest::ChunkToPatch>& chunks_to_patch) {
@@ -3952,6 +4057,35 @@ TraceStats TracingServiceImpl::GetTraceStats(TracingSession* tracing_session) {
   trace_stats.set_flushes_failed(tracing_session->flushes_failed);
   trace_stats.set_final_flush_outcome(tracing_session->final_flush_outcome);
 
+  if (tracing_session->config.write_into_file()) {
+    auto* wr_stats = trace_stats.mutable_write_into_file_stats();
+    wr_stats->set_bytes_zero_copy(tracing_session->bytes_written_zero_copy);
+    wr_stats->set_bytes_copied(tracing_session->bytes_written_copied);
+    uint64_t writev_calls = tracing_session->writev_calls;
+    uint64_t max_queued_bytes = tracing_session->file_write_max_queued_bytes;
+    if (const AsyncFileWriter* writer = tracing_session->file_writer.get()) {
+      writev_calls += writer->write_calls();
+      max_queued_bytes = writer->max_queued_bytes();
+    }
+    wr_stats->set_writev_calls(writev_calls);
+    if (tracing_session->config.file_write_queue_size_kb() > 0) {
+      wr_stats->set_queue_full_events(
+          tracing_session->file_write_queue_full_events);
+      wr_stats->set_max_queued_bytes(max_queued_bytes);
+    }
+  }
+
+  if (tracing_session->commit_data_requests) {
+    auto* commit_stats = trace_stats.mutable_commit_stats();
+    commit_stats->set_commit_data_requests(
+        tracing_session->commit_data_requests);
+    commit_stats->set_chunks_committed(tracing_session->chunks_committed);
+    int64_t duration_ms =
+        clock_->GetWallTimeMs().count() - tracing_session->started_at_ms;
+    commit_stats->set_duration_ms(
+        static_cast<uint64_t>(std::max<int64_t>(duration_ms, 0)));
+  }
+
   if (tracing_session->trace_filter) {
     auto* filt_stats = trace_stats.mutable_filter_stats();
     filt_stats->set_input_packets(tracing_session->filter_input_packets);
@@ -4484,6 +4618,8 @@ base::Status TracingServiceImpl::FlushAndCloneSession(
           "Failed to clone 'write_into_file' session: a file descriptor is "
           "required to copy existing file");
     }
+    if (session->file_writer)
+      session->file_writer->Drain();
     base::FlushFile(*session->write_into_file);
     base::Status status =
         base::CopyFileContents(*session->write_into_file, *args.output_file_fd);
@@ -4694,6 +4830,11 @@ bool TracingServiceImpl::DoCloneBuffers(const TracingSession& src,
 
   int64_t now = clock_->GetBootTimeNs().count();
 
+  // The buffers that are not transferred are copied at the end, all at once,
+  // as the copies of large buffers can run concurrently.
+  std::vector<size_t> copy_idxs;
+  std::vector<const TraceBuffer*> copy_srcs;
+
   for (size_t buf_idx = 0; buf_idx < src.buffers_index.size(); buf_idx++) {
     BufferID src_buf_id = src.buffers_index[buf_idx];
     if (buf_ids.count(src_buf_id) == 0)
@@ -4724,7 +4865,9 @@ bool TracingServiceImpl::DoCloneBuffers(const TracingSession& src,
         src_buf = std::move(new_buf);
       }
     } else {
-      new_buf = src_buf->CloneReadOnly();
+      copy_idxs.push_back(buf_idx);
+      copy_srcs.push_back(src_buf.get());
+      continue;
     }
     if (!new_buf.get()) {
       return false;
@@ -4732,6 +4875,18 @@ bool TracingServiceImpl::DoCloneBuffers(const TracingSession& src,
     clone_op->buffers[buf_idx] = std::move(new_buf);
     clone_op->buffer_cloned_timestamps[buf_idx] = now;
   }
+
+  // This blocks the service thread, and with it the producers' commits, until
+  // the largest of the buffers is copied, rather than until all of them are.
+  std::vector<std::unique_ptr<TraceBuffer>> copies =
+      TraceBuffer::CloneAllReadOnly(copy_srcs);
+  for (size_t i = 0; i < copies.size(); i++) {
+    if (!copies[i].get()) {
+      return false;
+    }
+    clone_op->buffers[copy_idxs[i]] = std::move(copies[i]);
+    clone_op->buffer_cloned_timestamps[copy_idxs[i]] = now;
+  }
   return true;
 }
 
@@ -4826,6 +4981,7 @@ base::Status TracingServiceImpl::FinishCloneSession(
   cloned_session->flushes_succeeded = src->flushes_succeeded;
   cloned_session->flushes_failed = src->flushes_failed;
   cloned_session->compress_deflate = src->compress_deflate;
+  cloned_session->compress_zstd = src->compress_zstd;
   if (src->trace_filter && !skip_trace_filter) {
     // Copy the trace filter, unless it's a clone-for-bugreport (b/317065412).
     cloned_session->trace_filter.reset(
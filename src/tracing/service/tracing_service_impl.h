@@ -21,6 +21,7 @@
 #include <memory>
 #include <optional>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "perfetto/base/logging.h"
@@ -104,6 +105,11 @@ class TracingServiceImpl : public TracingService {
                                      size_t size);
   void ApplyChunkPatches(ProducerID,
                          const std::vector<CommitDataRequest::ChunkToPatch>&);
+  // Accounts a CommitDataRequest in the CommitStats of the sessions owning
+  // the target buffers. |chunks_per_buffer| is the number of chunks moved
+  // into each buffer by the request.
+  void RecordCommitDataRequest(
+      const std::vector<std::pair<BufferID, uint32_t>>& chunks_per_buffer);
   void NotifyFlushDoneForProducer(ProducerID, FlushRequestID);
   void NotifyDataSourceStarted(ProducerID, DataSourceInstanceID);
   void NotifyDataSourceStopped(ProducerID, DataSourceInstanceID);
@@ -16,6 +16,7 @@
 
 #include "src/tracing/service/tracing_service_impl.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
 #include <cstdint>
@@ -113,6 +114,7 @@ using ::testing::Pointee;
 using ::testing::Property;
 using ::testing::Return;
 using ::testing::SaveArg;
+using ::testing::SizeIs;
 using testing::StrEq;
 using ::testing::StrictMock;
 using ::testing::StringMatchResultListener;
@@ -3019,6 +3021,203 @@ TEST_F(TracingServiceImplTest, WriteIntoFileFilterMultipleChunks) {
   }
   EXPECT_EQ(total_size, stats.filter_stats().output_bytes());
   EXPECT_GT(total_size, kNumTestPackets * kPayloadSize);
+
+  // The filter rewrites every packet, so nothing is written straight out of
+  // the trace buffer.
+  EXPECT_EQ(stats.write_into_file_stats().bytes_zero_copy(), 0u);
+  EXPECT_EQ(stats.write_into_file_stats().bytes_copied(), trace_raw.size());
+}
+
+TEST_F(TracingServiceImplTest, WriteIntoFileZeroCopyStats) {
+  static const size_t kNumTestPackets = 5;
+  static const size_t kPayloadSize = 500 * 1024UL;
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_file_write_period_ms(100000);  // 100s
+
+  base::TempFile tmp_file = base::TempFile::Create();
+  consumer->EnableTracing(trace_config, base::ScopedFile(dup(tmp_file.fd())));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  for (size_t i = 0; i < kNumTestPackets; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload(kPayloadSize, 'c');
+    tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+  }
+
+  writer->Flush();
+  writer.reset();
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  consumer->GetTraceStats();
+  TraceStats stats = consumer->WaitForTraceStats(true);
+
+  std::string trace_raw;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+  const auto& wr_stats = stats.write_into_file_stats();
+  EXPECT_EQ(wr_stats.bytes_zero_copy() + wr_stats.bytes_copied(),
+            trace_raw.size());
+  // The payloads come straight from the trace buffer.
+  EXPECT_GE(wr_stats.bytes_zero_copy(), kNumTestPackets * kPayloadSize);
+  EXPECT_GT(wr_stats.bytes_copied(), 0u);
+  EXPECT_GT(wr_stats.writev_calls(), 0u);
+}
+
+TEST_F(TracingServiceImplTest, CommitStats) {
+  std::unique_ptr<TracingServiceImpl> svc = CreateTracingServiceImpl();
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  consumer->EnableTracing(trace_config);
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  // No commits yet, no stats.
+  consumer->GetTraceStats();
+  EXPECT_FALSE(consumer->WaitForTraceStats(true).has_commit_stats());
+
+  // Write enough data to span several chunks.
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  for (size_t i = 0; i < 10; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload(10 * 1024, 'c');
+    tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+  }
+  writer->Flush();
+
+  consumer->GetTraceStats();
+  TraceStats stats = consumer->WaitForTraceStats(true);
+  ASSERT_TRUE(stats.has_commit_stats());
+  const auto& commit_stats = stats.commit_stats();
+  EXPECT_GT(commit_stats.commit_data_requests(), 0u);
+  EXPECT_GE(commit_stats.chunks_committed(),
+            commit_stats.commit_data_requests());
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+}
+
+// Stress test for TraceConfig.file_write_queue_size_kb. The output fd is a
+// pipe that nobody reads until the end of the test, which emulates a stalled
+// disk. CommitData and flush acks must keep being handled while periodic write
+// passes run: with synchronous writes the service thread would block forever
+// in writev() instead.
+TEST_F(TracingServiceImplTest, WriteIntoFileAsyncWithStalledFd) {
+  static const size_t kPayloadSize = 64 * 1024;
+  static const size_t kNumRounds = 20;
+  static const uint32_t kQueueSizeKb = 256;
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_file_write_period_ms(100);
+  trace_config.set_write_flush_mode(TraceConfig::WRITE_FLUSH_DISABLED);
+  trace_config.set_file_write_queue_size_kb(kQueueSizeKb);
+
+  base::Pipe pipe = base::Pipe::Create();
+  consumer->EnableTracing(trace_config, std::move(pipe.wr));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  int64_t max_latency_ns = 0;
+  for (size_t i = 0; i < kNumRounds; i++) {
+    {
+      auto tp = writer->NewTracePacket();
+      std::string payload(kPayloadSize, static_cast<char>('a' + i % 26));
+      tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+    }
+    // Measure the round trip of a consumer flush, which requires the service
+    // to handle the CommitData of the packet above and the producer's ack.
+    int64_t start_ns = base::GetWallTimeNs().count();
+    producer->ExpectFlush(writer.get());
+    auto flush_request = consumer->Flush();
+    ASSERT_TRUE(flush_request.WaitForReply());
+    max_latency_ns =
+        std::max(max_latency_ns, base::GetWallTimeNs().count() - start_ns);
+
+    // Run a periodic write pass.
+    AdvanceTimeAndRunUntilIdle(100);
+  }
+  PERFETTO_LOG("Max flush latency with a stalled output fd: %" PRId64 " us",
+               max_latency_ns / 1000);
+  // Generous bound, this is only to catch the service blocking on I/O.
+  EXPECT_LT(max_latency_ns, 5 * 1000 * 1000 * 1000LL);
+
+  consumer->GetTraceStats();
+  TraceStats stats = consumer->WaitForTraceStats(true);
+  const auto& wr_stats = stats.write_into_file_stats();
+  EXPECT_GT(wr_stats.queue_full_events(), 0u);
+  EXPECT_GE(wr_stats.max_queued_bytes(), kQueueSizeKb * 1024u);
+  EXPECT_EQ(wr_stats.bytes_zero_copy(), 0u);
+
+  // Unstall the fd. The last write pass drains the trace buffers and waits
+  // for the writer thread before closing the file.
+  std::string trace_raw;
+  std::thread reader([&pipe, &trace_raw] {
+    char buf[4096];
+    for (;;) {
+      ssize_t rsize = base::Read(*pipe.rd, buf, sizeof(buf));
+      if (rsize <= 0)
+        break;
+      trace_raw.append(buf, static_cast<size_t>(rsize));
+    }
+  });
+  writer.reset();
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+  reader.join();
+
+  protos::gen::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(trace_raw));
+  EXPECT_THAT(GetForTestingStrings(trace.packet()), SizeIs(kNumRounds));
 }
 
 // Test the logic that allows the trace config to set the shm total size and
@@ -36,6 +36,7 @@
 #include "perfetto/tracing/core/data_source_config.h"
 #include "perfetto/tracing/core/trace_config.h"
 
+#include "src/tracing/service/async_file_writer.h"
 #include "src/tracing/service/tracing_service_structs.h"
 
 namespace protozero {
@@ -161,6 +162,7 @@ struct TracingSession {
 
   // Whether we should compress TracePackets after reading them.
   bool compress_deflate = false;
+  bool compress_zstd = false;
 
   // The number of received triggers we've emitted into the trace output.
   size_t num_triggers_emitted_into_trace = 0;
@@ -173,6 +175,14 @@ struct TracingSession {
   uint64_t flushes_succeeded = 0;
   uint64_t flushes_failed = 0;
 
+  // CommitData() stats. See CommitStats in trace_stats.proto.
+  uint64_t commit_data_requests = 0;
+  uint64_t chunks_committed = 0;
+
+  // Wall time (in ms) when tracing was started, used to compute the rate of
+  // the stats above.
+  int64_t started_at_ms = 0;
+
   // Outcome of the final Flush() done by FlushAndDisableTracing().
   protos::gen::TraceStats_FinalFlushOutcome final_flush_outcome{};
 
@@ -241,6 +251,12 @@ struct TracingSession {
   base::ScopedFile write_into_file;
   uint32_t write_period_ms = 0;
 
+  // Set when TraceConfig.file_write_queue_size_kb > 0. Writes into
+  // |write_into_file| happen on the thread owned by this object. Declared
+  // after |write_into_file| so it's drained and destroyed before the file is
+  // closed.
+  std::unique_ptr<AsyncFileWriter> file_writer;
+
   // Flush strategy for the tracing session:
   // * kDisabled: default, no periodic or on-write flushing is performed.
   // * kOnWrite: Buffers are flushed every time data is written to the output
@@ -254,6 +270,14 @@ struct TracingSession {
   uint64_t max_file_size_bytes = 0;
   uint64_t bytes_written_into_file = 0;
 
+  // Breakdown of |bytes_written_into_file| and number of writev() calls. See
+  // TraceStats.WriteIntoFileStats.
+  uint64_t bytes_written_zero_copy = 0;
+  uint64_t bytes_written_copied = 0;
+  uint64_t writev_calls = 0;
+  uint64_t file_write_queue_full_events = 0;
+  uint64_t file_write_max_queued_bytes = 0;
+
   // Periodic task for snapshotting service events (e.g. clocks, sync markers
   // etc)
   base::PeriodicTask snapshot_periodic_task;
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/zstd_compressor.h"
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#error "Zstd must be enabled to compile this file."
+#endif
+
+#include <zstd.h>
+
+#include <array>
+#include <memory>
+
+#include "perfetto/protozero/proto_utils.h"
+
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+
+namespace {
+
+// Returns the tag + length preamble of a length-delimited field |id|.
+template <uint32_t id>
+Slice MakePreamble(size_t size) {
+  std::array<uint8_t, 16> buf;
+  uint8_t* ptr = buf.data();
+  constexpr uint32_t tag = protozero::proto_utils::MakeTagLengthDelimited(id);
+  ptr = protozero::proto_utils::WriteVarInt(tag, ptr);
+  ptr = protozero::proto_utils::WriteVarInt(size, ptr);
+  size_t preamble_size = static_cast<size_t>(ptr - buf.data());
+  Slice slice = Slice::Allocate(preamble_size);
+  memcpy(slice.own_data(), buf.data(), preamble_size);
+  return slice;
+}
+
+// Same as ZlibPacketCompressor, but emits a single Zstd frame.
+class ZstdPacketCompressor {
+ public:
+  explicit ZstdPacketCompressor(int level);
+  ~ZstdPacketCompressor();
+
+  void PushPacket(const TracePacket& packet);
+
+  // Can be called at most once, after which the object must be destroyed.
+  TracePacket Finish();
+
+ private:
+  // Returns true when |mode| is ZSTD_e_end and the frame is complete.
+  bool Compress(ZSTD_inBuffer* in, ZSTD_EndDirective mode);
+  void NewOutputSlice();
+  void PushCurSlice();
+
+  ZSTD_CCtx* cctx_;
+  ZSTD_outBuffer out_{};
+  size_t total_new_slices_size_ = 0;
+  std::vector<Slice> new_slices_;
+  std::unique_ptr<uint8_t[]> cur_slice_;
+};
+
+ZstdPacketCompressor::ZstdPacketCompressor(int level)
+    : cctx_(ZSTD_createCCtx()) {
+  PERFETTO_CHECK(cctx_);
+  if (level != 0) {
+    size_t res =
+        ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level);
+    PERFETTO_CHECK(!ZSTD_isError(res));
+  }
+}
+
+ZstdPacketCompressor::~ZstdPacketCompressor() {
+  ZSTD_freeCCtx(cctx_);
+}
+
+void ZstdPacketCompressor::PushPacket(const TracePacket& packet) {
+  // As for deflate, prefix each packet with a preamble so that the
+  // decompressed stream is a valid Trace proto.
+  Slice preamble = MakePreamble<protos::pbzero::Trace::kPacketFieldNumber>(
+      packet.size());
+  ZSTD_inBuffer in{preamble.start, preamble.size, 0};
+  Compress(&in, ZSTD_e_continue);
+  for (const Slice& slice : packet.slices()) {
+    in = ZSTD_inBuffer{slice.start, slice.size, 0};
+    Compress(&in, ZSTD_e_continue);
+  }
+}
+
+bool ZstdPacketCompressor::Compress(ZSTD_inBuffer* in,
+                                    ZSTD_EndDirective mode) {
+  for (;;) {
+    if (out_.pos == out_.size)
+      NewOutputSlice();
+    size_t remaining = ZSTD_compressStream2(cctx_, &out_, in, mode);
+    PERFETTO_CHECK(!ZSTD_isError(remaining));
+    if (mode == ZSTD_e_end) {
+      if (remaining == 0)
+        return true;
+    } else if (in->pos == in->size) {
+      return false;
+    }
+  }
+}
+
+TracePacket ZstdPacketCompressor::Finish() {
+  ZSTD_inBuffer in{nullptr, 0, 0};
+  Compress(&in, ZSTD_e_end);
+  PushCurSlice();
+
+  TracePacket packet;
+  packet.AddSlice(
+      MakePreamble<protos::pbzero::TracePacket::kCompressedPacketsFieldNumber>(
+          total_new_slices_size_));
+  for (auto& slice : new_slices_) {
+    packet.AddSlice(std::move(slice));
+  }
+  return packet;
+}
+
+void ZstdPacketCompressor::NewOutputSlice() {
+  PushCurSlice();
+  cur_slice_ = std::make_unique<uint8_t[]>(kZstdCompressSliceSize);
+  out_ = ZSTD_outBuffer{cur_slice_.get(), kZstdCompressSliceSize, 0};
+}
+
+void ZstdPacketCompressor::PushCurSlice() {
+  if (cur_slice_) {
+    total_new_slices_size_ += out_.pos;
+    new_slices_.push_back(
+        Slice::TakeOwnership(std::move(cur_slice_), out_.pos));
+  }
+}
+
+}  // namespace
+
+void ZstdCompressFn(std::vector<TracePacket>* packets, int level) {
+  if (packets->empty()) {
+    return;
+  }
+
+  ZstdPacketCompressor stream(level);
+
+  for (const TracePacket& packet : *packets) {
+    stream.PushPacket(packet);
+  }
+
+  TracePacket packet = stream.Finish();
+
+  packets->clear();
+  packets->push_back(std::move(packet));
+}
+
+}  // namespace perfetto
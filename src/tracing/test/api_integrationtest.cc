@@ -1386,6 +1386,55 @@ TEST_P(PerfettoApiTest, TrackEventTimestampIncrementalAccumulatedError) {
   EXPECT_LE(accumulated_timestamp, end - start);
 }
 
+TEST_P(PerfettoApiTest, TrackEventProcessInterning) {
+  perfetto::protos::gen::TrackEventConfig te_cfg;
+  te_cfg.set_enable_process_interning(true);
+  auto* tracing_session = NewTraceWithCategories({"foo"}, te_cfg);
+  tracing_session->get()->StartBlocking();
+
+  for (int i = 0; i < 2; i++) {
+    std::thread thread([] {
+      TRACE_EVENT_BEGIN("foo", "SharedEvent");
+      TRACE_EVENT_END("foo");
+    });
+    thread.join();
+  }
+  auto trace = StopSessionAndReturnParsedTrace(tracing_session);
+
+  // The event name is emitted once, on the shared sequence, and the events of
+  // both threads refer to it.
+  uint32_t shared_sequence_id = 0;
+  uint64_t shared_name_iid = 0;
+  size_t shared_name_count = 0;
+  std::unordered_set<uint64_t> scopes;
+  std::unordered_set<uint32_t> event_sequence_ids;
+  std::vector<uint64_t> event_name_iids;
+  for (const auto& packet : trace.packet()) {
+    const auto& defaults = packet.trace_packet_defaults();
+    if (defaults.has_shared_interned_data_scope())
+      scopes.insert(defaults.shared_interned_data_scope());
+    for (const auto& name : packet.interned_data().event_names()) {
+      ASSERT_EQ(name.name(), "SharedEvent");
+      EXPECT_TRUE(
+          packet.sequence_flags() &
+          perfetto::protos::pbzero::TracePacket::SEQ_SHARED_INTERNED_DATA);
+      shared_sequence_id = packet.trusted_packet_sequence_id();
+      shared_name_iid = name.iid();
+      shared_name_count++;
+    }
+    if (packet.track_event().type() ==
+        perfetto::protos::gen::TrackEvent::TYPE_SLICE_BEGIN) {
+      event_sequence_ids.insert(packet.trusted_packet_sequence_id());
+      event_name_iids.push_back(packet.track_event().name_iid());
+    }
+  }
+  EXPECT_EQ(shared_name_count, 1u);
+  EXPECT_EQ(scopes.size(), 1u);
+  EXPECT_EQ(event_sequence_ids.size(), 2u);
+  EXPECT_EQ(event_sequence_ids.count(shared_sequence_id), 0u);
+  EXPECT_THAT(event_name_iids, ElementsAre(shared_name_iid, shared_name_iid));
+}
+
 TEST_P(PerfettoApiTest, TrackEvent) {
   // Create a new trace session.
   auto* tracing_session = NewTraceWithCategories({"test"});
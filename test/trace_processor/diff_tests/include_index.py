@@ -124,6 +124,7 @@ from diff_tests.parser.track_event.tests import TrackEvent
 from diff_tests.parser.translated_args.tests import TranslatedArgs
 from diff_tests.parser.ufs.tests import Ufs
 from diff_tests.parser.zip.tests import Zip
+from diff_tests.stdlib.aggregation.group_by_tests import GroupBy
 from diff_tests.stdlib.android.cpu_cluster_tests import CpuClusters
 from diff_tests.stdlib.android.battery_tests import Battery
 from diff_tests.stdlib.android.desktop_mode_tests import DesktopMode
@@ -150,6 +151,7 @@ from diff_tests.stdlib.graphs.search_tests import GraphSearchTests
 from diff_tests.stdlib.intervals.create_intervals_tests import CreateIntervals
 from diff_tests.stdlib.intervals.intersect_tests import IntervalsIntersect
 from diff_tests.stdlib.intervals.tests import StdlibIntervals
+from diff_tests.stdlib.join.hash_join_tests import HashJoin
 from diff_tests.stdlib.linux.cpu import LinuxCpu
 from diff_tests.stdlib.linux.memory import Memory
 from diff_tests.stdlib.linux.tests import LinuxTests
@@ -323,6 +325,8 @@ def fetch_all_diff_tests(
       TreeRoundtrip,
       TreeFilter,
       TreePropagate,
+      GroupBy,
+      HashJoin,
       ExportTests,
       Frames,
       GraphSearchTests,
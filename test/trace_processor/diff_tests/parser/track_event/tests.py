@@ -160,6 +160,121 @@ class TrackEvent(TestSuite):
         "[NULL]","[NULL]","t2","[NULL]",2000,0,"cat","name2"
         """))
 
+  # Interned data shared by the sequences of a process.
+  def test_track_event_shared_interned_data(self):
+    return DiffTestBlueprint(
+        trace=TextProto(r"""
+        packet {
+          trusted_packet_sequence_id: 3
+          timestamp: 0
+          sequence_flags: 5
+          trace_packet_defaults {
+            shared_interned_data_scope: 42
+          }
+          interned_data {
+            event_categories {
+              iid: 1
+              name: "cat"
+            }
+            event_names {
+              iid: 1
+              name: "shared_name"
+            }
+          }
+        }
+        packet {
+          trusted_packet_sequence_id: 1
+          timestamp: 0
+          sequence_flags: 1
+          trace_packet_defaults {
+            shared_interned_data_scope: 42
+            track_event_defaults {
+              track_uuid: 1
+            }
+          }
+          track_descriptor {
+            uuid: 1
+            thread {
+              pid: 5
+              tid: 1
+              thread_name: "t1"
+            }
+          }
+        }
+        packet {
+          trusted_packet_sequence_id: 2
+          timestamp: 0
+          sequence_flags: 1
+          trace_packet_defaults {
+            shared_interned_data_scope: 42
+            track_event_defaults {
+              track_uuid: 2
+            }
+          }
+          track_descriptor {
+            uuid: 2
+            thread {
+              pid: 5
+              tid: 2
+              thread_name: "t2"
+            }
+          }
+        }
+        packet {
+          trusted_packet_sequence_id: 1
+          timestamp: 1000
+          sequence_flags: 2
+          track_event {
+            category_iids: 1
+            name_iid: 1
+            type: 3
+          }
+        }
+        packet {
+          trusted_packet_sequence_id: 2
+          timestamp: 2000
+          sequence_flags: 2
+          track_event {
+            category_iids: 1
+            name_iid: 1
+            type: 3
+          }
+        }
+        packet {
+          trusted_packet_sequence_id: 2
+          timestamp: 3000
+          sequence_flags: 2
+          interned_data {
+            event_names {
+              iid: 2
+              name: "local_name"
+            }
+          }
+          track_event {
+            category_iids: 1
+            name_iid: 2
+            type: 3
+          }
+        }
+        """),
+        query="""
+        SELECT
+          thread.name AS thread,
+          slice.ts,
+          slice.category,
+          slice.name
+        FROM slice
+        JOIN thread_track ON slice.track_id = thread_track.id
+        JOIN thread USING (utid)
+        ORDER BY ts ASC;
+        """,
+        out=Csv("""
+        "thread","ts","category","name"
+        "t1",1000,"cat","shared_name"
+        "t2",2000,"cat","shared_name"
+        "t2",3000,"cat","local_name"
+        """))
+
   # Typed args
   def test_track_event_typed_args_slices(self):
     return DiffTestBlueprint(
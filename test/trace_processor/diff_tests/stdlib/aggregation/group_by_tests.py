@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# Copyright (C) 2026 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from python.generators.diff_tests.testing import DataPath
+from python.generators.diff_tests.testing import Csv
+from python.generators.diff_tests.testing import DiffTestBlueprint
+from python.generators.diff_tests.testing import TestSuite
+
+
+class GroupBy(TestSuite):
+  """Tests for the native group by operator."""
+
+  def test_group_by_string_key_with_nulls(self):
+    """All the aggregates, with NULL keys and NULL values."""
+    return DiffTestBlueprint(
+        trace=DataPath('counters.json'),
+        query="""
+          INCLUDE PERFETTO MODULE std.aggregation.group_by;
+
+          CREATE PERFETTO TABLE events AS
+          SELECT 'a' AS name, 10 AS dur, 1 AS prio
+          UNION ALL SELECT 'b', 20, NULL
+          UNION ALL SELECT 'a', 30, 5
+          UNION ALL SELECT NULL, 40, 2
+          UNION ALL SELECT 'b', NULL, NULL
+          UNION ALL SELECT NULL, 60, 3;
+
+          SELECT name, cnt, total_dur, min_prio, max_prio, avg_dur
+          FROM _group_by_to_table!(
+            _group_by(
+              'events', 'name',
+              'COUNT() AS cnt',
+              'SUM(dur) AS total_dur',
+              'MIN(prio) AS min_prio',
+              'MAX(prio) AS max_prio',
+              'AVG(dur) AS avg_dur'
+            ),
+            name,
+            (cnt, total_dur, min_prio, max_prio, avg_dur)
+          )
+          ORDER BY name;
+        """,
+        out=Csv("""
+        "name","cnt","total_dur","min_prio","max_prio","avg_dur"
+        "[NULL]",2,100,2,3,50.000000
+        "a",2,40,1,5,20.000000
+        "b",2,20,"[NULL]","[NULL]",20.000000
+        """))
+
+  def test_group_by_sorted_key(self):
+    """A sorted key is grouped by finding runs of equal values."""
+    return DiffTestBlueprint(
+        trace=DataPath('counters.json'),
+        query="""
+          INCLUDE PERFETTO MODULE std.aggregation.group_by;
+
+          CREATE PERFETTO TABLE samples AS
+          SELECT 1 AS ts, 2.5 AS value
+          UNION ALL SELECT 1, 0.5
+          UNION ALL SELECT 2, 4.0
+          UNION ALL SELECT 3, 1.0
+          UNION ALL SELECT 3, 2.0;
+
+          SELECT ts, cnt, total
+          FROM _group_by_to_table!(
+            _group_by('samples', 'ts', 'COUNT() AS cnt', 'SUM(value) AS total'),
+            ts,
+            (cnt, total)
+          )
+          ORDER BY ts;
+        """,
+        out=Csv("""
+        "ts","cnt","total"
+        1,2,3.000000
+        2,1,4.000000
+        3,2,3.000000
+        """))
+
+  def test_group_by_matches_sqlite(self):
+    """Same result as SQLite's GROUP BY on an intrinsic table."""
+    return DiffTestBlueprint(
+        trace=DataPath('counters.json'),
+        query="""
+          INCLUDE PERFETTO MODULE std.aggregation.group_by;
+
+          SELECT COUNT(*) AS mismatches
+          FROM _group_by_to_table!(
+            _group_by(
+              '__intrinsic_counter', 'track_id',
+              'COUNT() AS cnt', 'SUM(value) AS total', 'MAX(ts) AS max_ts'
+            ),
+            track_id,
+            (cnt, total, max_ts)
+          ) n
+          FULL OUTER JOIN (
+            SELECT track_id, COUNT(*) AS cnt, SUM(value) AS total,
+                   MAX(ts) AS max_ts
+            FROM __intrinsic_counter
+            GROUP BY track_id
+          ) s USING (track_id)
+          WHERE n.cnt IS NOT s.cnt
+            OR n.total IS NOT s.total
+            OR n.max_ts IS NOT s.max_ts;
+        """,
+        out=Csv("""
+        "mismatches"
+        0
+        """))
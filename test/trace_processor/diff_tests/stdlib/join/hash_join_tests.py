@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Copyright (C) 2026 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from python.generators.diff_tests.testing import DataPath
+from python.generators.diff_tests.testing import Csv
+from python.generators.diff_tests.testing import DiffTestBlueprint
+from python.generators.diff_tests.testing import TestSuite
+
+
+class HashJoin(TestSuite):
+  """Tests for the native hash join operator."""
+
+  def test_hash_join_duplicates_and_nulls(self):
+    """Every pair of matching rows, NULL keys matching nothing."""
+    return DiffTestBlueprint(
+        trace=DataPath('counters.json'),
+        query="""
+          INCLUDE PERFETTO MODULE std.join.hash_join;
+
+          CREATE PERFETTO TABLE events AS
+          SELECT 1 AS ts, 'a' AS name
+          UNION ALL SELECT 2, 'b'
+          UNION ALL SELECT 3, NULL
+          UNION ALL SELECT 4, 'a'
+          UNION ALL SELECT 5, 'c';
+
+          CREATE PERFETTO TABLE categories AS
+          SELECT 'a' AS name, 10 AS category
+          UNION ALL SELECT 'b', 20
+          UNION ALL SELECT NULL, 30
+          UNION ALL SELECT 'a', 40;
+
+          SELECT ts, name, category
+          FROM _hash_join_to_table!(
+            _hash_join(
+              'events', 'name', 'categories', 'name',
+              'left.ts', 'left.name', 'right.category'
+            ),
+            (ts, name, category)
+          );
+        """,
+        out=Csv("""
+        "ts","name","category"
+        1,"a",10
+        1,"a",40
+        2,"b",20
+        4,"a",10
+        4,"a",40
+        """))
+
+  def test_hash_join_matches_sqlite(self):
+    """Same result as SQLite's JOIN of sched slices with their thread."""
+    return DiffTestBlueprint(
+        trace=DataPath('android_sched_and_ps.pb'),
+        query="""
+          INCLUDE PERFETTO MODULE std.join.hash_join;
+
+          CREATE PERFETTO TABLE native_join AS
+          SELECT *
+          FROM _hash_join_to_table!(
+            _hash_join(
+              '__intrinsic_sched_slice', 'utid', '__intrinsic_thread', 'id',
+              'left.id AS slice_id', 'left.dur', 'right.name AS thread_name'
+            ),
+            (slice_id, dur, thread_name)
+          );
+
+          CREATE PERFETTO TABLE sqlite_join AS
+          SELECT s.id AS slice_id, s.dur, t.name AS thread_name
+          FROM __intrinsic_sched_slice s
+          JOIN __intrinsic_thread t ON s.utid = t.id;
+
+          SELECT
+            (SELECT COUNT(*) FROM native_join)
+              = (SELECT COUNT(*) FROM sqlite_join)
+              AS same_count,
+            (
+              SELECT COUNT(*) FROM (
+                SELECT * FROM native_join EXCEPT SELECT * FROM sqlite_join
+              )
+            ) AS mismatches;
+        """,
+        out=Csv("""
+        "same_count","mismatches"
+        1,0
+        """))
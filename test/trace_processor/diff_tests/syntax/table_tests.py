@@ -80,6 +80,24 @@ class PerfettoTable(TestSuite):
         4,"arg_set_id","uint32",2,3
         """))
 
+  def test_perfetto_table_info_encoding(self):
+    return DiffTestBlueprint(
+        trace=TextProto(''),
+        query="""
+        CREATE PERFETTO TABLE foo AS
+        SELECT 2 AS c, 'a' AS s
+        UNION ALL
+        SELECT 0 AS c, 'b' AS s;
+
+        SELECT name, encoding, size_bytes > 0 AS has_size
+        FROM perfetto_table_info('foo');
+        """,
+        out=Csv("""
+        "name","encoding","has_size"
+        "c","none",1
+        "s","none",1
+        """))
+
   def test_perfetto_table_info_runtime_table(self):
     return DiffTestBlueprint(
         trace=TextProto(''),